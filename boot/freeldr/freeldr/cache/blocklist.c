@@ -52,36 +52,31 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
 
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PLIST_ENTRY     HashListHead;
+    PLIST_ENTRY     Entry;
+    PCACHE_BLOCK    CacheBlock;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
     //
-    // Make sure the block list has entries before I start searching it.
+    // Search the hash bucket of this block
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    HashListHead = &CacheDrive->CacheBlockHash[CACHE_BLOCK_HASH(BlockNumber)];
+    for (Entry = HashListHead->Flink; Entry != HashListHead; Entry = Entry->Flink)
     {
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashListEntry);
+
         //
-        // Search the list and find the BIOS drive number
+        // We found the block, so return it
         //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
+        if (CacheBlock->BlockNumber == BlockNumber)
         {
             //
-            // We found the block, so return it
+            // Increment the blocks access count
             //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
-
-                return CacheBlock;
-            }
+            CacheBlock->AccessCount++;
 
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
+            return CacheBlock;
         }
     }
 
@@ -129,6 +124,8 @@ PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNu
 
     // Add it to our list of blocks managed by the cache
     InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+    InsertHeadList(&CacheDrive->CacheBlockHash[CACHE_BLOCK_HASH(BlockNumber)],
+                   &CacheBlock->HashListEntry);
 
     // Update the cache data
     CacheBlockCount++;
@@ -156,12 +153,13 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashListEntry);
 
     // Free the block memory and the block structure
     FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
@@ -235,3 +233,37 @@ VOID CacheInternalOptimizeBlockList(PCACHE_DRIVE CacheDrive, PCACHE_BLOCK CacheB
         InsertHeadList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
     }
 }
+
+// Reads whole blocks straight into the caller's buffer and leaves
+// the cache alone. The reads go through DiskReadBuffer in chunks
+// as large as it allows instead of one block at a time.
+BOOLEAN CacheInternalReadBlocksDirect(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG BlockCount, PVOID Buffer)
+{
+    ULONGLONG    SectorNumber;
+    ULONG        SectorCount;
+    ULONG        MaxSectors;
+    ULONG        ReadSectors;
+
+    TRACE("CacheInternalReadBlocksDirect() BlockNumber = %d BlockCount = %d\n", BlockNumber, BlockCount);
+
+    SectorNumber = (ULONGLONG)BlockNumber * CacheDrive->BlockSize;
+    SectorCount = BlockCount * CacheDrive->BlockSize;
+    MaxSectors = (ULONG)(DiskReadBufferSize / CacheDrive->BytesPerSector);
+
+    while (SectorCount > 0)
+    {
+        ReadSectors = min(SectorCount, MaxSectors);
+
+        if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, SectorNumber, ReadSectors, DiskReadBuffer))
+        {
+            return FALSE;
+        }
+        RtlCopyMemory(Buffer, DiskReadBuffer, ReadSectors * CacheDrive->BytesPerSector);
+
+        Buffer = (PVOID)((ULONG_PTR)Buffer + (ReadSectors * CacheDrive->BytesPerSector));
+        SectorNumber += ReadSectors;
+        SectorCount -= ReadSectors;
+    }
+
+    return TRUE;
+}
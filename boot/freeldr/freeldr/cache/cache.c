@@ -38,6 +38,7 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 {
     PCACHE_BLOCK    NextCacheBlock;
     GEOMETRY    DriveGeometry;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
     // by all means lets keep it, unless it is a removable
@@ -80,6 +81,10 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Initialize the structure
     RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
     InitializeListHead(&CacheManagerDrive.CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_BLOCK_HASH_SIZE; Idx++)
+    {
+        InitializeListHead(&CacheManagerDrive.CacheBlockHash[Idx]);
+    }
     CacheManagerDrive.DriveNumber = DriveNumber;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
@@ -122,6 +127,7 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
     ULONG                EndBlock;
     ULONG                SectorOffsetInEndBlock;
     ULONG                BlockCount;
+    ULONG                RunLength;
     ULONG                Idx;
 
     TRACE("CacheReadDiskSectors() DiskNumber: 0x%x StartSector: %I64d SectorCount: %d Buffer: 0x%x\n", DiskNumber, StartSector, SectorCount, Buffer);
@@ -182,12 +188,31 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
     for (Idx=StartBlock+1; BlockCount>1; Idx++)
     {
         //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
+        // Whole blocks that aren't cached yet are read straight into the
+        // buffer, as many at once as possible. This is a bulk load (e.g. a
+        // boot driver read from start to end), so caching them would only
+        // cost a copy and evict blocks worth keeping.
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
+        CacheBlock = CacheInternalFindBlock(&CacheManagerDrive, Idx);
         if (CacheBlock == NULL)
         {
-            return FALSE;
+            RunLength = 1;
+            while ((RunLength < BlockCount - 1) &&
+                   (CacheInternalFindBlock(&CacheManagerDrive, Idx + RunLength) == NULL))
+            {
+                RunLength++;
+            }
+
+            if (!CacheInternalReadBlocksDirect(&CacheManagerDrive, Idx, RunLength, Buffer))
+            {
+                return FALSE;
+            }
+            TRACE("2 - CacheInternalReadBlocksDirect(%d, %d, 0x%x)\n", Idx, RunLength, Buffer);
+
+            Buffer = (PVOID)((ULONG_PTR)Buffer + (RunLength * CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
+            BlockCount -= RunLength;
+            Idx += RunLength - 1;
+            continue;
         }
 
         //
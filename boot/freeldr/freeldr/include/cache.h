@@ -35,6 +35,7 @@
 typedef struct
 {
     LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    HashListEntry;                // Entry in the drive's block hash bucket
 
     ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
@@ -44,6 +45,16 @@ typedef struct
 
 } CACHE_BLOCK, *PCACHE_BLOCK;
 
+///////////////////////////////////////////////////////////////////////////////////////
+//
+// Cached blocks are also kept in a hash table indexed by block number, so that
+// finding a block doesn't have to walk the whole LRU list. Consecutive blocks
+// land in consecutive buckets.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+#define CACHE_BLOCK_HASH_SIZE           256
+#define CACHE_BLOCK_HASH(BlockNumber)   ((BlockNumber) & (CACHE_BLOCK_HASH_SIZE - 1))
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached drive. It contains the BIOS drive number
@@ -57,7 +68,8 @@ typedef struct
     ULONG            BytesPerSector;
 
     ULONG            BlockSize;            // Block size (in sectors)
-    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures, most recently used first
+    LIST_ENTRY        CacheBlockHash[CACHE_BLOCK_HASH_SIZE];    // Same blocks, by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
@@ -85,6 +97,7 @@ BOOLEAN            CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive);
 VOID            CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive);                            // Checks the cache size limits to see if we can add a new block, if not calls CacheInternalFreeBlock()
 VOID            CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive);                                // Dumps the list of cached blocks to the debug output port
 VOID            CacheInternalOptimizeBlockList(PCACHE_DRIVE CacheDrive, PCACHE_BLOCK CacheBlock);    // Moves the specified block to the head of the list
+BOOLEAN            CacheInternalReadBlocksDirect(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG BlockCount, PVOID Buffer);    // Reads blocks into the caller's buffer without caching them
 
 
 BOOLEAN    CacheInitializeDrive(UCHAR DriveNumber);
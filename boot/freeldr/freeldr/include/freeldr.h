@@ -84,6 +84,7 @@
 #include <conversion.h> // More-or-less related to MM also...
 
 /* File system headers */
+#include <fs/bootpack.h>
 #include <fs/ext2.h>
 #include <fs/fat.h>
 #include <fs/ntfs.h>
@@ -0,0 +1,13 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Boot pack support
+ */
+
+#pragma once
+
+#include <bootpack.h>
+
+BOOLEAN BootPackLoad(PCSTR BootPath);
+VOID BootPackUnload(VOID);
+const DEVVTBL* BootPackLookup(ULONG DeviceId, PCSTR FileName);
@@ -0,0 +1,375 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Boot pack support: serve the kernel, HAL, boot drivers,
+ *              SYSTEM hive and NLS tables from a single compressed image
+ *              read from the boot device in one go.
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include <freeldr.h>
+
+#define Z_SOLO
+#include <zlib.h>
+
+#include <debug.h>
+
+DBG_DEFAULT_CHANNEL(FILESYSTEM);
+
+/* GLOBALS ********************************************************************/
+
+#define TAG_BOOT_PACK_FILE 'FPtB'
+#define TAG_BOOT_PACK_ZLIB 'ZPtB'
+
+typedef struct _BOOT_PACK_FILE
+{
+    PBOOT_PACK_ENTRY Entry;
+    ULONG FilePointer;
+} BOOT_PACK_FILE, *PBOOT_PACK_FILE;
+
+static PBOOT_PACK_ENTRY BootPackEntries = NULL;
+static ULONG BootPackEntryCount = 0;
+static PUCHAR BootPackData = NULL;
+static ULONG BootPackDataSize = 0;
+static ULONG BootPackDeviceId = (ULONG)-1;
+static CHAR BootPackDirectory[MAX_PATH];
+
+/* FUNCTIONS ******************************************************************/
+
+static voidpf BootPackZlibAlloc(voidpf Opaque, uInt Items, uInt Size)
+{
+    return FrLdrTempAlloc(Items * Size, TAG_BOOT_PACK_ZLIB);
+}
+
+static void BootPackZlibFree(voidpf Opaque, voidpf Address)
+{
+    FrLdrTempFree(Address, TAG_BOOT_PACK_ZLIB);
+}
+
+/*
+ * Copies a device-relative path, turning '/' into '\\', dropping leading
+ * and trailing separators and collapsing repeated ones, so that the
+ * result can be compared against the names stored in the pack.
+ */
+static BOOLEAN BootPackNormalizePath(PCHAR Buffer, SIZE_T BufferSize, PCSTR Path)
+{
+    SIZE_T Length = 0;
+    BOOLEAN Separator = TRUE;
+
+    for (; *Path; Path++)
+    {
+        CHAR c = (*Path == '/') ? '\\' : *Path;
+
+        if (c == '\\')
+        {
+            if (Separator)
+                continue;
+            Separator = TRUE;
+        }
+        else
+        {
+            Separator = FALSE;
+        }
+
+        if (Length + 1 >= BufferSize)
+            return FALSE;
+        Buffer[Length++] = c;
+    }
+
+    if (Length > 0 && Buffer[Length - 1] == '\\')
+        Length--;
+    Buffer[Length] = ANSI_NULL;
+    return TRUE;
+}
+
+static PBOOT_PACK_ENTRY BootPackFindEntry(ULONG DeviceId, PCSTR FileName)
+{
+    CHAR Path[MAX_PATH];
+    PCSTR Name;
+    SIZE_T DirectoryLength;
+    ULONG i;
+
+    if (!BootPackData || DeviceId != BootPackDeviceId)
+        return NULL;
+
+    if (!BootPackNormalizePath(Path, sizeof(Path), FileName))
+        return NULL;
+
+    /* Names in the pack are relative to the directory holding it */
+    DirectoryLength = strlen(BootPackDirectory);
+    if (_strnicmp(Path, BootPackDirectory, DirectoryLength) != 0)
+        return NULL;
+    Name = Path + DirectoryLength;
+
+    for (i = 0; i < BootPackEntryCount; i++)
+    {
+        if (_stricmp(Name, BootPackEntries[i].Name) == 0)
+            return &BootPackEntries[i];
+    }
+
+    return NULL;
+}
+
+static ARC_STATUS BootPackClose(ULONG FileId)
+{
+    PBOOT_PACK_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    FrLdrTempFree(FileHandle, TAG_BOOT_PACK_FILE);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackGetFileInformation(ULONG FileId, FILEINFORMATION* Information)
+{
+    PBOOT_PACK_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    RtlZeroMemory(Information, sizeof(FILEINFORMATION));
+    Information->EndingAddress.LowPart = FileHandle->Entry->Size;
+    Information->CurrentAddress.LowPart = FileHandle->FilePointer;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
+{
+    PBOOT_PACK_ENTRY Entry;
+    PBOOT_PACK_FILE FileHandle;
+
+    if (OpenMode != OpenReadOnly)
+        return EACCES;
+
+    Entry = BootPackFindEntry(FsGetDeviceId(*FileId), Path);
+    if (!Entry)
+        return ENOENT;
+
+    FileHandle = FrLdrTempAlloc(sizeof(BOOT_PACK_FILE), TAG_BOOT_PACK_FILE);
+    if (!FileHandle)
+        return ENOMEM;
+
+    TRACE("BootPackOpen() '%s' -> '%s', %lu bytes\n", Path, Entry->Name, Entry->Size);
+
+    FileHandle->Entry = Entry;
+    FileHandle->FilePointer = 0;
+    FsSetDeviceSpecific(*FileId, FileHandle);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
+{
+    PBOOT_PACK_FILE FileHandle = FsGetDeviceSpecific(FileId);
+    ULONG Remaining;
+
+    Remaining = FileHandle->Entry->Size - FileHandle->FilePointer;
+    if (N > Remaining)
+        N = Remaining;
+
+    RtlCopyMemory(Buffer,
+                  BootPackData + FileHandle->Entry->Offset + FileHandle->FilePointer,
+                  N);
+    FileHandle->FilePointer += N;
+    *Count = N;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BootPackSeek(ULONG FileId, LARGE_INTEGER* Position, SEEKMODE SeekMode)
+{
+    PBOOT_PACK_FILE FileHandle = FsGetDeviceSpecific(FileId);
+    LARGE_INTEGER NewPosition = *Position;
+
+    switch (SeekMode)
+    {
+        case SeekAbsolute:
+            break;
+        case SeekRelative:
+            NewPosition.QuadPart += FileHandle->FilePointer;
+            break;
+        default:
+            ASSERT(FALSE);
+            return EINVAL;
+    }
+
+    if (NewPosition.HighPart != 0)
+        return EINVAL;
+    if (NewPosition.LowPart > FileHandle->Entry->Size)
+        return EINVAL;
+
+    FileHandle->FilePointer = NewPosition.LowPart;
+    return ESUCCESS;
+}
+
+/* The service name is the one of the underlying file system, see FsGetServiceName() */
+static const DEVVTBL BootPackFuncTable =
+{
+    BootPackClose,
+    BootPackGetFileInformation,
+    BootPackOpen,
+    BootPackRead,
+    BootPackSeek,
+    NULL
+};
+
+const DEVVTBL* BootPackLookup(ULONG DeviceId, PCSTR FileName)
+{
+    return BootPackFindEntry(DeviceId, FileName) ? &BootPackFuncTable : NULL;
+}
+
+static BOOLEAN BootPackInflate(PUCHAR Source, ULONG SourceSize, PUCHAR Destination, ULONG DestinationSize)
+{
+    z_stream Stream;
+    int Result;
+
+    RtlZeroMemory(&Stream, sizeof(Stream));
+    Stream.zalloc = BootPackZlibAlloc;
+    Stream.zfree = BootPackZlibFree;
+    Stream.next_in = Source;
+    Stream.avail_in = SourceSize;
+    Stream.next_out = Destination;
+    Stream.avail_out = DestinationSize;
+
+    if (inflateInit(&Stream) != Z_OK)
+        return FALSE;
+
+    Result = inflate(&Stream, Z_FINISH);
+    inflateEnd(&Stream);
+
+    if (Result != Z_STREAM_END || Stream.total_out != DestinationSize)
+    {
+        ERR("Boot pack: inflate failed (%d), %lu of %lu bytes\n",
+            Result, Stream.total_out, DestinationSize);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOLEAN BootPackLoad(PCSTR BootPath)
+{
+    BOOT_PACK_HEADER Header;
+    CHAR FileName[MAX_PATH];
+    PCSTR DevicePath;
+    PUCHAR Buffer, Data;
+    ULONG FileId, DeviceId, Count, TableSize, i;
+    ARC_STATUS Status;
+
+    BootPackUnload();
+
+    DevicePath = strrchr(BootPath, ')');
+    if (!DevicePath)
+        return FALSE;
+    DevicePath++;
+
+    if (strlen(BootPath) + sizeof("\\" BOOT_PACK_FILE_NAME) > sizeof(FileName))
+        return FALSE;
+    strcpy(FileName, BootPath);
+    if (*FileName && FileName[strlen(FileName) - 1] != '\\')
+        strcat(FileName, "\\");
+    strcat(FileName, BOOT_PACK_FILE_NAME);
+
+    Status = ArcOpen(FileName, OpenReadOnly, &FileId);
+    if (Status != ESUCCESS)
+    {
+        TRACE("No boot pack at '%s'\n", FileName);
+        return FALSE;
+    }
+    DeviceId = FsGetDeviceId(FileId);
+
+    Status = ArcRead(FileId, &Header, sizeof(Header), &Count);
+    if (Status != ESUCCESS || Count != sizeof(Header) ||
+        Header.Signature != BOOT_PACK_SIGNATURE ||
+        Header.Version != BOOT_PACK_VERSION ||
+        Header.EntryCount == 0 ||
+        Header.EntryCount > (MAXULONG - Header.CompressedSize) / sizeof(BOOT_PACK_ENTRY))
+    {
+        ERR("Invalid boot pack '%s'\n", FileName);
+        ArcClose(FileId);
+        return FALSE;
+    }
+
+    /* Read the entry table and the compressed stream in a single request */
+    TableSize = Header.EntryCount * sizeof(BOOT_PACK_ENTRY);
+    Buffer = MmAllocateMemoryWithType(TableSize + Header.CompressedSize, LoaderFirmwareTemporary);
+    Data = MmAllocateMemoryWithType(Header.UncompressedSize, LoaderFirmwareTemporary);
+    if (!Buffer || !Data)
+    {
+        ERR("Cannot allocate memory for boot pack '%s'\n", FileName);
+        if (Buffer)
+            MmFreeMemory(Buffer);
+        if (Data)
+            MmFreeMemory(Data);
+        ArcClose(FileId);
+        return FALSE;
+    }
+
+    Status = ArcRead(FileId, Buffer, TableSize + Header.CompressedSize, &Count);
+    ArcClose(FileId);
+    if (Status != ESUCCESS || Count != TableSize + Header.CompressedSize)
+    {
+        ERR("Cannot read boot pack '%s'\n", FileName);
+        goto Failure;
+    }
+
+    if (!BootPackInflate(Buffer + TableSize, Header.CompressedSize, Data, Header.UncompressedSize))
+        goto Failure;
+
+    if ((Header.Flags & BOOT_PACK_FLAG_CRC32) &&
+        RtlComputeCrc32(0, Data, Header.UncompressedSize) != Header.Crc32)
+    {
+        ERR("Boot pack '%s' is corrupted\n", FileName);
+        goto Failure;
+    }
+
+    /* Validate the entries before anything gets served from them */
+    BootPackEntries = (PBOOT_PACK_ENTRY)Buffer;
+    for (i = 0; i < Header.EntryCount; i++)
+    {
+        PBOOT_PACK_ENTRY Entry = &BootPackEntries[i];
+
+        Entry->Name[BOOT_PACK_MAX_NAME - 1] = ANSI_NULL;
+        if (Entry->Offset > Header.UncompressedSize ||
+            Entry->Size > Header.UncompressedSize - Entry->Offset)
+        {
+            ERR("Boot pack '%s': bad entry '%s'\n", FileName, Entry->Name);
+            BootPackEntries = NULL;
+            goto Failure;
+        }
+    }
+
+    if (!BootPackNormalizePath(BootPackDirectory, sizeof(BootPackDirectory) - 1, DevicePath))
+    {
+        BootPackEntries = NULL;
+        goto Failure;
+    }
+    if (*BootPackDirectory)
+        strcat(BootPackDirectory, "\\");
+
+    BootPackEntryCount = Header.EntryCount;
+    BootPackData = Data;
+    BootPackDataSize = Header.UncompressedSize;
+    BootPackDeviceId = DeviceId;
+
+    TRACE("Boot pack '%s': %lu files, %lu -> %lu bytes\n", FileName,
+          BootPackEntryCount, Header.CompressedSize, BootPackDataSize);
+    return TRUE;
+
+Failure:
+    MmFreeMemory(Data);
+    MmFreeMemory(Buffer);
+    return FALSE;
+}
+
+VOID BootPackUnload(VOID)
+{
+    if (!BootPackData)
+        return;
+
+    MmFreeMemory(BootPackData);
+    MmFreeMemory(BootPackEntries);
+
+    BootPackEntries = NULL;
+    BootPackEntryCount = 0;
+    BootPackData = NULL;
+    BootPackDataSize = 0;
+    BootPackDeviceId = (ULONG)-1;
+    *BootPackDirectory = ANSI_NULL;
+}
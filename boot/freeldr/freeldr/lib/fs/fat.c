@@ -1103,29 +1103,57 @@ ULONG* FatGetClusterChainArray(PFAT_VOLUME_INFO Volume, ULONG StartCluster)
     return ArrayPointer;
 }
 
+/*
+ * FatReadAdjacentClusters()
+ * Reads clusters that follow each other on disk with a single read
+ */
+static BOOLEAN FatReadAdjacentClusters(PFAT_VOLUME_INFO Volume, ULONG StartClusterNumber, ULONG NumberOfClusters, PVOID Buffer)
+{
+    ULONG        ClusterStartSector;
+
+    ClusterStartSector = ((StartClusterNumber - 2) * Volume->SectorsPerCluster) + Volume->DataSectorStart;
+
+    return FatReadVolumeSectors(Volume, ClusterStartSector, NumberOfClusters * Volume->SectorsPerCluster, Buffer);
+}
+
 /*
  * FatReadClusterChain()
  * Reads the specified clusters into memory
  */
 BOOLEAN FatReadClusterChain(PFAT_VOLUME_INFO Volume, ULONG StartClusterNumber, ULONG NumberOfClusters, PVOID Buffer)
 {
-    ULONG        ClusterStartSector;
+    ULONG        ClusterCount;
+    ULONG        NextClusterNumber;
 
     TRACE("FatReadClusterChain() StartClusterNumber = %d NumberOfClusters = %d Buffer = 0x%x\n", StartClusterNumber, NumberOfClusters, Buffer);
 
     while (NumberOfClusters > 0)
     {
-
-        //TRACE("FatReadClusterChain() StartClusterNumber = %d NumberOfClusters = %d Buffer = 0x%x\n", StartClusterNumber, NumberOfClusters, Buffer);
         //
-        // Calculate starting sector for cluster
+        // Find out how many of the next clusters in the
+        // chain are also next to each other on disk
         //
-        ClusterStartSector = ((StartClusterNumber - 2) * Volume->SectorsPerCluster) + Volume->DataSectorStart;
+        ClusterCount = 1;
+        for (;;)
+        {
+            if (!FatGetFatEntry(Volume, StartClusterNumber + ClusterCount - 1, &NextClusterNumber))
+            {
+                return FALSE;
+            }
+
+            if ((ClusterCount >= NumberOfClusters) ||
+                (NextClusterNumber != StartClusterNumber + ClusterCount))
+            {
+                break;
+            }
+
+            ClusterCount++;
+        }
 
         //
-        // Read cluster into memory
+        // Read the whole run into memory
         //
-        if (!FatReadVolumeSectors(Volume, ClusterStartSector, Volume->SectorsPerCluster, Buffer))
+        if (!FatReadAdjacentClusters(Volume, StartClusterNumber, ClusterCount, Buffer))
         {
             return FALSE;
         }
@@ -1133,20 +1161,17 @@ BOOLEAN FatReadClusterChain(PFAT_VOLUME_INFO Volume, ULONG StartClusterNumber, U
         //
         // Decrement count of clusters left to read
         //
-        NumberOfClusters--;
+        NumberOfClusters -= ClusterCount;
 
         //
-        // Increment buffer address by cluster size
+        // Increment buffer address by the size of the run
         //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (Volume->SectorsPerCluster * Volume->BytesPerSector));
+        Buffer = (PVOID)((ULONG_PTR)Buffer + (ClusterCount * Volume->SectorsPerCluster * Volume->BytesPerSector));
 
         //
-        // Get next cluster
+        // Continue with the cluster following the run
         //
-        if (!FatGetFatEntry(Volume, StartClusterNumber, &StartClusterNumber))
-        {
-            return FALSE;
-        }
+        StartClusterNumber = NextClusterNumber;
 
         //
         // If end of chain then break out of our cluster reading loop
@@ -1216,6 +1241,8 @@ BOOLEAN FatReadFile(PFAT_FILE_INFO FatFileInfo, ULONG BytesToRead, ULONG* BytesR
     ULONG            OffsetInCluster;
     ULONG            LengthInCluster;
     ULONG            NumberOfClusters;
+    ULONG            ClusterIndex;
+    ULONG            ClusterCount;
     ULONG            BytesPerCluster;
 
     TRACE("FatReadFile() BytesToRead = %d Buffer = 0x%x\n", BytesToRead, Buffer);
@@ -1314,25 +1341,37 @@ BOOLEAN FatReadFile(PFAT_FILE_INFO FatFileInfo, ULONG BytesToRead, ULONG* BytesR
         //
         NumberOfClusters = (BytesToRead / BytesPerCluster);
 
-        if (NumberOfClusters > 0)
+        //
+        // We already have the cluster chain of the file, so use it to
+        // read each run of adjacent clusters with a single read
+        //
+        while (NumberOfClusters > 0)
         {
-            ClusterNumber = (FatFileInfo->FilePointer / BytesPerCluster);
-            ClusterNumber = FatFileInfo->FileFatChain[ClusterNumber];
+            ClusterIndex = (FatFileInfo->FilePointer / BytesPerCluster);
+            ClusterNumber = FatFileInfo->FileFatChain[ClusterIndex];
+
+            ClusterCount = 1;
+            while ((ClusterCount < NumberOfClusters) &&
+                   (FatFileInfo->FileFatChain[ClusterIndex + ClusterCount] == ClusterNumber + ClusterCount))
+            {
+                ClusterCount++;
+            }
 
             //
             // Now do the read and update BytesRead, BytesToRead, FilePointer, & Buffer
             //
-            if (!FatReadClusterChain(Volume, ClusterNumber, NumberOfClusters, Buffer))
+            if (!FatReadAdjacentClusters(Volume, ClusterNumber, ClusterCount, Buffer))
             {
                 return FALSE;
             }
             if (BytesRead != NULL)
             {
-                *BytesRead += (NumberOfClusters * BytesPerCluster);
+                *BytesRead += (ClusterCount * BytesPerCluster);
             }
-            BytesToRead -= (NumberOfClusters * BytesPerCluster);
-            FatFileInfo->FilePointer += (NumberOfClusters * BytesPerCluster);
-            Buffer = (PVOID)((ULONG_PTR)Buffer + (NumberOfClusters * BytesPerCluster));
+            BytesToRead -= (ClusterCount * BytesPerCluster);
+            FatFileInfo->FilePointer += (ClusterCount * BytesPerCluster);
+            Buffer = (PVOID)((ULONG_PTR)Buffer + (ClusterCount * BytesPerCluster));
+            NumberOfClusters -= ClusterCount;
         }
     }
 
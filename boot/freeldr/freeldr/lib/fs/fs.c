@@ -202,8 +202,11 @@ ARC_STATUS ArcOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
     if (*FileName == '\\')
         FileName++;
 
-    /* Open the file */
-    FileData[i].FuncTable = FileData[DeviceId].FileFuncTable;
+    /* Open the file, from the boot pack if it holds a copy of it */
+    if (OpenMode == OpenReadOnly)
+        FileData[i].FuncTable = BootPackLookup(DeviceId, FileName);
+    if (!FileData[i].FuncTable)
+        FileData[i].FuncTable = FileData[DeviceId].FileFuncTable;
     FileData[i].DeviceId = DeviceId;
     *FileId = i;
     Status = FileData[i].FuncTable->Open(FileName, OpenMode, FileId);
@@ -458,9 +461,18 @@ VOID FsRegisterDevice(CHAR* Prefix, const DEVVTBL* FuncTable)
 
 LPCWSTR FsGetServiceName(ULONG FileId)
 {
+    ULONG DeviceId;
+
     if (FileId >= MAX_FDS || !FileData[FileId].FuncTable)
         return NULL;
-    return FileData[FileId].FuncTable->ServiceName;
+    if (FileData[FileId].FuncTable->ServiceName)
+        return FileData[FileId].FuncTable->ServiceName;
+
+    /* Files served from memory (boot pack) belong to the file system of their device */
+    DeviceId = FileData[FileId].DeviceId;
+    if (DeviceId >= MAX_FDS || !FileData[DeviceId].FileFuncTable)
+        return NULL;
+    return FileData[DeviceId].FileFuncTable->ServiceName;
 }
 
 VOID FsSetDeviceSpecific(ULONG FileId, VOID* Specific)
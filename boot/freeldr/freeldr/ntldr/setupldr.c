@@ -320,6 +320,9 @@ LoadReactOSSetup(IN OperatingSystemItem* OperatingSystem,
     /* Set textmode setup flag */
     SetupBlock->Flags = SETUPLDR_TEXT_MODE;
 
+    /* Read the boot pack, if any: the files below are then served from memory */
+    BootPackLoad(BootPath);
+
     /* Load NLS data, they are in system32 */
     strcpy(FileName, BootPath);
     strcat(FileName, "system32\\");
@@ -746,6 +746,9 @@ LoadAndBootWindows(IN OperatingSystemItem* OperatingSystem,
     /* Allocate and minimalist-initialize LPB */
     AllocateAndInitLPB(&LoaderBlock);
 
+    /* Read the boot pack, if any: the files below are then served from memory */
+    BootPackLoad(BootPath);
+
     /* Load the system hive */
     UiDrawBackdrop();
     UiDrawProgressBarCenter(15, 100, "Loading system hive...");
@@ -753,14 +756,20 @@ LoadAndBootWindows(IN OperatingSystemItem* OperatingSystem,
     TRACE("SYSTEM hive %s\n", (Success ? "loaded" : "not loaded"));
     /* Bail out if failure */
     if (!Success)
+    {
+        BootPackUnload();
         return;
+    }
 
     /* Load NLS data, OEM font, and prepare boot drivers list */
     Success = WinLdrScanSystemHive(LoaderBlock, BootPath);
     TRACE("SYSTEM hive %s\n", (Success ? "scanned" : "not scanned"));
     /* Bail out if failure */
     if (!Success)
+    {
+        BootPackUnload();
         return;
+    }
 
     /* Finish loading */
     LoadAndBootWindowsCommon(OperatingSystemVersion,
@@ -807,6 +816,7 @@ LoadAndBootWindowsCommon(
                               &KernelDTE);
     if (!Success)
     {
+        BootPackUnload();
         UiMessageBox("Error loading NTOS core.");
         return;
     }
@@ -817,6 +827,9 @@ LoadAndBootWindowsCommon(
     Success = WinLdrLoadBootDrivers(LoaderBlock, BootPath);
     TRACE("Boot drivers loading %s\n", Success ? "successful" : "failed");
 
+    /* Everything that could come from the boot pack is loaded now */
+    BootPackUnload();
+
     /* Initialize Phase 1 - no drivers loading anymore */
     WinLdrInitializePhase1(LoaderBlock,
                            BootOptions,
@@ -24,6 +24,19 @@
 #define ConioRectWidth(Rect) \
     (((Rect)->Left) > ((Rect)->Right) ? 0 : ((Rect)->Right) - ((Rect)->Left) + 1)
 
+/*
+ * Size of the capture buffer kept around for WriteConsole. Writes that fit
+ * in it reuse it instead of allocating (and zeroing) a new one in the CSR
+ * port heap each time; larger writes and concurrent writers fall back to
+ * a regular capture buffer. This only saves the allocation: the text is
+ * still copied in here, and CSRSRV still copies the capture buffer to its
+ * own heap before consrv sees it (and back again on reply).
+ */
+#define WRITE_CAPTURE_BUFFER_SIZE   0x1000
+
+static PCSR_CAPTURE_BUFFER WriteCaptureBuffer = NULL;
+static LONG WriteCaptureBufferInUse = FALSE;
+
 
 /* PRIVATE FUNCTIONS **********************************************************/
 
@@ -594,6 +607,53 @@ IntReadConsoleOutputCode(IN HANDLE hConsoleOutput,
  * Write functions *
  *******************/
 
+static
+PCSR_CAPTURE_BUFFER
+IntAllocateWriteCaptureBuffer(IN ULONG SizeBytes)
+{
+    PCSR_CAPTURE_BUFFER CaptureBuffer;
+
+    if (SizeBytes > WRITE_CAPTURE_BUFFER_SIZE ||
+        InterlockedExchange(&WriteCaptureBufferInUse, TRUE))
+    {
+        return CsrAllocateCaptureBuffer(1, SizeBytes);
+    }
+
+    if (WriteCaptureBuffer == NULL)
+    {
+        WriteCaptureBuffer = CsrAllocateCaptureBuffer(1, WRITE_CAPTURE_BUFFER_SIZE);
+        if (WriteCaptureBuffer == NULL)
+        {
+            InterlockedExchange(&WriteCaptureBufferInUse, FALSE);
+            return CsrAllocateCaptureBuffer(1, SizeBytes);
+        }
+    }
+
+    /*
+     * Reset the header, CsrClientCallServer leaves it locked. CSRSRV copies
+     * Size bytes in and back out, so only announce what this write needs,
+     * computed the same way as CsrAllocateCaptureBuffer does.
+     */
+    CaptureBuffer = WriteCaptureBuffer;
+    CaptureBuffer->Size = ((FIELD_OFFSET(CSR_CAPTURE_BUFFER, PointerOffsetsArray) +
+                            sizeof(ULONG_PTR) + SizeBytes + 3) & ~3) + 3;
+    CaptureBuffer->PointerCount = 0;
+    CaptureBuffer->PointerOffsetsArray[0] = 0;
+    CaptureBuffer->BufferEnd = (PVOID)&CaptureBuffer->PointerOffsetsArray[1];
+
+    return CaptureBuffer;
+}
+
+static
+VOID
+IntFreeWriteCaptureBuffer(IN PCSR_CAPTURE_BUFFER CaptureBuffer)
+{
+    if (CaptureBuffer == WriteCaptureBuffer)
+        InterlockedExchange(&WriteCaptureBufferInUse, FALSE);
+    else
+        CsrFreeCaptureBuffer(CaptureBuffer);
+}
+
 static
 BOOL
 IntWriteConsole(IN HANDLE hConsoleOutput,
@@ -654,7 +714,7 @@ IntWriteConsole(IN HANDLE hConsoleOutput,
     else
     {
         /* Allocate a Capture Buffer */
-        CaptureBuffer = CsrAllocateCaptureBuffer(1, SizeBytes);
+        CaptureBuffer = IntAllocateWriteCaptureBuffer(SizeBytes);
         if (CaptureBuffer == NULL)
         {
             DPRINT1("CsrAllocateCaptureBuffer failed!\n");
@@ -680,7 +740,7 @@ IntWriteConsole(IN HANDLE hConsoleOutput,
     Success = NT_SUCCESS(ApiMessage.Status);
 
     /* Release the capture buffer if needed */
-    if (CaptureBuffer) CsrFreeCaptureBuffer(CaptureBuffer);
+    if (CaptureBuffer) IntFreeWriteCaptureBuffer(CaptureBuffer);
 
     /* Retrieve the results */
     if (Success)
@@ -15,6 +15,35 @@ static struct
     ULONG Handle;
 } BreakPointHandles[32];
 
+/* Recently read memory, invalidated when we write or resume */
+static struct
+{
+    ULONG_PTR Address;
+    ULONG_PTR DirectoryTableBase;
+    BOOLEAN Valid;
+    UCHAR Data[KDGDB_CACHE_LINE_SIZE];
+} MemoryCache[KDGDB_CACHE_LINES];
+static ULONG MemoryCacheNext;
+
+/* Memory read in progress */
+static struct
+{
+    ULONG_PTR Address;
+    ULONG Remaining;
+    ULONG Length;
+    BOOLEAN Binary;
+    BOOLEAN Exact;
+    UCHAR Buffer[GDB_MAX_TRANSFER];
+} MemoryRead;
+
+/* Memory write in progress */
+static struct
+{
+    ULONG_PTR Address;
+    ULONG Remaining;
+    UCHAR* Data;
+} MemoryWrite;
+
 
 /* GLOBALS ********************************************************************/
 UINT_PTR gdb_dbg_pid;
@@ -157,11 +186,13 @@ handle_gdb_query(void)
 {
     if (strncmp(gdb_input, "qSupported:", 11) == 0)
     {
+        char gdb_out[96];
 #if MONOPROCESS
-        return send_gdb_packet("PacketSize=1000;qXfer:libraries:read+;");
+        sprintf(gdb_out, "PacketSize=%x;qXfer:libraries:read+;binary-upload+;", GDB_PACKET_SIZE);
 #else
-        return send_gdb_packet("PacketSize=1000;multiprocess+;qXfer:libraries:read+;");
+        sprintf(gdb_out, "PacketSize=%x;multiprocess+;qXfer:libraries:read+;binary-upload+;", GDB_PACKET_SIZE);
 #endif
+        return send_gdb_packet(gdb_out);
     }
 
     if (strncmp(gdb_input, "qAttached", 9) == 0)
@@ -436,34 +467,9 @@ handle_gdb_registers(
 #endif
 
 static
-void
-ReadMemorySendHandler(
-    _In_ ULONG PacketType,
-    _In_ PSTRING MessageHeader,
-    _In_ PSTRING MessageData)
+VOID
+RestoreCurrentProcessTlb(void)
 {
-    DBGKD_MANIPULATE_STATE64* State = (DBGKD_MANIPULATE_STATE64*)MessageHeader->Buffer;
-
-    if (PacketType != PACKET_TYPE_KD_STATE_MANIPULATE)
-    {
-        // KdAssert
-        KDDBGPRINT("Wrong packet type (%lu) received after DbgKdReadVirtualMemoryApi request.\n", PacketType);
-        while (1);
-    }
-
-    if (State->ApiNumber != DbgKdReadVirtualMemoryApi)
-    {
-        KDDBGPRINT("Wrong API number (%lu) after DbgKdReadVirtualMemoryApi request.\n", State->ApiNumber);
-    }
-
-    /* Check status. Allow to send partial data. */
-    if (!MessageData->Length && !NT_SUCCESS(State->ReturnStatus))
-        send_gdb_ntstatus(State->ReturnStatus);
-    else
-        send_gdb_memory(MessageData->Buffer, MessageData->Length);
-    KdpSendPacketHandler = NULL;
-    KdpManipulateStateHandler = NULL;
-
 #if MONOPROCESS
     if (gdb_dbg_tid != 0)
     /* Reset the TLB */
@@ -477,23 +483,11 @@ ReadMemorySendHandler(
     }
 }
 
+/* Set the TLB according to the process being accessed. Pid 0 means any process. */
 static
-KDSTATUS
-handle_gdb_read_mem(
-    _Out_ DBGKD_MANIPULATE_STATE64* State,
-    _Out_ PSTRING MessageData,
-    _Out_ PULONG MessageLength,
-    _Inout_ PKD_CONTEXT KdContext)
+BOOLEAN
+AttachDebugProcessTlb(void)
 {
-    State->ApiNumber = DbgKdReadVirtualMemoryApi;
-    State->ReturnStatus = STATUS_SUCCESS; /* ? */
-    State->Processor = CurrentStateChange.Processor;
-    State->ProcessorLevel = CurrentStateChange.ProcessorLevel;
-    if (MessageData)
-        MessageData->Length = 0;
-    *MessageLength = 0;
-
-    /* Set the TLB according to the process being read. Pid 0 means any process. */
 #if MONOPROCESS
     if ((gdb_dbg_tid != 0) && gdb_tid_to_handle(gdb_dbg_tid) != PsGetCurrentThreadId())
     {
@@ -502,14 +496,14 @@ handle_gdb_read_mem(
         if (AttachedThread == NULL)
         {
             KDDBGPRINT("The current GDB debug thread is invalid!");
-            return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
+            return FALSE;
         }
 
         AttachedProcess = AttachedThread->Tcb.Process;
         if (AttachedProcess == NULL)
         {
             KDDBGPRINT("The current GDB debug thread is invalid!");
-            return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
+            return FALSE;
         }
         __writecr3(AttachedProcess->DirectoryTableBase[0]);
     }
@@ -520,22 +514,278 @@ handle_gdb_read_mem(
         if (AttachedProcess == NULL)
         {
             KDDBGPRINT("The current GDB debug thread is invalid!");
-            return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
+            return FALSE;
         }
         /* Only do this if Ps is initialized */
         if (ProcessListHead->Flink)
             __writecr3(AttachedProcess->Pcb.DirectoryTableBase[0]);
     }
 #endif
+    return TRUE;
+}
+
+static
+PUCHAR
+LookupMemoryCache(
+    _In_ ULONG_PTR Address)
+{
+    ULONG_PTR LineAddress = Address & ~(ULONG_PTR)(KDGDB_CACHE_LINE_SIZE - 1);
+    ULONG_PTR DirectoryTableBase = __readcr3();
+    ULONG i;
 
-    State->u.ReadMemory.TargetBaseAddress = hex_to_address(&gdb_input[1]);
-    State->u.ReadMemory.TransferCount = hex_to_address(strstr(&gdb_input[1], ",") + 1);
+    for (i = 0; i < KDGDB_CACHE_LINES; i++)
+    {
+        if (MemoryCache[i].Valid
+                && (MemoryCache[i].Address == LineAddress)
+                && (MemoryCache[i].DirectoryTableBase == DirectoryTableBase))
+        {
+            return &MemoryCache[i].Data[Address - LineAddress];
+        }
+    }
+
+    return NULL;
+}
+
+static
+VOID
+InsertMemoryCache(
+    _In_ ULONG_PTR LineAddress,
+    _In_ const VOID* Data)
+{
+    ULONG i = MemoryCacheNext++ % KDGDB_CACHE_LINES;
+
+    MemoryCache[i].Address = LineAddress;
+    MemoryCache[i].DirectoryTableBase = __readcr3();
+    RtlCopyMemory(MemoryCache[i].Data, Data, KDGDB_CACHE_LINE_SIZE);
+    MemoryCache[i].Valid = TRUE;
+}
+
+void
+gdb_invalidate_memory_cache(void)
+{
+    ULONG i;
+
+    for (i = 0; i < KDGDB_CACHE_LINES; i++)
+        MemoryCache[i].Valid = FALSE;
+}
+
+/* Answers GDB with what was read so far and goes back to the GDB loop */
+static
+KDSTATUS
+FinishMemoryRead(
+    _In_ NTSTATUS ReadStatus)
+{
+    KDSTATUS Status;
+
+    KdpSendPacketHandler = NULL;
+    KdpManipulateStateHandler = NULL;
+
+    /* Allow to send partial data. */
+    if (!MemoryRead.Length && !NT_SUCCESS(ReadStatus))
+    {
+        send_gdb_ntstatus(ReadStatus);
+        Status = KdPacketReceived;
+    }
+    else if (MemoryRead.Binary)
+    {
+        start_gdb_packet();
+        send_gdb_partial_packet("b");
+        send_gdb_partial_binary(MemoryRead.Buffer, MemoryRead.Length);
+        Status = finish_gdb_packet();
+    }
+    else
+    {
+        Status = send_gdb_memory(MemoryRead.Buffer, MemoryRead.Length);
+    }
+
+    RestoreCurrentProcessTlb();
+    return Status;
+}
+
+static
+void
+ReadMemorySendHandler(
+    _In_ ULONG PacketType,
+    _In_ PSTRING MessageHeader,
+    _In_ PSTRING MessageData);
+
+/* Serves the pending read from the cache, and asks KD for the first line which isn't there */
+static
+KDSTATUS
+ContinueMemoryRead(
+    _Out_ DBGKD_MANIPULATE_STATE64* State,
+    _Out_ PSTRING MessageData,
+    _Out_ PULONG MessageLength)
+{
+    PUCHAR CachedData;
+    ULONG Chunk;
+
+    while (MemoryRead.Remaining)
+    {
+        CachedData = LookupMemoryCache(MemoryRead.Address);
+        if (!CachedData)
+            break;
+
+        Chunk = KDGDB_CACHE_LINE_SIZE - (MemoryRead.Address & (KDGDB_CACHE_LINE_SIZE - 1));
+        if (Chunk > MemoryRead.Remaining)
+            Chunk = MemoryRead.Remaining;
+
+        RtlCopyMemory(&MemoryRead.Buffer[MemoryRead.Length], CachedData, Chunk);
+        MemoryRead.Length += Chunk;
+        MemoryRead.Address += Chunk;
+        MemoryRead.Remaining -= Chunk;
+    }
+
+    if (!MemoryRead.Remaining)
+        return LOOP_IF_SUCCESS(FinishMemoryRead(STATUS_SUCCESS));
+
+    State->ApiNumber = DbgKdReadVirtualMemoryApi;
+    State->ReturnStatus = STATUS_SUCCESS; /* ? */
+    State->Processor = CurrentStateChange.Processor;
+    State->ProcessorLevel = CurrentStateChange.ProcessorLevel;
+    if (MessageData)
+        MessageData->Length = 0;
+    *MessageLength = 0;
+
+    /* Read the whole line, it will most likely be asked for again.
+     * Device memory is read exactly where asked, and never cached */
+    Chunk = KDGDB_CACHE_LINE_SIZE - (MemoryRead.Address & (KDGDB_CACHE_LINE_SIZE - 1));
+    MemoryRead.Exact = !gdb_is_cached_memory(MemoryRead.Address);
+    if (MemoryRead.Exact)
+    {
+        if (Chunk > MemoryRead.Remaining)
+            Chunk = MemoryRead.Remaining;
+        State->u.ReadMemory.TargetBaseAddress = MemoryRead.Address;
+        State->u.ReadMemory.TransferCount = Chunk;
+    }
+    else
+    {
+        State->u.ReadMemory.TargetBaseAddress = MemoryRead.Address & ~(ULONG_PTR)(KDGDB_CACHE_LINE_SIZE - 1);
+        State->u.ReadMemory.TransferCount = KDGDB_CACHE_LINE_SIZE;
+    }
 
     /* KD will reply with KdSendPacket. Catch it */
     KdpSendPacketHandler = ReadMemorySendHandler;
+    KdpManipulateStateHandler = NULL;
     return KdPacketReceived;
 }
 
+static
+KDSTATUS
+ReadMemoryManipulateStateHandler(
+    _Out_ DBGKD_MANIPULATE_STATE64* State,
+    _Out_ PSTRING MessageData,
+    _Out_ PULONG MessageLength,
+    _Inout_ PKD_CONTEXT KdContext)
+{
+    KDSTATUS Status = ContinueMemoryRead(State, MessageData, MessageLength);
+
+    /* Everything was sent, get back to GDB */
+    if (Status == (KDSTATUS)-1)
+        return gdb_receive_and_interpret_packet(State, MessageData, MessageLength, KdContext);
+
+    return Status;
+}
+
+static
+void
+ReadMemorySendHandler(
+    _In_ ULONG PacketType,
+    _In_ PSTRING MessageHeader,
+    _In_ PSTRING MessageData)
+{
+    DBGKD_MANIPULATE_STATE64* State = (DBGKD_MANIPULATE_STATE64*)MessageHeader->Buffer;
+    ULONG_PTR LineAddress;
+    ULONG Offset, Chunk;
+
+    if (PacketType != PACKET_TYPE_KD_STATE_MANIPULATE)
+    {
+        // KdAssert
+        KDDBGPRINT("Wrong packet type (%lu) received after DbgKdReadVirtualMemoryApi request.\n", PacketType);
+        while (1);
+    }
+
+    if (State->ApiNumber != DbgKdReadVirtualMemoryApi)
+    {
+        KDDBGPRINT("Wrong API number (%lu) after DbgKdReadVirtualMemoryApi request.\n", State->ApiNumber);
+    }
+
+    LineAddress = (ULONG_PTR)State->u.ReadMemory.TargetBaseAddress;
+
+    if (MemoryRead.Exact)
+    {
+        RtlCopyMemory(&MemoryRead.Buffer[MemoryRead.Length], MessageData->Buffer, MessageData->Length);
+        MemoryRead.Length += MessageData->Length;
+
+        if (NT_SUCCESS(State->ReturnStatus) && (MessageData->Length == State->u.ReadMemory.TransferCount))
+        {
+            /* Go on with the rest of the request, which may be in another page */
+            MemoryRead.Address += MessageData->Length;
+            MemoryRead.Remaining -= MessageData->Length;
+            KdpSendPacketHandler = NULL;
+            KdpManipulateStateHandler = ReadMemoryManipulateStateHandler;
+            return;
+        }
+
+        FinishMemoryRead(NT_SUCCESS(State->ReturnStatus) ? STATUS_ACCESS_VIOLATION : State->ReturnStatus);
+        return;
+    }
+
+    if (NT_SUCCESS(State->ReturnStatus) && (MessageData->Length == KDGDB_CACHE_LINE_SIZE))
+    {
+        /* Keep it and go on with the rest of the request */
+        InsertMemoryCache(LineAddress, MessageData->Buffer);
+        KdpSendPacketHandler = NULL;
+        KdpManipulateStateHandler = ReadMemoryManipulateStateHandler;
+        return;
+    }
+
+    /* Partial line. Take what we can and don't cache it */
+    Offset = (ULONG)(MemoryRead.Address - LineAddress);
+    if (MessageData->Length > Offset)
+    {
+        Chunk = MessageData->Length - Offset;
+        if (Chunk > MemoryRead.Remaining)
+            Chunk = MemoryRead.Remaining;
+        RtlCopyMemory(&MemoryRead.Buffer[MemoryRead.Length], &MessageData->Buffer[Offset], Chunk);
+        MemoryRead.Length += Chunk;
+    }
+
+    FinishMemoryRead(NT_SUCCESS(State->ReturnStatus) ? STATUS_ACCESS_VIOLATION : State->ReturnStatus);
+}
+
+/* m and x packets */
+static
+KDSTATUS
+handle_gdb_read_mem(
+    _Out_ DBGKD_MANIPULATE_STATE64* State,
+    _Out_ PSTRING MessageData,
+    _Out_ PULONG MessageLength,
+    _Inout_ PKD_CONTEXT KdContext)
+{
+    if (!AttachDebugProcessTlb())
+        return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
+
+    MemoryRead.Binary = (gdb_input[0] == 'x');
+    MemoryRead.Address = hex_to_address(&gdb_input[1]);
+    MemoryRead.Remaining = hex_to_address(strstr(&gdb_input[1], ",") + 1);
+    MemoryRead.Length = 0;
+
+    /* GDB copes with shorter answers */
+    if (MemoryRead.Remaining > sizeof(MemoryRead.Buffer))
+        MemoryRead.Remaining = sizeof(MemoryRead.Buffer);
+
+    return ContinueMemoryRead(State, MessageData, MessageLength);
+}
+
+static
+KDSTATUS
+WriteMemoryManipulateStateHandler(
+    _Out_ DBGKD_MANIPULATE_STATE64* State,
+    _Out_ PSTRING MessageData,
+    _Out_ PULONG MessageLength,
+    _Inout_ PKD_CONTEXT KdContext);
+
 static
 void
 WriteMemorySendHandler(
@@ -557,6 +807,14 @@ WriteMemorySendHandler(
         KDDBGPRINT("Wrong API number (%lu) after DbgKdWriteVirtualMemoryApi request.\n", State->ApiNumber);
     }
 
+    /* KD takes at most one packet worth of data per request, write the rest */
+    if (NT_SUCCESS(State->ReturnStatus) && MemoryWrite.Remaining)
+    {
+        KdpSendPacketHandler = NULL;
+        KdpManipulateStateHandler = WriteMemoryManipulateStateHandler;
+        return;
+    }
+
     /* Check status */
     if (!NT_SUCCESS(State->ReturnStatus))
         send_gdb_ntstatus(State->ReturnStatus);
@@ -565,113 +823,85 @@ WriteMemorySendHandler(
     KdpSendPacketHandler = NULL;
     KdpManipulateStateHandler = NULL;
 
-#if MONOPROCESS
-    if (gdb_dbg_tid != 0)
-    /* Reset the TLB */
-#else
-    if ((gdb_dbg_pid != 0) && gdb_pid_to_handle(gdb_dbg_pid) != PsGetCurrentProcessId())
-#endif
-    {
-        /* Only do this if Ps is initialized */
-        if (ProcessListHead->Flink)
-            __writecr3(PsGetCurrentProcess()->Pcb.DirectoryTableBase[0]);
-    }
+    RestoreCurrentProcessTlb();
 }
 
 static
 KDSTATUS
-handle_gdb_write_mem(
+WriteMemoryManipulateStateHandler(
     _Out_ DBGKD_MANIPULATE_STATE64* State,
     _Out_ PSTRING MessageData,
     _Out_ PULONG MessageLength,
     _Inout_ PKD_CONTEXT KdContext)
 {
-    /* Maximal input buffer is 0x1000. Each byte is encoded on two bytes by GDB */
-    static UCHAR OutBuffer[0x800];
-    ULONG BufferLength;
-    char* blob_ptr;
-    UCHAR* OutPtr;
+    ULONG Chunk = MemoryWrite.Remaining;
+
+    if (Chunk > KDGDB_MAX_KD_TRANSFER)
+        Chunk = KDGDB_MAX_KD_TRANSFER;
 
     State->ApiNumber = DbgKdWriteVirtualMemoryApi;
     State->ReturnStatus = STATUS_SUCCESS; /* ? */
     State->Processor = CurrentStateChange.Processor;
     State->ProcessorLevel = CurrentStateChange.ProcessorLevel;
+    State->u.WriteMemory.TargetBaseAddress = MemoryWrite.Address;
+    State->u.WriteMemory.TransferCount = Chunk;
+    MessageData->Length = (USHORT)Chunk;
+    MessageData->Buffer = (CHAR*)MemoryWrite.Data;
+    *MessageLength = Chunk;
 
-    /* Set the TLB according to the process being read. Pid 0 means any process. */
-#if MONOPROCESS
-    if ((gdb_dbg_tid != 0) && gdb_tid_to_handle(gdb_dbg_tid) != PsGetCurrentThreadId())
-    {
-        PETHREAD AttachedThread = find_thread(0, gdb_dbg_tid);
-        PKPROCESS AttachedProcess;
-        if (AttachedThread == NULL)
-        {
-            KDDBGPRINT("The current GDB debug thread is invalid!");
-            return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
-        }
+    MemoryWrite.Address += Chunk;
+    MemoryWrite.Data += Chunk;
+    MemoryWrite.Remaining -= Chunk;
 
-        AttachedProcess = AttachedThread->Tcb.Process;
-        if (AttachedProcess == NULL)
-        {
-            KDDBGPRINT("The current GDB debug thread is invalid!");
-            return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
-        }
-        __writecr3(AttachedProcess->DirectoryTableBase[0]);
-    }
-#else
-    if ((gdb_dbg_pid != 0) && gdb_pid_to_handle(gdb_dbg_pid) != PsGetCurrentProcessId())
-    {
-        PEPROCESS AttachedProcess = find_process(gdb_dbg_pid);
-        if (AttachedProcess == NULL)
-        {
-            KDDBGPRINT("The current GDB debug thread is invalid!");
-            return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
-        }
-        /* Only do this if Ps is initialized */
-        if (ProcessListHead->Flink)
-            __writecr3(AttachedProcess->Pcb.DirectoryTableBase[0]);
-    }
-#endif
+    /* KD will reply with KdSendPacket. Catch it */
+    KdpSendPacketHandler = WriteMemorySendHandler;
+    KdpManipulateStateHandler = NULL;
+    return KdPacketReceived;
+}
+
+/* X packet */
+static
+KDSTATUS
+handle_gdb_write_mem(
+    _Out_ DBGKD_MANIPULATE_STATE64* State,
+    _Out_ PSTRING MessageData,
+    _Out_ PULONG MessageLength,
+    _Inout_ PKD_CONTEXT KdContext)
+{
+    /* The binary data can be as big as the whole packet */
+    static UCHAR OutBuffer[GDB_PACKET_SIZE];
+    ULONG BufferLength;
+    char* blob_ptr;
+
+    /* Whatever we have in the cache may be stale after this */
+    gdb_invalidate_memory_cache();
 
-    State->u.WriteMemory.TargetBaseAddress = hex_to_address(&gdb_input[1]);
+    if (!AttachDebugProcessTlb())
+        return LOOP_IF_SUCCESS(send_gdb_packet("E03"));
+
+    MemoryWrite.Address = hex_to_address(&gdb_input[1]);
     BufferLength = hex_to_address(strstr(&gdb_input[1], ",") + 1);
     if (BufferLength == 0)
     {
         /* Nothing to do */
+        RestoreCurrentProcessTlb();
         return LOOP_IF_SUCCESS(send_gdb_packet("OK"));
     }
-    
-    State->u.WriteMemory.TransferCount = BufferLength;
-    MessageData->Length = BufferLength;
-    MessageData->Buffer = (CHAR*)OutBuffer;
 
-    OutPtr = OutBuffer;
     blob_ptr = strstr(strstr(&gdb_input[1], ",") + 1, ":") + 1;
-    while (BufferLength)
+    if ((BufferLength > sizeof(OutBuffer))
+            || (blob_ptr + BufferLength > gdb_input + gdb_input_length))
     {
-        if (BufferLength >= 4)
-        {
-            *((ULONG*)OutPtr) = *((ULONG*)blob_ptr);
-            OutPtr += 4;
-            blob_ptr += 4;
-            BufferLength -= 4;
-        }
-        else if (BufferLength >= 2)
-        {
-            *((USHORT*)OutPtr) = *((USHORT*)blob_ptr);
-            OutPtr += 2;
-            blob_ptr += 2;
-            BufferLength -= 2;
-        }
-        else
-        {
-            *OutPtr++ = *blob_ptr++;
-            BufferLength--;
-        }
+        KDDBGPRINT("Invalid 'X' packet length: %lu.\n", BufferLength);
+        RestoreCurrentProcessTlb();
+        return LOOP_IF_SUCCESS(send_gdb_packet("E01"));
     }
 
-    /* KD will reply with KdSendPacket. Catch it */
-    KdpSendPacketHandler = WriteMemorySendHandler;
-    return KdPacketReceived;
+    RtlCopyMemory(OutBuffer, blob_ptr, BufferLength);
+    MemoryWrite.Data = OutBuffer;
+    MemoryWrite.Remaining = BufferLength;
+
+    return WriteMemoryManipulateStateHandler(State, MessageData, MessageLength, KdContext);
 }
 
 static
@@ -758,6 +988,9 @@ handle_gdb_insert_breakpoint(
                 return LOOP_IF_SUCCESS(send_gdb_packet("E01"));
             }
 
+            /* The breakpoint instruction changes memory */
+            gdb_invalidate_memory_cache();
+
             State->ApiNumber = DbgKdWriteBreakPointApi;
             State->u.WriteBreakPoint.BreakPointAddress = Address;
             /* FIXME : ignoring all other Z0 arguments */
@@ -851,6 +1084,8 @@ handle_gdb_remove_breakpoint(
                 return LOOP_IF_SUCCESS(send_gdb_packet("E01"));
             }
 
+            gdb_invalidate_memory_cache();
+
             State->ApiNumber = DbgKdRestoreBreakPointApi;
             State->u.RestoreBreakPoint.BreakPointHandle = Handle;
             /* FIXME : ignoring all other z0 arguments */
@@ -989,6 +1224,7 @@ gdb_receive_and_interpret_packet(
             Status = LOOP_IF_SUCCESS(handle_gdb_set_thread());
             break;
         case 'm':
+        case 'x':
             Status = handle_gdb_read_mem(State, MessageData, MessageLength, KdContext);
             break;
         case 'p':
@@ -8,7 +8,8 @@
 #include "kdgdb.h"
 
 /* GLOBALS ********************************************************************/
-CHAR gdb_input[0x1000];
+CHAR gdb_input[GDB_PACKET_SIZE + 1];
+ULONG gdb_input_length;
 
 /* GLOBAL FUNCTIONS ***********************************************************/
 char
@@ -58,9 +59,18 @@ gdb_receive_packet(_Inout_ PKD_CONTEXT KdContext)
         if (Byte == '#')
         {
             *ByteBuffer = '\0';
+            gdb_input_length = (ULONG)(ByteBuffer - (UCHAR*)gdb_input);
             break;
         }
         CheckSum += (CHAR)Byte;
+
+        /* GDB should respect the PacketSize we gave it */
+        if (ByteBuffer == (UCHAR*)&gdb_input[GDB_PACKET_SIZE])
+        {
+            KDDBGPRINT("Packet too long!");
+            KdpSendByte('-');
+            return KdPacketNeedsResend;
+        }
         
         /* See if we should escape */
         if (Byte == 0x7d)
@@ -260,4 +260,24 @@ gdb_send_register(void)
     }
 }
 
+/* Whether the address is mapped as plain cached memory. Uncached and
+ * write-through mappings are device memory, where reading a byte more than
+ * asked for may have side effects. Uses the (non PAE) page table self-map. */
+BOOLEAN
+gdb_is_cached_memory(
+    _In_ ULONG_PTR Address)
+{
+    PHARDWARE_PTE_X86 Pde = (PHARDWARE_PTE_X86)0xC0300000 + (Address >> 22);
+    PHARDWARE_PTE_X86 Pte = (PHARDWARE_PTE_X86)0xC0000000 + (Address >> 12);
+
+    if (!Pde->Valid || Pde->WriteThrough || Pde->CacheDisable)
+        return FALSE;
+
+    /* Large page: the PDE is the whole story. Its PAT bit is bit 12 */
+    if (Pde->LargePage)
+        return !(*(PULONG)Pde & 0x1000);
+
+    /* For a 4KB page, the LargePage bit is the PAT bit */
+    return Pte->Valid && !Pte->WriteThrough && !Pte->CacheDisable && !Pte->LargePage;
+}
 
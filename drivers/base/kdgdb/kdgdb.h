@@ -31,6 +31,17 @@ extern ULONG KdpDbgPrint(const char* Format, ...);
 #define KDDBGPRINT KdpDbgPrint
 #endif
 
+/* Size of the packets we accept, as advertised to GDB in qSupported */
+#define GDB_PACKET_SIZE 0x4000
+/* Biggest memory transfer we answer in one packet. Each byte may take two characters. */
+#define GDB_MAX_TRANSFER ((GDB_PACKET_SIZE / 2) - 0x10)
+/* Biggest memory transfer KD accepts in one manipulate state request */
+#define KDGDB_MAX_KD_TRANSFER (PACKET_MAX_SIZE - sizeof(DBGKD_MANIPULATE_STATE64))
+
+/* Target side memory cache. Lines must fit in one KD transfer and must not span pages. */
+#define KDGDB_CACHE_LINE_SIZE 0x800
+#define KDGDB_CACHE_LINES 16
+
 /* GDB doesn't like pid - tid 0, so +1 them */
 FORCEINLINE HANDLE gdb_tid_to_handle(UINT_PTR Tid)
 {
@@ -73,9 +84,11 @@ typedef KDSTATUS (*KDP_MANIPULATESTATE_HANDLER)(
 extern UINT_PTR gdb_dbg_tid;
 extern UINT_PTR gdb_dbg_pid;
 extern KDSTATUS gdb_receive_and_interpret_packet(_Out_ DBGKD_MANIPULATE_STATE64* State, _Out_ PSTRING MessageData, _Out_ PULONG MessageLength, _Inout_ PKD_CONTEXT KdContext);
+void gdb_invalidate_memory_cache(void);
 
 /* gdb_receive.c */
 extern CHAR gdb_input[];
+extern ULONG gdb_input_length;
 KDSTATUS NTAPI gdb_receive_packet(_Inout_ PKD_CONTEXT KdContext);
 char hex_value(char ch);
 
@@ -119,6 +132,7 @@ extern PETHREAD find_thread(_In_ UINT_PTR Pid, _In_ UINT_PTR Tid);
 /* arch_sup.c */
 extern KDSTATUS gdb_send_register(void);
 extern KDSTATUS gdb_send_registers(void);
+extern BOOLEAN gdb_is_cached_memory(_In_ ULONG_PTR Address);
 
 /* Architecture specific defines. See ntoskrnl/include/internal/arch/ke.h */
 #ifdef _M_IX86
@@ -231,6 +231,8 @@ ContinueManipulateStateHandler(
     KdpManipulateStateHandler = NULL;
     /* We're not handling an exception anymore */
     InException = FALSE;
+    /* The target is running again, forget what we read */
+    gdb_invalidate_memory_cache();
 
     return KdPacketReceived;
 }
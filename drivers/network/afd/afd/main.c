@@ -22,6 +22,9 @@ DWORD DebugTraceLevel = MIN_TRACE;
 
 #endif /* DBG */
 
+/* Parameters\DirectReceive: hand pending recv buffers to the transport */
+BOOLEAN AfdDirectReceive = TRUE;
+
 void OskitDumpBuffer( PCHAR Data, UINT Len ) {
     unsigned int i;
 
@@ -348,6 +351,7 @@ AfdCreateSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
     InitializeListHead( &FCB->DatagramList );
     InitializeListHead( &FCB->PendingConnections );
+    InitializeListHead( &FCB->PollWaiters );
 
     AFD_DbgPrint(MID_TRACE,("%p: Checking command channel\n", FCB));
 
@@ -428,6 +432,11 @@ AfdCleanupSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         }
     }
 
+    /* A receive handed to the transport is not on the list, but holds a
+     * reference to the file object just the same */
+    if (FCB->DirectRecvIrp)
+        IoCancelIrp(FCB->DirectRecvIrp);
+
     KillSelectsForFCB( FCB->DeviceExt, FileObject, FALSE );
 
     return UnlockAndMaybeComplete(FCB, STATUS_SUCCESS, Irp, 0);
@@ -1201,6 +1210,17 @@ AfdCancelHandler(PDEVICE_OBJECT DeviceObject,
             return;
     }
 
+    if (Function == FUNCTION_RECV && Irp == FCB->DirectRecvIrp)
+    {
+        /* The transport is filling this IRP's buffer, so have it give the
+         * receive back. The IRP is completed from ReceiveComplete. */
+        if (FCB->ReceiveIrp.InFlightRequest)
+            IoCancelIrp(FCB->ReceiveIrp.InFlightRequest);
+
+        SocketStateUnlock(FCB);
+        return;
+    }
+
     CurrentEntry = FCB->PendingIrpList[Function].Flink;
     while (CurrentEntry != &FCB->PendingIrpList[Function])
     {
@@ -1224,6 +1244,31 @@ AfdCancelHandler(PDEVICE_OBJECT DeviceObject,
     DbgPrint("WARNING!!! IRP cancellation race could lead to a process hang! (Function: %u)\n", Function);
 }
 
+static VOID
+AfdReadParameters(PUNICODE_STRING RegistryPath)
+{
+    RTL_QUERY_REGISTRY_TABLE QueryTable[3];
+    ULONG DirectReceive = AfdDirectReceive;
+    ULONG Default = DirectReceive;
+
+    RtlZeroMemory(QueryTable, sizeof(QueryTable));
+    QueryTable[0].Flags = RTL_QUERY_REGISTRY_SUBKEY;
+    QueryTable[0].Name = L"Parameters";
+    QueryTable[1].Flags = RTL_QUERY_REGISTRY_DIRECT;
+    QueryTable[1].Name = L"DirectReceive";
+    QueryTable[1].EntryContext = &DirectReceive;
+    QueryTable[1].DefaultType = REG_DWORD;
+    QueryTable[1].DefaultData = &Default;
+    QueryTable[1].DefaultLength = sizeof(Default);
+
+    RtlQueryRegistryValues(RTL_REGISTRY_ABSOLUTE, RegistryPath->Buffer,
+                           QueryTable, NULL, NULL);
+
+    AfdDirectReceive = (DirectReceive != 0);
+    AFD_DbgPrint(MID_TRACE,("Direct receive %s\n",
+                            AfdDirectReceive ? "enabled" : "disabled"));
+}
+
 static DRIVER_UNLOAD AfdUnload;
 static VOID NTAPI
 AfdUnload(PDRIVER_OBJECT DriverObject)
@@ -1239,7 +1284,8 @@ DriverEntry(PDRIVER_OBJECT DriverObject, PUNICODE_STRING RegistryPath)
     PAFD_DEVICE_EXTENSION DeviceExt;
     NTSTATUS Status;
 
-    UNREFERENCED_PARAMETER(RegistryPath);
+    AfdReadParameters(RegistryPath);
+
     /* register driver routines */
     DriverObject->MajorFunction[IRP_MJ_CLOSE] = AfdDispatch;
     DriverObject->MajorFunction[IRP_MJ_CREATE] = AfdDispatch;
@@ -10,14 +10,138 @@
 
 #include "afd.h"
 
+/* Receives at least this large are worth pulling back an idle receive
+ * into our window for, so that the data can land in the caller's buffer */
+#define AFD_DIRECT_RECV_MINIMUM PAGE_SIZE
+
+static VOID CompleteRecvIrp( PIRP Irp, NTSTATUS Status, ULONG_PTR Information )
+{
+    PIO_STACK_LOCATION IrpSp = IoGetCurrentIrpStackLocation( Irp );
+    PAFD_RECV_INFO RecvReq = GetLockedData( Irp, IrpSp );
+
+    AFD_DbgPrint(MID_TRACE,("Completing recv %p (%u)\n", Irp, (UINT)Information));
+
+    UnlockBuffers( RecvReq->BufferArray, RecvReq->BufferCount, FALSE );
+    Irp->IoStatus.Status = Status;
+    Irp->IoStatus.Information = Information;
+    if( Irp->MdlAddress ) UnlockRequest( Irp, IrpSp );
+    (void)IoSetCancelRoutine(Irp, NULL);
+    IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+}
+
+static PIRP GetDirectRecvCandidate( PAFD_FCB FCB, UINT MinimumLength )
+{
+    PIRP NextIrp;
+    PAFD_RECV_INFO RecvReq;
+    PAFD_MAPBUF Map;
+
+    if (!AfdDirectReceive) return NULL;
+
+    /* Data that is already buffered has to be consumed first */
+    if (FCB->Recv.Content != FCB->Recv.BytesUsed) return NULL;
+
+    if (IsListEmpty(&FCB->PendingIrpList[FUNCTION_RECV])) return NULL;
+
+    NextIrp = CONTAINING_RECORD(FCB->PendingIrpList[FUNCTION_RECV].Flink,
+                                IRP, Tail.Overlay.ListEntry);
+
+    /* IRPs without a cancel routine are still being set up or already being cancelled */
+    if (!NextIrp->CancelRoutine) return NULL;
+
+    RecvReq = GetLockedData(NextIrp, IoGetCurrentIrpStackLocation(NextIrp));
+
+    /* The transport can only fill a single buffer, and must not consume peeked data */
+    if (!RecvReq->BufferArray || RecvReq->BufferCount != 1) return NULL;
+    if (RecvReq->TdiFlags & (TDI_RECEIVE_PEEK | TDI_RECEIVE_EXPEDITED)) return NULL;
+
+    Map = (PAFD_MAPBUF)(RecvReq->BufferArray + RecvReq->BufferCount);
+    if (!Map[0].Mdl || RecvReq->BufferArray[0].len < MinimumLength) return NULL;
+
+    return NextIrp;
+}
+
+static BOOLEAN ReceiveDirect( PAFD_FCB FCB )
+{
+    PIRP NextIrp;
+    PAFD_RECV_INFO RecvReq;
+    PAFD_MAPBUF Map;
+    NTSTATUS Status;
+
+    NextIrp = GetDirectRecvCandidate(FCB, 1);
+    if (!NextIrp) return FALSE;
+
+    /* Take the IRP away from the cancel routine while we dequeue it */
+    if (!IoSetCancelRoutine(NextIrp, NULL)) return FALSE;
+
+    RemoveEntryList(&NextIrp->Tail.Overlay.ListEntry);
+
+    /* Cancelling it now means pulling the receive back from the transport */
+    (void)IoSetCancelRoutine(NextIrp, AfdCancelHandler);
+    if (NextIrp->Cancel && IoSetCancelRoutine(NextIrp, NULL))
+    {
+        CompleteRecvIrp(NextIrp, STATUS_CANCELLED, 0);
+        return FALSE;
+    }
+
+    RecvReq = GetLockedData(NextIrp, IoGetCurrentIrpStackLocation(NextIrp));
+    Map = (PAFD_MAPBUF)(RecvReq->BufferArray + RecvReq->BufferCount);
+
+    AFD_DbgPrint(MID_TRACE,("Receiving directly into %p\n", NextIrp));
+
+    FCB->DirectRecvIrp = NextIrp;
+
+    Status = TdiReceiveMdl( &FCB->ReceiveIrp.InFlightRequest,
+                            FCB->Connection.Object,
+                            TDI_RECEIVE_NORMAL,
+                            Map[0].Mdl,
+                            RecvReq->BufferArray[0].len,
+                            ReceiveComplete,
+                            FCB );
+
+    /* The receive could not be issued, the IRP waits for the window again */
+    if (Status != STATUS_PENDING && FCB->DirectRecvIrp == NextIrp)
+    {
+        FCB->DirectRecvIrp = NULL;
+        InsertHeadList(&FCB->PendingIrpList[FUNCTION_RECV],
+                       &NextIrp->Tail.Overlay.ListEntry);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static VOID RefillSocketBuffer( PAFD_FCB FCB )
 {
+    /* Receives are only posted once the connection is established */
+    if (FCB->State != SOCKET_STATE_CONNECTED) return;
+
     /* Make sure nothing's in flight first */
-    if (FCB->ReceiveIrp.InFlightRequest) return;
+    if (FCB->ReceiveIrp.InFlightRequest)
+    {
+        /* An idle receive into our window would cost a pending receive
+         * an extra copy. Pull it back so the caller's buffer is used. */
+        if (!FCB->DirectRecvIrp && !FCB->RecvRedirect && !FCB->TdiReceiveClosed &&
+            GetDirectRecvCandidate(FCB, AFD_DIRECT_RECV_MINIMUM))
+        {
+            FCB->RecvRedirect = TRUE;
+            IoCancelIrp(FCB->ReceiveIrp.InFlightRequest);
+        }
+        return;
+    }
 
     /* Now ensure that receive is still allowed */
     if (FCB->TdiReceiveClosed) return;
 
+    /* Check if the buffer is empty */
+    if (FCB->Recv.Content == FCB->Recv.BytesUsed)
+    {
+        FCB->Recv.Content = 0;
+        FCB->Recv.BytesUsed = 0;
+
+        /* A pending receive can take the data without going through the window */
+        if (ReceiveDirect(FCB)) return;
+    }
+
     /* Check if the buffer is full */
     if (FCB->Recv.Content == FCB->Recv.Size)
     {
@@ -52,6 +176,10 @@ static VOID RefillSocketBuffer( PAFD_FCB FCB )
 
 static VOID HandleReceiveComplete( PAFD_FCB FCB, NTSTATUS Status, ULONG_PTR Information )
 {
+    /* We pulled the receive back ourselves to use a caller's buffer instead */
+    if (Status == STATUS_CANCELLED && FCB->RecvRedirect)
+        return;
+
     FCB->LastReceiveStatus = Status;
 
     /* We got closed while the receive was in progress */
@@ -71,11 +199,6 @@ static VOID HandleReceiveComplete( PAFD_FCB FCB, NTSTATUS Status, ULONG_PTR Info
             /* Receive is closed */
             FCB->TdiReceiveClosed = TRUE;
         }
-        else
-        {
-            /* Issue another receive IRP to keep the buffer well stocked */
-            RefillSocketBuffer(FCB);
-        }
     }
     /* Receive failed with no data (unexpected closure) */
     else
@@ -85,6 +208,33 @@ static VOID HandleReceiveComplete( PAFD_FCB FCB, NTSTATUS Status, ULONG_PTR Info
     }
 }
 
+static VOID HandleDirectReceiveComplete( PAFD_FCB FCB, NTSTATUS Status, ULONG_PTR Information )
+{
+    PIRP RecvIrp = FCB->DirectRecvIrp;
+
+    FCB->DirectRecvIrp = NULL;
+
+    if (Status == STATUS_SUCCESS && Information != 0)
+    {
+        /* The data is already in the caller's buffer */
+        FCB->LastReceiveStatus = Status;
+        CompleteRecvIrp(RecvIrp, STATUS_SUCCESS, Information);
+    }
+    else if (Status == STATUS_CANCELLED && RecvIrp->Cancel)
+    {
+        /* The caller cancelled the receive, the socket itself is fine */
+        CompleteRecvIrp(RecvIrp, STATUS_CANCELLED, 0);
+    }
+    else
+    {
+        /* Closure or failure: account for it as for our own window and
+         * let ReceiveActivity complete the request accordingly */
+        HandleReceiveComplete(FCB, Status, 0);
+        InsertHeadList(&FCB->PendingIrpList[FUNCTION_RECV],
+                       &RecvIrp->Tail.Overlay.ListEntry);
+    }
+}
+
 static BOOLEAN CantReadMore( PAFD_FCB FCB ) {
     UINT BytesAvailable = FCB->Recv.Content - FCB->Recv.BytesUsed;
 
@@ -142,9 +292,6 @@ static NTSTATUS TryToSatisfyRecvRequestFromBuffer( PAFD_FCB FCB,
         }
     }
 
-    /* Issue another receive IRP to keep the buffer well stocked */
-    RefillSocketBuffer(FCB);
-
     return STATUS_SUCCESS;
 }
 
@@ -219,18 +366,10 @@ static NTSTATUS ReceiveActivity( PAFD_FCB FCB, PIRP Irp ) {
                                &NextIrp->Tail.Overlay.ListEntry);
                 break;
             } else {
-                AFD_DbgPrint(MID_TRACE,("Completing recv %p (%u)\n", NextIrp,
-                                        TotalBytesCopied));
-                UnlockBuffers( RecvReq->BufferArray,
-                               RecvReq->BufferCount, FALSE );
-                NextIrp->IoStatus.Status = Status;
-                NextIrp->IoStatus.Information = TotalBytesCopied;
                 if( NextIrp == Irp ) {
                     RetStatus = Status;
                 }
-                if( NextIrp->MdlAddress ) UnlockRequest( NextIrp, IoGetCurrentIrpStackLocation( NextIrp ) );
-                (void)IoSetCancelRoutine(NextIrp, NULL);
-                IoCompleteRequest( NextIrp, IO_NETWORK_INCREMENT );
+                CompleteRecvIrp( NextIrp, Status, TotalBytesCopied );
             }
         }
     }
@@ -286,7 +425,14 @@ NTSTATUS NTAPI ReceiveComplete
     ASSERT(FCB->ReceiveIrp.InFlightRequest == Irp);
     FCB->ReceiveIrp.InFlightRequest = NULL;
 
+    /* The buffer of a direct receive is owned by the receive request */
+    if( FCB->DirectRecvIrp ) Irp->MdlAddress = NULL;
+
     if( FCB->State == SOCKET_STATE_CLOSED ) {
+        if( FCB->DirectRecvIrp ) {
+            CompleteRecvIrp( FCB->DirectRecvIrp, STATUS_FILE_CLOSED, 0 );
+            FCB->DirectRecvIrp = NULL;
+        }
         /* Cleanup our IRP queue because the FCB is being destroyed */
         while( !IsListEmpty( &FCB->PendingIrpList[FUNCTION_RECV] ) ) {
             NextIrpEntry = RemoveHeadList(&FCB->PendingIrpList[FUNCTION_RECV]);
@@ -308,10 +454,18 @@ NTSTATUS NTAPI ReceiveComplete
         return STATUS_INVALID_PARAMETER;
     }
 
-    HandleReceiveComplete( FCB, Irp->IoStatus.Status, Irp->IoStatus.Information );
+    if( FCB->DirectRecvIrp )
+        HandleDirectReceiveComplete( FCB, Irp->IoStatus.Status, Irp->IoStatus.Information );
+    else
+        HandleReceiveComplete( FCB, Irp->IoStatus.Status, Irp->IoStatus.Information );
+
+    FCB->RecvRedirect = FALSE;
 
     ReceiveActivity( FCB, NULL );
 
+    /* Issue another receive IRP to keep the buffer well stocked */
+    RefillSocketBuffer( FCB );
+
     SocketStateUnlock( FCB );
 
     return STATUS_SUCCESS;
@@ -526,6 +680,7 @@ AfdConnectedSocketReadData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         TotalBytesCopied = 0;
         RemoveEntryList( &Irp->Tail.Overlay.ListEntry );
         UnlockBuffers( RecvReq->BufferArray, RecvReq->BufferCount, FALSE );
+        RefillSocketBuffer( FCB );
         return UnlockAndMaybeComplete( FCB, Status, Irp,
                                        TotalBytesCopied );
     } else if( Status == STATUS_PENDING ) {
@@ -536,6 +691,9 @@ AfdConnectedSocketReadData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         AFD_DbgPrint(MID_TRACE,("Completed with status %x\n", Status));
     }
 
+    /* Keep a receive in flight, straight into this IRP's buffer if we can */
+    RefillSocketBuffer( FCB );
+
     SocketStateUnlock( FCB );
     return Status;
 }
@@ -68,6 +68,8 @@ VOID SignalSocket(
     {
         KeCancelTimer( &Poll->Timer );
         RemoveEntryList( &Poll->ListEntry );
+        for( i = 0; i < PollReq->HandleCount; i++ )
+            RemoveEntryList( &Poll->Waiters[i].ListEntry );
         ExFreePool( Poll );
     }
 
@@ -122,38 +124,43 @@ static VOID NTAPI SelectTimeout( PKDPC Dpc,
     AFD_DbgPrint(MID_TRACE,("Timeout\n"));
 }
 
+static BOOLEAN IsAfdSocket( PDEVICE_OBJECT DeviceObject,
+                            PFILE_OBJECT FileObject ) {
+    PAFD_FCB FCB = FileObject->FsContext;
+
+    /* Any file can be passed in, only ours have an FCB pointing back at them */
+    return FileObject->DeviceObject == DeviceObject &&
+           FCB != NULL && FCB->FileObject == FileObject;
+}
+
 VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         PFILE_OBJECT FileObject,
                         BOOLEAN OnlyExclusive ) {
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
+    PAFD_POLL_WAITER Waiter;
     PAFD_ACTIVE_POLL Poll;
-    PIRP Irp;
     PAFD_POLL_INFO PollReq;
-    PAFD_HANDLE HandleArray;
-    UINT i;
+    PAFD_FCB FCB = FileObject->FsContext;
 
     AFD_DbgPrint(MID_TRACE,("Killing selects that refer to %p\n", FileObject));
+    ASSERT(FCB && FCB->FileObject == FileObject);
 
     KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-    ListEntry = DeviceExt->Polls.Flink;
-    while ( ListEntry != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD(ListEntry, AFD_ACTIVE_POLL, ListEntry);
-        ListEntry = ListEntry->Flink;
-        Irp = Poll->Irp;
-        PollReq = Irp->AssociatedIrp.SystemBuffer;
-        HandleArray = AFD_HANDLES(PollReq);
-
-        for( i = 0; i < PollReq->HandleCount; i++ ) {
-            AFD_DbgPrint(MAX_TRACE,("Req: %u, This %p\n",
-                                    HandleArray[i].Handle, FileObject));
-            if( (PVOID)HandleArray[i].Handle == FileObject &&
-                (!OnlyExclusive || (OnlyExclusive && Poll->Exclusive)) ) {
-                ZeroEvents( PollReq->Handles, PollReq->HandleCount );
-                SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
-            }
-        }
+    /* Signalling a poll unlinks all its waiters, so rescan from the start */
+    ListEntry = FCB->PollWaiters.Flink;
+    while ( ListEntry != &FCB->PollWaiters ) {
+        Waiter = CONTAINING_RECORD(ListEntry, AFD_POLL_WAITER, ListEntry);
+        Poll = Waiter->Poll;
+
+        if( !OnlyExclusive || Poll->Exclusive ) {
+            PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+            ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+            SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
+            ListEntry = FCB->PollWaiters.Flink;
+        } else
+            ListEntry = ListEntry->Flink;
     }
 
     KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
@@ -189,6 +196,21 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
         return STATUS_NO_MEMORY;
     }
 
+    /* The sockets get linked to the poll, so they must all be AFD's */
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
+
+        if( !IsAfdSocket( DeviceObject,
+                          (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle ) ) {
+            AFD_DbgPrint(MIN_TRACE,("Handle %u is not a socket\n", i));
+            UnlockHandles( AFD_HANDLES(PollReq), PollReq->HandleCount );
+            Irp->IoStatus.Status = STATUS_INVALID_HANDLE;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+            return STATUS_INVALID_HANDLE;
+        }
+    }
+
     if( Exclusive ) {
         for( i = 0; i < PollReq->HandleCount; i++ ) {
             if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
@@ -228,13 +250,30 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
        PAFD_ACTIVE_POLL Poll = NULL;
 
-       Poll = ExAllocatePool( NonPagedPool, sizeof(AFD_ACTIVE_POLL) );
+       Poll = ExAllocatePool( NonPagedPool,
+                              FIELD_OFFSET(AFD_ACTIVE_POLL,
+                                           Waiters[max(PollReq->HandleCount, 1)]) );
 
        if (Poll){
           Poll->Irp = Irp;
           Poll->DeviceExt = DeviceExt;
           Poll->Exclusive = Exclusive;
 
+          /* Queue the poll on each of its sockets */
+          for( i = 0; i < PollReq->HandleCount; i++ ) {
+              Poll->Waiters[i].Poll = Poll;
+              Poll->Waiters[i].Index = i;
+
+              if( !AFD_HANDLES(PollReq)[i].Handle ) {
+                  InitializeListHead( &Poll->Waiters[i].ListEntry );
+                  continue;
+              }
+
+              FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+              FCB = FileObject->FsContext;
+              InsertTailList( &FCB->PollWaiters, &Poll->Waiters[i].ListEntry );
+          }
+
           KeInitializeTimerEx( &Poll->Timer, NotificationTimer );
 
           KeInitializeDpc( (PRKDPC)&Poll->TimeoutDpc, SelectTimeout, Poll );
@@ -404,6 +443,7 @@ static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject
 
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     PAFD_ACTIVE_POLL Poll = NULL;
+    PAFD_POLL_WAITER Waiter;
     PLIST_ENTRY ThePollEnt = NULL;
     PAFD_FCB FCB;
     KIRQL OldIrql;
@@ -422,18 +462,21 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
         return;
     }
 
-    /* Now signal normal select irps */
-    ThePollEnt = DeviceExt->Polls.Flink;
+    /* Now signal the select irps waiting on this socket */
+    ThePollEnt = FCB->PollWaiters.Flink;
 
-    while( ThePollEnt != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD( ThePollEnt, AFD_ACTIVE_POLL, ListEntry );
+    while( ThePollEnt != &FCB->PollWaiters ) {
+        Waiter = CONTAINING_RECORD( ThePollEnt, AFD_POLL_WAITER, ListEntry );
+        Poll = Waiter->Poll;
         PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
         AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
 
-        if( UpdatePollWithFCB( Poll, FileObject ) ) {
-            ThePollEnt = ThePollEnt->Flink;
+        if( (PollReq->Handles[Waiter->Index].Events & FCB->PollState) &&
+            UpdatePollWithFCB( Poll, FileObject ) ) {
             AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
             SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
+            /* The poll's waiters are gone, rescan from the start */
+            ThePollEnt = FCB->PollWaiters.Flink;
         } else
             ThePollEnt = ThePollEnt->Flink;
     }
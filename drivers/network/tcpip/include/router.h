@@ -10,6 +10,15 @@
 #include <neighbor.h>
 
 
+/* Node of the IPv4 prefix trie indexing the FIB */
+typedef struct _FIB_NODE {
+    struct _FIB_NODE *Parent;     /* Parent node, NULL for the root */
+    struct _FIB_NODE *Child[2];   /* Children, selected by the bit after the prefix */
+    ULONG Prefix;                 /* Prefix in host order, bits past PrefixLength are zero */
+    UINT PrefixLength;            /* Number of significant bits in Prefix */
+    LIST_ENTRY Routes;            /* FIB entries with exactly this prefix */
+} FIB_NODE, *PFIB_NODE;
+
 /* Forward Information Base Entry */
 typedef struct _FIB_ENTRY {
     LIST_ENTRY ListEntry;         /* Entry on list */
@@ -18,6 +27,8 @@ typedef struct _FIB_ENTRY {
     IP_ADDRESS Netmask;           /* Netmask of network */
     PNEIGHBOR_CACHE_ENTRY Router; /* Pointer to NCE of router to use */
     UINT Metric;                  /* Cost of this route */
+    PFIB_NODE Node;               /* Trie node holding this entry (IPv4 only) */
+    LIST_ENTRY NodeListEntry;     /* Entry on the node route list */
 } FIB_ENTRY, *PFIB_ENTRY;
 
 PFIB_ENTRY RouterAddRoute(
@@ -1445,6 +1445,14 @@ NTSTATUS NTAPI ClassPnpStartDevice(IN PDEVICE_OBJECT DeviceObject)
              *  Allocate/initialize TRANSFER_PACKETs and related resources.
              */
             status = InitializeTransferPackets(DeviceObject);
+
+            /*
+             *  The read/write scheduler sizes its merges by HwMaxXferLen,
+             *  so set it up after the transfer packets.
+             */
+            if (NT_SUCCESS(status)){
+                ClasspInitializeIoScheduler(DeviceObject);
+            }
         }
 
         //
@@ -1678,10 +1686,10 @@ NTSTATUS NTAPI ClassReadWrite(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp)
                              commonExtension->PartitionZeroExtension->DMByteSkew;
 
                         /*
-                         *  Perform the actual transfer(s) on the hardware
-                         *  to service this request.
+                         *  Queue the request in the read/write scheduler,
+                         *  which performs the actual transfer(s) on the hardware.
                          */
-                        ServiceTransferRequest(DeviceObject, Irp);
+                        ClasspQueueIoRequest(DeviceObject, Irp);
                         status = STATUS_PENDING;
                     }
                     else {
@@ -4958,6 +4966,52 @@ ClassDeviceControl(
         break;
     }
 
+    case IOCTL_CLASS_QUERY_IO_SCHEDULER_STATISTICS: {
+
+        if (srb) {
+            ExFreePool(srb);
+            srb = NULL;
+        }
+
+        if(irpStack->Parameters.DeviceIoControl.OutputBufferLength <
+           sizeof(CLASS_IO_SCHEDULER_STATISTICS)) {
+
+            //
+            // Indicate unsuccessful status and no data transferred.
+            //
+
+            Irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+            Irp->IoStatus.Information = sizeof(CLASS_IO_SCHEDULER_STATISTICS);
+
+            ClassReleaseRemoveLock(DeviceObject, Irp);
+            ClassCompleteRequest(DeviceObject, Irp, IO_NO_INCREMENT);
+            status = STATUS_BUFFER_TOO_SMALL;
+
+        } else if(!commonExtension->IsFdo) {
+
+            //
+            // The scheduler lives in the FDO, forward this down
+            //
+
+            IoCopyCurrentIrpStackLocationToNext(Irp);
+
+            ClassReleaseRemoveLock(DeviceObject, Irp);
+            status = IoCallDriver(commonExtension->LowerDeviceObject, Irp);
+
+        } else {
+
+            ClasspQueryIoSchedulerStatistics(DeviceObject,
+                                             Irp->AssociatedIrp.SystemBuffer);
+            Irp->IoStatus.Status = STATUS_SUCCESS;
+            Irp->IoStatus.Information = sizeof(CLASS_IO_SCHEDULER_STATISTICS);
+            ClassReleaseRemoveLock(DeviceObject, Irp);
+            ClassCompleteRequest(DeviceObject, Irp, IO_NO_INCREMENT);
+            status = STATUS_SUCCESS;
+
+        }
+        break;
+    }
+
     case IOCTL_STORAGE_SET_HOTPLUG_INFO: {
 
         if (srb)
@@ -32,6 +32,7 @@ Revision History:
 #include <classpnp.h>
 #include <ioevent.h>
 #include <pseh/pseh2.h>
+#include <reactos/drivers/ntddiosched.h>
 
 extern CLASSPNP_SCAN_FOR_SPECIAL_INFO ClassBadItems[];
 
@@ -45,6 +46,7 @@ extern GUID ClassGuidQueryRegInfoEx;
 #define CLASSP_REG_WRITE_CACHE_VALUE_NAME       (L"WriteCacheEnableOverride")
 #define CLASSP_REG_PERF_RESTORE_VALUE_NAME      (L"RestorePerfAtCount")
 #define CLASSP_REG_REMOVAL_POLICY_VALUE_NAME    (L"UserRemovalPolicy")
+#define CLASSP_REG_IO_SCHEDULER_VALUE_NAME      (L"IoScheduler")
 
 #define CLASS_PERF_RESTORE_MINIMUM (0x10)
 #define CLASS_ERROR_LEVEL_1 (0x4)
@@ -82,6 +84,7 @@ extern GUID ClassGuidQueryRegInfoEx;
 #define CLASS_TAG_PRIVATE_DATA              'CPcS'
 #define CLASS_TAG_PRIVATE_DATA_FDO          'FPcS'
 #define CLASS_TAG_PRIVATE_DATA_PDO          'PPcS'
+#define CLASS_TAG_IO_REQUEST                'QIcS'
 
 struct _MEDIA_CHANGE_DETECTION_INFO {
 
@@ -380,6 +383,84 @@ typedef struct _TRANSFER_PACKET {
 #define MAX_WORKINGSET_TRANSFER_PACKETS_Enterprise   2048
 
 
+/*
+ *  A CLASS_IO_REQUEST is one transfer waiting in the I/O scheduler.
+ *  It holds one client irp, or several whose disk ranges are contiguous
+ *  and whose buffers can be described by a single MDL; these are merged
+ *  into one transfer to the port driver.
+ */
+typedef struct _CLASS_IO_REQUEST {
+
+    LIST_ENTRY SortedListEntry;     // in the scheduler's offset-sorted list for Priority
+    LIST_ENTRY FifoListEntry;       // in the scheduler's arrival list for Priority
+
+    /*
+     *  Client irps, in disk order, linked through Irp->Tail.Overlay.ListEntry.
+     */
+    LIST_ENTRY IrpList;
+    ULONG NumIrps;
+
+    ULONGLONG Offset;               // from the beginning of the disk
+    ULONG Length;
+    ULONG IrpFlags;                 // paging flags of the client irps
+    UCHAR MajorFunction;
+    UCHAR StackFlags;
+    UCHAR Priority;                 // CLASS_IO_PRIORITY_xxx
+    BOOLEAN NoMerge;
+
+    ULONGLONG Deadline;             // interrupt time, taken from the first client irp
+
+    PDEVICE_OBJECT Fdo;
+    PMDL MergedMdl;                 // our own MDL when NumIrps > 1
+
+} CLASS_IO_REQUEST, *PCLASS_IO_REQUEST;
+
+/*
+ *  The scheduler's per-irp context, kept in Irp->Tail.Overlay.DriverContext
+ *  while the client irp waits in the scheduler.
+ */
+typedef struct _CLASS_IO_IRP_CONTEXT {
+    LARGE_INTEGER ArrivalTime;      // performance counter, for the latency histogram
+    ULONGLONG Deadline;             // interrupt time
+} CLASS_IO_IRP_CONTEXT, *PCLASS_IO_IRP_CONTEXT;
+
+C_ASSERT(sizeof(CLASS_IO_IRP_CONTEXT) <= 4 * sizeof(PVOID));
+
+#define CLASS_IO_IRP_CONTEXT(_irp) \
+    ((PCLASS_IO_IRP_CONTEXT)(_irp)->Tail.Overlay.DriverContext)
+
+typedef struct _CLASS_IO_SCHEDULER CLASS_IO_SCHEDULER, *PCLASS_IO_SCHEDULER;
+
+typedef PCLASS_IO_REQUEST (NTAPI *PCLASS_IO_SELECT_REQUEST)(PCLASS_IO_SCHEDULER Scheduler);
+
+struct _CLASS_IO_SCHEDULER {
+
+    KSPIN_LOCK Lock;
+
+    ULONG Policy;                   // CLASS_IO_SCHEDULER_xxx
+    PCLASS_IO_SELECT_REQUEST SelectRequest;
+
+    /*
+     *  Waiting requests of each priority class, once sorted by disk offset
+     *  (for the elevator and for finding merge candidates)
+     *  and once in arrival order (for deadlines).
+     */
+    LIST_ENTRY SortedList[CLASS_IO_PRIORITY_CLASSES];
+    LIST_ENTRY FifoList[CLASS_IO_PRIORITY_CLASSES];
+
+    ULONGLONG HeadPosition;         // end of the last dispatched transfer
+    ULONG MaxTransferLength;        // limit for merged requests
+    BOOLEAN Dispatching;            // a frame is draining the queue
+    LARGE_INTEGER PerfFrequency;
+
+    /*
+     *  QueueDepth, OutstandingCount and MaxOutstanding in here
+     *  are the live counters, not copies.
+     */
+    CLASS_IO_SCHEDULER_STATISTICS Stats;
+
+};
+
 //
 // add to the front of this structure to help prevent illegal
 // snooping by other utilities.
@@ -461,6 +542,11 @@ struct _CLASS_PRIVATE_FDO_DATA {
     ULONG ErrorLogNextIndex;
     CLASS_ERROR_LOG_DATA ErrorLogs[NUM_ERROR_LOG_ENTRIES];
 
+    /*
+     *  Read/write scheduler that sits in front of the transfer packet engine.
+     */
+    CLASS_IO_SCHEDULER IoScheduler;
+
 };
 
 
@@ -866,6 +952,9 @@ PMDL NTAPI BuildDeviceInputMdl(PVOID Buffer, ULONG BufferLen);
 VOID NTAPI FreeDeviceInputMdl(PMDL Mdl);
 NTSTATUS NTAPI InitializeTransferPackets(PDEVICE_OBJECT Fdo);
 VOID NTAPI DestroyAllTransferPackets(PDEVICE_OBJECT Fdo);
+VOID NTAPI ClasspInitializeIoScheduler(PDEVICE_OBJECT Fdo);
+VOID NTAPI ClasspQueueIoRequest(PDEVICE_OBJECT Fdo, PIRP Irp);
+VOID NTAPI ClasspQueryIoSchedulerStatistics(PDEVICE_OBJECT Fdo, PCLASS_IO_SCHEDULER_STATISTICS Stats);
 
 #include "debug.h"
 
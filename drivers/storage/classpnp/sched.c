@@ -0,0 +1,758 @@
+/*
+ * PROJECT:     ReactOS Storage Stack / ClassPnP
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Read/write scheduler in front of the transfer packet engine
+ */
+
+/*
+ *  Client read/write irps for the FDO are queued here instead of going
+ *  straight to ServiceTransferRequest.  Only a few transfers are kept at
+ *  the port driver at a time; the rest wait in the scheduler, where
+ *  requests for contiguous disk ranges are merged into one transfer and
+ *  the next transfer is picked by the scheduling policy:
+ *
+ *      CLASS_IO_SCHEDULER_NONE      - no queuing, the old behaviour.
+ *      CLASS_IO_SCHEDULER_FIFO      - arrival order.
+ *      CLASS_IO_SCHEDULER_DEADLINE  - elevator (C-LOOK) order within the most
+ *                                     important non-empty priority class,
+ *                                     unless a request has waited past its
+ *                                     deadline.
+ *
+ *  A dispatched request is sent to ServiceTransferRequest through a small
+ *  carrier irp of our own, so the transfer packet engine does not need
+ *  to know about merged requests.
+ */
+
+#include "classp.h"
+
+#ifdef ALLOC_PRAGMA
+    #pragma alloc_text(PAGE, ClasspInitializeIoScheduler)
+#endif
+
+
+/*
+ *  Number of transfers kept at the port driver.
+ *  Adapters that queue commands get a deeper window.
+ */
+#define CLASS_IO_MAX_OUTSTANDING            2
+#define CLASS_IO_MAX_OUTSTANDING_QUEUED     16
+
+/*
+ *  Limit on the number of client irps merged into one transfer.
+ */
+#define CLASS_IO_MAX_MERGED_IRPS            32
+
+/*
+ *  How long a request of each priority class may wait
+ *  before it is dispatched out of elevator order (100ns units).
+ */
+static const ULONGLONG ClasspIoDeadline[CLASS_IO_PRIORITY_CLASSES] = {
+    100 * 10000ULL,         // CLASS_IO_PRIORITY_HIGH: 100ms
+    500 * 10000ULL,         // CLASS_IO_PRIORITY_NORMAL: 500ms
+    5000 * 10000ULL         // CLASS_IO_PRIORITY_LOW: 5s
+};
+
+
+static NTSTATUS NTAPI ClasspIoRequestComplete(IN PDEVICE_OBJECT NullFdo, IN PIRP Irp, IN PVOID Context);
+
+
+/*
+ *  ClasspGetIoPriority
+ *
+ *      The kernel does not keep an I/O priority in the irp,
+ *      so derive one from the paging flags.
+ */
+static UCHAR ClasspGetIoPriority(PIRP Irp)
+{
+    PIO_STACK_LOCATION currentSp = IoGetCurrentIrpStackLocation(Irp);
+
+    if (TEST_FLAG(Irp->Flags, IRP_PAGING_IO)){
+        if (currentSp->MajorFunction == IRP_MJ_READ){
+            /*
+             *  Somebody is waiting on a page fault.
+             */
+            return CLASS_IO_PRIORITY_HIGH;
+        }
+        else if (!TEST_FLAG(Irp->Flags, IRP_SYNCHRONOUS_PAGING_IO)){
+            /*
+             *  Background write-behind of the modified and mapped page writers.
+             */
+            return CLASS_IO_PRIORITY_LOW;
+        }
+    }
+
+    return CLASS_IO_PRIORITY_NORMAL;
+}
+
+
+/*
+ *  ClasspIsIrpMergeable
+ *
+ *      An irp can only be merged if its buffer is described by exactly one MDL.
+ */
+static BOOLEAN ClasspIsIrpMergeable(PCLASS_IO_SCHEDULER Scheduler, PIRP Irp)
+{
+    PIO_STACK_LOCATION currentSp = IoGetCurrentIrpStackLocation(Irp);
+    PMDL mdl = Irp->MdlAddress;
+
+    return (mdl &&
+            !mdl->Next &&
+            (MmGetMdlByteCount(mdl) == currentSp->Parameters.Read.Length) &&
+            (currentSp->Parameters.Read.Length <= Scheduler->MaxTransferLength));
+}
+
+
+/*
+ *  ClasspCanJoinBuffers
+ *
+ *      The merged MDL is built by concatenating the page frame arrays of the
+ *      client MDLs, so the first buffer has to end on a page boundary and
+ *      the second one has to start on one.
+ */
+static BOOLEAN ClasspCanJoinBuffers(PIRP FirstIrp, PIRP SecondIrp)
+{
+    PMDL firstMdl = FirstIrp->MdlAddress;
+    PMDL secondMdl = SecondIrp->MdlAddress;
+
+    return ((((MmGetMdlByteOffset(firstMdl) + MmGetMdlByteCount(firstMdl)) & (PAGE_SIZE - 1)) == 0) &&
+            (MmGetMdlByteOffset(secondMdl) == 0));
+}
+
+
+static BOOLEAN ClasspCanMergeIntoRequest(PCLASS_IO_SCHEDULER Scheduler,
+                                         PCLASS_IO_REQUEST IoRequest,
+                                         PIO_STACK_LOCATION CurrentSp,
+                                         ULONG IrpFlags)
+{
+    return (!IoRequest->NoMerge &&
+            (IoRequest->MajorFunction == CurrentSp->MajorFunction) &&
+            (IoRequest->StackFlags == CurrentSp->Flags) &&
+            (IoRequest->IrpFlags == IrpFlags) &&
+            (IoRequest->NumIrps < CLASS_IO_MAX_MERGED_IRPS) &&
+            (CurrentSp->Parameters.Read.Length <= Scheduler->MaxTransferLength - IoRequest->Length));
+}
+
+
+/*
+ *  ClasspInsertSortedIoRequest
+ *
+ *      Inserts a request into its priority class's offset-sorted list.
+ */
+static VOID ClasspInsertSortedIoRequest(PCLASS_IO_SCHEDULER Scheduler, PCLASS_IO_REQUEST IoRequest)
+{
+    PLIST_ENTRY listHead = &Scheduler->SortedList[IoRequest->Priority];
+    PLIST_ENTRY listEntry;
+
+    for (listEntry = listHead->Flink; listEntry != listHead; listEntry = listEntry->Flink){
+        PCLASS_IO_REQUEST thisRequest = CONTAINING_RECORD(listEntry, CLASS_IO_REQUEST, SortedListEntry);
+        if (thisRequest->Offset > IoRequest->Offset){
+            break;
+        }
+    }
+
+    /*
+     *  Insert in front of listEntry (which may be the list head).
+     */
+    InsertTailList(listEntry, &IoRequest->SortedListEntry);
+}
+
+
+/*
+ *  ClasspInsertIoRequest
+ *
+ *      Adds a client irp to the scheduler, merging it into a waiting request
+ *      if one ends where it starts or starts where it ends.
+ *      Must be called with the scheduler lock held.
+ *      Returns FALSE if we could not allocate a new request.
+ */
+static BOOLEAN ClasspInsertIoRequest(PCLASS_IO_SCHEDULER Scheduler,
+                                     PDEVICE_OBJECT Fdo,
+                                     PIRP Irp,
+                                     UCHAR Priority,
+                                     BOOLEAN NoMerge)
+{
+    PIO_STACK_LOCATION currentSp = IoGetCurrentIrpStackLocation(Irp);
+    ULONGLONG offset = (ULONGLONG)currentSp->Parameters.Read.ByteOffset.QuadPart;
+    ULONG length = currentSp->Parameters.Read.Length;
+    ULONG irpFlags = Irp->Flags & (IRP_PAGING_IO | IRP_SYNCHRONOUS_PAGING_IO);
+    PCLASS_IO_REQUEST ioRequest;
+    PLIST_ENTRY listEntry;
+
+    NoMerge = NoMerge || !ClasspIsIrpMergeable(Scheduler, Irp);
+
+    if (!NoMerge){
+        for (listEntry = Scheduler->SortedList[Priority].Flink;
+             listEntry != &Scheduler->SortedList[Priority];
+             listEntry = listEntry->Flink){
+
+            ioRequest = CONTAINING_RECORD(listEntry, CLASS_IO_REQUEST, SortedListEntry);
+
+            if (ioRequest->Offset > offset + length){
+                /*
+                 *  The list is sorted, nothing further on can touch this irp.
+                 */
+                break;
+            }
+
+            if (!ClasspCanMergeIntoRequest(Scheduler, ioRequest, currentSp, irpFlags)){
+                continue;
+            }
+
+            if (ioRequest->Offset + ioRequest->Length == offset){
+                PIRP lastIrp = CONTAINING_RECORD(ioRequest->IrpList.Blink, IRP, Tail.Overlay.ListEntry);
+
+                if (ClasspCanJoinBuffers(lastIrp, Irp)){
+                    InsertTailList(&ioRequest->IrpList, &Irp->Tail.Overlay.ListEntry);
+                    ioRequest->Length += length;
+                    ioRequest->NumIrps++;
+                    Scheduler->Stats.BackMergeCount++;
+                    goto Queued;
+                }
+            }
+            else if (offset + length == ioRequest->Offset){
+                PIRP firstIrp = CONTAINING_RECORD(ioRequest->IrpList.Flink, IRP, Tail.Overlay.ListEntry);
+
+                if (ClasspCanJoinBuffers(Irp, firstIrp)){
+                    InsertHeadList(&ioRequest->IrpList, &Irp->Tail.Overlay.ListEntry);
+                    ioRequest->Offset = offset;
+                    ioRequest->Length += length;
+                    ioRequest->NumIrps++;
+                    Scheduler->Stats.FrontMergeCount++;
+
+                    /*
+                     *  The request moved down; keep the sorted list sorted.
+                     *  It keeps its place in the arrival list and the deadline
+                     *  of its oldest irp.
+                     */
+                    RemoveEntryList(&ioRequest->SortedListEntry);
+                    ClasspInsertSortedIoRequest(Scheduler, ioRequest);
+                    goto Queued;
+                }
+            }
+        }
+    }
+
+    ioRequest = ExAllocatePoolWithTag(NonPagedPool, sizeof(CLASS_IO_REQUEST), CLASS_TAG_IO_REQUEST);
+    if (!ioRequest){
+        return FALSE;
+    }
+
+    RtlZeroMemory(ioRequest, sizeof(CLASS_IO_REQUEST));
+    InitializeListHead(&ioRequest->IrpList);
+    InsertTailList(&ioRequest->IrpList, &Irp->Tail.Overlay.ListEntry);
+    ioRequest->NumIrps = 1;
+    ioRequest->Offset = offset;
+    ioRequest->Length = length;
+    ioRequest->IrpFlags = irpFlags;
+    ioRequest->MajorFunction = currentSp->MajorFunction;
+    ioRequest->StackFlags = currentSp->Flags;
+    ioRequest->Priority = Priority;
+    ioRequest->NoMerge = NoMerge;
+    ioRequest->Deadline = CLASS_IO_IRP_CONTEXT(Irp)->Deadline;
+    ioRequest->Fdo = Fdo;
+
+    ClasspInsertSortedIoRequest(Scheduler, ioRequest);
+    InsertTailList(&Scheduler->FifoList[Priority], &ioRequest->FifoListEntry);
+
+Queued:
+    Scheduler->Stats.QueueDepth++;
+    Scheduler->Stats.PeakQueueDepth = MAX(Scheduler->Stats.PeakQueueDepth, Scheduler->Stats.QueueDepth);
+    return TRUE;
+}
+
+
+/*
+ *  ClasspSelectFifo
+ *
+ *      Under the FIFO policy everything is queued as CLASS_IO_PRIORITY_NORMAL.
+ */
+static PCLASS_IO_REQUEST NTAPI ClasspSelectFifo(PCLASS_IO_SCHEDULER Scheduler)
+{
+    PLIST_ENTRY listHead = &Scheduler->FifoList[CLASS_IO_PRIORITY_NORMAL];
+
+    if (IsListEmpty(listHead)){
+        return NULL;
+    }
+
+    return CONTAINING_RECORD(listHead->Flink, CLASS_IO_REQUEST, FifoListEntry);
+}
+
+
+/*
+ *  ClasspSelectDeadline
+ *
+ *      A request whose deadline has passed goes first, most important class first.
+ *      Otherwise the most important non-empty class is served in C-LOOK order:
+ *      the first request at or beyond the head position, wrapping around
+ *      to the lowest offset.
+ */
+static PCLASS_IO_REQUEST NTAPI ClasspSelectDeadline(PCLASS_IO_SCHEDULER Scheduler)
+{
+    ULONGLONG now = KeQueryInterruptTime();
+    PCLASS_IO_REQUEST ioRequest;
+    PLIST_ENTRY listHead;
+    PLIST_ENTRY listEntry;
+    ULONG priority;
+
+    for (priority = 0; priority < CLASS_IO_PRIORITY_CLASSES; priority++){
+        listHead = &Scheduler->FifoList[priority];
+        if (!IsListEmpty(listHead)){
+            ioRequest = CONTAINING_RECORD(listHead->Flink, CLASS_IO_REQUEST, FifoListEntry);
+            if (ioRequest->Deadline <= now){
+                Scheduler->Stats.DeadlineExpiredCount++;
+                return ioRequest;
+            }
+        }
+    }
+
+    for (priority = 0; priority < CLASS_IO_PRIORITY_CLASSES; priority++){
+        listHead = &Scheduler->SortedList[priority];
+        if (IsListEmpty(listHead)){
+            continue;
+        }
+
+        /*
+         *  Background writes only get half of the window,
+         *  so that a page fault arriving behind them finds room at the device.
+         */
+        if ((priority == CLASS_IO_PRIORITY_LOW) &&
+            (Scheduler->Stats.OutstandingCount >= MAX(Scheduler->Stats.MaxOutstanding / 2, 1))){
+            return NULL;
+        }
+
+        for (listEntry = listHead->Flink; listEntry != listHead; listEntry = listEntry->Flink){
+            ioRequest = CONTAINING_RECORD(listEntry, CLASS_IO_REQUEST, SortedListEntry);
+            if (ioRequest->Offset >= Scheduler->HeadPosition){
+                return ioRequest;
+            }
+        }
+
+        return CONTAINING_RECORD(listHead->Flink, CLASS_IO_REQUEST, SortedListEntry);
+    }
+
+    return NULL;
+}
+
+
+/*
+ *  ClasspBuildMergedMdl
+ *
+ *      Builds one MDL describing the buffers of all the client irps of a merged
+ *      request.  It starts at the first client buffer's virtual address,
+ *      which is only used as the base for offsets into the MDL.
+ */
+static PMDL ClasspBuildMergedMdl(PCLASS_IO_REQUEST IoRequest)
+{
+    PIRP firstIrp = CONTAINING_RECORD(IoRequest->IrpList.Flink, IRP, Tail.Overlay.ListEntry);
+    PMDL mdl;
+
+    mdl = IoAllocateMdl(MmGetMdlVirtualAddress(firstIrp->MdlAddress), IoRequest->Length, FALSE, FALSE, NULL);
+    if (mdl){
+        PPFN_NUMBER pfnArray = MmGetMdlPfnArray(mdl);
+        PLIST_ENTRY listEntry;
+
+        for (listEntry = IoRequest->IrpList.Flink;
+             listEntry != &IoRequest->IrpList;
+             listEntry = listEntry->Flink){
+
+            PIRP irp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            PMDL clientMdl = irp->MdlAddress;
+            ULONG numPages = ADDRESS_AND_SIZE_TO_SPAN_PAGES(MmGetMdlVirtualAddress(clientMdl),
+                                                            MmGetMdlByteCount(clientMdl));
+
+            RtlCopyMemory(pfnArray, MmGetMdlPfnArray(clientMdl), numPages * sizeof(PFN_NUMBER));
+            pfnArray += numPages;
+        }
+
+        ASSERT(pfnArray == MmGetMdlPfnArray(mdl) +
+               ADDRESS_AND_SIZE_TO_SPAN_PAGES(MmGetMdlVirtualAddress(mdl), IoRequest->Length));
+
+        /*
+         *  The client MDLs are locked and stay so until we complete the client irps.
+         */
+        mdl->MdlFlags |= MDL_PAGES_LOCKED;
+    }
+
+    return mdl;
+}
+
+
+static VOID ClasspFreeMergedMdl(PMDL Mdl)
+{
+    if (Mdl->MdlFlags & MDL_MAPPED_TO_SYSTEM_VA){
+        MmUnmapLockedPages(Mdl->MappedSystemVa, Mdl);
+    }
+    IoFreeMdl(Mdl);
+}
+
+
+/*
+ *  ClasspRecordIoLatency
+ *
+ *      Adds a completed client irp to the latency histogram.
+ *      Must be called with the scheduler lock held.
+ */
+static VOID ClasspRecordIoLatency(PCLASS_IO_SCHEDULER Scheduler, PIRP Irp, LARGE_INTEGER Now)
+{
+    ULONGLONG elapsedTicks = (ULONGLONG)(Now.QuadPart - CLASS_IO_IRP_CONTEXT(Irp)->ArrivalTime.QuadPart);
+    ULONGLONG elapsedUs = (elapsedTicks * 1000000) / (ULONGLONG)Scheduler->PerfFrequency.QuadPart;
+    ULONGLONG bucketLimit = CLASS_IO_LATENCY_BASE_US;
+    ULONG bucket = 0;
+
+    while ((elapsedUs >= bucketLimit) && (bucket < CLASS_IO_LATENCY_BUCKETS - 1)){
+        bucketLimit <<= 1;
+        bucket++;
+    }
+
+    Scheduler->Stats.LatencyHistogram[bucket]++;
+}
+
+
+/*
+ *  ClasspIoRequestDone
+ *
+ *      Frees a request that is no longer at the port driver
+ *      and lets the next one go.
+ */
+static VOID ClasspIoRequestDone(PCLASS_IO_SCHEDULER Scheduler, PCLASS_IO_REQUEST IoRequest)
+{
+    KIRQL oldIrql;
+
+    KeAcquireSpinLock(&Scheduler->Lock, &oldIrql);
+    ASSERT(Scheduler->Stats.OutstandingCount > 0);
+    Scheduler->Stats.OutstandingCount--;
+    KeReleaseSpinLock(&Scheduler->Lock, oldIrql);
+
+    ExFreePool(IoRequest);
+}
+
+
+/*
+ *  ClasspSubmitIoRequest
+ *
+ *      Sends a dispatched request to the transfer packet engine
+ *      through a carrier irp.
+ */
+static VOID ClasspSubmitIoRequest(PCLASS_IO_SCHEDULER Scheduler, PCLASS_IO_REQUEST IoRequest)
+{
+    PDEVICE_OBJECT fdo = IoRequest->Fdo;
+    PIRP firstIrp = CONTAINING_RECORD(IoRequest->IrpList.Flink, IRP, Tail.Overlay.ListEntry);
+    PMDL mdl = firstIrp->MdlAddress;
+    PIRP carrierIrp = NULL;
+
+    if (IoRequest->NumIrps > 1){
+        mdl = IoRequest->MergedMdl = ClasspBuildMergedMdl(IoRequest);
+    }
+
+    if (mdl){
+        carrierIrp = IoAllocateIrp(1, FALSE);
+    }
+
+    if (carrierIrp){
+        PIO_STACK_LOCATION nextSp = IoGetNextIrpStackLocation(carrierIrp);
+
+        nextSp->MajorFunction = IoRequest->MajorFunction;
+        nextSp->Flags = IoRequest->StackFlags;
+        nextSp->Parameters.Read.ByteOffset.QuadPart = IoRequest->Offset;
+        nextSp->Parameters.Read.Length = IoRequest->Length;
+        nextSp->DeviceObject = fdo;
+        IoSetCompletionRoutine(carrierIrp, ClasspIoRequestComplete, IoRequest, TRUE, TRUE, TRUE);
+
+        /*
+         *  Make our stack location the current one,
+         *  as if the carrier had been sent to us.
+         */
+        IoSetNextIrpStackLocation(carrierIrp);
+
+        carrierIrp->MdlAddress = mdl;
+        carrierIrp->Flags |= IoRequest->IrpFlags;
+
+        /*
+         *  TransferPktComplete releases this when the transfer completes.
+         */
+        ClassAcquireRemoveLock(fdo, carrierIrp);
+        ServiceTransferRequest(fdo, carrierIrp);
+    }
+    else {
+        /*
+         *  Out of memory.  Send the client irps down one by one,
+         *  the way they would have gone without the scheduler.
+         */
+        DBGWARN(("ClasspSubmitIoRequest: no carrier irp for request %ph, sending its %d irps directly.", IoRequest, IoRequest->NumIrps));
+
+        if (IoRequest->MergedMdl){
+            ClasspFreeMergedMdl(IoRequest->MergedMdl);
+            IoRequest->MergedMdl = NULL;
+        }
+
+        while (!IsListEmpty(&IoRequest->IrpList)){
+            PLIST_ENTRY listEntry = RemoveHeadList(&IoRequest->IrpList);
+            PIRP irp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            ServiceTransferRequest(fdo, irp);
+        }
+
+        ClasspIoRequestDone(Scheduler, IoRequest);
+    }
+}
+
+
+/*
+ *  ClasspDispatchIoRequests
+ *
+ *      Sends waiting requests to the port driver while there is room.
+ *
+ *      A carrier completed synchronously by the port driver calls back in here
+ *      through ClasspIoRequestComplete; only the outermost frame drains the queue,
+ *      and it stops draining in the same lock hold that finds nothing left to send.
+ */
+static VOID ClasspDispatchIoRequests(PDEVICE_OBJECT Fdo)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_IO_SCHEDULER scheduler = &fdoExt->PrivateFdoData->IoScheduler;
+    PCLASS_IO_REQUEST ioRequest;
+    BOOLEAN draining = FALSE;
+    KIRQL oldIrql;
+
+    for (;;){
+        ioRequest = NULL;
+
+        KeAcquireSpinLock(&scheduler->Lock, &oldIrql);
+        if (!draining){
+            if (scheduler->Dispatching){
+                KeReleaseSpinLock(&scheduler->Lock, oldIrql);
+                break;
+            }
+            scheduler->Dispatching = draining = TRUE;
+        }
+        if (scheduler->Stats.OutstandingCount < scheduler->Stats.MaxOutstanding){
+            ioRequest = scheduler->SelectRequest(scheduler);
+            if (ioRequest){
+                RemoveEntryList(&ioRequest->SortedListEntry);
+                RemoveEntryList(&ioRequest->FifoListEntry);
+                scheduler->HeadPosition = ioRequest->Offset + ioRequest->Length;
+                scheduler->Stats.QueueDepth -= ioRequest->NumIrps;
+                scheduler->Stats.OutstandingCount++;
+                scheduler->Stats.DispatchCount++;
+            }
+        }
+        if (!ioRequest){
+            scheduler->Dispatching = FALSE;
+        }
+        KeReleaseSpinLock(&scheduler->Lock, oldIrql);
+
+        if (!ioRequest){
+            break;
+        }
+
+        ClasspSubmitIoRequest(scheduler, ioRequest);
+    }
+}
+
+
+/*
+ *  ClasspIoRequestComplete
+ *
+ *      Completion routine for carrier irps.
+ *      Completes the client irps of the request and dispatches more.
+ */
+static NTSTATUS NTAPI ClasspIoRequestComplete(IN PDEVICE_OBJECT NullFdo, IN PIRP Irp, IN PVOID Context)
+{
+    PCLASS_IO_REQUEST ioRequest = (PCLASS_IO_REQUEST)Context;
+    PDEVICE_OBJECT fdo = ioRequest->Fdo;
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = fdo->DeviceExtension;
+    PCLASS_IO_SCHEDULER scheduler = &fdoExt->PrivateFdoData->IoScheduler;
+    NTSTATUS status = Irp->IoStatus.Status;
+    LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+    LIST_ENTRY directIrpList;
+    PLIST_ENTRY listEntry;
+    PIRP clientIrp;
+    KIRQL oldIrql;
+    UCHAR uniqueAddr;
+
+    /*
+     *  In case a remove is pending, bump the lock count so we don't get freed
+     *  right after we complete the last client irp.
+     */
+    ClassAcquireRemoveLock(fdo, (PIRP)&uniqueAddr);
+
+    if (ioRequest->MergedMdl){
+        ClasspFreeMergedMdl(ioRequest->MergedMdl);
+        ioRequest->MergedMdl = NULL;
+    }
+    IoFreeIrp(Irp);
+
+    InitializeListHead(&directIrpList);
+
+    if (!NT_SUCCESS(status) && (ioRequest->NumIrps > 1)){
+        /*
+         *  Retry the client irps of a failed merged transfer on their own,
+         *  so that a bad sector only fails the irp that covers it.
+         */
+        DBGWARN(("ClasspIoRequestComplete: merged request %ph failed with %xh, splitting it.", ioRequest, status));
+
+        KeAcquireSpinLock(&scheduler->Lock, &oldIrql);
+        while (!IsListEmpty(&ioRequest->IrpList)){
+            listEntry = RemoveHeadList(&ioRequest->IrpList);
+            clientIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            if (!ClasspInsertIoRequest(scheduler, fdo, clientIrp, ioRequest->Priority, TRUE)){
+                InsertTailList(&directIrpList, &clientIrp->Tail.Overlay.ListEntry);
+            }
+        }
+        KeReleaseSpinLock(&scheduler->Lock, oldIrql);
+
+        while (!IsListEmpty(&directIrpList)){
+            listEntry = RemoveHeadList(&directIrpList);
+            clientIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            ServiceTransferRequest(fdo, clientIrp);
+        }
+    }
+    else {
+        while (!IsListEmpty(&ioRequest->IrpList)){
+            listEntry = RemoveHeadList(&ioRequest->IrpList);
+            clientIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+
+            if (NT_SUCCESS(status)){
+                clientIrp->IoStatus.Status = STATUS_SUCCESS;
+                clientIrp->IoStatus.Information = IoGetCurrentIrpStackLocation(clientIrp)->Parameters.Read.Length;
+            }
+            else {
+                clientIrp->IoStatus.Status = status;
+                clientIrp->IoStatus.Information = 0;
+
+                /*
+                 *  The carrier has no thread, so the transfer packet engine
+                 *  could not alert the user; do it for the client irp.
+                 */
+                if (IoIsErrorUserInduced(status) && clientIrp->Tail.Overlay.Thread){
+                    IoSetHardErrorOrVerifyDevice(clientIrp, fdo);
+                }
+            }
+
+            KeAcquireSpinLock(&scheduler->Lock, &oldIrql);
+            ClasspRecordIoLatency(scheduler, clientIrp, now);
+            KeReleaseSpinLock(&scheduler->Lock, oldIrql);
+
+            ClassReleaseRemoveLock(fdo, clientIrp);
+            ClassCompleteRequest(fdo, clientIrp, IO_DISK_INCREMENT);
+        }
+    }
+
+    ClasspIoRequestDone(scheduler, ioRequest);
+    ClasspDispatchIoRequests(fdo);
+
+    ClassReleaseRemoveLock(fdo, (PIRP)&uniqueAddr);
+
+    return STATUS_MORE_PROCESSING_REQUIRED;
+}
+
+
+/*
+ *  ClasspQueueIoRequest
+ *
+ *      Entry point for client read/write irps on the FDO,
+ *      called instead of ServiceTransferRequest.
+ *      The irp's byte offset is already relative to the beginning of the disk.
+ */
+VOID NTAPI ClasspQueueIoRequest(PDEVICE_OBJECT Fdo, PIRP Irp)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_IO_SCHEDULER scheduler = &fdoExt->PrivateFdoData->IoScheduler;
+    PCLASS_IO_IRP_CONTEXT irpContext = CLASS_IO_IRP_CONTEXT(Irp);
+    BOOLEAN queued;
+    UCHAR priority;
+    KIRQL oldIrql;
+
+    if (scheduler->Policy == CLASS_IO_SCHEDULER_NONE){
+        ServiceTransferRequest(Fdo, Irp);
+        return;
+    }
+
+    priority = ClasspGetIoPriority(Irp);
+    irpContext->ArrivalTime = KeQueryPerformanceCounter(NULL);
+    irpContext->Deadline = KeQueryInterruptTime() + ClasspIoDeadline[priority];
+
+    /*
+     *  The irp will complete on a different thread.
+     */
+    IoMarkIrpPending(Irp);
+
+    KeAcquireSpinLock(&scheduler->Lock, &oldIrql);
+    scheduler->Stats.RequestCount++;
+    scheduler->Stats.PriorityRequestCount[priority]++;
+    if (scheduler->Policy == CLASS_IO_SCHEDULER_FIFO){
+        priority = CLASS_IO_PRIORITY_NORMAL;
+    }
+    queued = ClasspInsertIoRequest(scheduler, Fdo, Irp, priority, FALSE);
+    KeReleaseSpinLock(&scheduler->Lock, oldIrql);
+
+    if (queued){
+        ClasspDispatchIoRequests(Fdo);
+    }
+    else {
+        DBGWARN(("ClasspQueueIoRequest: no memory to queue irp %ph, sending it directly.", Irp));
+        ServiceTransferRequest(Fdo, Irp);
+    }
+}
+
+
+/*
+ *  ClasspQueryIoSchedulerStatistics
+ *
+ *      Returns a snapshot of the scheduler statistics.
+ */
+VOID NTAPI ClasspQueryIoSchedulerStatistics(PDEVICE_OBJECT Fdo, PCLASS_IO_SCHEDULER_STATISTICS Stats)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_IO_SCHEDULER scheduler = &fdoExt->PrivateFdoData->IoScheduler;
+    KIRQL oldIrql;
+
+    KeAcquireSpinLock(&scheduler->Lock, &oldIrql);
+    *Stats = scheduler->Stats;
+    KeReleaseSpinLock(&scheduler->Lock, oldIrql);
+}
+
+
+/*
+ *  ClasspInitializeIoScheduler
+ *
+ *      Called at start time, after the transfer packets have been set up.
+ */
+VOID NTAPI ClasspInitializeIoScheduler(PDEVICE_OBJECT Fdo)
+{
+    PCOMMON_DEVICE_EXTENSION commonExt = Fdo->DeviceExtension;
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PSTORAGE_ADAPTER_DESCRIPTOR adapterDesc = commonExt->PartitionZeroExtension->AdapterDescriptor;
+    PCLASS_IO_SCHEDULER scheduler = &fdoExt->PrivateFdoData->IoScheduler;
+    ULONG policy = CLASS_IO_SCHEDULER_DEADLINE;
+    ULONG i;
+
+    PAGED_CODE();
+
+    ClassGetDeviceParameter(fdoExt,
+                            CLASSP_REG_SUBKEY_NAME,
+                            CLASSP_REG_IO_SCHEDULER_VALUE_NAME,
+                            &policy);
+    if (policy > CLASS_IO_SCHEDULER_DEADLINE){
+        DBGWARN(("ClasspInitializeIoScheduler: unknown policy %d, using the default.", policy));
+        policy = CLASS_IO_SCHEDULER_DEADLINE;
+    }
+
+    KeInitializeSpinLock(&scheduler->Lock);
+    for (i = 0; i < CLASS_IO_PRIORITY_CLASSES; i++){
+        InitializeListHead(&scheduler->SortedList[i]);
+        InitializeListHead(&scheduler->FifoList[i]);
+    }
+
+    scheduler->Policy = policy;
+    scheduler->SelectRequest = (policy == CLASS_IO_SCHEDULER_FIFO) ? ClasspSelectFifo : ClasspSelectDeadline;
+    scheduler->HeadPosition = 0;
+    scheduler->Dispatching = FALSE;
+    scheduler->MaxTransferLength = fdoExt->PrivateFdoData->HwMaxXferLen;
+    KeQueryPerformanceCounter(&scheduler->PerfFrequency);
+
+    RtlZeroMemory(&scheduler->Stats, sizeof(CLASS_IO_SCHEDULER_STATISTICS));
+    scheduler->Stats.Version = sizeof(CLASS_IO_SCHEDULER_STATISTICS);
+    scheduler->Stats.Policy = policy;
+    scheduler->Stats.MaxOutstanding = (adapterDesc && adapterDesc->CommandQueueing) ?
+                                      CLASS_IO_MAX_OUTSTANDING_QUEUED : CLASS_IO_MAX_OUTSTANDING;
+}
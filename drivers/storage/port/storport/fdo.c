@@ -24,8 +24,8 @@ PortFdoInterruptRoutine(
 {
     PFDO_DEVICE_EXTENSION DeviceExtension;
 
-    DPRINT1("PortFdoInterruptRoutine(%p %p)\n",
-            Interrupt, ServiceContext);
+    DPRINT("PortFdoInterruptRoutine(%p %p)\n",
+           Interrupt, ServiceContext);
 
     DeviceExtension = (PFDO_DEVICE_EXTENSION)ServiceContext;
 
@@ -99,6 +99,45 @@ PortFdoConnectInterrupt(
 }
 
 
+static
+NTSTATUS
+PortFdoCreateDmaAdapter(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    PPORT_CONFIGURATION_INFORMATION PortConfig = &DeviceExtension->Miniport.PortConfig;
+    DEVICE_DESCRIPTION DeviceDescription;
+    ULONG NumberOfMapRegisters;
+
+    DPRINT1("PortFdoCreateDmaAdapter(%p)\n",
+            DeviceExtension);
+
+    /* PIO-only adapters do not need an adapter object */
+    if (!PortConfig->Master || DeviceExtension->DmaAdapter != NULL)
+        return STATUS_SUCCESS;
+
+    RtlZeroMemory(&DeviceDescription, sizeof(DEVICE_DESCRIPTION));
+    DeviceDescription.Version = DEVICE_DESCRIPTION_VERSION;
+    DeviceDescription.Master = TRUE;
+    DeviceDescription.ScatterGather = TRUE;
+    DeviceDescription.Dma32BitAddresses = PortConfig->Dma32BitAddresses;
+    DeviceDescription.Dma64BitAddresses = (PortConfig->Dma64BitAddresses != 0);
+    DeviceDescription.InterfaceType = PortConfig->AdapterInterfaceType;
+    DeviceDescription.BusNumber = PortConfig->SystemIoBusNumber;
+    DeviceDescription.MaximumLength = PortConfig->MaximumTransferLength;
+
+    DeviceExtension->DmaAdapter = IoGetDmaAdapter(DeviceExtension->PhysicalDevice,
+                                                  &DeviceDescription,
+                                                  &NumberOfMapRegisters);
+    if (DeviceExtension->DmaAdapter == NULL)
+    {
+        DPRINT1("IoGetDmaAdapter() failed\n");
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
 static
 NTSTATUS
 PortFdoStartMiniport(
@@ -139,6 +178,17 @@ PortFdoStartMiniport(
         return Status;
     }
 
+    /* The miniport has set up its DMA capabilities now */
+    Status = PortFdoCreateDmaAdapter(DeviceExtension);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("PortFdoCreateDmaAdapter() failed (Status 0x%08lx)\n", Status);
+        return Status;
+    }
+
+    PortInitializeRequestData(DeviceExtension,
+                              DeviceExtension->Miniport.PortConfig.SrbExtensionSize);
+
     /* Connect the configured interrupt */
     Status = PortFdoConnectInterrupt(DeviceExtension);
     if (!NT_SUCCESS(Status))
@@ -243,20 +293,245 @@ PortFdoStartDevice(
 }
 
 
+static
+NTSTATUS
+NTAPI
+PortFdoInquiryCompletion(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ PVOID Context)
+{
+    KeSetEvent((PKEVENT)Context, IO_NO_INCREMENT, FALSE);
+    return STATUS_MORE_PROCESSING_REQUIRED;
+}
+
+
+static
+NTSTATUS
+PortFdoSendInquiry(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PUNIT_DATA Unit,
+    _In_ PINQUIRYDATA InquiryBuffer)
+{
+    SCSI_REQUEST_BLOCK Srb;
+    PIO_STACK_LOCATION Stack;
+    LARGE_INTEGER Timeout;
+    KEVENT Event;
+    PIRP Irp;
+    PMDL Mdl;
+    NTSTATUS Status;
+
+    Irp = IoAllocateIrp(DeviceExtension->Device->StackSize, FALSE);
+    if (Irp == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    Mdl = IoAllocateMdl(InquiryBuffer,
+                        INQUIRYDATABUFFERSIZE,
+                        FALSE,
+                        FALSE,
+                        Irp);
+    if (Mdl == NULL)
+    {
+        IoFreeIrp(Irp);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    MmBuildMdlForNonPagedPool(Mdl);
+
+    RtlZeroMemory(InquiryBuffer, INQUIRYDATABUFFERSIZE);
+    RtlZeroMemory(&Srb, sizeof(SCSI_REQUEST_BLOCK));
+    Srb.Length = sizeof(SCSI_REQUEST_BLOCK);
+    Srb.Function = SRB_FUNCTION_EXECUTE_SCSI;
+    Srb.PathId = Unit->PathId;
+    Srb.TargetId = Unit->TargetId;
+    Srb.Lun = Unit->Lun;
+    Srb.SrbFlags = SRB_FLAGS_DATA_IN | SRB_FLAGS_DISABLE_AUTOSENSE | SRB_FLAGS_DISABLE_SYNCH_TRANSFER;
+    Srb.DataBuffer = InquiryBuffer;
+    Srb.DataTransferLength = INQUIRYDATABUFFERSIZE;
+    Srb.TimeOutValue = 4;
+    Srb.CdbLength = 6;
+    Srb.Cdb[0] = SCSIOP_INQUIRY;
+    Srb.Cdb[4] = INQUIRYDATABUFFERSIZE;
+
+    KeInitializeEvent(&Event, NotificationEvent, FALSE);
+
+    Stack = IoGetNextIrpStackLocation(Irp);
+    Stack->MajorFunction = IRP_MJ_SCSI;
+    Stack->Parameters.Scsi.Srb = &Srb;
+
+    IoSetCompletionRoutine(Irp,
+                           PortFdoInquiryCompletion,
+                           &Event,
+                           TRUE,
+                           TRUE,
+                           TRUE);
+
+    /* The request goes through our own queues */
+    Status = IoCallDriver(DeviceExtension->Device, Irp);
+    if (Status == STATUS_PENDING)
+    {
+        /* Do not let a hung miniport stall the PnP thread */
+        Timeout.QuadPart = (LONGLONG)Srb.TimeOutValue * -10000000LL;
+        Status = KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, &Timeout);
+        if (Status == STATUS_TIMEOUT)
+        {
+            DPRINT1("Inquiry timed out at %u/%u/%u\n",
+                    Unit->PathId, Unit->TargetId, Unit->Lun);
+
+            /* The SRB lives on our stack, so wait for the aborted request to come back */
+            PortAbortUnitRequests(Unit, SRB_STATUS_TIMEOUT);
+            KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
+        }
+    }
+
+    if (SRB_STATUS(Srb.SrbStatus) == SRB_STATUS_SUCCESS ||
+        SRB_STATUS(Srb.SrbStatus) == SRB_STATUS_DATA_OVERRUN)
+        Status = STATUS_SUCCESS;
+    else
+        Status = STATUS_NO_SUCH_DEVICE;
+
+    IoFreeMdl(Mdl);
+    Irp->MdlAddress = NULL;
+    IoFreeIrp(Irp);
+
+    return Status;
+}
+
+
+static
+NTSTATUS
+PortFdoScanBus(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    PPORT_CONFIGURATION_INFORMATION PortConfig = &DeviceExtension->Miniport.PortConfig;
+    PINQUIRYDATA InquiryBuffer;
+    PUNIT_DATA Unit;
+    ULONG Bus, Target, Lun;
+    ULONG NumberOfBuses;
+    ULONG UnitCount = 0;
+    NTSTATUS Status;
+
+    DPRINT1("PortFdoScanBus(%p)\n",
+            DeviceExtension);
+
+    InquiryBuffer = ExAllocatePoolWithTag(NonPagedPool,
+                                          INQUIRYDATABUFFERSIZE,
+                                          TAG_INQUIRY_DATA);
+    if (InquiryBuffer == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    NumberOfBuses = max(PortConfig->NumberOfBuses, 1);
+
+    for (Bus = 0; Bus < NumberOfBuses; Bus++)
+    {
+        for (Target = 0; Target < PortConfig->MaximumNumberOfTargets; Target++)
+        {
+            for (Lun = 0; Lun < PortConfig->MaximumNumberOfLogicalUnits; Lun++)
+            {
+                /* Units found by an earlier scan stay */
+                if (PortFindUnit(DeviceExtension, Bus, Target, Lun) != NULL)
+                    continue;
+
+                Unit = PortCreateUnit(DeviceExtension, Bus, Target, Lun);
+                if (Unit == NULL)
+                {
+                    ExFreePoolWithTag(InquiryBuffer, TAG_INQUIRY_DATA);
+                    return STATUS_INSUFFICIENT_RESOURCES;
+                }
+
+                Status = PortFdoSendInquiry(DeviceExtension, Unit, InquiryBuffer);
+
+                /* Qualifier 3: no device supported at this unit */
+                if (NT_SUCCESS(Status) &&
+                    InquiryBuffer->DeviceTypeQualifier != 3)
+                {
+                    DPRINT1("Found device type %u at %lu/%lu/%lu\n",
+                            InquiryBuffer->DeviceType, Bus, Target, Lun);
+                    RtlCopyMemory(&Unit->InquiryData,
+                                  InquiryBuffer,
+                                  INQUIRYDATABUFFERSIZE);
+
+                    /* Class drivers attach to the PDO */
+                    Status = PortCreatePdo(DeviceExtension, Unit);
+                    if (NT_SUCCESS(Status))
+                        UnitCount++;
+                    else
+                        PortDeleteUnit(Unit);
+                }
+                else
+                {
+                    PortDeleteUnit(Unit);
+                }
+            }
+        }
+    }
+
+    ExFreePoolWithTag(InquiryBuffer, TAG_INQUIRY_DATA);
+
+    DPRINT1("PortFdoScanBus(%p) found %lu new units\n",
+            DeviceExtension, UnitCount);
+
+    return STATUS_SUCCESS;
+}
+
+
 static
 NTSTATUS
 PortFdoQueryBusRelations(
     _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
     _Out_ PULONG_PTR Information)
 {
-    NTSTATUS Status = STATUS_SUCCESS;;
+    PDEVICE_RELATIONS DeviceRelations;
+    PLIST_ENTRY Entry;
+    PUNIT_DATA Unit;
+    ULONG Count, Size;
+    KIRQL OldIrql;
 
     DPRINT1("PortFdoQueryBusRelations(%p %p)\n",
             DeviceExtension, Information);
 
-    *Information = 0;
+    /* Find the units the requests can be sent to */
+    PortFdoScanBus(DeviceExtension);
 
-    return Status;
+    /* The scan is the only one adding units, so the count holds while we allocate */
+    Count = 0;
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    for (Entry = DeviceExtension->UnitListHead.Flink;
+         Entry != &DeviceExtension->UnitListHead;
+         Entry = Entry->Flink)
+    {
+        Unit = CONTAINING_RECORD(Entry, UNIT_DATA, UnitListEntry);
+        if (Unit->Device != NULL)
+            Count++;
+    }
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    Size = FIELD_OFFSET(DEVICE_RELATIONS, Objects) + Count * sizeof(PDEVICE_OBJECT);
+    DeviceRelations = ExAllocatePoolWithTag(PagedPool,
+                                            max(Size, sizeof(DEVICE_RELATIONS)),
+                                            TAG_RELATIONS);
+    if (DeviceRelations == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    DeviceRelations->Count = 0;
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    for (Entry = DeviceExtension->UnitListHead.Flink;
+         Entry != &DeviceExtension->UnitListHead && DeviceRelations->Count < Count;
+         Entry = Entry->Flink)
+    {
+        Unit = CONTAINING_RECORD(Entry, UNIT_DATA, UnitListEntry);
+        if (Unit->Device == NULL)
+            continue;
+
+        /* The PnP manager drops the reference */
+        ObReferenceObject(Unit->Device);
+        DeviceRelations->Objects[DeviceRelations->Count++] = Unit->Device;
+    }
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    *Information = (ULONG_PTR)DeviceRelations;
+
+    return STATUS_SUCCESS;
 }
 
 
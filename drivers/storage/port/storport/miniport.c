@@ -353,13 +353,59 @@ MiniportHwInterrupt(
 {
     BOOLEAN Result;
 
-    DPRINT1("MiniportHwInterrupt(%p)\n",
-            Miniport);
+    DPRINT("MiniportHwInterrupt(%p)\n",
+           Miniport);
 
     Result = Miniport->InitData->HwInterrupt(&Miniport->MiniportExtension->HwDeviceExtension);
-    DPRINT1("HwInterrupt() returned %u\n", Result);
+    DPRINT("HwInterrupt() returned %u\n", Result);
 
     return Result;
 }
 
+
+BOOLEAN
+MiniportHwBuildIo(
+    _In_ PMINIPORT Miniport,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    DPRINT("MiniportHwBuildIo(%p %p)\n",
+           Miniport, Srb);
+
+    /* HwBuildIo is optional */
+    if (Miniport->InitData->HwBuildIo == NULL)
+        return TRUE;
+
+    return Miniport->InitData->HwBuildIo(&Miniport->MiniportExtension->HwDeviceExtension,
+                                         Srb);
+}
+
+
+BOOLEAN
+MiniportHwStartIo(
+    _In_ PMINIPORT Miniport,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    DPRINT("MiniportHwStartIo(%p %p)\n",
+           Miniport, Srb);
+
+    return Miniport->InitData->HwStartIo(&Miniport->MiniportExtension->HwDeviceExtension,
+                                         Srb);
+}
+
+
+BOOLEAN
+MiniportHwResetBus(
+    _In_ PMINIPORT Miniport,
+    _In_ ULONG PathId)
+{
+    DPRINT("MiniportHwResetBus(%p %lu)\n",
+           Miniport, PathId);
+
+    if (Miniport->InitData->HwResetBus == NULL)
+        return FALSE;
+
+    return Miniport->InitData->HwResetBus(&Miniport->MiniportExtension->HwDeviceExtension,
+                                          PathId);
+}
+
 /* EOF */
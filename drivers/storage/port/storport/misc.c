@@ -370,6 +370,114 @@ AllocateAddressMapping(
     return STATUS_SUCCESS;
 }
 
+
+NTSTATUS
+TranslateSrbStatus(
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    switch (SRB_STATUS(Srb->SrbStatus))
+    {
+        case SRB_STATUS_SUCCESS:
+        case SRB_STATUS_DATA_OVERRUN:
+            /* Overruns are underruns as well, DataTransferLength holds the actual size */
+            return STATUS_SUCCESS;
+
+        case SRB_STATUS_INVALID_LUN:
+        case SRB_STATUS_INVALID_TARGET_ID:
+        case SRB_STATUS_NO_DEVICE:
+        case SRB_STATUS_NO_HBA:
+            return STATUS_DEVICE_DOES_NOT_EXIST;
+
+        case SRB_STATUS_TIMEOUT:
+        case SRB_STATUS_COMMAND_TIMEOUT:
+            return STATUS_IO_TIMEOUT;
+
+        case SRB_STATUS_SELECTION_TIMEOUT:
+            return STATUS_DEVICE_NOT_CONNECTED;
+
+        case SRB_STATUS_BAD_FUNCTION:
+        case SRB_STATUS_INVALID_REQUEST:
+            return STATUS_INVALID_DEVICE_REQUEST;
+
+        case SRB_STATUS_ABORTED:
+        case SRB_STATUS_REQUEST_FLUSHED:
+            return STATUS_CANCELLED;
+
+        default:
+            return STATUS_IO_DEVICE_ERROR;
+    }
+}
+
+static
+NTSTATUS
+OpenRegistryKey(
+    _In_opt_ HANDLE RootHandle,
+    _In_ PUNICODE_STRING KeyName,
+    _In_ BOOLEAN Create,
+    _Out_ PHANDLE KeyHandle)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               KeyName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               RootHandle,
+                               NULL);
+
+    if (Create)
+        return ZwCreateKey(KeyHandle,
+                           KEY_ALL_ACCESS,
+                           &ObjectAttributes,
+                           0,
+                           NULL,
+                           REG_OPTION_NON_VOLATILE,
+                           NULL);
+
+    return ZwOpenKey(KeyHandle,
+                     KEY_READ,
+                     &ObjectAttributes);
+}
+
+
+NTSTATUS
+OpenDeviceParametersKey(
+    _In_ PUNICODE_STRING RegistryPath,
+    _In_ ULONG DeviceNumber,
+    _In_ BOOLEAN Create,
+    _Out_ PHANDLE KeyHandle)
+{
+    UNICODE_STRING KeyName;
+    WCHAR NameBuffer[32];
+    HANDLE ServiceKey, ParametersKey;
+    NTSTATUS Status;
+
+    DPRINT("OpenDeviceParametersKey(%wZ %ld %u)\n",
+           RegistryPath, DeviceNumber, Create);
+
+    /* A device number of -1 selects the global 'Parameters\Device' key */
+    if (DeviceNumber == (ULONG)-1)
+        swprintf(NameBuffer, L"Device");
+    else
+        swprintf(NameBuffer, L"Device%lu", DeviceNumber);
+
+    Status = OpenRegistryKey(NULL, RegistryPath, FALSE, &ServiceKey);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    RtlInitUnicodeString(&KeyName, L"Parameters");
+    Status = OpenRegistryKey(ServiceKey, &KeyName, Create, &ParametersKey);
+    ZwClose(ServiceKey);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    RtlInitUnicodeString(&KeyName, NameBuffer);
+    Status = OpenRegistryKey(ParametersKey, &KeyName, Create, KeyHandle);
+    ZwClose(ParametersKey);
+
+    return Status;
+}
+
+
 #if defined(_M_AMD64)
 /* KeQuerySystemTime is an inline function, 
    so we cannot forward the export to ntoskrnl */
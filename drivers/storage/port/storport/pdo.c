@@ -13,20 +13,645 @@
 #include <debug.h>
 
 
+/* Longest hardware ID: "SCSI\" + type + vendor + product + revision */
+#define MAX_ID_LENGTH 64
+
+
 /* FUNCTIONS ******************************************************************/
 
+static
+PCWSTR
+PortGetDeviceTypeName(
+    _In_ PINQUIRYDATA InquiryData)
+{
+    switch (InquiryData->DeviceType)
+    {
+        case DIRECT_ACCESS_DEVICE:
+            return L"Disk";
+        case SEQUENTIAL_ACCESS_DEVICE:
+            return L"Sequential";
+        case PRINTER_DEVICE:
+            return L"Printer";
+        case PROCESSOR_DEVICE:
+            return L"Processor";
+        case WRITE_ONCE_READ_MULTIPLE_DEVICE:
+            return L"Worm";
+        case READ_ONLY_DIRECT_ACCESS_DEVICE:
+            return L"CdRom";
+        case SCANNER_DEVICE:
+            return L"Scanner";
+        case OPTICAL_DEVICE:
+            return L"Optical";
+        case MEDIUM_CHANGER:
+            return L"Changer";
+        case COMMUNICATION_DEVICE:
+            return L"Net";
+        default:
+            return L"Other";
+    }
+}
+
+
+static
+PCWSTR
+PortGetGenericTypeName(
+    _In_ PINQUIRYDATA InquiryData)
+{
+    switch (InquiryData->DeviceType)
+    {
+        case DIRECT_ACCESS_DEVICE:
+            return L"GenDisk";
+        case SEQUENTIAL_ACCESS_DEVICE:
+            return L"GenSequential";
+        case PRINTER_DEVICE:
+            return L"GenPrinter";
+        case PROCESSOR_DEVICE:
+            return L"GenProcessor";
+        case WRITE_ONCE_READ_MULTIPLE_DEVICE:
+            return L"GenWorm";
+        case READ_ONLY_DIRECT_ACCESS_DEVICE:
+            return L"GenCdRom";
+        case SCANNER_DEVICE:
+            return L"GenScanner";
+        case OPTICAL_DEVICE:
+            return L"GenOptical";
+        case MEDIUM_CHANGER:
+            return L"GenChanger";
+        case COMMUNICATION_DEVICE:
+            return L"GenNet";
+        default:
+            return L"ScsiOther";
+    }
+}
+
+
+static
+VOID
+PortCopyInquiryField(
+    _Out_writes_(Length + 1) PWCHAR Buffer,
+    _In_reads_(Length) PUCHAR Field,
+    _In_ ULONG Length)
+{
+    ULONG i;
+
+    /* Blanks and anything not printable become underscores */
+    for (i = 0; i < Length; i++)
+    {
+        if (Field[i] <= ' ' || Field[i] >= 0x7F || Field[i] == ',')
+            Buffer[i] = L'_';
+        else
+            Buffer[i] = (WCHAR)Field[i];
+    }
+
+    Buffer[Length] = UNICODE_NULL;
+}
+
+
+static
+PWSTR
+PortAllocateIdString(
+    _In_ SIZE_T Length)
+{
+    PWSTR Buffer;
+
+    /* The PnP manager frees the IDs */
+    Buffer = ExAllocatePoolWithTag(PagedPool,
+                                   Length * sizeof(WCHAR),
+                                   TAG_PNP_ID);
+    if (Buffer != NULL)
+        RtlZeroMemory(Buffer, Length * sizeof(WCHAR));
+
+    return Buffer;
+}
+
+
+static
+NTSTATUS
+PortPdoQueryId(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIO_STACK_LOCATION Stack,
+    _Out_ PULONG_PTR Information)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PINQUIRYDATA InquiryData;
+    WCHAR Vendor[9], Product[17], Revision[5];
+    PCWSTR TypeName, GenericName;
+    PWSTR Buffer, Ptr;
+    size_t Remaining;
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    InquiryData = &DeviceExtension->Unit->InquiryData;
+
+    PortCopyInquiryField(Vendor, InquiryData->VendorId, 8);
+    PortCopyInquiryField(Product, InquiryData->ProductId, 16);
+    PortCopyInquiryField(Revision, InquiryData->ProductRevisionLevel, 4);
+    TypeName = PortGetDeviceTypeName(InquiryData);
+    GenericName = PortGetGenericTypeName(InquiryData);
+
+    switch (Stack->Parameters.QueryId.IdType)
+    {
+        case BusQueryDeviceID:
+            DPRINT("IRP_MJ_PNP / IRP_MN_QUERY_ID / BusQueryDeviceID\n");
+            Buffer = PortAllocateIdString(MAX_ID_LENGTH);
+            if (Buffer == NULL)
+                return STATUS_INSUFFICIENT_RESOURCES;
+
+            RtlStringCchPrintfW(Buffer, MAX_ID_LENGTH,
+                                L"SCSI\\%s&Ven_%s&Prod_%s&Rev_%s",
+                                TypeName, Vendor, Product, Revision);
+            break;
+
+        case BusQueryHardwareIDs:
+            DPRINT("IRP_MJ_PNP / IRP_MN_QUERY_ID / BusQueryHardwareIDs\n");
+            Buffer = PortAllocateIdString(6 * MAX_ID_LENGTH + 1);
+            if (Buffer == NULL)
+                return STATUS_INSUFFICIENT_RESOURCES;
+
+            /* Build the list from the most to the least specific ID */
+            Ptr = Buffer;
+            Remaining = 6 * MAX_ID_LENGTH;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"SCSI\\%s%s%s%s", TypeName, Vendor, Product, Revision);
+            Ptr++; Remaining--;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"SCSI\\%s%s%s", TypeName, Vendor, Product);
+            Ptr++; Remaining--;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"SCSI\\%s%s", TypeName, Vendor);
+            Ptr++; Remaining--;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"SCSI\\%s%s%c", Vendor, Product, Revision[0]);
+            Ptr++; Remaining--;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"%s%s%c", Vendor, Product, Revision[0]);
+            Ptr++; Remaining--;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"%s", GenericName);
+            break;
+
+        case BusQueryCompatibleIDs:
+            DPRINT("IRP_MJ_PNP / IRP_MN_QUERY_ID / BusQueryCompatibleIDs\n");
+            Buffer = PortAllocateIdString(2 * MAX_ID_LENGTH + 1);
+            if (Buffer == NULL)
+                return STATUS_INSUFFICIENT_RESOURCES;
+
+            Ptr = Buffer;
+            Remaining = 2 * MAX_ID_LENGTH;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"SCSI\\%s", TypeName);
+            Ptr++; Remaining--;
+            RtlStringCchPrintfExW(Ptr, Remaining, &Ptr, &Remaining, 0,
+                                  L"SCSI\\RAW");
+            break;
+
+        case BusQueryInstanceID:
+            DPRINT("IRP_MJ_PNP / IRP_MN_QUERY_ID / BusQueryInstanceID\n");
+            Buffer = PortAllocateIdString(MAX_ID_LENGTH);
+            if (Buffer == NULL)
+                return STATUS_INSUFFICIENT_RESOURCES;
+
+            RtlStringCchPrintfW(Buffer, MAX_ID_LENGTH,
+                                L"%x&%x&%x",
+                                DeviceExtension->Unit->PathId,
+                                DeviceExtension->Unit->TargetId,
+                                DeviceExtension->Unit->Lun);
+            break;
+
+        default:
+            DPRINT1("IRP_MJ_PNP / IRP_MN_QUERY_ID / unknown query id type 0x%lx\n",
+                    Stack->Parameters.QueryId.IdType);
+            return STATUS_NOT_SUPPORTED;
+    }
+
+    *Information = (ULONG_PTR)Buffer;
+
+    return STATUS_SUCCESS;
+}
+
+
+static
+NTSTATUS
+PortPdoQueryDeviceText(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIO_STACK_LOCATION Stack,
+    _Out_ PULONG_PTR Information)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PINQUIRYDATA InquiryData;
+    PWSTR Buffer;
+    ULONG i, j;
+
+    if (Stack->Parameters.QueryDeviceText.DeviceTextType != DeviceTextDescription)
+        return STATUS_NOT_SUPPORTED;
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    InquiryData = &DeviceExtension->Unit->InquiryData;
+
+    Buffer = PortAllocateIdString(8 + 1 + 16 + 1);
+    if (Buffer == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* "<Vendor> <Product>" */
+    for (i = 0, j = 0; i < 8 && InquiryData->VendorId[i] != 0; i++)
+        Buffer[j++] = (WCHAR)InquiryData->VendorId[i];
+    while (j > 0 && Buffer[j - 1] == L' ')
+        j--;
+    Buffer[j++] = L' ';
+    for (i = 0; i < 16 && InquiryData->ProductId[i] != 0; i++)
+        Buffer[j++] = (WCHAR)InquiryData->ProductId[i];
+    while (j > 0 && Buffer[j - 1] == L' ')
+        j--;
+    Buffer[j] = UNICODE_NULL;
+
+    *Information = (ULONG_PTR)Buffer;
+
+    return STATUS_SUCCESS;
+}
+
+
+static
+NTSTATUS
+PortPdoQueryCapabilities(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIO_STACK_LOCATION Stack)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PDEVICE_CAPABILITIES Capabilities;
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    Capabilities = Stack->Parameters.DeviceCapabilities.Capabilities;
+
+    if (Capabilities->Version != 1)
+        return STATUS_UNSUCCESSFUL;
+
+    Capabilities->UniqueID = FALSE;
+    Capabilities->SilentInstall = TRUE;
+    Capabilities->RawDeviceOK = TRUE;
+    Capabilities->Removable = DeviceExtension->Unit->InquiryData.RemovableMedia;
+    Capabilities->Address = (DeviceExtension->Unit->TargetId << 8) |
+                            DeviceExtension->Unit->Lun;
+
+    return STATUS_SUCCESS;
+}
+
+
+static
+NTSTATUS
+PortPdoQueryTargetRelation(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _Out_ PULONG_PTR Information)
+{
+    PDEVICE_RELATIONS DeviceRelations;
+
+    DeviceRelations = ExAllocatePoolWithTag(PagedPool,
+                                            sizeof(DEVICE_RELATIONS),
+                                            TAG_RELATIONS);
+    if (DeviceRelations == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    ObReferenceObject(DeviceObject);
+    DeviceRelations->Count = 1;
+    DeviceRelations->Objects[0] = DeviceObject;
+
+    *Information = (ULONG_PTR)DeviceRelations;
+
+    return STATUS_SUCCESS;
+}
+
+
+NTSTATUS
+PortCreatePdo(
+    _In_ PFDO_DEVICE_EXTENSION FdoExtension,
+    _In_ PUNIT_DATA Unit)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PDEVICE_OBJECT Pdo;
+    NTSTATUS Status;
+
+    DPRINT("PortCreatePdo(%p %p)\n", FdoExtension, Unit);
+
+    Status = IoCreateDevice(FdoExtension->Device->DriverObject,
+                            sizeof(PDO_DEVICE_EXTENSION),
+                            NULL,
+                            FILE_DEVICE_MASS_STORAGE,
+                            FILE_AUTOGENERATED_DEVICE_NAME | FILE_DEVICE_SECURE_OPEN,
+                            FALSE,
+                            &Pdo);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("IoCreateDevice() failed (Status 0x%08lx)\n", Status);
+        return Status;
+    }
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)Pdo->DeviceExtension;
+    RtlZeroMemory(DeviceExtension, sizeof(PDO_DEVICE_EXTENSION));
+    DeviceExtension->ExtensionType = PdoExtension;
+    DeviceExtension->Device = Pdo;
+    DeviceExtension->AttachedFdo = FdoExtension->Device;
+    DeviceExtension->FdoExtension = FdoExtension;
+    DeviceExtension->Unit = Unit;
+    DeviceExtension->PnpState = dsStopped;
+
+    /* Requests are passed on to the FDO */
+    Pdo->StackSize = FdoExtension->Device->StackSize + 1;
+    Pdo->AlignmentRequirement = FdoExtension->Device->AlignmentRequirement;
+    Pdo->Flags |= DO_DIRECT_IO | DO_POWER_PAGABLE;
+    Pdo->Flags &= ~DO_DEVICE_INITIALIZING;
+
+    Unit->Device = Pdo;
+
+    return STATUS_SUCCESS;
+}
+
+
+NTSTATUS
+NTAPI
+PortPdoScsi(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PSCSI_REQUEST_BLOCK Srb;
+
+    DPRINT("PortPdoScsi(%p %p)\n", DeviceObject, Irp);
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    Srb = IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
+
+    if (Srb == NULL)
+    {
+        Irp->IoStatus.Status = STATUS_INVALID_PARAMETER;
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Address the unit this PDO stands for and queue it on the adapter */
+    Srb->PathId = DeviceExtension->Unit->PathId;
+    Srb->TargetId = DeviceExtension->Unit->TargetId;
+    Srb->Lun = DeviceExtension->Unit->Lun;
+
+    IoSkipCurrentIrpStackLocation(Irp);
+    return IoCallDriver(DeviceExtension->AttachedFdo, Irp);
+}
+
+
+NTSTATUS
+NTAPI
+PortPdoDeviceControl(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp)
+{
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PPORT_CONFIGURATION_INFORMATION PortConfig;
+    PIO_STACK_LOCATION Stack;
+    PSTORAGE_PROPERTY_QUERY Query;
+    PSTORAGE_ADAPTER_DESCRIPTOR AdapterDescriptor;
+    PSTORAGE_DEVICE_DESCRIPTOR DeviceDescriptor;
+    PSCSI_ADDRESS Address;
+    PINQUIRYDATA InquiryData;
+    ULONG OutputLength, Size;
+    ULONG_PTR Information = 0;
+    NTSTATUS Status;
+
+    DPRINT("PortPdoDeviceControl(%p %p)\n", DeviceObject, Irp);
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    PortConfig = &DeviceExtension->FdoExtension->Miniport.PortConfig;
+    InquiryData = &DeviceExtension->Unit->InquiryData;
+    Stack = IoGetCurrentIrpStackLocation(Irp);
+    OutputLength = Stack->Parameters.DeviceIoControl.OutputBufferLength;
+
+    switch (Stack->Parameters.DeviceIoControl.IoControlCode)
+    {
+        case IOCTL_STORAGE_QUERY_PROPERTY:
+            if (Stack->Parameters.DeviceIoControl.InputBufferLength < sizeof(STORAGE_PROPERTY_QUERY))
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            Query = (PSTORAGE_PROPERTY_QUERY)Irp->AssociatedIrp.SystemBuffer;
+            if (Query->PropertyId == StorageAdapterProperty)
+            {
+                if (Query->QueryType == PropertyExistsQuery)
+                {
+                    Status = STATUS_SUCCESS;
+                    break;
+                }
+
+                if (Query->QueryType != PropertyStandardQuery ||
+                    OutputLength < sizeof(STORAGE_DESCRIPTOR_HEADER))
+                {
+                    Status = STATUS_INVALID_PARAMETER;
+                    break;
+                }
+
+                AdapterDescriptor = (PSTORAGE_ADAPTER_DESCRIPTOR)Irp->AssociatedIrp.SystemBuffer;
+                Size = min(OutputLength, sizeof(STORAGE_ADAPTER_DESCRIPTOR));
+                if (Size < sizeof(STORAGE_ADAPTER_DESCRIPTOR))
+                {
+                    /* Only the header fits */
+                    AdapterDescriptor->Version = sizeof(STORAGE_ADAPTER_DESCRIPTOR);
+                    AdapterDescriptor->Size = sizeof(STORAGE_ADAPTER_DESCRIPTOR);
+                    Information = sizeof(STORAGE_DESCRIPTOR_HEADER);
+                    Status = STATUS_SUCCESS;
+                    break;
+                }
+
+                RtlZeroMemory(AdapterDescriptor, Size);
+                AdapterDescriptor->Version = sizeof(STORAGE_ADAPTER_DESCRIPTOR);
+                AdapterDescriptor->Size = sizeof(STORAGE_ADAPTER_DESCRIPTOR);
+                AdapterDescriptor->MaximumTransferLength = PortConfig->MaximumTransferLength;
+                AdapterDescriptor->MaximumPhysicalPages = PortConfig->NumberOfPhysicalBreaks;
+                AdapterDescriptor->AlignmentMask = PortConfig->AlignmentMask;
+                AdapterDescriptor->AdapterUsesPio = FALSE;
+                AdapterDescriptor->AdapterScansDown = FALSE;
+                AdapterDescriptor->CommandQueueing = TRUE;
+                AdapterDescriptor->AcceleratedTransfer = TRUE;
+                AdapterDescriptor->BusType = BusTypeScsi;
+                Information = Size;
+                Status = STATUS_SUCCESS;
+            }
+            else if (Query->PropertyId == StorageDeviceProperty)
+            {
+                if (Query->QueryType == PropertyExistsQuery)
+                {
+                    Status = STATUS_SUCCESS;
+                    break;
+                }
+
+                if (Query->QueryType != PropertyStandardQuery ||
+                    OutputLength < sizeof(STORAGE_DESCRIPTOR_HEADER))
+                {
+                    Status = STATUS_INVALID_PARAMETER;
+                    break;
+                }
+
+                /* Descriptor, the raw inquiry data and three NUL terminated strings */
+                Size = FIELD_OFFSET(STORAGE_DEVICE_DESCRIPTOR, RawDeviceProperties) +
+                       INQUIRYDATABUFFERSIZE + (8 + 1) + (16 + 1) + (4 + 1);
+
+                DeviceDescriptor = (PSTORAGE_DEVICE_DESCRIPTOR)Irp->AssociatedIrp.SystemBuffer;
+                if (OutputLength < Size)
+                {
+                    DeviceDescriptor->Version = sizeof(STORAGE_DEVICE_DESCRIPTOR);
+                    DeviceDescriptor->Size = Size;
+                    Information = sizeof(STORAGE_DESCRIPTOR_HEADER);
+                    Status = STATUS_SUCCESS;
+                    break;
+                }
+
+                RtlZeroMemory(DeviceDescriptor, Size);
+                DeviceDescriptor->Version = sizeof(STORAGE_DEVICE_DESCRIPTOR);
+                DeviceDescriptor->Size = Size;
+                DeviceDescriptor->DeviceType = InquiryData->DeviceType;
+                DeviceDescriptor->DeviceTypeModifier = InquiryData->DeviceTypeModifier;
+                DeviceDescriptor->RemovableMedia = InquiryData->RemovableMedia;
+                DeviceDescriptor->CommandQueueing = InquiryData->CommandQueue;
+                DeviceDescriptor->BusType = BusTypeScsi;
+                DeviceDescriptor->SerialNumberOffset = 0;
+                DeviceDescriptor->RawPropertiesLength = INQUIRYDATABUFFERSIZE;
+                RtlCopyMemory(DeviceDescriptor->RawDeviceProperties,
+                              InquiryData,
+                              INQUIRYDATABUFFERSIZE);
+
+                DeviceDescriptor->VendorIdOffset =
+                    FIELD_OFFSET(STORAGE_DEVICE_DESCRIPTOR, RawDeviceProperties) + INQUIRYDATABUFFERSIZE;
+                RtlCopyMemory((PUCHAR)DeviceDescriptor + DeviceDescriptor->VendorIdOffset,
+                              InquiryData->VendorId, 8);
+
+                DeviceDescriptor->ProductIdOffset = DeviceDescriptor->VendorIdOffset + 8 + 1;
+                RtlCopyMemory((PUCHAR)DeviceDescriptor + DeviceDescriptor->ProductIdOffset,
+                              InquiryData->ProductId, 16);
+
+                DeviceDescriptor->ProductRevisionOffset = DeviceDescriptor->ProductIdOffset + 16 + 1;
+                RtlCopyMemory((PUCHAR)DeviceDescriptor + DeviceDescriptor->ProductRevisionOffset,
+                              InquiryData->ProductRevisionLevel, 4);
+
+                Information = Size;
+                Status = STATUS_SUCCESS;
+            }
+            else
+            {
+                Status = STATUS_NOT_SUPPORTED;
+            }
+            break;
+
+        case IOCTL_SCSI_GET_ADDRESS:
+            if (OutputLength < sizeof(SCSI_ADDRESS))
+            {
+                Status = STATUS_BUFFER_TOO_SMALL;
+                break;
+            }
+
+            Address = (PSCSI_ADDRESS)Irp->AssociatedIrp.SystemBuffer;
+            Address->Length = sizeof(SCSI_ADDRESS);
+            Address->PortNumber = (UCHAR)DeviceExtension->FdoExtension->PortNumber;
+            Address->PathId = DeviceExtension->Unit->PathId;
+            Address->TargetId = DeviceExtension->Unit->TargetId;
+            Address->Lun = DeviceExtension->Unit->Lun;
+            Information = sizeof(SCSI_ADDRESS);
+            Status = STATUS_SUCCESS;
+            break;
+
+        default:
+            DPRINT1("Unsupported IOCTL 0x%lx\n",
+                    Stack->Parameters.DeviceIoControl.IoControlCode);
+            Status = STATUS_NOT_SUPPORTED;
+            break;
+    }
+
+    Irp->IoStatus.Information = Information;
+    Irp->IoStatus.Status = Status;
+    IoCompleteRequest(Irp, IO_NO_INCREMENT);
+
+    return Status;
+}
+
+
 NTSTATUS
 NTAPI
 PortPdoPnp(
     _In_ PDEVICE_OBJECT DeviceObject,
     _In_ PIRP Irp)
 {
-    DPRINT1("PortPdoPnp()\n");
+    PPDO_DEVICE_EXTENSION DeviceExtension;
+    PIO_STACK_LOCATION Stack;
+    ULONG_PTR Information;
+    NTSTATUS Status;
+
+    DPRINT1("PortPdoPnp(%p %p)\n", DeviceObject, Irp);
+
+    DeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    ASSERT(DeviceExtension->ExtensionType == PdoExtension);
+
+    Stack = IoGetCurrentIrpStackLocation(Irp);
+
+    /* Leave the IRP alone unless we handle it */
+    Status = Irp->IoStatus.Status;
+    Information = Irp->IoStatus.Information;
+
+    switch (Stack->MinorFunction)
+    {
+        case IRP_MN_START_DEVICE: /* 0x00 */
+            DPRINT1("IRP_MJ_PNP / IRP_MN_START_DEVICE\n");
+            DeviceExtension->PnpState = dsStarted;
+            Status = STATUS_SUCCESS;
+            break;
+
+        case IRP_MN_QUERY_REMOVE_DEVICE: /* 0x01 */
+        case IRP_MN_CANCEL_REMOVE_DEVICE: /* 0x03 */
+        case IRP_MN_QUERY_STOP_DEVICE: /* 0x05 */
+        case IRP_MN_CANCEL_STOP_DEVICE: /* 0x06 */
+            Status = STATUS_SUCCESS;
+            break;
 
-    Irp->IoStatus.Information = 0;
-    Irp->IoStatus.Status = STATUS_SUCCESS;
+        case IRP_MN_REMOVE_DEVICE: /* 0x02 */
+        case IRP_MN_STOP_DEVICE: /* 0x04 */
+        case IRP_MN_SURPRISE_REMOVAL: /* 0x17 */
+            /* The PDO stays as long as the unit is there */
+            DeviceExtension->PnpState = dsStopped;
+            Status = STATUS_SUCCESS;
+            break;
+
+        case IRP_MN_QUERY_DEVICE_RELATIONS: /* 0x07 */
+            DPRINT1("IRP_MJ_PNP / IRP_MN_QUERY_DEVICE_RELATIONS\n");
+            if (Stack->Parameters.QueryDeviceRelations.Type == TargetDeviceRelation)
+                Status = PortPdoQueryTargetRelation(DeviceObject, &Information);
+            break;
+
+        case IRP_MN_QUERY_CAPABILITIES: /* 0x09 */
+            DPRINT1("IRP_MJ_PNP / IRP_MN_QUERY_CAPABILITIES\n");
+            Status = PortPdoQueryCapabilities(DeviceObject, Stack);
+            break;
+
+        case IRP_MN_QUERY_DEVICE_TEXT: /* 0x0c */
+            DPRINT1("IRP_MJ_PNP / IRP_MN_QUERY_DEVICE_TEXT\n");
+            Status = PortPdoQueryDeviceText(DeviceObject, Stack, &Information);
+            break;
+
+        case IRP_MN_QUERY_ID: /* 0x13 */
+            DPRINT1("IRP_MJ_PNP / IRP_MN_QUERY_ID\n");
+            Status = PortPdoQueryId(DeviceObject, Stack, &Information);
+            break;
+
+        case IRP_MN_QUERY_PNP_DEVICE_STATE: /* 0x14 */
+            DPRINT1("IRP_MJ_PNP / IRP_MN_QUERY_PNP_DEVICE_STATE\n");
+            Information = 0;
+            Status = STATUS_SUCCESS;
+            break;
+
+        default:
+            DPRINT1("IRP_MJ_PNP / Unknown IOCTL 0x%lx\n", Stack->MinorFunction);
+            break;
+    }
+
+    Irp->IoStatus.Information = Information;
+    Irp->IoStatus.Status = Status;
     IoCompleteRequest(Irp, IO_NO_INCREMENT);
-    return STATUS_SUCCESS;
+
+    return Status;
 }
 
 /* EOF */
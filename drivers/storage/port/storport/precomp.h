@@ -21,6 +21,7 @@
 #include <ntdddisk.h>
 #include <mountdev.h>
 #include <wdmguid.h>
+#include <ntstrsafe.h>
 
 /* Memory Tags */
 #define TAG_GLOBAL_DATA     'DGtS'
@@ -29,6 +30,15 @@
 #define TAG_ACCRESS_RANGE   'RAtS'
 #define TAG_RESOURCE_LIST   'LRtS'
 #define TAG_ADDRESS_MAPPING 'MAtS'
+#define TAG_UNIT_DATA       'DUtS'
+#define TAG_REQUEST_DATA    'DRtS'
+#define TAG_INQUIRY_DATA    'QItS'
+#define TAG_REGISTRY        'GRtS'
+#define TAG_RELATIONS       'LDtS'
+#define TAG_PNP_ID          'DPtS'
+
+/* Queue depth of a unit until the miniport sets its own */
+#define DEFAULT_QUEUE_DEPTH 20
 
 typedef enum
 {
@@ -63,6 +73,8 @@ typedef struct _DRIVER_OBJECT_EXTENSION
     ULONG AdapterCount;
 
     LIST_ENTRY InitDataListHead;
+
+    UNICODE_STRING RegistryPath;
 } DRIVER_OBJECT_EXTENSION, *PDRIVER_OBJECT_EXTENSION;
 
 typedef struct _MINIPORT_DEVICE_EXTENSION
@@ -103,14 +115,78 @@ typedef struct _FDO_DEVICE_EXTENSION
     PHW_PASSIVE_INITIALIZE_ROUTINE HwPassiveInitRoutine;
     PKINTERRUPT Interrupt;
     ULONG InterruptIrql;
+    ULONG PortNumber;
+    PUCHAR RegistryBuffer;
+
+    /* Request engine */
+    PDMA_ADAPTER DmaAdapter;
+    KSPIN_LOCK StartIoLock;
+    KSPIN_LOCK QueueLock;                   /* Protects the unit list and all request queues */
+    LIST_ENTRY UnitListHead;
+    ULONG OutstandingCount;
+    LONG BusyCount;                         /* Completions to wait for after StorPortBusy */
+    BOOLEAN Paused;
+    KTIMER PauseTimer;
+    KDPC PauseDpc;
+    KSPIN_LOCK CompletionLock;
+    LIST_ENTRY CompletionListHead;          /* Requests completed by the miniport */
+    KDPC CompletionDpc;
+    NPAGED_LOOKASIDE_LIST RequestLookaside;
+    ULONG RequestDataSize;
+    BOOLEAN RequestLookasideInitialized;
 } FDO_DEVICE_EXTENSION, *PFDO_DEVICE_EXTENSION;
 
+typedef struct _UNIT_DATA
+{
+    LIST_ENTRY UnitListEntry;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PDEVICE_OBJECT Device;                  /* The PDO reported for this unit */
+    UCHAR PathId;
+    UCHAR TargetId;
+    UCHAR Lun;
+    BOOLEAN Paused;
+    INQUIRYDATA InquiryData;
+
+    LIST_ENTRY PendingIrpListHead;          /* Requests waiting for a queue slot */
+    LIST_ENTRY ActiveRequestListHead;       /* Requests owned by the miniport */
+    ULONG QueueDepth;
+    ULONG OutstandingCount;
+    LONG BusyCount;                         /* Completions to wait for after StorPortDeviceBusy */
+    KTIMER PauseTimer;
+    KDPC PauseDpc;
+
+    UCHAR LuExtension[0];
+} UNIT_DATA, *PUNIT_DATA;
+
+typedef struct _REQUEST_DATA
+{
+    LIST_ENTRY ActiveListEntry;
+    PIRP Irp;
+    PUNIT_DATA Unit;
+    PSCATTER_GATHER_LIST ScatterGatherList;
+    PVOID OriginalDataBuffer;
+    LONG Completed;
+    /* The SRB extension follows */
+} REQUEST_DATA, *PREQUEST_DATA;
+
+#define REQUEST_DATA_HEADER_SIZE ALIGN_UP_BY(sizeof(REQUEST_DATA), 16)
+
+typedef struct _SYNCHRONIZE_ACCESS_CONTEXT
+{
+    PSTOR_SYNCHRONIZED_ACCESS Routine;
+    PVOID HwDeviceExtension;
+    PVOID Context;
+} SYNCHRONIZE_ACCESS_CONTEXT, *PSYNCHRONIZE_ACCESS_CONTEXT;
+
 
 typedef struct _PDO_DEVICE_EXTENSION
 {
     EXTENSION_TYPE ExtensionType;
 
+    PDEVICE_OBJECT Device;
     PDEVICE_OBJECT AttachedFdo;
+    PFDO_DEVICE_EXTENSION FdoExtension;
+    PUNIT_DATA Unit;
 
     DEVICE_STATE PnpState;
 
@@ -146,8 +222,34 @@ BOOLEAN
 MiniportHwInterrupt(
     _In_ PMINIPORT Miniport);
 
+BOOLEAN
+MiniportHwBuildIo(
+    _In_ PMINIPORT Miniport,
+    _In_ PSCSI_REQUEST_BLOCK Srb);
+
+BOOLEAN
+MiniportHwStartIo(
+    _In_ PMINIPORT Miniport,
+    _In_ PSCSI_REQUEST_BLOCK Srb);
+
+BOOLEAN
+MiniportHwResetBus(
+    _In_ PMINIPORT Miniport,
+    _In_ ULONG PathId);
+
 /* misc.c */
 
+NTSTATUS
+TranslateSrbStatus(
+    _In_ PSCSI_REQUEST_BLOCK Srb);
+
+NTSTATUS
+OpenDeviceParametersKey(
+    _In_ PUNICODE_STRING RegistryPath,
+    _In_ ULONG DeviceNumber,
+    _In_ BOOLEAN Create,
+    _Out_ PHANDLE KeyHandle);
+
 NTSTATUS
 ForwardIrpAndWait(
     _In_ PDEVICE_OBJECT LowerDevice,
@@ -204,8 +306,99 @@ AllocateAddressMapping(
     ULONG NumberOfBytes,
     ULONG BusNumber);
 
+/* queue.c */
+
+VOID
+PortInitializeQueues(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension);
+
+VOID
+PortInitializeRequestData(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ ULONG SrbExtensionSize);
+
+PUNIT_DATA
+PortCreateUnit(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun);
+
+VOID
+PortDeleteUnit(
+    _In_ PUNIT_DATA Unit);
+
+PUNIT_DATA
+PortFindUnit(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun);
+
+NTSTATUS
+PortQueueRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp);
+
+VOID
+PortNotifyRequestComplete(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PSCSI_REQUEST_BLOCK Srb);
+
+VOID
+PortCompleteActiveRequests(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun,
+    _In_ UCHAR SrbStatus);
+
+VOID
+PortAbortUnitRequests(
+    _In_ PUNIT_DATA Unit,
+    _In_ UCHAR SrbStatus);
+
+VOID
+PortRestartQueues(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension);
+
+VOID
+PortPauseAdapter(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ LONGLONG Interval);
+
+VOID
+PortResumeAdapter(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension);
+
+VOID
+PortPauseUnit(
+    _In_ PUNIT_DATA Unit,
+    _In_ LONGLONG Interval);
+
+VOID
+PortResumeUnit(
+    _In_ PUNIT_DATA Unit);
+
 /* pdo.c */
 
+NTSTATUS
+PortCreatePdo(
+    _In_ PFDO_DEVICE_EXTENSION FdoExtension,
+    _In_ PUNIT_DATA Unit);
+
+NTSTATUS
+NTAPI
+PortPdoScsi(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp);
+
+NTSTATUS
+NTAPI
+PortPdoDeviceControl(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp);
+
 NTSTATUS
 NTAPI
 PortPdoPnp(
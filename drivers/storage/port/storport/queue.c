@@ -0,0 +1,839 @@
+/*
+ * PROJECT:     ReactOS Storport Driver
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Storport request queues
+ * COPYRIGHT:   Copyright 2017 Eric Kohl (eric.kohl@reactos.org)
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "precomp.h"
+
+#define NDEBUG
+#include <debug.h>
+
+
+/* Retry interval for requests the miniport or the system could not take (10ms) */
+#define BUSY_RETRY_INTERVAL (10 * 10000)
+
+
+/* FUNCTIONS ******************************************************************/
+
+static
+PSCSI_REQUEST_BLOCK
+GetIrpSrb(
+    _In_ PIRP Irp)
+{
+    return IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
+}
+
+
+static
+BOOLEAN
+PortIsAdapterBlocked(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    if (DeviceExtension->Paused)
+        return TRUE;
+
+    /* A busy adapter gets new requests once enough of the outstanding ones completed */
+    return (DeviceExtension->BusyCount > 0) && (DeviceExtension->OutstandingCount > 0);
+}
+
+
+static
+BOOLEAN
+PortIsUnitBlocked(
+    _In_ PUNIT_DATA Unit)
+{
+    if (Unit->Paused)
+        return TRUE;
+
+    if (Unit->OutstandingCount >= Unit->QueueDepth)
+        return TRUE;
+
+    return (Unit->BusyCount > 0) && (Unit->OutstandingCount > 0);
+}
+
+
+static
+BOOLEAN
+PortIsReadWriteRequest(
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    if (Srb->Function != SRB_FUNCTION_EXECUTE_SCSI)
+        return FALSE;
+
+    switch (Srb->Cdb[0])
+    {
+        case SCSIOP_READ6:
+        case SCSIOP_WRITE6:
+        case SCSIOP_READ:
+        case SCSIOP_WRITE:
+        case SCSIOP_READ12:
+        case SCSIOP_WRITE12:
+        case SCSIOP_READ16:
+        case SCSIOP_WRITE16:
+            return TRUE;
+
+        default:
+            return FALSE;
+    }
+}
+
+
+static
+VOID
+PortQueueCompletion(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp)
+{
+    /* May be called at DIRQL, the rest is done by the completion DPC */
+    ExInterlockedInsertTailList(&DeviceExtension->CompletionListHead,
+                                &Irp->Tail.Overlay.ListEntry,
+                                &DeviceExtension->CompletionLock);
+
+    KeInsertQueueDpc(&DeviceExtension->CompletionDpc, NULL, NULL);
+}
+
+
+static
+BOOLEAN
+NTAPI
+PortStartIoSynchronized(
+    _In_ PVOID SynchronizeContext)
+{
+    PSCSI_REQUEST_BLOCK Srb = (PSCSI_REQUEST_BLOCK)SynchronizeContext;
+    PIRP Irp = (PIRP)Srb->OriginalRequest;
+    PREQUEST_DATA Request = (PREQUEST_DATA)Irp->Tail.Overlay.DriverContext[0];
+
+    return MiniportHwStartIo(&Request->Unit->DeviceExtension->Miniport, Srb);
+}
+
+
+static
+BOOLEAN
+NTAPI
+PortResetBusSynchronized(
+    _In_ PVOID SynchronizeContext)
+{
+    PUNIT_DATA Unit = (PUNIT_DATA)SynchronizeContext;
+
+    return MiniportHwResetBus(&Unit->DeviceExtension->Miniport, Unit->PathId);
+}
+
+
+static
+VOID
+PortIssueRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PREQUEST_DATA Request)
+{
+    PMINIPORT Miniport = &DeviceExtension->Miniport;
+    PIRP Irp = Request->Irp;
+    PSCSI_REQUEST_BLOCK Srb = GetIrpSrb(Irp);
+    PVOID SystemAddress;
+
+    ASSERT(KeGetCurrentIrql() == DISPATCH_LEVEL);
+
+    /* Give the miniport a system address if it is going to touch the data */
+    if (Srb->DataTransferLength != 0 &&
+        Irp->MdlAddress != NULL &&
+        (Miniport->PortConfig.MapBuffers == STOR_MAP_ALL_BUFFERS ||
+         (Miniport->PortConfig.MapBuffers == STOR_MAP_NON_READ_WRITE_BUFFERS && !PortIsReadWriteRequest(Srb))))
+    {
+        SystemAddress = MmGetSystemAddressForMdlSafe(Irp->MdlAddress, HighPagePriority);
+        if (SystemAddress == NULL)
+        {
+            Srb->SrbStatus = SRB_STATUS_BUSY;
+            PortNotifyRequestComplete(DeviceExtension, Srb);
+            return;
+        }
+
+        Srb->DataBuffer = (PUCHAR)SystemAddress +
+                          ((ULONG_PTR)Srb->DataBuffer - (ULONG_PTR)MmGetMdlVirtualAddress(Irp->MdlAddress));
+    }
+
+    /* BuildIo runs unsynchronized, a FALSE return means the request has been completed */
+    if (!MiniportHwBuildIo(Miniport, Srb))
+        return;
+
+    if (Miniport->PortConfig.SynchronizationModel == StorSynchronizeHalfDuplex &&
+        DeviceExtension->Interrupt != NULL)
+    {
+        KeSynchronizeExecution(DeviceExtension->Interrupt,
+                               PortStartIoSynchronized,
+                               Srb);
+    }
+    else
+    {
+        KeAcquireSpinLockAtDpcLevel(&DeviceExtension->StartIoLock);
+        MiniportHwStartIo(Miniport, Srb);
+        KeReleaseSpinLockFromDpcLevel(&DeviceExtension->StartIoLock);
+    }
+}
+
+
+static
+VOID
+NTAPI
+PortAdapterListControl(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ PSCATTER_GATHER_LIST ScatterGather,
+    _In_ PVOID Context)
+{
+    PREQUEST_DATA Request = (PREQUEST_DATA)Context;
+
+    /* The Irp argument is not ours, the request comes in the context */
+    Request->ScatterGatherList = ScatterGather;
+
+    PortIssueRequest((PFDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension,
+                     Request);
+}
+
+
+static
+VOID
+PortStartRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PUNIT_DATA Unit,
+    _In_ PIRP Irp)
+{
+    PSCSI_REQUEST_BLOCK Srb = GetIrpSrb(Irp);
+    PDMA_ADAPTER DmaAdapter = DeviceExtension->DmaAdapter;
+    PREQUEST_DATA Request;
+    KIRQL OldIrql;
+    NTSTATUS Status;
+
+    Request = ExAllocateFromNPagedLookasideList(&DeviceExtension->RequestLookaside);
+    if (Request == NULL)
+    {
+        /* Put the request back and try again later */
+        KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+        Unit->OutstandingCount--;
+        DeviceExtension->OutstandingCount--;
+        InsertHeadList(&Unit->PendingIrpListHead, &Irp->Tail.Overlay.ListEntry);
+        KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+        PortPauseUnit(Unit, BUSY_RETRY_INTERVAL);
+        return;
+    }
+
+    RtlZeroMemory(Request, DeviceExtension->RequestDataSize);
+    Request->Irp = Irp;
+    Request->Unit = Unit;
+    Request->OriginalDataBuffer = Srb->DataBuffer;
+    Irp->Tail.Overlay.DriverContext[0] = Request;
+
+    if (DeviceExtension->RequestDataSize > REQUEST_DATA_HEADER_SIZE)
+        Srb->SrbExtension = (PUCHAR)Request + REQUEST_DATA_HEADER_SIZE;
+    else
+        Srb->SrbExtension = NULL;
+
+    Srb->OriginalRequest = Irp;
+    Srb->SrbStatus = SRB_STATUS_PENDING;
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    InsertTailList(&Unit->ActiveRequestListHead, &Request->ActiveListEntry);
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
+    if (Srb->DataTransferLength != 0 &&
+        (Srb->SrbFlags & SRB_FLAGS_UNSPECIFIED_DIRECTION) != 0 &&
+        Irp->MdlAddress != NULL &&
+        DmaAdapter != NULL)
+    {
+        /* The list control routine issues the request once the list is built */
+        Status = DmaAdapter->DmaOperations->GetScatterGatherList(DmaAdapter,
+                                                                 DeviceExtension->Device,
+                                                                 Irp->MdlAddress,
+                                                                 Request->OriginalDataBuffer,
+                                                                 Srb->DataTransferLength,
+                                                                 PortAdapterListControl,
+                                                                 Request,
+                                                                 (Srb->SrbFlags & SRB_FLAGS_DATA_OUT) ? TRUE : FALSE);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("GetScatterGatherList() failed (Status 0x%08lx)\n", Status);
+            Srb->SrbStatus = SRB_STATUS_BUSY;
+            PortNotifyRequestComplete(DeviceExtension, Srb);
+        }
+    }
+    else
+    {
+        PortIssueRequest(DeviceExtension, Request);
+    }
+
+    KeLowerIrql(OldIrql);
+}
+
+
+static
+VOID
+PortStartNextRequests(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    PLIST_ENTRY UnitEntry;
+    PUNIT_DATA Unit = NULL;
+    PIRP Irp;
+    KIRQL OldIrql;
+
+    for (;;)
+    {
+        Irp = NULL;
+
+        KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+
+        if (!PortIsAdapterBlocked(DeviceExtension))
+        {
+            UnitEntry = DeviceExtension->UnitListHead.Flink;
+            while (UnitEntry != &DeviceExtension->UnitListHead)
+            {
+                Unit = CONTAINING_RECORD(UnitEntry,
+                                         UNIT_DATA,
+                                         UnitListEntry);
+
+                if (!IsListEmpty(&Unit->PendingIrpListHead) &&
+                    !PortIsUnitBlocked(Unit))
+                {
+                    Irp = CONTAINING_RECORD(RemoveHeadList(&Unit->PendingIrpListHead),
+                                            IRP,
+                                            Tail.Overlay.ListEntry);
+                    Unit->OutstandingCount++;
+                    DeviceExtension->OutstandingCount++;
+
+                    /* Rotate the unit list, so that every unit gets its turn */
+                    RemoveEntryList(&Unit->UnitListEntry);
+                    InsertTailList(&DeviceExtension->UnitListHead,
+                                   &Unit->UnitListEntry);
+                    break;
+                }
+
+                UnitEntry = UnitEntry->Flink;
+            }
+        }
+
+        KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+        if (Irp == NULL)
+            break;
+
+        PortStartRequest(DeviceExtension, Unit, Irp);
+    }
+}
+
+
+static
+VOID
+PortFinishRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp)
+{
+    PSCSI_REQUEST_BLOCK Srb = GetIrpSrb(Irp);
+    PREQUEST_DATA Request = (PREQUEST_DATA)Irp->Tail.Overlay.DriverContext[0];
+    PUNIT_DATA Unit = Request->Unit;
+    PDMA_ADAPTER DmaAdapter = DeviceExtension->DmaAdapter;
+    BOOLEAN Retry;
+
+    if (Request->ScatterGatherList != NULL)
+    {
+        DmaAdapter->DmaOperations->PutScatterGatherList(DmaAdapter,
+                                                        Request->ScatterGatherList,
+                                                        (Srb->SrbFlags & SRB_FLAGS_DATA_OUT) ? TRUE : FALSE);
+    }
+
+    Srb->DataBuffer = Request->OriginalDataBuffer;
+    Srb->SrbExtension = NULL;
+
+    Retry = (SRB_STATUS(Srb->SrbStatus) == SRB_STATUS_BUSY);
+
+    KeAcquireSpinLockAtDpcLevel(&DeviceExtension->QueueLock);
+
+    RemoveEntryList(&Request->ActiveListEntry);
+    Unit->OutstandingCount--;
+    DeviceExtension->OutstandingCount--;
+
+    if (Unit->BusyCount > 0)
+        InterlockedDecrement(&Unit->BusyCount);
+    if (DeviceExtension->BusyCount > 0)
+        InterlockedDecrement(&DeviceExtension->BusyCount);
+
+    if (Retry)
+    {
+        /* The miniport could not take the request, it goes first next time */
+        InsertHeadList(&Unit->PendingIrpListHead, &Irp->Tail.Overlay.ListEntry);
+    }
+
+    KeReleaseSpinLockFromDpcLevel(&DeviceExtension->QueueLock);
+
+    ExFreeToNPagedLookasideList(&DeviceExtension->RequestLookaside, Request);
+
+    if (Retry)
+    {
+        /* Nothing else will complete on this unit, so retry after a while */
+        if (Unit->OutstandingCount == 0)
+            PortPauseUnit(Unit, BUSY_RETRY_INTERVAL);
+        return;
+    }
+
+    Irp->IoStatus.Status = TranslateSrbStatus(Srb);
+    Irp->IoStatus.Information = NT_SUCCESS(Irp->IoStatus.Status) ? Srb->DataTransferLength : 0;
+    IoCompleteRequest(Irp, IO_DISK_INCREMENT);
+}
+
+
+static
+VOID
+NTAPI
+PortCompletionDpcRoutine(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PFDO_DEVICE_EXTENSION DeviceExtension = (PFDO_DEVICE_EXTENSION)DeferredContext;
+    PLIST_ENTRY Entry;
+
+    for (;;)
+    {
+        Entry = ExInterlockedRemoveHeadList(&DeviceExtension->CompletionListHead,
+                                            &DeviceExtension->CompletionLock);
+        if (Entry == NULL)
+            break;
+
+        PortFinishRequest(DeviceExtension,
+                          CONTAINING_RECORD(Entry, IRP, Tail.Overlay.ListEntry));
+    }
+
+    /* Refill the queues the completed requests made room in */
+    PortStartNextRequests(DeviceExtension);
+}
+
+
+static
+VOID
+NTAPI
+PortAdapterPauseDpcRoutine(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PFDO_DEVICE_EXTENSION DeviceExtension = (PFDO_DEVICE_EXTENSION)DeferredContext;
+
+    DeviceExtension->Paused = FALSE;
+    PortStartNextRequests(DeviceExtension);
+}
+
+
+static
+VOID
+NTAPI
+PortUnitPauseDpcRoutine(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PUNIT_DATA Unit = (PUNIT_DATA)DeferredContext;
+
+    Unit->Paused = FALSE;
+    PortStartNextRequests(Unit->DeviceExtension);
+}
+
+
+VOID
+PortInitializeQueues(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    KeInitializeSpinLock(&DeviceExtension->StartIoLock);
+    KeInitializeSpinLock(&DeviceExtension->QueueLock);
+    KeInitializeSpinLock(&DeviceExtension->CompletionLock);
+
+    InitializeListHead(&DeviceExtension->UnitListHead);
+    InitializeListHead(&DeviceExtension->CompletionListHead);
+
+    KeInitializeDpc(&DeviceExtension->CompletionDpc,
+                    PortCompletionDpcRoutine,
+                    DeviceExtension);
+
+    KeInitializeTimer(&DeviceExtension->PauseTimer);
+    KeInitializeDpc(&DeviceExtension->PauseDpc,
+                    PortAdapterPauseDpcRoutine,
+                    DeviceExtension);
+}
+
+
+VOID
+PortInitializeRequestData(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ ULONG SrbExtensionSize)
+{
+    if (DeviceExtension->RequestLookasideInitialized)
+        return;
+
+    /* Every request carries the SRB extension of the miniport */
+    DeviceExtension->RequestDataSize = REQUEST_DATA_HEADER_SIZE + SrbExtensionSize;
+
+    ExInitializeNPagedLookasideList(&DeviceExtension->RequestLookaside,
+                                    NULL,
+                                    NULL,
+                                    0,
+                                    DeviceExtension->RequestDataSize,
+                                    TAG_REQUEST_DATA,
+                                    0);
+
+    DeviceExtension->RequestLookasideInitialized = TRUE;
+}
+
+
+PUNIT_DATA
+PortCreateUnit(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun)
+{
+    PPORT_CONFIGURATION_INFORMATION PortConfig = &DeviceExtension->Miniport.PortConfig;
+    PUNIT_DATA Unit;
+    ULONG Size;
+    KIRQL OldIrql;
+
+    DPRINT("PortCreateUnit(%p %u %u %u)\n",
+           DeviceExtension, PathId, TargetId, Lun);
+
+    Size = FIELD_OFFSET(UNIT_DATA, LuExtension) + PortConfig->SpecificLuExtensionSize;
+
+    Unit = ExAllocatePoolWithTag(NonPagedPool,
+                                 Size,
+                                 TAG_UNIT_DATA);
+    if (Unit == NULL)
+        return NULL;
+
+    RtlZeroMemory(Unit, Size);
+
+    Unit->DeviceExtension = DeviceExtension;
+    Unit->PathId = PathId;
+    Unit->TargetId = TargetId;
+    Unit->Lun = Lun;
+
+    InitializeListHead(&Unit->PendingIrpListHead);
+    InitializeListHead(&Unit->ActiveRequestListHead);
+
+    /* Until the miniport calls StorPortSetDeviceQueueDepth */
+    Unit->QueueDepth = PortConfig->MultipleRequestPerLu ? DEFAULT_QUEUE_DEPTH : 1;
+
+    KeInitializeTimer(&Unit->PauseTimer);
+    KeInitializeDpc(&Unit->PauseDpc,
+                    PortUnitPauseDpcRoutine,
+                    Unit);
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    InsertTailList(&DeviceExtension->UnitListHead,
+                   &Unit->UnitListEntry);
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    return Unit;
+}
+
+
+VOID
+PortDeleteUnit(
+    _In_ PUNIT_DATA Unit)
+{
+    PFDO_DEVICE_EXTENSION DeviceExtension = Unit->DeviceExtension;
+    KIRQL OldIrql;
+
+    DPRINT("PortDeleteUnit(%p)\n", Unit);
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    ASSERT(IsListEmpty(&Unit->PendingIrpListHead));
+    ASSERT(Unit->OutstandingCount == 0);
+    RemoveEntryList(&Unit->UnitListEntry);
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    /* Make sure the pause DPC is not running anymore */
+    KeCancelTimer(&Unit->PauseTimer);
+    KeFlushQueuedDpcs();
+
+    ExFreePoolWithTag(Unit, TAG_UNIT_DATA);
+}
+
+
+static
+PUNIT_DATA
+PortFindUnitLocked(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun)
+{
+    PLIST_ENTRY UnitEntry;
+    PUNIT_DATA Unit;
+
+    UnitEntry = DeviceExtension->UnitListHead.Flink;
+    while (UnitEntry != &DeviceExtension->UnitListHead)
+    {
+        Unit = CONTAINING_RECORD(UnitEntry,
+                                 UNIT_DATA,
+                                 UnitListEntry);
+
+        if (Unit->PathId == PathId &&
+            Unit->TargetId == TargetId &&
+            Unit->Lun == Lun)
+            return Unit;
+
+        UnitEntry = UnitEntry->Flink;
+    }
+
+    return NULL;
+}
+
+
+PUNIT_DATA
+PortFindUnit(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun)
+{
+    PUNIT_DATA Unit;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    Unit = PortFindUnitLocked(DeviceExtension, PathId, TargetId, Lun);
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    return Unit;
+}
+
+
+NTSTATUS
+PortQueueRequest(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PIRP Irp)
+{
+    PSCSI_REQUEST_BLOCK Srb = GetIrpSrb(Irp);
+    PUNIT_DATA Unit;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+
+    Unit = PortFindUnitLocked(DeviceExtension,
+                              Srb->PathId,
+                              Srb->TargetId,
+                              Srb->Lun);
+    if (Unit == NULL)
+    {
+        KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+        Srb->SrbStatus = SRB_STATUS_NO_DEVICE;
+        Irp->IoStatus.Status = STATUS_NO_SUCH_DEVICE;
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        return STATUS_NO_SUCH_DEVICE;
+    }
+
+    Srb->SrbStatus = SRB_STATUS_PENDING;
+    IoMarkIrpPending(Irp);
+    InsertTailList(&Unit->PendingIrpListHead, &Irp->Tail.Overlay.ListEntry);
+
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    PortStartNextRequests(DeviceExtension);
+
+    return STATUS_PENDING;
+}
+
+
+VOID
+PortNotifyRequestComplete(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PIRP Irp = (PIRP)Srb->OriginalRequest;
+    PREQUEST_DATA Request = (PREQUEST_DATA)Irp->Tail.Overlay.DriverContext[0];
+
+    /* StorPortCompleteRequest may have been faster */
+    if (InterlockedExchange(&Request->Completed, TRUE))
+        return;
+
+    PortQueueCompletion(DeviceExtension, Irp);
+}
+
+
+VOID
+PortCompleteActiveRequests(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ UCHAR PathId,
+    _In_ UCHAR TargetId,
+    _In_ UCHAR Lun,
+    _In_ UCHAR SrbStatus)
+{
+    PLIST_ENTRY UnitEntry, RequestEntry;
+    PUNIT_DATA Unit;
+    PREQUEST_DATA Request;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+
+    UnitEntry = DeviceExtension->UnitListHead.Flink;
+    while (UnitEntry != &DeviceExtension->UnitListHead)
+    {
+        Unit = CONTAINING_RECORD(UnitEntry,
+                                 UNIT_DATA,
+                                 UnitListEntry);
+        UnitEntry = UnitEntry->Flink;
+
+        /* 0xFF matches any path, target or unit */
+        if ((PathId != 0xFF && Unit->PathId != PathId) ||
+            (TargetId != 0xFF && Unit->TargetId != TargetId) ||
+            (Lun != 0xFF && Unit->Lun != Lun))
+            continue;
+
+        RequestEntry = Unit->ActiveRequestListHead.Flink;
+        while (RequestEntry != &Unit->ActiveRequestListHead)
+        {
+            Request = CONTAINING_RECORD(RequestEntry,
+                                        REQUEST_DATA,
+                                        ActiveListEntry);
+            RequestEntry = RequestEntry->Flink;
+
+            if (!InterlockedExchange(&Request->Completed, TRUE))
+            {
+                GetIrpSrb(Request->Irp)->SrbStatus = SrbStatus;
+                PortQueueCompletion(DeviceExtension, Request->Irp);
+            }
+        }
+    }
+
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+}
+
+
+VOID
+PortAbortUnitRequests(
+    _In_ PUNIT_DATA Unit,
+    _In_ UCHAR SrbStatus)
+{
+    PFDO_DEVICE_EXTENSION DeviceExtension = Unit->DeviceExtension;
+    PMINIPORT Miniport = &DeviceExtension->Miniport;
+    LIST_ENTRY AbortListHead;
+    PSCSI_REQUEST_BLOCK Srb;
+    PIRP Irp;
+    KIRQL OldIrql;
+
+    DPRINT1("PortAbortUnitRequests(%p %u)\n", Unit, SrbStatus);
+
+    /* Let the miniport drop whatever it still holds on this bus */
+    if (Miniport->PortConfig.SynchronizationModel == StorSynchronizeHalfDuplex &&
+        DeviceExtension->Interrupt != NULL)
+    {
+        KeSynchronizeExecution(DeviceExtension->Interrupt,
+                               PortResetBusSynchronized,
+                               Unit);
+    }
+    else
+    {
+        KeAcquireSpinLock(&DeviceExtension->StartIoLock, &OldIrql);
+        MiniportHwResetBus(Miniport, Unit->PathId);
+        KeReleaseSpinLock(&DeviceExtension->StartIoLock, OldIrql);
+    }
+
+    /* Requests that never reached the miniport are completed right here */
+    InitializeListHead(&AbortListHead);
+
+    KeAcquireSpinLock(&DeviceExtension->QueueLock, &OldIrql);
+    while (!IsListEmpty(&Unit->PendingIrpListHead))
+    {
+        InsertTailList(&AbortListHead,
+                       RemoveHeadList(&Unit->PendingIrpListHead));
+    }
+    KeReleaseSpinLock(&DeviceExtension->QueueLock, OldIrql);
+
+    while (!IsListEmpty(&AbortListHead))
+    {
+        Irp = CONTAINING_RECORD(RemoveHeadList(&AbortListHead),
+                                IRP,
+                                Tail.Overlay.ListEntry);
+        Srb = GetIrpSrb(Irp);
+        Srb->SrbStatus = SrbStatus;
+        Irp->IoStatus.Status = TranslateSrbStatus(Srb);
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+    }
+
+    /* The active ones go through the completion DPC */
+    PortCompleteActiveRequests(DeviceExtension,
+                               Unit->PathId,
+                               Unit->TargetId,
+                               Unit->Lun,
+                               SrbStatus);
+}
+
+
+VOID
+PortRestartQueues(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    /* Never start requests from within a miniport callback */
+    KeInsertQueueDpc(&DeviceExtension->CompletionDpc, NULL, NULL);
+}
+
+
+VOID
+PortPauseAdapter(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension,
+    _In_ LONGLONG Interval)
+{
+    LARGE_INTEGER DueTime;
+
+    DeviceExtension->Paused = TRUE;
+
+    DueTime.QuadPart = -Interval;
+    KeSetTimer(&DeviceExtension->PauseTimer,
+               DueTime,
+               &DeviceExtension->PauseDpc);
+}
+
+
+VOID
+PortResumeAdapter(
+    _In_ PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    KeCancelTimer(&DeviceExtension->PauseTimer);
+    DeviceExtension->Paused = FALSE;
+
+    PortRestartQueues(DeviceExtension);
+}
+
+
+VOID
+PortPauseUnit(
+    _In_ PUNIT_DATA Unit,
+    _In_ LONGLONG Interval)
+{
+    LARGE_INTEGER DueTime;
+
+    Unit->Paused = TRUE;
+
+    DueTime.QuadPart = -Interval;
+    KeSetTimer(&Unit->PauseTimer,
+               DueTime,
+               &Unit->PauseDpc);
+}
+
+
+VOID
+PortResumeUnit(
+    _In_ PUNIT_DATA Unit)
+{
+    KeCancelTimer(&Unit->PauseTimer);
+    Unit->Paused = FALSE;
+
+    PortRestartQueues(Unit->DeviceExtension);
+}
+
+/* EOF */
@@ -20,6 +20,34 @@ ULONG PortNumber = 0;
 
 /* FUNCTIONS ******************************************************************/
 
+static
+PFDO_DEVICE_EXTENSION
+PortGetFdoExtension(
+    _In_ PVOID HwDeviceExtension)
+{
+    PMINIPORT_DEVICE_EXTENSION MiniportExtension;
+
+    MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
+                                          MINIPORT_DEVICE_EXTENSION,
+                                          HwDeviceExtension);
+
+    return MiniportExtension->Miniport->DeviceExtension;
+}
+
+
+static
+BOOLEAN
+NTAPI
+PortSynchronizeRoutine(
+    _In_ PVOID SynchronizeContext)
+{
+    PSYNCHRONIZE_ACCESS_CONTEXT SyncContext = (PSYNCHRONIZE_ACCESS_CONTEXT)SynchronizeContext;
+
+    return SyncContext->Routine(SyncContext->HwDeviceExtension,
+                                SyncContext->Context);
+}
+
+
 static
 NTSTATUS
 PortAddDriverInitData(
@@ -113,6 +141,7 @@ PortAddDevice(
     UNICODE_STRING DeviceName;
     PDEVICE_OBJECT Fdo = NULL;
     KLOCK_QUEUE_HANDLE LockHandle;
+    ULONG DevicePortNumber;
     NTSTATUS Status;
 
     DPRINT1("PortAddDevice(%p %p)\n",
@@ -121,11 +150,11 @@ PortAddDevice(
     ASSERT(DriverObject);
     ASSERT(PhysicalDeviceObject);
 
+    DevicePortNumber = PortNumber++;
     swprintf(NameBuffer,
              L"\\Device\\RaidPort%lu",
-             PortNumber);
+             DevicePortNumber);
     RtlInitUnicodeString(&DeviceName, NameBuffer);
-    PortNumber++;
 
     DPRINT1("Creating device: %wZ\n", &DeviceName);
 
@@ -157,9 +186,12 @@ PortAddDevice(
 
     DeviceExtension->Device = Fdo;
     DeviceExtension->PhysicalDevice = PhysicalDeviceObject;
+    DeviceExtension->PortNumber = DevicePortNumber;
 
     DeviceExtension->PnpState = dsStopped;
 
+    PortInitializeQueues(DeviceExtension);
+
     /* Attach the FDO to the device stack */
     Status = IoAttachDeviceToDeviceStackSafe(Fdo,
                                              PhysicalDeviceObject,
@@ -212,6 +244,10 @@ PortUnload(
     if (DriverExtension != NULL)
     {
         PortDeleteDriverInitData(DriverExtension);
+
+        if (DriverExtension->RegistryPath.Buffer != NULL)
+            ExFreePoolWithTag(DriverExtension->RegistryPath.Buffer,
+                              TAG_REGISTRY);
     }
 }
 
@@ -264,6 +300,9 @@ PortDispatchDeviceControl(
     DPRINT1("PortDispatchDeviceControl(%p %p)\n",
             DeviceObject, Irp);
 
+    if (((PFDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension)->ExtensionType == PdoExtension)
+        return PortPdoDeviceControl(DeviceObject, Irp);
+
     Irp->IoStatus.Status = STATUS_SUCCESS;
     Irp->IoStatus.Information = 0;
 
@@ -280,15 +319,47 @@ PortDispatchScsi(
     IN PDEVICE_OBJECT DeviceObject,
     IN PIRP Irp)
 {
-    DPRINT1("PortDispatchScsi(%p %p)\n",
-            DeviceObject, Irp);
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PSCSI_REQUEST_BLOCK Srb;
+    NTSTATUS Status;
 
-    Irp->IoStatus.Status = STATUS_SUCCESS;
-    Irp->IoStatus.Information = 0;
+    DPRINT("PortDispatchScsi(%p %p)\n",
+           DeviceObject, Irp);
 
-    IoCompleteRequest(Irp, IO_NO_INCREMENT);
+    DeviceExtension = (PFDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+    Srb = IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
 
-    return STATUS_SUCCESS;
+    /* Class drivers send their requests to the unit's PDO */
+    if (DeviceExtension->ExtensionType == PdoExtension)
+        return PortPdoScsi(DeviceObject, Irp);
+
+    if (DeviceExtension->ExtensionType != FdoExtension ||
+        DeviceExtension->PnpState != dsStarted ||
+        Srb == NULL)
+    {
+        Status = STATUS_INVALID_DEVICE_REQUEST;
+        Irp->IoStatus.Status = Status;
+        Irp->IoStatus.Information = 0;
+        IoCompleteRequest(Irp, IO_NO_INCREMENT);
+        return Status;
+    }
+
+    switch (Srb->Function)
+    {
+        case SRB_FUNCTION_CLAIM_DEVICE:
+        case SRB_FUNCTION_RELEASE_DEVICE:
+        case SRB_FUNCTION_FLUSH_QUEUE:
+        case SRB_FUNCTION_RELEASE_QUEUE:
+            /* The queues are never frozen, nothing to do for the miniport */
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+            Irp->IoStatus.Status = STATUS_SUCCESS;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest(Irp, IO_NO_INCREMENT);
+            return STATUS_SUCCESS;
+
+        default:
+            return PortQueueRequest(DeviceExtension, Irp);
+    }
 }
 
 
@@ -381,7 +452,7 @@ DriverEntry(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 PUCHAR
@@ -390,14 +461,34 @@ StorPortAllocateRegistryBuffer(
     _In_ PVOID HwDeviceExtension,
     _In_ PULONG Length)
 {
-    DPRINT1("StorPortAllocateRegistryBuffer()\n");
-    UNIMPLEMENTED;
-    return NULL;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+
+    DPRINT1("StorPortAllocateRegistryBuffer(%p %lu)\n",
+            HwDeviceExtension, *Length);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    /* Only one registry buffer per adapter */
+    if (DeviceExtension->RegistryBuffer != NULL)
+        return NULL;
+
+    DeviceExtension->RegistryBuffer = ExAllocatePoolWithTag(NonPagedPool,
+                                                            *Length,
+                                                            TAG_REGISTRY);
+    if (DeviceExtension->RegistryBuffer == NULL)
+    {
+        *Length = 0;
+        return NULL;
+    }
+
+    RtlZeroMemory(DeviceExtension->RegistryBuffer, *Length);
+
+    return DeviceExtension->RegistryBuffer;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -406,14 +497,21 @@ StorPortBusy(
     _In_ PVOID HwDeviceExtension,
     _In_ ULONG RequestsToComplete)
 {
-    DPRINT1("StorPortBuzy()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+
+    DPRINT("StorPortBusy(%p %lu)\n",
+           HwDeviceExtension, RequestsToComplete);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    InterlockedExchange(&DeviceExtension->BusyCount, (LONG)max(RequestsToComplete, 1));
+
+    return TRUE;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 VOID
@@ -425,8 +523,14 @@ StorPortCompleteRequest(
     _In_ UCHAR Lun,
     _In_ UCHAR SrbStatus)
 {
-    DPRINT1("StorPortCompleteRequest()\n");
-    UNIMPLEMENTED;
+    DPRINT1("StorPortCompleteRequest(%p %u %u %u 0x%02x)\n",
+            HwDeviceExtension, PathId, TargetId, Lun, SrbStatus);
+
+    PortCompleteActiveRequests(PortGetFdoExtension(HwDeviceExtension),
+                               PathId,
+                               TargetId,
+                               Lun,
+                               SrbStatus);
 }
 
 
@@ -482,7 +586,7 @@ StorPortDebugPrint(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -494,14 +598,26 @@ StorPortDeviceBusy(
     _In_ UCHAR Lun,
     _In_ ULONG RequestsToComplete)
 {
-    DPRINT1("StorPortDeviceBusy()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PUNIT_DATA Unit;
+
+    DPRINT("StorPortDeviceBusy(%p %u %u %u %lu)\n",
+           HwDeviceExtension, PathId, TargetId, Lun, RequestsToComplete);
+
+    Unit = PortFindUnit(PortGetFdoExtension(HwDeviceExtension),
+                        PathId,
+                        TargetId,
+                        Lun);
+    if (Unit == NULL)
+        return FALSE;
+
+    InterlockedExchange(&Unit->BusyCount, (LONG)max(RequestsToComplete, 1));
+
+    return TRUE;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -512,9 +628,22 @@ StorPortDeviceReady(
     _In_ UCHAR TargetId,
     _In_ UCHAR Lun)
 {
-    DPRINT1("StorPortDeviceReady()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PUNIT_DATA Unit;
+
+    DPRINT("StorPortDeviceReady(%p %u %u %u)\n",
+           HwDeviceExtension, PathId, TargetId, Lun);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    Unit = PortFindUnit(DeviceExtension, PathId, TargetId, Lun);
+    if (Unit == NULL)
+        return FALSE;
+
+    InterlockedExchange(&Unit->BusyCount, 0);
+    PortRestartQueues(DeviceExtension);
+
+    return TRUE;
 }
 
 
@@ -534,7 +663,7 @@ StorPortFreeDeviceBase(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 VOID
@@ -543,8 +672,18 @@ StorPortFreeRegistryBuffer(
     _In_ PVOID HwDeviceExtension,
     _In_ PUCHAR Buffer)
 {
-    DPRINT1("StorPortFreeRegistryBuffer()\n");
-    UNIMPLEMENTED;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+
+    DPRINT1("StorPortFreeRegistryBuffer(%p %p)\n",
+            HwDeviceExtension, Buffer);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    if (Buffer == NULL || Buffer != DeviceExtension->RegistryBuffer)
+        return;
+
+    ExFreePoolWithTag(DeviceExtension->RegistryBuffer, TAG_REGISTRY);
+    DeviceExtension->RegistryBuffer = NULL;
 }
 
 
@@ -665,7 +804,7 @@ StorPortGetDeviceBase(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 PVOID
@@ -676,9 +815,22 @@ StorPortGetLogicalUnit(
     _In_ UCHAR TargetId,
     _In_ UCHAR Lun)
 {
-    DPRINT1("StorPortGetLogicalUnit()\n");
-    UNIMPLEMENTED;
-    return NULL;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PUNIT_DATA Unit;
+
+    DPRINT("StorPortGetLogicalUnit(%p %u %u %u)\n",
+           HwDeviceExtension, PathId, TargetId, Lun);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    if (DeviceExtension->Miniport.PortConfig.SpecificLuExtensionSize == 0)
+        return NULL;
+
+    Unit = PortFindUnit(DeviceExtension, PathId, TargetId, Lun);
+    if (Unit == NULL)
+        return NULL;
+
+    return Unit->LuExtension;
 }
 
 
@@ -699,15 +851,15 @@ StorPortGetPhysicalAddress(
     STOR_PHYSICAL_ADDRESS PhysicalAddress;
     ULONG_PTR Offset;
 
-    DPRINT1("StorPortGetPhysicalAddress(%p %p %p %p)\n",
-            HwDeviceExtension, Srb, VirtualAddress, Length);
+    DPRINT("StorPortGetPhysicalAddress(%p %p %p %p)\n",
+           HwDeviceExtension, Srb, VirtualAddress, Length);
 
     /* Get the miniport extension */
     MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
                                           MINIPORT_DEVICE_EXTENSION,
                                           HwDeviceExtension);
-    DPRINT1("HwDeviceExtension %p  MiniportExtension %p\n",
-            HwDeviceExtension, MiniportExtension);
+    DPRINT("HwDeviceExtension %p  MiniportExtension %p\n",
+           HwDeviceExtension, MiniportExtension);
 
     DeviceExtension = MiniportExtension->Miniport->DeviceExtension;
 
@@ -723,19 +875,16 @@ StorPortGetPhysicalAddress(
         return PhysicalAddress;
     }
 
-    // FIXME
-
-    UNIMPLEMENTED;
-
-    *Length = 0;
-    PhysicalAddress.QuadPart = (LONGLONG)0;
+    /* Nonpaged memory of the miniport (SRB extension, LU extension or mapped data) */
+    PhysicalAddress = MmGetPhysicalAddress(VirtualAddress);
+    *Length = PAGE_SIZE - BYTE_OFFSET(VirtualAddress);
 
     return PhysicalAddress;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 PSTOR_SCATTER_GATHER_LIST
@@ -744,9 +893,19 @@ StorPortGetScatterGatherList(
     _In_ PVOID DeviceExtension,
     _In_ PSCSI_REQUEST_BLOCK Srb)
 {
-    DPRINT1("StorPortGetScatterGatherList()\n");
-    UNIMPLEMENTED;
-    return NULL;
+    PREQUEST_DATA Request;
+    PIRP Irp;
+
+    DPRINT("StorPortGetScatterGatherList(%p %p)\n",
+           DeviceExtension, Srb);
+
+    Irp = (PIRP)Srb->OriginalRequest;
+    if (Irp == NULL)
+        return NULL;
+
+    /* The HAL list has the same layout as the Storport list */
+    Request = (PREQUEST_DATA)Irp->Tail.Overlay.DriverContext[0];
+    return (PSTOR_SCATTER_GATHER_LIST)Request->ScatterGatherList;
 }
 
 
@@ -921,6 +1080,17 @@ StorPortInitialize(
 
         InitializeListHead(&DriverObjectExtension->InitDataListHead);
 
+        /* Keep the service key for StorPortRegistryRead/Write */
+        DriverObjectExtension->RegistryPath.Buffer = ExAllocatePoolWithTag(NonPagedPool,
+                                                                           RegistryPath->Length,
+                                                                           TAG_REGISTRY);
+        if (DriverObjectExtension->RegistryPath.Buffer != NULL)
+        {
+            DriverObjectExtension->RegistryPath.MaximumLength = RegistryPath->Length;
+            RtlCopyUnicodeString(&DriverObjectExtension->RegistryPath,
+                                 RegistryPath);
+        }
+
         /* Set handlers */
         DriverObject->DriverExtension->AddDevice = PortAddDevice;
 //        DriverObject->DriverStartIo = PortStartIo;
@@ -998,10 +1168,15 @@ StorPortNotification(
     PBOOLEAN Result;
     PSTOR_DPC Dpc;
     PHW_DPC_ROUTINE HwDpcRoutine;
+    PSCSI_REQUEST_BLOCK Srb;
+    PVOID SystemArgument1, SystemArgument2;
+    STOR_SPINLOCK LockType;
+    PVOID LockContext;
+    PSTOR_LOCK_HANDLE LockHandle;
     va_list ap;
 
-    DPRINT1("StorPortNotification(%x %p)\n",
-            NotificationType, HwDeviceExtension);
+    DPRINT("StorPortNotification(%x %p)\n",
+           NotificationType, HwDeviceExtension);
 
     /* Get the miniport extension */
     if (HwDeviceExtension != NULL)
@@ -1009,8 +1184,8 @@ StorPortNotification(
         MiniportExtension = CONTAINING_RECORD(HwDeviceExtension,
                                               MINIPORT_DEVICE_EXTENSION,
                                               HwDeviceExtension);
-        DPRINT1("HwDeviceExtension %p  MiniportExtension %p\n",
-                HwDeviceExtension, MiniportExtension);
+        DPRINT("HwDeviceExtension %p  MiniportExtension %p\n",
+               HwDeviceExtension, MiniportExtension);
 
         DeviceExtension = MiniportExtension->Miniport->DeviceExtension;
     }
@@ -1042,12 +1217,79 @@ StorPortNotification(
             HwDpcRoutine = (PHW_DPC_ROUTINE)va_arg(ap, PHW_DPC_ROUTINE);
             DPRINT1("HwDpcRoutine %p\n", HwDpcRoutine);
 
+            /* The miniport DPC routine gets its own device extension */
             KeInitializeDpc((PRKDPC)&Dpc->Dpc,
                             (PKDEFERRED_ROUTINE)HwDpcRoutine,
-                            (PVOID)DeviceExtension);
+                            HwDeviceExtension);
             KeInitializeSpinLock(&Dpc->Lock);
             break;
 
+        case RequestComplete:
+            Srb = (PSCSI_REQUEST_BLOCK)va_arg(ap, PSCSI_REQUEST_BLOCK);
+            DPRINT("RequestComplete %p\n", Srb);
+            PortNotifyRequestComplete(DeviceExtension, Srb);
+            break;
+
+        case NextRequest:
+        case NextLuRequest:
+            /* The queues are restarted after every completion anyway */
+            PortRestartQueues(DeviceExtension);
+            break;
+
+        case ResetDetected:
+            DPRINT1("ResetDetected\n");
+            break;
+
+        case IssueDpc:
+            Dpc = (PSTOR_DPC)va_arg(ap, PSTOR_DPC);
+            SystemArgument1 = (PVOID)va_arg(ap, PVOID);
+            SystemArgument2 = (PVOID)va_arg(ap, PVOID);
+            Result = (PBOOLEAN)va_arg(ap, PBOOLEAN);
+
+            *Result = KeInsertQueueDpc((PRKDPC)&Dpc->Dpc,
+                                       SystemArgument1,
+                                       SystemArgument2);
+            break;
+
+        case AcquireSpinLock:
+            LockType = (STOR_SPINLOCK)va_arg(ap, int);
+            LockContext = (PVOID)va_arg(ap, PVOID);
+            LockHandle = (PSTOR_LOCK_HANDLE)va_arg(ap, PSTOR_LOCK_HANDLE);
+
+            LockHandle->Lock = LockType;
+            LockHandle->Context.LockQueue.Next = NULL;
+
+            if (LockType == InterruptLock && DeviceExtension->Interrupt != NULL)
+            {
+                LockHandle->Context.LockQueue.Lock = DeviceExtension->Interrupt;
+                LockHandle->Context.OldIrql = KeAcquireInterruptSpinLock(DeviceExtension->Interrupt);
+                break;
+            }
+
+            /* Without an interrupt, the StartIo lock serializes against StartIo */
+            if (LockType == DpcLock)
+                LockHandle->Context.LockQueue.Lock = &((PSTOR_DPC)LockContext)->Lock;
+            else
+                LockHandle->Context.LockQueue.Lock = &DeviceExtension->StartIoLock;
+
+            KeAcquireSpinLock((PKSPIN_LOCK)LockHandle->Context.LockQueue.Lock,
+                              &LockHandle->Context.OldIrql);
+            break;
+
+        case ReleaseSpinLock:
+            LockHandle = (PSTOR_LOCK_HANDLE)va_arg(ap, PSTOR_LOCK_HANDLE);
+
+            if (LockHandle->Lock == InterruptLock && DeviceExtension->Interrupt != NULL)
+            {
+                KeReleaseInterruptSpinLock((PKINTERRUPT)LockHandle->Context.LockQueue.Lock,
+                                           LockHandle->Context.OldIrql);
+                break;
+            }
+
+            KeReleaseSpinLock((PKSPIN_LOCK)LockHandle->Context.LockQueue.Lock,
+                              LockHandle->Context.OldIrql);
+            break;
+
         default:
             DPRINT1("Unsupported Notification %lx\n", NotificationType);
             break;
@@ -1058,7 +1300,7 @@ StorPortNotification(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1067,14 +1309,19 @@ StorPortPause(
     _In_ PVOID HwDeviceExtension,
     _In_ ULONG TimeOut)
 {
-    DPRINT1("StorPortPause()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    DPRINT1("StorPortPause(%p %lu)\n",
+            HwDeviceExtension, TimeOut);
+
+    /* The timeout is given in seconds */
+    PortPauseAdapter(PortGetFdoExtension(HwDeviceExtension),
+                     (LONGLONG)TimeOut * 10000000);
+
+    return TRUE;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1086,14 +1333,27 @@ StorPortPauseDevice(
     _In_ UCHAR Lun,
     _In_ ULONG TimeOut)
 {
-    DPRINT1("StorPortPauseDevice()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PUNIT_DATA Unit;
+
+    DPRINT1("StorPortPauseDevice(%p %u %u %u %lu)\n",
+            HwDeviceExtension, PathId, TargetId, Lun, TimeOut);
+
+    Unit = PortFindUnit(PortGetFdoExtension(HwDeviceExtension),
+                        PathId,
+                        TargetId,
+                        Lun);
+    if (Unit == NULL)
+        return FALSE;
+
+    /* The timeout is given in seconds */
+    PortPauseUnit(Unit, (LONGLONG)TimeOut * 10000000);
+
+    return TRUE;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1101,14 +1361,22 @@ NTAPI
 StorPortReady(
     _In_ PVOID HwDeviceExtension)
 {
-    DPRINT1("StorPortReady()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+
+    DPRINT("StorPortReady(%p)\n",
+           HwDeviceExtension);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    InterlockedExchange(&DeviceExtension->BusyCount, 0);
+    PortRestartQueues(DeviceExtension);
+
+    return TRUE;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1121,14 +1389,88 @@ StorPortRegistryRead(
     _In_ PUCHAR Buffer,
     _In_ PULONG BufferLength)
 {
-    DPRINT1("StorPortRegistryRead()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PKEY_VALUE_PARTIAL_INFORMATION ValueInfo = NULL;
+    UNICODE_STRING Name = {0, 0, NULL};
+    ANSI_STRING AnsiName;
+    HANDLE KeyHandle = NULL;
+    ULONG Size, ResultSize;
+    BOOLEAN Result = FALSE;
+    NTSTATUS Status;
+
+    DPRINT1("StorPortRegistryRead(%p %s %lu %lu %p %p)\n",
+            HwDeviceExtension, ValueName, Global, Type, Buffer, BufferLength);
+
+    if (KeGetCurrentIrql() != PASSIVE_LEVEL)
+        return FALSE;
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    if (Buffer == NULL || Buffer != DeviceExtension->RegistryBuffer)
+        return FALSE;
+
+    Status = OpenDeviceParametersKey(&DeviceExtension->DriverExtension->RegistryPath,
+                                     Global ? (ULONG)-1 : DeviceExtension->PortNumber,
+                                     FALSE,
+                                     &KeyHandle);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    RtlInitAnsiString(&AnsiName, (PCSZ)ValueName);
+    Status = RtlAnsiStringToUnicodeString(&Name, &AnsiName, TRUE);
+    if (!NT_SUCCESS(Status))
+        goto done;
+
+    Size = FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data) + *BufferLength * sizeof(WCHAR);
+    ValueInfo = ExAllocatePoolWithTag(PagedPool, Size, TAG_REGISTRY);
+    if (ValueInfo == NULL)
+        goto done;
+
+    Status = ZwQueryValueKey(KeyHandle,
+                             &Name,
+                             KeyValuePartialInformation,
+                             ValueInfo,
+                             Size,
+                             &ResultSize);
+    if (!NT_SUCCESS(Status) || ValueInfo->Type != Type)
+        goto done;
+
+    if (Type == REG_SZ || Type == REG_EXPAND_SZ || Type == REG_MULTI_SZ)
+    {
+        /* Miniports deal with ANSI strings */
+        Status = RtlUnicodeToMultiByteN((PCHAR)Buffer,
+                                        *BufferLength,
+                                        &ResultSize,
+                                        (PWCH)ValueInfo->Data,
+                                        ValueInfo->DataLength);
+        if (!NT_SUCCESS(Status))
+            goto done;
+    }
+    else
+    {
+        if (ValueInfo->DataLength > *BufferLength)
+            goto done;
+
+        ResultSize = ValueInfo->DataLength;
+        RtlCopyMemory(Buffer, ValueInfo->Data, ResultSize);
+    }
+
+    *BufferLength = ResultSize;
+    Result = TRUE;
+
+done:
+    if (ValueInfo != NULL)
+        ExFreePoolWithTag(ValueInfo, TAG_REGISTRY);
+
+    RtlFreeUnicodeString(&Name);
+    ZwClose(KeyHandle);
+
+    return Result;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1141,14 +1483,76 @@ StorPortRegistryWrite(
     _In_ PUCHAR Buffer,
     _In_ ULONG BufferLength)
 {
-    DPRINT1("StorPortRegistryWrite()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    UNICODE_STRING Name = {0, 0, NULL};
+    ANSI_STRING AnsiName;
+    HANDLE KeyHandle = NULL;
+    PVOID Data = Buffer;
+    ULONG DataLength = BufferLength;
+    NTSTATUS Status;
+
+    DPRINT1("StorPortRegistryWrite(%p %s %lu %lu %p %lu)\n",
+            HwDeviceExtension, ValueName, Global, Type, Buffer, BufferLength);
+
+    if (KeGetCurrentIrql() != PASSIVE_LEVEL)
+        return FALSE;
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    if (Buffer == NULL || Buffer != DeviceExtension->RegistryBuffer)
+        return FALSE;
+
+    Status = OpenDeviceParametersKey(&DeviceExtension->DriverExtension->RegistryPath,
+                                     Global ? (ULONG)-1 : DeviceExtension->PortNumber,
+                                     TRUE,
+                                     &KeyHandle);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    RtlInitAnsiString(&AnsiName, (PCSZ)ValueName);
+    Status = RtlAnsiStringToUnicodeString(&Name, &AnsiName, TRUE);
+    if (!NT_SUCCESS(Status))
+        goto done;
+
+    if (Type == REG_SZ || Type == REG_EXPAND_SZ || Type == REG_MULTI_SZ)
+    {
+        /* Miniports deal with ANSI strings */
+        RtlMultiByteToUnicodeSize(&DataLength, (PCSTR)Buffer, BufferLength);
+
+        Data = ExAllocatePoolWithTag(PagedPool, DataLength, TAG_REGISTRY);
+        if (Data == NULL)
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto done;
+        }
+
+        RtlMultiByteToUnicodeN((PWCH)Data,
+                               DataLength,
+                               &DataLength,
+                               (PCSTR)Buffer,
+                               BufferLength);
+    }
+
+    Status = ZwSetValueKey(KeyHandle,
+                           &Name,
+                           0,
+                           Type,
+                           Data,
+                           DataLength);
+
+done:
+    if (Data != NULL && Data != Buffer)
+        ExFreePoolWithTag(Data, TAG_REGISTRY);
+
+    RtlFreeUnicodeString(&Name);
+    ZwClose(KeyHandle);
+
+    return NT_SUCCESS(Status);
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1156,14 +1560,17 @@ NTAPI
 StorPortResume(
     _In_ PVOID HwDeviceExtension)
 {
-    DPRINT1("StorPortResume()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    DPRINT1("StorPortResume(%p)\n",
+            HwDeviceExtension);
+
+    PortResumeAdapter(PortGetFdoExtension(HwDeviceExtension));
+
+    return TRUE;
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1174,9 +1581,21 @@ StorPortResumeDevice(
     _In_ UCHAR TargetId,
     _In_ UCHAR Lun)
 {
-    DPRINT1("StorPortResumeDevice()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PUNIT_DATA Unit;
+
+    DPRINT1("StorPortResumeDevice(%p %u %u %u)\n",
+            HwDeviceExtension, PathId, TargetId, Lun);
+
+    Unit = PortFindUnit(PortGetFdoExtension(HwDeviceExtension),
+                        PathId,
+                        TargetId,
+                        Lun);
+    if (Unit == NULL)
+        return FALSE;
+
+    PortResumeUnit(Unit);
+
+    return TRUE;
 }
 
 
@@ -1222,7 +1641,7 @@ StorPortSetBusDataByOffset(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 BOOLEAN
@@ -1234,9 +1653,24 @@ StorPortSetDeviceQueueDepth(
     _In_ UCHAR Lun,
     _In_ ULONG Depth)
 {
-    DPRINT1("StorPortSetDeviceQueueDepth()\n");
-    UNIMPLEMENTED;
-    return FALSE;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    PUNIT_DATA Unit;
+
+    DPRINT1("StorPortSetDeviceQueueDepth(%p %u %u %u %lu)\n",
+            HwDeviceExtension, PathId, TargetId, Lun, Depth);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    Unit = PortFindUnit(DeviceExtension, PathId, TargetId, Lun);
+    if (Unit == NULL)
+        return FALSE;
+
+    Unit->QueueDepth = max(Depth, 1);
+
+    /* A deeper queue may take more requests right now */
+    PortRestartQueues(DeviceExtension);
+
+    return TRUE;
 }
 
 
@@ -1254,7 +1688,7 @@ StorPortStallExecution(
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 STORPORT_API
 VOID
@@ -1264,8 +1698,31 @@ StorPortSynchronizeAccess(
     _In_ PSTOR_SYNCHRONIZED_ACCESS SynchronizedAccessRoutine,
     _In_opt_ PVOID Context)
 {
-    DPRINT1("StorPortSynchronizeAccess()\n");
-    UNIMPLEMENTED;
+    PFDO_DEVICE_EXTENSION DeviceExtension;
+    SYNCHRONIZE_ACCESS_CONTEXT SyncContext;
+    KIRQL OldIrql;
+
+    DPRINT("StorPortSynchronizeAccess(%p %p %p)\n",
+           HwDeviceExtension, SynchronizedAccessRoutine, Context);
+
+    DeviceExtension = PortGetFdoExtension(HwDeviceExtension);
+
+    if (DeviceExtension->Interrupt != NULL)
+    {
+        SyncContext.Routine = SynchronizedAccessRoutine;
+        SyncContext.HwDeviceExtension = HwDeviceExtension;
+        SyncContext.Context = Context;
+
+        KeSynchronizeExecution(DeviceExtension->Interrupt,
+                               PortSynchronizeRoutine,
+                               &SyncContext);
+    }
+    else
+    {
+        KeAcquireSpinLock(&DeviceExtension->StartIoLock, &OldIrql);
+        SynchronizedAccessRoutine(HwDeviceExtension, Context);
+        KeReleaseSpinLock(&DeviceExtension->StartIoLock, OldIrql);
+    }
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <portcls.h>
 #include <float_cast.h>
+#include <samplerate.h>
 
 typedef struct
 {
@@ -18,6 +19,25 @@ typedef struct
 
 }SUM_NODE_CONTEXT, *PSUM_NODE_CONTEXT;
 
+typedef struct
+{
+    KSDATAFORMAT_WAVEFORMATEX Formats[2];               // input and output format of the pin
+
+    SRC_STATE * SrcState;                               // resampler, kept for the lifetime of the stream
+    ULONG SrcChannels;                                  // channel count SrcState was created for
+    ULONG SrcInputRate;                                 // rates SrcState is converting between
+    ULONG SrcOutputRate;
+    PFLOAT FloatIn;                                     // resampler scratch buffers
+    ULONG FloatInLength;                                // length in samples
+    PFLOAT FloatOut;
+    ULONG FloatOutLength;
+
+    LONG VolumeLevel;                                   // stream volume in 1/65536 dB
+    ULONG Gain;                                         // stream volume as 16.16 fixed point factor
+}KMIXER_PIN_CONTEXT, *PKMIXER_PIN_CONTEXT;
+
+#define KMIXER_UNITY_GAIN (1 << 16)
+
 
 NTSTATUS
 NTAPI
@@ -8,15 +8,154 @@
 
 #include "kmixer.h"
 
-#include <samplerate.h>
-
 #define NDEBUG
 #include <debug.h>
 
 const GUID KSPROPSETID_Connection              = {0x1D58C920L, 0xAC9B, 0x11CF, {0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00}};
+const GUID KSPROPSETID_Audio                   = {0x45FFAAA0L, 0x6E1B, 0x11D0, {0xBC, 0xF2, 0x44, 0x45, 0x53, 0x54, 0x00, 0x00}};
+
+static
+NTSTATUS
+EnsureFloatBuffer(
+    PFLOAT * Buffer,
+    PULONG Length,
+    ULONG NewLength,
+    ULONG Preserve)
+{
+    PFLOAT NewBuffer;
+
+    if (*Length >= NewLength)
+        return STATUS_SUCCESS;
+
+    NewBuffer = ExAllocatePool(NonPagedPool, NewLength * sizeof(FLOAT));
+    if (!NewBuffer)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    if (*Buffer)
+    {
+        RtlMoveMemory(NewBuffer, *Buffer, Preserve * sizeof(FLOAT));
+        ExFreePool(*Buffer);
+    }
+
+    *Buffer = NewBuffer;
+    *Length = NewLength;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+ConvertToFloat(
+    PUCHAR Buffer,
+    ULONG BytesPerSample,
+    ULONG Gain,
+    PFLOAT Out,
+    ULONG Count)
+{
+    ULONG Index = 0;
+    FLOAT Scale;
+
+    /* the stream volume is folded into the scale factor */
+    if (BytesPerSample == 1)
+    {
+        Scale = (FLOAT)Gain / (65536.0f * 128.0f);
+
+        for(; Index < Count; Index++)
+            Out[Index] = ((LONG)Buffer[Index] - 0x80) * Scale;
+    }
+    else if (BytesPerSample == 2)
+    {
+        PSHORT In = (PSHORT)Buffer;
+
+        Scale = (FLOAT)Gain / (65536.0f * 32768.0f);
+
+        for(; Index + 4 <= Count; Index += 4)
+        {
+            Out[Index] = In[Index] * Scale;
+            Out[Index + 1] = In[Index + 1] * Scale;
+            Out[Index + 2] = In[Index + 2] * Scale;
+            Out[Index + 3] = In[Index + 3] * Scale;
+        }
+        for(; Index < Count; Index++)
+            Out[Index] = In[Index] * Scale;
+    }
+    else if (BytesPerSample == 4)
+    {
+        PLONG In = (PLONG)Buffer;
+
+        Scale = (FLOAT)Gain / (65536.0f * 2147483648.0f);
+
+        for(; Index + 4 <= Count; Index += 4)
+        {
+            Out[Index] = In[Index] * Scale;
+            Out[Index + 1] = In[Index + 1] * Scale;
+            Out[Index + 2] = In[Index + 2] * Scale;
+            Out[Index + 3] = In[Index + 3] * Scale;
+        }
+        for(; Index < Count; Index++)
+            Out[Index] = In[Index] * Scale;
+    }
+}
+
+static
+VOID
+ConvertFromFloat(
+    PFLOAT In,
+    ULONG BytesPerSample,
+    PUCHAR Buffer,
+    ULONG Count)
+{
+    ULONG Index;
+    FLOAT Value;
+
+    if (BytesPerSample == 1)
+    {
+        for(Index = 0; Index < Count; Index++)
+        {
+            Value = In[Index] * 128.0f;
+            if (Value >= 127.0f)
+                Buffer[Index] = 0xFF;
+            else if (Value <= -128.0f)
+                Buffer[Index] = 0x00;
+            else
+                Buffer[Index] = (UCHAR)(lrintf(Value) + 0x80);
+        }
+    }
+    else if (BytesPerSample == 2)
+    {
+        PSHORT Out = (PSHORT)Buffer;
+
+        for(Index = 0; Index < Count; Index++)
+        {
+            Value = In[Index] * 32768.0f;
+            if (Value >= 32767.0f)
+                Out[Index] = 32767;
+            else if (Value <= -32768.0f)
+                Out[Index] = -32768;
+            else
+                Out[Index] = (SHORT)lrintf(Value);
+        }
+    }
+    else if (BytesPerSample == 4)
+    {
+        PLONG Out = (PLONG)Buffer;
+
+        for(Index = 0; Index < Count; Index++)
+        {
+            /* 0x7FFFFFFF is not representable as float, compare against 2^31 */
+            Value = In[Index] * 2147483648.0f;
+            if (Value >= 2147483648.0f)
+                Out[Index] = 0x7FFFFFFF;
+            else if (Value <= -2147483648.0f)
+                Out[Index] = (LONG)0x80000000;
+            else
+                Out[Index] = lrintf(Value);
+        }
+    }
+}
 
 NTSTATUS
 PerformSampleRateConversion(
+    PKMIXER_PIN_CONTEXT Context,
     PUCHAR Buffer,
     ULONG BufferLength,
     ULONG OldRate,
@@ -28,19 +167,27 @@ PerformSampleRateConversion(
 {
     KFLOATING_SAVE FloatSave;
     NTSTATUS Status;
-    ULONG Index;
-    SRC_STATE * State;
     SRC_DATA Data;
     PUCHAR ResultOut;
     int error;
-    PFLOAT FloatIn, FloatOut;
     ULONG NumSamples;
     ULONG NewSamples;
+    ULONG Generated;
 
     DPRINT("PerformSampleRateConversion OldRate %u NewRate %u BytesPerSample %u NumChannels %u Irql %u\n", OldRate, NewRate, BytesPerSample, NumChannels, KeGetCurrentIrql());
 
     ASSERT(BytesPerSample == 1 || BytesPerSample == 2 || BytesPerSample == 4);
 
+    NumSamples = BufferLength / (BytesPerSample * NumChannels);
+    NewSamples = ((((ULONG64)NumSamples * NewRate) + (OldRate / 2)) / OldRate) + 2;
+
+    /* make room for the frames the resampler still holds from the previous buffer */
+    Status = EnsureFloatBuffer(&Context->FloatIn, &Context->FloatInLength, NumSamples * NumChannels, 0);
+    if (NT_SUCCESS(Status))
+        Status = EnsureFloatBuffer(&Context->FloatOut, &Context->FloatOutLength, (NewSamples + 64) * NumChannels, 0);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
     /* first acquire float save context */
     Status = KeSaveFloatingPointState(&FloatSave);
 
@@ -50,104 +197,147 @@ PerformSampleRateConversion(
         return Status;
     }
 
-    NumSamples = BufferLength / (BytesPerSample * NumChannels);
+    if (Context->SrcState && Context->SrcChannels != NumChannels)
+    {
+        /* channel count changed, the filter history is useless */
+        Context->SrcState = src_delete(Context->SrcState);
+    }
 
-    FloatIn = ExAllocatePool(NonPagedPool, NumSamples * NumChannels * sizeof(FLOAT));
-    if (!FloatIn)
+    if (!Context->SrcState)
     {
-        KeRestoreFloatingPointState(&FloatSave);
-        return STATUS_INSUFFICIENT_RESOURCES;
+        Context->SrcState = src_new(SRC_SINC_FASTEST, NumChannels, &error);
+        if (!Context->SrcState)
+        {
+            DPRINT1("src_new failed with %x\n", error);
+            KeRestoreFloatingPointState(&FloatSave);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+        Context->SrcChannels = NumChannels;
+        Context->SrcInputRate = OldRate;
+        Context->SrcOutputRate = NewRate;
+    }
+    else if (Context->SrcInputRate != OldRate || Context->SrcOutputRate != NewRate)
+    {
+        /* format changed, start over */
+        src_reset(Context->SrcState);
+        Context->SrcInputRate = OldRate;
+        Context->SrcOutputRate = NewRate;
     }
 
-    NewSamples = ((((ULONG64)NumSamples * NewRate) + (OldRate / 2)) / OldRate) + 2;
+    ConvertToFloat(Buffer, BytesPerSample, Context->Gain, Context->FloatIn, NumSamples * NumChannels);
 
-    FloatOut = ExAllocatePool(NonPagedPool, NewSamples * NumChannels * sizeof(FLOAT));
-    if (!FloatOut)
+    Data.data_in = Context->FloatIn;
+    Data.input_frames = NumSamples;
+    Data.src_ratio = (double)NewRate / (double)OldRate;
+    Data.end_of_input = 0;
+    Generated = 0;
+
+    for(;;)
     {
-        ExFreePool(FloatIn);
-        KeRestoreFloatingPointState(&FloatSave);
-        return STATUS_INSUFFICIENT_RESOURCES;
+        Data.data_out = Context->FloatOut + Generated * NumChannels;
+        Data.output_frames = Context->FloatOutLength / NumChannels - Generated;
+
+        error = src_process(Context->SrcState, &Data);
+        if (error)
+        {
+            DPRINT1("src_process failed with %x\n", error);
+            KeRestoreFloatingPointState(&FloatSave);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+        Generated += Data.output_frames_gen;
+        Data.data_in += Data.input_frames_used * NumChannels;
+        Data.input_frames -= Data.input_frames_used;
+
+        if (!Data.input_frames)
+            break;
+
+        if (!Data.input_frames_used && !Data.output_frames_gen)
+        {
+            DPRINT1("src_process made no progress\n");
+            KeRestoreFloatingPointState(&FloatSave);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+        /* output buffer is full, grow it */
+        Status = EnsureFloatBuffer(&Context->FloatOut, &Context->FloatOutLength, Context->FloatOutLength * 2, Generated * NumChannels);
+        if (!NT_SUCCESS(Status))
+        {
+            KeRestoreFloatingPointState(&FloatSave);
+            return Status;
+        }
     }
 
-    ResultOut = ExAllocatePool(NonPagedPool, NewSamples * NumChannels * BytesPerSample);
+    ResultOut = ExAllocatePool(NonPagedPool, max(Generated * NumChannels * BytesPerSample, 1));
     if (!ResultOut)
     {
-        ExFreePool(FloatIn);
-        ExFreePool(FloatOut);
         KeRestoreFloatingPointState(&FloatSave);
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    State = src_new(SRC_SINC_FASTEST, NumChannels, &error);
-    if (!State)
-    {
-        DPRINT1("src_new failed with %x\n", error);
-        KeRestoreFloatingPointState(&FloatSave);
-        ExFreePool(FloatIn);
-        ExFreePool(FloatOut);
-        ExFreePool(ResultOut);
-        return STATUS_UNSUCCESSFUL;
-    }
+    ConvertFromFloat(Context->FloatOut, BytesPerSample, ResultOut, Generated * NumChannels);
 
-    /* fixme use asm */
-    if (BytesPerSample == 1)
-    {
-        for(Index = 0; Index < NumSamples * NumChannels; Index++)
-            FloatIn[Index] = (float)(Buffer[Index] / (1.0 * 0x80));
-    }
-    else if (BytesPerSample == 2)
-    {
-        src_short_to_float_array((short*)Buffer, FloatIn, NumSamples * NumChannels);
-    }
-    else if (BytesPerSample == 4)
-    {
-        src_int_to_float_array((int*)Buffer, FloatIn, NumSamples * NumChannels);
-    }
+    KeRestoreFloatingPointState(&FloatSave);
 
-    Data.data_in = FloatIn;
-    Data.data_out = FloatOut;
-    Data.input_frames = NumSamples;
-    Data.output_frames = NewSamples;
-    Data.src_ratio = (double)NewRate / (double)OldRate;
+    *Result = ResultOut;
+    *ResultLength = Generated * BytesPerSample * NumChannels;
+    return STATUS_SUCCESS;
+}
 
-    error = src_process(State, &Data);
-    if (error)
+NTSTATUS
+PerformVolumeConversion(
+    PUCHAR Buffer,
+    ULONG BufferLength,
+    ULONG BitsPerSample,
+    ULONG Gain)
+{
+    ULONG Samples;
+    ULONG Index;
+
+    /* the stream volume never amplifies, so no clipping is needed */
+    ASSERT(Gain < KMIXER_UNITY_GAIN);
+
+    Samples = BufferLength / (BitsPerSample / 8);
+
+    if (BitsPerSample == 8)
     {
-        DPRINT1("src_process failed with %x\n", error);
-        KeRestoreFloatingPointState(&FloatSave);
-        ExFreePool(FloatIn);
-        ExFreePool(FloatOut);
-        ExFreePool(ResultOut);
-        return STATUS_UNSUCCESSFUL;
+        for(Index = 0; Index < Samples; Index++)
+            Buffer[Index] = (UCHAR)(((((LONG)Buffer[Index] - 0x80) * (LONG)Gain) >> 16) + 0x80);
     }
-
-    if (BytesPerSample == 1)
+    else if (BitsPerSample == 16)
     {
-        /* FIXME perform over/under clipping */
+        PSHORT Samples16 = (PSHORT)Buffer;
 
-        for(Index = 0; Index < Data.output_frames_gen * NumChannels; Index++)
-            ResultOut[Index] = (lrintf(FloatOut[Index]) >> 24);
+        for(Index = 0; Index < Samples; Index++)
+            Samples16[Index] = (SHORT)((Samples16[Index] * (LONG)Gain) >> 16);
     }
-    else if (BytesPerSample == 2)
+    else if (BitsPerSample == 24)
     {
-        PUSHORT Res = (PUSHORT)ResultOut;
+        LONG Sample;
 
-        src_float_to_short_array(FloatOut, (short*)Res, Data.output_frames_gen * NumChannels);
+        for(Index = 0; Index < Samples * 3; Index += 3)
+        {
+            Sample = (LONG)((ULONG)Buffer[Index] << 8 | (ULONG)Buffer[Index + 1] << 16 | (ULONG)Buffer[Index + 2] << 24) >> 8;
+            Sample = (LONG)(((LONGLONG)Sample * Gain) >> 16);
+            Buffer[Index] = (UCHAR)Sample;
+            Buffer[Index + 1] = (UCHAR)(Sample >> 8);
+            Buffer[Index + 2] = (UCHAR)(Sample >> 16);
+        }
     }
-    else if (BytesPerSample == 4)
+    else if (BitsPerSample == 32)
     {
-        PULONG Res = (PULONG)ResultOut;
+        PLONG Samples32 = (PLONG)Buffer;
 
-        src_float_to_int_array(FloatOut, (int*)Res, Data.output_frames_gen * NumChannels);
+        for(Index = 0; Index < Samples; Index++)
+            Samples32[Index] = (LONG)(((LONGLONG)Samples32[Index] * Gain) >> 16);
+    }
+    else
+    {
+        DPRINT1("Not implemented volume conversion BitsPerSample %u\n", BitsPerSample);
+        return STATUS_NOT_IMPLEMENTED;
     }
 
-
-    *Result = ResultOut;
-    *ResultLength = Data.output_frames_gen * BytesPerSample * NumChannels;
-    ExFreePool(FloatIn);
-    ExFreePool(FloatOut);
-    src_delete(State);
-    KeRestoreFloatingPointState(&FloatSave);
     return STATUS_SUCCESS;
 }
 
@@ -417,6 +607,41 @@ PerformQualityConversion(
     return STATUS_SUCCESS;
 }
 
+static
+NTSTATUS
+SetStreamVolume(
+    PKMIXER_PIN_CONTEXT Context,
+    LONG VolumeLevel)
+{
+    KFLOATING_SAVE FloatSave;
+    NTSTATUS Status;
+
+    /* -96 dB is silence, the stream volume only attenuates */
+    if (VolumeLevel > 0)
+        VolumeLevel = 0;
+    else if (VolumeLevel < -96 * 65536)
+        VolumeLevel = -96 * 65536;
+
+    if (VolumeLevel == 0)
+    {
+        Context->VolumeLevel = VolumeLevel;
+        Context->Gain = KMIXER_UNITY_GAIN;
+        return STATUS_SUCCESS;
+    }
+
+    Status = KeSaveFloatingPointState(&FloatSave);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    Context->VolumeLevel = VolumeLevel;
+    if (VolumeLevel == -96 * 65536)
+        Context->Gain = 0;
+    else
+        Context->Gain = (ULONG)(pow(10.0, VolumeLevel / (20.0 * 65536.0)) * KMIXER_UNITY_GAIN + 0.5);
+
+    KeRestoreFloatingPointState(&FloatSave);
+    return STATUS_SUCCESS;
+}
 
 NTSTATUS
 NTAPI
@@ -426,9 +651,12 @@ Pin_fnDeviceIoControl(
 {
     PIO_STACK_LOCATION IoStack;
     PKSP_PIN Property;
+    PKMIXER_PIN_CONTEXT Context;
+    NTSTATUS Status;
     //DPRINT1("Pin_fnDeviceIoControl called DeviceObject %p Irp %p\n", DeviceObject);
 
     IoStack = IoGetCurrentIrpStackLocation(Irp);
+    Context = (PKMIXER_PIN_CONTEXT)IoStack->FileObject->FsContext2;
 
     if (IoStack->Parameters.DeviceIoControl.InputBufferLength == sizeof(KSP_PIN) && IoStack->Parameters.DeviceIoControl.OutputBufferLength == sizeof(KSDATAFORMAT_WAVEFORMATEX))
     {
@@ -441,7 +669,7 @@ Pin_fnDeviceIoControl(
                 PKSDATAFORMAT_WAVEFORMATEX Formats;
                 PKSDATAFORMAT_WAVEFORMATEX WaveFormat;
 
-                Formats = (PKSDATAFORMAT_WAVEFORMATEX)IoStack->FileObject->FsContext2;
+                Formats = Context->Formats;
                 WaveFormat = (PKSDATAFORMAT_WAVEFORMATEX)Irp->UserBuffer;
 
                 ASSERT(Property->PinId == 0 || Property->PinId == 1);
@@ -459,6 +687,33 @@ Pin_fnDeviceIoControl(
             }
         }
     }
+    else if (IoStack->Parameters.DeviceIoControl.InputBufferLength == sizeof(KSNODEPROPERTY_AUDIO_CHANNEL) && IoStack->Parameters.DeviceIoControl.OutputBufferLength == sizeof(LONG))
+    {
+        PKSNODEPROPERTY_AUDIO_CHANNEL Channel = (PKSNODEPROPERTY_AUDIO_CHANNEL)IoStack->Parameters.DeviceIoControl.Type3InputBuffer;
+
+        /* the volume applies to the whole stream, the channel is ignored */
+        if (IsEqualGUIDAligned(&Channel->NodeProperty.Property.Set, &KSPROPSETID_Audio) &&
+            Channel->NodeProperty.Property.Id == KSPROPERTY_AUDIO_VOLUMELEVEL)
+        {
+            ASSERT(Irp->UserBuffer);
+
+            if (Channel->NodeProperty.Property.Flags & KSPROPERTY_TYPE_SET)
+            {
+                Status = SetStreamVolume(Context, *(PLONG)Irp->UserBuffer);
+                Irp->IoStatus.Information = 0;
+            }
+            else
+            {
+                *(PLONG)Irp->UserBuffer = Context->VolumeLevel;
+                Status = STATUS_SUCCESS;
+                Irp->IoStatus.Information = sizeof(LONG);
+            }
+
+            Irp->IoStatus.Status = Status;
+            IoCompleteRequest(Irp, IO_NO_INCREMENT);
+            return Status;
+        }
+    }
     DPRINT1("Size %u Expected %u\n",IoStack->Parameters.DeviceIoControl.OutputBufferLength,  sizeof(KSDATAFORMAT_WAVEFORMATEX));
     Irp->IoStatus.Information = 0;
     Irp->IoStatus.Status = STATUS_UNSUCCESSFUL;
@@ -514,7 +769,25 @@ Pin_fnClose(
     PDEVICE_OBJECT DeviceObject,
     PIRP Irp)
 {
-    UNIMPLEMENTED;
+    PIO_STACK_LOCATION IoStack;
+    PKMIXER_PIN_CONTEXT Context;
+
+    IoStack = IoGetCurrentIrpStackLocation(Irp);
+    Context = (PKMIXER_PIN_CONTEXT)IoStack->FileObject->FsContext2;
+
+    if (Context)
+    {
+        /* release the resampler of the stream */
+        if (Context->SrcState)
+            src_delete(Context->SrcState);
+        if (Context->FloatIn)
+            ExFreePool(Context->FloatIn);
+        if (Context->FloatOut)
+            ExFreePool(Context->FloatOut);
+
+        ExFreePool(Context);
+        IoStack->FileObject->FsContext2 = NULL;
+    }
 
     Irp->IoStatus.Status = STATUS_SUCCESS;
     Irp->IoStatus.Information = 0;
@@ -604,15 +877,15 @@ Pin_fnFastWrite(
     PVOID BufferOut;
     ULONG BufferLength;
     NTSTATUS Status = STATUS_SUCCESS;
-    PKSDATAFORMAT_WAVEFORMATEX Formats;
+    PKMIXER_PIN_CONTEXT Context;
     PKSDATAFORMAT_WAVEFORMATEX InputFormat, OutputFormat;
 
     DPRINT("Pin_fnFastWrite called DeviceObject %p Irp %p\n", DeviceObject);
 
-    Formats = (PKSDATAFORMAT_WAVEFORMATEX)FileObject->FsContext2;
+    Context = (PKMIXER_PIN_CONTEXT)FileObject->FsContext2;
 
-    InputFormat = Formats;
-    OutputFormat = (Formats + 1);
+    InputFormat = &Context->Formats[0];
+    OutputFormat = &Context->Formats[1];
     StreamHeader = (PKSSTREAM_HEADER)Buffer;
 
 
@@ -657,7 +930,8 @@ Pin_fnFastWrite(
 
     if (InputFormat->WaveFormatEx.nSamplesPerSec != OutputFormat->WaveFormatEx.nSamplesPerSec)
     {
-        Status = PerformSampleRateConversion(StreamHeader->Data,
+        Status = PerformSampleRateConversion(Context,
+                                             StreamHeader->Data,
                                              StreamHeader->DataUsed,
                                              InputFormat->WaveFormatEx.nSamplesPerSec,
                                              OutputFormat->WaveFormatEx.nSamplesPerSec,
@@ -672,6 +946,14 @@ Pin_fnFastWrite(
             StreamHeader->DataUsed = BufferLength;
         }
     }
+    else if (Context->Gain != KMIXER_UNITY_GAIN)
+    {
+        /* the resampler applies the volume itself, otherwise scale in place */
+        Status = PerformVolumeConversion(StreamHeader->Data,
+                                         StreamHeader->DataUsed,
+                                         OutputFormat->WaveFormatEx.wBitsPerSample,
+                                         Context->Gain);
+    }
 
     IoStatus->Status = Status;
 
@@ -701,21 +983,27 @@ CreatePin(
 {
     NTSTATUS Status;
     KSOBJECT_HEADER ObjectHeader;
-    PKSDATAFORMAT DataFormat;
+    PKMIXER_PIN_CONTEXT Context;
     PIO_STACK_LOCATION IoStack;
 
 
-    DataFormat = ExAllocatePool(NonPagedPool, sizeof(KSDATAFORMAT_WAVEFORMATEX) * 2);
-    if (!DataFormat)
+    Context = ExAllocatePool(NonPagedPool, sizeof(KMIXER_PIN_CONTEXT));
+    if (!Context)
         return STATUS_INSUFFICIENT_RESOURCES;
 
-    RtlZeroMemory(DataFormat, sizeof(KSDATAFORMAT_WAVEFORMATEX) * 2);
+    RtlZeroMemory(Context, sizeof(KMIXER_PIN_CONTEXT));
+    Context->Gain = KMIXER_UNITY_GAIN;
 
     IoStack = IoGetCurrentIrpStackLocation(Irp);
-    IoStack->FileObject->FsContext2 = (PVOID)DataFormat;
+    IoStack->FileObject->FsContext2 = (PVOID)Context;
 
     /* allocate object header */
     Status = KsAllocateObjectHeader(&ObjectHeader, 0, NULL, Irp, &PinTable);
+    if (!NT_SUCCESS(Status))
+    {
+        ExFreePool(Context);
+        IoStack->FileObject->FsContext2 = NULL;
+    }
     return Status;
 }
 
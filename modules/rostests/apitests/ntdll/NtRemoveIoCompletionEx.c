@@ -0,0 +1,220 @@
+/*
+ * PROJECT:         ReactOS API tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * PURPOSE:         Test for NtRemoveIoCompletionEx
+ */
+
+/* For the completion notification modes */
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+
+#include <apitest.h>
+
+#define WIN32_NO_STATUS
+#include <ndk/iofuncs.h>
+#include <ndk/obfuncs.h>
+
+static
+VOID
+Test_Batch(HANDLE Port)
+{
+    FILE_IO_COMPLETION_INFORMATION Entries[8];
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+    ULONG Removed;
+    ULONG i;
+
+    Timeout.QuadPart = 0;
+
+    for (i = 0; i < 3; i++)
+    {
+        Status = NtSetIoCompletion(Port, (PVOID)(ULONG_PTR)(i + 1), (PVOID)(ULONG_PTR)(i + 0x10), STATUS_SUCCESS, i);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    Removed = 0xdeadbeef;
+    RtlFillMemory(Entries, sizeof(Entries), 0x55);
+    Status = NtRemoveIoCompletionEx(Port, Entries, 8, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_int(Removed, 3);
+    for (i = 0; i < 3; i++)
+    {
+        ok(Entries[i].KeyContext == (PVOID)(ULONG_PTR)(i + 1), "[%lu] KeyContext = %p\n", i, Entries[i].KeyContext);
+        ok(Entries[i].ApcContext == (PVOID)(ULONG_PTR)(i + 0x10), "[%lu] ApcContext = %p\n", i, Entries[i].ApcContext);
+        ok_ntstatus(Entries[i].IoStatusBlock.Status, STATUS_SUCCESS);
+        ok(Entries[i].IoStatusBlock.Information == i, "[%lu] Information = %Iu\n", i, Entries[i].IoStatusBlock.Information);
+    }
+
+    /* The port is empty now */
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, Entries, 8, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_TIMEOUT);
+    ok_int(Removed, 0);
+}
+
+static
+VOID
+Test_PartialBatch(HANDLE Port)
+{
+    FILE_IO_COMPLETION_INFORMATION Entries[2];
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+    ULONG Removed;
+
+    Timeout.QuadPart = 0;
+
+    Status = NtSetIoCompletion(Port, (PVOID)1, NULL, STATUS_SUCCESS, 0);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    Status = NtSetIoCompletion(Port, (PVOID)2, NULL, STATUS_SUCCESS, 0);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    /* Only as many entries as requested are removed */
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, Entries, 1, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_int(Removed, 1);
+    ok(Entries[0].KeyContext == (PVOID)1, "KeyContext = %p\n", Entries[0].KeyContext);
+
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, Entries, 2, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_int(Removed, 1);
+    ok(Entries[0].KeyContext == (PVOID)2, "KeyContext = %p\n", Entries[0].KeyContext);
+}
+
+static
+VOID
+Test_InvalidParameters(HANDLE Port)
+{
+    FILE_IO_COMPLETION_INFORMATION Entry;
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+    ULONG Removed;
+
+    Timeout.QuadPart = 0;
+
+    Status = NtRemoveIoCompletionEx(Port, &Entry, 0, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_INVALID_PARAMETER);
+
+    Status = NtRemoveIoCompletionEx(NULL, &Entry, 1, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_INVALID_HANDLE);
+}
+
+static
+VOID
+Test_SkipModes(HANDLE Port)
+{
+    FILE_IO_COMPLETION_NOTIFICATION_INFORMATION NotificationInfo;
+    FILE_COMPLETION_INFORMATION CompletionInfo;
+    FILE_IO_COMPLETION_INFORMATION Entry;
+    IO_STATUS_BLOCK IoStatusBlock, ReadIoStatusBlock;
+    LARGE_INTEGER Timeout;
+    HANDLE Server, Client;
+    OVERLAPPED Overlapped;
+    DWORD Written;
+    NTSTATUS Status;
+    ULONG Removed;
+    UCHAR Buffer[4] = { 1, 2, 3, 4 };
+    UCHAR ReadBuffer[4];
+
+    Server = CreateNamedPipeW(L"\\\\.\\pipe\\NtRemoveIoCompletionEx",
+                              PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                              PIPE_TYPE_BYTE | PIPE_WAIT,
+                              1, 4096, 4096, 0, NULL);
+    ok(Server != INVALID_HANDLE_VALUE, "CreateNamedPipeW failed with %lu\n", GetLastError());
+    if (Server == INVALID_HANDLE_VALUE)
+        return;
+
+    Client = CreateFileW(L"\\\\.\\pipe\\NtRemoveIoCompletionEx",
+                         GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                         OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+    ok(Client != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (Client == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(Server);
+        return;
+    }
+
+    CompletionInfo.Port = Port;
+    CompletionInfo.Key = (PVOID)0x42;
+    Status = NtSetInformationFile(Server, &IoStatusBlock, &CompletionInfo, sizeof(CompletionInfo), FileCompletionInformation);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    /* No modes by default */
+    NotificationInfo.Flags = 0xdeadbeef;
+    Status = NtQueryInformationFile(Server, &IoStatusBlock, &NotificationInfo, sizeof(NotificationInfo), FileIoCompletionNotificationInformation);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_hex(NotificationInfo.Flags, 0);
+
+    NotificationInfo.Flags = FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE;
+    Status = NtSetInformationFile(Server, &IoStatusBlock, &NotificationInfo, sizeof(NotificationInfo), FileIoCompletionNotificationInformation);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    /* The query returns what was set */
+    NotificationInfo.Flags = 0xdeadbeef;
+    Status = NtQueryInformationFile(Server, &IoStatusBlock, &NotificationInfo, sizeof(NotificationInfo), FileIoCompletionNotificationInformation);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_hex(NotificationInfo.Flags, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE);
+
+    /* There is room in the pipe, so the write succeeds right away */
+    Status = NtWriteFile(Server, NULL, NULL, (PVOID)1, &IoStatusBlock, Buffer, sizeof(Buffer), NULL, NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_ntstatus(IoStatusBlock.Status, STATUS_SUCCESS);
+    ok(IoStatusBlock.Information == sizeof(Buffer), "Information = %Iu\n", IoStatusBlock.Information);
+
+    /* ... and neither queues a packet nor signals the file */
+    Timeout.QuadPart = 0;
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, &Entry, 1, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_TIMEOUT);
+    ok_int(Removed, 0);
+    ok_int(WaitForSingleObject(Server, 0), WAIT_TIMEOUT);
+
+    /* Nothing to read yet, so the read pends */
+    Status = NtReadFile(Server, NULL, NULL, (PVOID)2, &ReadIoStatusBlock, ReadBuffer, sizeof(ReadBuffer), NULL, NULL);
+    ok_ntstatus(Status, STATUS_PENDING);
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!WriteFile(Client, Buffer, sizeof(Buffer), &Written, &Overlapped))
+    {
+        ok(GetLastError() == ERROR_IO_PENDING, "WriteFile failed with %lu\n", GetLastError());
+        GetOverlappedResult(Client, &Overlapped, &Written, TRUE);
+    }
+    CloseHandle(Overlapped.hEvent);
+
+    /* A request that pended still gets its packet */
+    Timeout.QuadPart = -5000 * 10000LL;
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, &Entry, 1, &Removed, &Timeout, FALSE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_int(Removed, 1);
+    ok(Entry.KeyContext == (PVOID)0x42, "KeyContext = %p\n", Entry.KeyContext);
+    ok(Entry.ApcContext == (PVOID)2, "ApcContext = %p\n", Entry.ApcContext);
+    ok_ntstatus(Entry.IoStatusBlock.Status, STATUS_SUCCESS);
+    ok(Entry.IoStatusBlock.Information == sizeof(ReadBuffer), "Information = %Iu\n", Entry.IoStatusBlock.Information);
+
+    CloseHandle(Client);
+    CloseHandle(Server);
+}
+
+START_TEST(NtRemoveIoCompletionEx)
+{
+    HANDLE Port;
+    NTSTATUS Status;
+
+    Status = NtCreateIoCompletion(&Port, IO_COMPLETION_ALL_ACCESS, NULL, 0);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to create completion port\n");
+        return;
+    }
+
+    Test_Batch(Port);
+    Test_PartialBatch(Port);
+    Test_InvalidParameters(Port);
+    Test_SkipModes(Port);
+
+    NtClose(Port);
+}
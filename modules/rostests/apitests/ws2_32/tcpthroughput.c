@@ -0,0 +1,219 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Loopback TCP bulk transfer throughput
+ */
+
+#include <apitest.h>
+
+#include <stdio.h>
+#include <windows.h>
+#include <winsock2.h>
+
+#define TRANSFER_SIZE   (32 * 1024 * 1024)
+#define CHUNK_SIZE      (64 * 1024)
+#define TRANSFER_TIMEOUT 120000
+
+typedef struct _SENDER_CONTEXT
+{
+    SOCKET Socket;
+    ULONG BytesSent;
+    int Error;
+} SENDER_CONTEXT, *PSENDER_CONTEXT;
+
+static
+UCHAR
+PatternByte(ULONG Offset)
+{
+    /* Not a multiple of the chunk size, so misplaced data shows up */
+    return (UCHAR)(Offset % 251);
+}
+
+/* Kernel plus user time of the whole process, in 100ns units */
+static
+ULONGLONG
+ProcessCpuTime(VOID)
+{
+    FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+    ULARGE_INTEGER Kernel, User;
+
+    if (!GetProcessTimes(GetCurrentProcess(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+        return 0;
+
+    Kernel.LowPart = KernelTime.dwLowDateTime;
+    Kernel.HighPart = KernelTime.dwHighDateTime;
+    User.LowPart = UserTime.dwLowDateTime;
+    User.HighPart = UserTime.dwHighDateTime;
+    return Kernel.QuadPart + User.QuadPart;
+}
+
+static
+DWORD
+WINAPI
+SenderThread(LPVOID Parameter)
+{
+    PSENDER_CONTEXT Context = (PSENDER_CONTEXT)Parameter;
+    PUCHAR Buffer;
+    ULONG Offset, i;
+    int Length, Result;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, CHUNK_SIZE);
+    if (!Buffer)
+    {
+        Context->Error = ERROR_NOT_ENOUGH_MEMORY;
+        return 0;
+    }
+
+    for (Offset = 0; Offset < TRANSFER_SIZE; Offset += Length)
+    {
+        Length = min(CHUNK_SIZE, TRANSFER_SIZE - Offset);
+        for (i = 0; i < (ULONG)Length; i++)
+            Buffer[i] = PatternByte(Offset + i);
+
+        Result = send(Context->Socket, (const char *)Buffer, Length, 0);
+        if (Result == SOCKET_ERROR)
+        {
+            Context->Error = WSAGetLastError();
+            break;
+        }
+
+        /* Blocking sends take everything or fail */
+        Length = Result;
+        Context->BytesSent += Result;
+    }
+
+    shutdown(Context->Socket, SD_SEND);
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    return 0;
+}
+
+START_TEST(tcpthroughput)
+{
+    WSADATA WsaData;
+    SOCKET ListenSocket, ServerSocket, ClientSocket;
+    struct sockaddr_in Address;
+    SENDER_CONTEXT Context;
+    HANDLE Thread;
+    PUCHAR Buffer;
+    ULONG Received, Mismatch, i;
+    DWORD StartTime, Elapsed;
+    ULONGLONG StartCpu, CpuTime;
+    int AddressLength, Result;
+
+    if (WSAStartup(MAKEWORD(2, 2), &WsaData) != 0)
+    {
+        skip("WSAStartup failed\n");
+        return;
+    }
+
+    ListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ClientSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(ListenSocket != INVALID_SOCKET, "socket failed with %d\n", WSAGetLastError());
+    ok(ClientSocket != INVALID_SOCKET, "socket failed with %d\n", WSAGetLastError());
+    if (ListenSocket == INVALID_SOCKET || ClientSocket == INVALID_SOCKET)
+    {
+        closesocket(ListenSocket);
+        closesocket(ClientSocket);
+        WSACleanup();
+        return;
+    }
+
+    /* Let the stack pick the port */
+    ZeroMemory(&Address, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    Address.sin_port = 0;
+    Result = bind(ListenSocket, (struct sockaddr *)&Address, sizeof(Address));
+    ok(Result == 0, "bind failed with %d\n", WSAGetLastError());
+    AddressLength = sizeof(Address);
+    Result = getsockname(ListenSocket, (struct sockaddr *)&Address, &AddressLength);
+    ok(Result == 0, "getsockname failed with %d\n", WSAGetLastError());
+    Result = listen(ListenSocket, 1);
+    ok(Result == 0, "listen failed with %d\n", WSAGetLastError());
+
+    Result = connect(ClientSocket, (struct sockaddr *)&Address, sizeof(Address));
+    ok(Result == 0, "connect failed with %d\n", WSAGetLastError());
+    ServerSocket = accept(ListenSocket, NULL, NULL);
+    ok(ServerSocket != INVALID_SOCKET, "accept failed with %d\n", WSAGetLastError());
+    if (Result != 0 || ServerSocket == INVALID_SOCKET)
+    {
+        closesocket(ListenSocket);
+        closesocket(ClientSocket);
+        WSACleanup();
+        return;
+    }
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, CHUNK_SIZE);
+    ok(Buffer != NULL, "HeapAlloc failed\n");
+    if (!Buffer)
+    {
+        closesocket(ServerSocket);
+        closesocket(ListenSocket);
+        closesocket(ClientSocket);
+        WSACleanup();
+        return;
+    }
+
+    ZeroMemory(&Context, sizeof(Context));
+    Context.Socket = ClientSocket;
+
+    StartTime = GetTickCount();
+    StartCpu = ProcessCpuTime();
+    Thread = CreateThread(NULL, 0, SenderThread, &Context, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+
+    /* Receive until the sender shuts its side down, checking every byte */
+    Received = 0;
+    Mismatch = 0;
+    while (Thread != NULL)
+    {
+        Result = recv(ServerSocket, (char *)Buffer, CHUNK_SIZE, 0);
+        if (Result <= 0)
+        {
+            ok(Result == 0, "recv failed with %d\n", WSAGetLastError());
+            break;
+        }
+
+        for (i = 0; i < (ULONG)Result; i++)
+        {
+            if (Buffer[i] != PatternByte(Received + i))
+                Mismatch++;
+        }
+        Received += Result;
+
+        if (GetTickCount() - StartTime > TRANSFER_TIMEOUT)
+        {
+            ok(0, "Transfer did not finish in %u ms\n", TRANSFER_TIMEOUT);
+            break;
+        }
+    }
+    Elapsed = GetTickCount() - StartTime;
+    CpuTime = ProcessCpuTime() - StartCpu;
+
+    if (Thread != NULL)
+    {
+        /* Unblocks a stuck sender */
+        closesocket(ServerSocket);
+        ServerSocket = INVALID_SOCKET;
+        ok(WaitForSingleObject(Thread, 10000) == WAIT_OBJECT_0, "Sender did not exit\n");
+        CloseHandle(Thread);
+    }
+
+    ok(Context.Error == 0, "send failed with %d\n", Context.Error);
+    ok(Context.BytesSent == TRANSFER_SIZE, "Sent %lu bytes\n", Context.BytesSent);
+    ok(Received == TRANSFER_SIZE, "Received %lu bytes\n", Received);
+    ok(Mismatch == 0, "%lu bytes differ\n", Mismatch);
+
+    /* Compare CPU per MB with AFD's Parameters\DirectReceive on and off */
+    trace("%lu bytes in %lu ms, %lu KB/s, %lu us CPU per MB\n",
+          Received, Elapsed,
+          (ULONG)(((ULONGLONG)Received * 1000 / 1024) / max(Elapsed, 1)),
+          (ULONG)(CpuTime / 10 * 1024 * 1024 / max(Received, 1)));
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    if (ServerSocket != INVALID_SOCKET)
+        closesocket(ServerSocket);
+    closesocket(ListenSocket);
+    closesocket(ClientSocket);
+    WSACleanup();
+}
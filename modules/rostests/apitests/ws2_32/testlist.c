@@ -14,6 +14,7 @@ extern void func_nonblocking(void);
 extern void func_nostartup(void);
 extern void func_recv(void);
 extern void func_send(void);
+extern void func_tcpthroughput(void);
 extern void func_WSAAsync(void);
 extern void func_WSAIoctl(void);
 extern void func_WSARecv(void);
@@ -32,6 +33,7 @@ const struct test winetest_testlist[] =
     { "nostartup", func_nostartup },
     { "recv", func_recv },
     { "send", func_send },
+    { "tcpthroughput", func_tcpthroughput },
     { "WSAAsync", func_WSAAsync },
     { "WSAIoctl", func_WSAIoctl },
     { "WSARecv", func_WSARecv },
@@ -26,6 +26,7 @@ KMT_TESTFUNC Test_RtlRegistry;
 KMT_TESTFUNC Test_RtlSplayTree;
 KMT_TESTFUNC Test_RtlStack;
 KMT_TESTFUNC Test_RtlUnicodeString;
+KMT_TESTFUNC Test_TcpIpChecksum;
 KMT_TESTFUNC Test_TcpIpIoctl;
 KMT_TESTFUNC Test_TcpIpTdi;
 KMT_TESTFUNC Test_TcpIpConnect;
@@ -52,6 +53,7 @@ const KMT_TEST TestList[] =
     { "RtlSplayTree",                 Test_RtlSplayTree },
     { "RtlStack",                     Test_RtlStack },
     { "RtlUnicodeString",             Test_RtlUnicodeString },
+    { "TcpIpChecksum",                Test_TcpIpChecksum },
     { "TcpIpTdi",                     Test_TcpIpTdi },
     { "TcpIpConnect",                 Test_TcpIpConnect },
     { NULL,                           NULL },
@@ -687,9 +687,97 @@ static VOID FsRtlLargeMcbTestsExt2()
     FsRtlUninitializeLargeMcb(&FirstMcb);
 }
 
+#define MANY_RUNS_COUNT 100000
+#define MANY_RUNS_LENGTH 16
+
+/* A heavily fragmented file: walking all of its runs must not be quadratic */
+static VOID FsRtlLargeMcbTestsManyRuns()
+{
+    LARGE_MCB LargeMcb;
+    LONGLONG Vbn, Lbn, SectorCount, StartingLbn, CountFromStartingLbn;
+    ULONGLONG StartTime;
+    ULONG i, NbRuns, Index, Errors;
+    BOOLEAN Result;
+
+    FsRtlInitializeLargeMcb(&LargeMcb, PagedPool);
+
+    /* Contiguous Vbns, but every run lands somewhere else on disk */
+    StartTime = KeQueryInterruptTime();
+    Errors = 0;
+    for (i = 0; i < MANY_RUNS_COUNT; i++)
+    {
+        if (!FsRtlAddLargeMcbEntry(&LargeMcb, (LONGLONG)i * MANY_RUNS_LENGTH, (LONGLONG)i * MANY_RUNS_LENGTH * 2, MANY_RUNS_LENGTH))
+            Errors++;
+    }
+    trace("Adding %lu runs took %I64u ms\n", MANY_RUNS_COUNT, (KeQueryInterruptTime() - StartTime) / 10000);
+    ok(Errors == 0, "%lu additions failed\n", Errors);
+
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&LargeMcb);
+    ok(NbRuns == MANY_RUNS_COUNT, "Expected %lu runs, got: %lu\n", MANY_RUNS_COUNT, NbRuns);
+
+    StartTime = KeQueryInterruptTime();
+    Errors = 0;
+    for (i = 0; FsRtlGetNextLargeMcbEntry(&LargeMcb, i, &Vbn, &Lbn, &SectorCount); i++)
+    {
+        if (Vbn != (LONGLONG)i * MANY_RUNS_LENGTH || Lbn != Vbn * 2 || SectorCount != MANY_RUNS_LENGTH)
+            Errors++;
+    }
+    trace("Enumerating %lu runs took %I64u ms\n", i, (KeQueryInterruptTime() - StartTime) / 10000);
+    ok(i == MANY_RUNS_COUNT, "Expected %lu runs, got: %lu\n", MANY_RUNS_COUNT, i);
+    ok(Errors == 0, "%lu runs were wrong\n", Errors);
+
+    StartTime = KeQueryInterruptTime();
+    Errors = 0;
+    for (i = 0; i < MANY_RUNS_COUNT; i++)
+    {
+        Vbn = (LONGLONG)((i * 7919) % MANY_RUNS_COUNT) * MANY_RUNS_LENGTH + 3;
+        Result = FsRtlLookupLargeMcbEntry(&LargeMcb, Vbn, &Lbn, &SectorCount, &StartingLbn, &CountFromStartingLbn, &Index);
+        if (!Result || Lbn != (Vbn - 3) * 2 + 3 || SectorCount != MANY_RUNS_LENGTH - 3 ||
+            StartingLbn != (Vbn - 3) * 2 || CountFromStartingLbn != MANY_RUNS_LENGTH ||
+            Index != (i * 7919) % MANY_RUNS_COUNT)
+        {
+            Errors++;
+        }
+    }
+    trace("Looking up %lu Vbns took %I64u ms\n", MANY_RUNS_COUNT, (KeQueryInterruptTime() - StartTime) / 10000);
+    ok(Errors == 0, "%lu lookups were wrong\n", Errors);
+
+    ok(FsRtlLookupLastLargeMcbEntryAndIndex(&LargeMcb, &Vbn, &Lbn, &Index) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Vbn == (LONGLONG)MANY_RUNS_COUNT * MANY_RUNS_LENGTH - 1, "Expected Vbn %I64d, got: %I64d\n", (LONGLONG)MANY_RUNS_COUNT * MANY_RUNS_LENGTH - 1, Vbn);
+    ok(Index == MANY_RUNS_COUNT - 1, "Expected Index %lu, got: %lu\n", MANY_RUNS_COUNT - 1, Index);
+
+    /* Punch a hole in the middle of a run: one run becomes three */
+    FsRtlRemoveLargeMcbEntry(&LargeMcb, (MANY_RUNS_COUNT / 2) * MANY_RUNS_LENGTH + 4, 8);
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&LargeMcb);
+    ok(NbRuns == MANY_RUNS_COUNT + 2, "Expected %lu runs, got: %lu\n", MANY_RUNS_COUNT + 2, NbRuns);
+    ok(FsRtlGetNextLargeMcbEntry(&LargeMcb, MANY_RUNS_COUNT / 2 + 1, &Vbn, &Lbn, &SectorCount) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Lbn == -1, "Expected Lbn -1, got: %I64d\n", Lbn);
+    ok(SectorCount == 8, "Expected SectorCount 8, got: %I64d\n", SectorCount);
+
+    FsRtlTruncateLargeMcb(&LargeMcb, (MANY_RUNS_COUNT / 4) * MANY_RUNS_LENGTH);
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&LargeMcb);
+    ok(NbRuns == MANY_RUNS_COUNT / 4, "Expected %lu runs, got: %lu\n", MANY_RUNS_COUNT / 4, NbRuns);
+
+    /* Truncating or removing inside the last run only shortens it */
+    FsRtlTruncateLargeMcb(&LargeMcb, (MANY_RUNS_COUNT / 4 - 1) * MANY_RUNS_LENGTH + 10);
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&LargeMcb);
+    ok(NbRuns == MANY_RUNS_COUNT / 4, "Expected %lu runs, got: %lu\n", MANY_RUNS_COUNT / 4, NbRuns);
+    ok(FsRtlLookupLastLargeMcbEntry(&LargeMcb, &Vbn, &Lbn) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Vbn == (MANY_RUNS_COUNT / 4 - 1) * MANY_RUNS_LENGTH + 9, "Expected Vbn %I64d, got: %I64d\n", (LONGLONG)(MANY_RUNS_COUNT / 4 - 1) * MANY_RUNS_LENGTH + 9, Vbn);
+
+    FsRtlRemoveLargeMcbEntry(&LargeMcb, (MANY_RUNS_COUNT / 4 - 1) * MANY_RUNS_LENGTH + 4, 100);
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&LargeMcb);
+    ok(NbRuns == MANY_RUNS_COUNT / 4, "Expected %lu runs, got: %lu\n", MANY_RUNS_COUNT / 4, NbRuns);
+    ok(FsRtlLookupLastLargeMcbEntry(&LargeMcb, &Vbn, &Lbn) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Vbn == (MANY_RUNS_COUNT / 4 - 1) * MANY_RUNS_LENGTH + 3, "Expected Vbn %I64d, got: %I64d\n", (LONGLONG)(MANY_RUNS_COUNT / 4 - 1) * MANY_RUNS_LENGTH + 3, Vbn);
+
+    FsRtlUninitializeLargeMcb(&LargeMcb);
+}
+
 START_TEST(FsRtlMcb)
 {
     FsRtlMcbTest();
     FsRtlLargeMcbTest();
     FsRtlLargeMcbTestsExt2();
+    FsRtlLargeMcbTestsManyRuns();
 }
@@ -0,0 +1,145 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Kernel-Mode Test Suite I/O completion port dequeue benchmark
+ */
+
+#include <kmt_test.h>
+#include <ndk/iofuncs.h>
+
+#define PACKET_COUNT    20000
+#define BATCH_SIZE      64
+
+static
+VOID
+QueuePackets(
+    HANDLE Port,
+    ULONG Count)
+{
+    NTSTATUS Status;
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+    {
+        Status = ZwSetIoCompletion(Port, (PVOID)(ULONG_PTR)(i + 1), NULL, STATUS_SUCCESS, i);
+        if (!NT_SUCCESS(Status))
+        {
+            ok_eq_hex(Status, STATUS_SUCCESS);
+            break;
+        }
+    }
+}
+
+static
+ULONG
+RemoveOneByOne(
+    HANDLE Port,
+    ULONG Count)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER Timeout;
+    IO_STATUS_BLOCK IoStatus;
+    PVOID Key, Context;
+    ULONG Removed, Misordered = 0;
+
+    Timeout.QuadPart = 0;
+    for (Removed = 0; Removed < Count; Removed++)
+    {
+        Status = ZwRemoveIoCompletion(Port, &Key, &Context, &IoStatus, &Timeout);
+        if (Status != STATUS_SUCCESS)
+            break;
+
+        if (Key != (PVOID)(ULONG_PTR)(Removed + 1))
+            Misordered++;
+    }
+
+    ok_eq_ulong(Misordered, 0UL);
+    return Removed;
+}
+
+static
+ULONG
+RemoveBatched(
+    HANDLE Port,
+    ULONG Count)
+{
+    FILE_IO_COMPLETION_INFORMATION Entries[BATCH_SIZE];
+    NTSTATUS Status;
+    LARGE_INTEGER Timeout;
+    ULONG Removed = 0, Misordered = 0;
+    ULONG Batch, i;
+
+    Timeout.QuadPart = 0;
+    while (Removed < Count)
+    {
+        Status = ZwRemoveIoCompletionEx(Port, Entries, BATCH_SIZE, &Batch, &Timeout, FALSE);
+        if (Status != STATUS_SUCCESS)
+            break;
+
+        for (i = 0; i < Batch; i++)
+        {
+            if (Entries[i].KeyContext != (PVOID)(ULONG_PTR)(Removed + i + 1))
+                Misordered++;
+        }
+        Removed += Batch;
+    }
+
+    ok_eq_ulong(Misordered, 0UL);
+    return Removed;
+}
+
+static
+ULONGLONG
+ElapsedMicroseconds(
+    LARGE_INTEGER Start,
+    LARGE_INTEGER Frequency)
+{
+    LARGE_INTEGER End;
+
+    End = KeQueryPerformanceCounter(NULL);
+    return (ULONGLONG)(End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+}
+
+START_TEST(IoCompletion)
+{
+    NTSTATUS Status;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE Port;
+    LARGE_INTEGER Start, Frequency, Timeout;
+    FILE_IO_COMPLETION_INFORMATION Entry;
+    ULONGLONG SingleTime, BatchTime;
+    ULONG Removed;
+
+    InitializeObjectAttributes(&ObjectAttributes, NULL, OBJ_KERNEL_HANDLE, NULL, NULL);
+    Status = ZwCreateIoCompletion(&Port, IO_COMPLETION_ALL_ACCESS, &ObjectAttributes, 0);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "No completion port\n"))
+        return;
+
+    KeQueryPerformanceCounter(&Frequency);
+
+    /* One system service per packet */
+    QueuePackets(Port, PACKET_COUNT);
+    Start = KeQueryPerformanceCounter(NULL);
+    Removed = RemoveOneByOne(Port, PACKET_COUNT);
+    SingleTime = ElapsedMicroseconds(Start, Frequency);
+    ok_eq_ulong(Removed, (ULONG)PACKET_COUNT);
+
+    /* Up to BATCH_SIZE packets per system service */
+    QueuePackets(Port, PACKET_COUNT);
+    Start = KeQueryPerformanceCounter(NULL);
+    Removed = RemoveBatched(Port, PACKET_COUNT);
+    BatchTime = ElapsedMicroseconds(Start, Frequency);
+    ok_eq_ulong(Removed, (ULONG)PACKET_COUNT);
+
+    trace("%d packets: ZwRemoveIoCompletion %I64u us, ZwRemoveIoCompletionEx(%d) %I64u us\n",
+          PACKET_COUNT, SingleTime, BATCH_SIZE, BatchTime);
+
+    /* Both loops must have drained the port */
+    Timeout.QuadPart = 0;
+    Status = ZwRemoveIoCompletionEx(Port, &Entry, 1, &Removed, &Timeout, FALSE);
+    ok_eq_hex(Status, STATUS_TIMEOUT);
+    ok_eq_ulong(Removed, 0UL);
+
+    ZwClose(Port);
+}
@@ -87,8 +87,79 @@ static void RtlSplayTreeTest()
     ok(IsListEmpty(&Allocations), "Didn't free all memory\n");
 }
 
+static RTL_GENERIC_COMPARE_RESULTS NTAPI
+CompareUlongTable(PRTL_GENERIC_TABLE Table, PVOID A, PVOID B)
+{
+    return (*((PULONG)A) < *((PULONG)B)) ? GenericLessThan :
+        (*((PULONG)A) > *((PULONG)B)) ? GenericGreaterThan :
+        GenericEqual;
+}
+
+#define INDEX_TEST_KEYS 512
+
+/* Insert and delete random keys, checking indexed access against a bitmap of the keys in the table */
+static void RtlGenericTableIndexTest()
+{
+    static BOOLEAN Present[INDEX_TEST_KEYS];
+    RTL_GENERIC_TABLE Table;
+    ULONG Seed = 0x12345678;
+    ULONG Count = 0;
+    ULONG Step, Key, i, j;
+    PULONG Element;
+    BOOLEAN WasNew, Mismatch;
+
+    RtlZeroMemory(Present, sizeof(Present));
+    RtlInitializeGenericTable
+        (&Table,
+         CompareUlongTable,
+         AllocRoutine,
+         FreeRoutine,
+         NULL);
+    for (Step = 0; Step < 4000; Step++) {
+        Seed = Seed * 1103515245 + 12345;
+        Key = (Seed >> 16) % INDEX_TEST_KEYS;
+        if (Step < 2000 ? (Seed & 0x300) != 0 : (Seed & 0x300) == 0) {
+            Element = (PULONG)RtlInsertElementGenericTable
+                (&Table,
+                 &Key,
+                 sizeof(Key),
+                 &WasNew);
+            ok(Element && *Element == Key, "Insert of %lu failed\n", Key);
+            ok(WasNew == !Present[Key], "Newness didn't match for %lu\n", Key);
+            if (!Present[Key]) Count++;
+            Present[Key] = TRUE;
+        } else {
+            ok(RtlDeleteElementGenericTable(&Table, &Key) == Present[Key],
+               "Delete of %lu didn't match\n", Key);
+            if (Present[Key]) Count--;
+            Present[Key] = FALSE;
+        }
+        if (Step % 100)
+            continue;
+        ok_eq_ulong(RtlNumberGenericTableElements(&Table), Count);
+        Mismatch = FALSE;
+        for (i = 0, j = 0; j < INDEX_TEST_KEYS; j++) {
+            if (!Present[j])
+                continue;
+            Element = (PULONG)RtlGetElementGenericTable(&Table, i);
+            if (!Element || *Element != j)
+                Mismatch = TRUE;
+            i++;
+        }
+        ok(!Mismatch, "Indexed access mismatch at step %lu\n", Step);
+        ok(!RtlGetElementGenericTable(&Table, Count), "Found an element past the end\n");
+    }
+    for (Key = 0; Key < INDEX_TEST_KEYS; Key++) {
+        if (Present[Key])
+            RtlDeleteElementGenericTable(&Table, &Key);
+    }
+    ok(!RtlNumberGenericTableElements(&Table), "Not zero elements\n");
+    ok(IsListEmpty(&Allocations), "Didn't free all memory\n");
+}
+
 START_TEST(RtlSplayTree)
 {
     InitializeListHead(&Allocations);
     RtlSplayTreeTest();
+    RtlGenericTableIndexTest();
 }
@@ -37,6 +37,15 @@ START_TEST(TcpIpTdi)
     UnloadTcpIpTestDriver();
 }
 
+START_TEST(TcpIpChecksum)
+{
+    LoadTcpIpTestDriver();
+
+    ok(KmtSendToDriver(IOCTL_TEST_CHECKSUM) == ERROR_SUCCESS, "\n");
+
+    UnloadTcpIpTestDriver();
+}
+
 static
 DWORD
 WINAPI
@@ -0,0 +1,168 @@
+/*
+ * PROJECT:         ReactOS kernel-mode tests
+ * LICENSE:         GPLv2+ - See COPYING in the top level directory
+ * PURPOSE:         Kernel-Mode Test Suite for the tcpip checksum routines
+ */
+
+#include <kmt_test.h>
+
+#include "tcpip.h"
+
+#define TAG_TEST 'tseT'
+
+#define BUFFER_SIZE     (64 * 1024)
+#define MAX_OFFSET      8
+
+/* From sdk/lib/drivers/ip/network/checksum.c */
+ULONG ChecksumFold(ULONG Sum);
+ULONG ChecksumCompute(PVOID Data, UINT Count, ULONG Seed);
+
+static const UINT BenchLengths[] = { 64, 576, 1500, 9000, BUFFER_SIZE - MAX_OFFSET };
+
+/* RFC 1071, one 16-bit word at a time */
+static
+ULONG
+ReferenceChecksum(
+    PUCHAR Data,
+    UINT Count,
+    ULONG Seed)
+{
+    ULONG Sum = Seed;
+
+    while (Count > 1)
+    {
+        Sum += *(PUSHORT)Data;
+        Sum = (Sum & 0xFFFF) + (Sum >> 16);
+        Data += sizeof(USHORT);
+        Count -= sizeof(USHORT);
+    }
+
+    if (Count > 0)
+        Sum += *Data;
+
+    return ChecksumFold(Sum);
+}
+
+static
+VOID
+TestChecksumResults(
+    PUCHAR Buffer)
+{
+    ULONG Offset, Length, Mismatch = 0;
+
+    for (Offset = 0; Offset < MAX_OFFSET; Offset++)
+    {
+        for (Length = 0; Length <= 300; Length++)
+        {
+            if (ChecksumFold(ChecksumCompute(Buffer + Offset, Length, 0)) !=
+                ReferenceChecksum(Buffer + Offset, Length, 0))
+                Mismatch++;
+
+            /* A seed carried over from a previous fragment */
+            if (ChecksumFold(ChecksumCompute(Buffer + Offset, Length, 0xFFFF)) !=
+                ReferenceChecksum(Buffer + Offset, Length, 0xFFFF))
+                Mismatch++;
+        }
+    }
+
+    ok_eq_ulong(Mismatch, 0UL);
+
+    /* All ones must not fold to the other zero */
+    RtlFillMemory(Buffer, BUFFER_SIZE, 0xFF);
+    ok_eq_ulong(ChecksumFold(ChecksumCompute(Buffer, BUFFER_SIZE, 0)), 0xFFFFUL);
+    ok_eq_ulong(ReferenceChecksum(Buffer, BUFFER_SIZE, 0), 0xFFFFUL);
+}
+
+static
+ULONGLONG
+TimeChecksum(
+    PUCHAR Buffer,
+    UINT Length,
+    ULONG Iterations,
+    BOOLEAN Reference,
+    LARGE_INTEGER Frequency)
+{
+    LARGE_INTEGER Start, End;
+    volatile ULONG Sum = 0;
+    ULONG i;
+
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < Iterations; i++)
+    {
+        if (Reference)
+            Sum += ReferenceChecksum(Buffer + 1, Length, 0);
+        else
+            Sum += ChecksumFold(ChecksumCompute(Buffer + 1, Length, 0));
+    }
+    End = KeQueryPerformanceCounter(NULL);
+
+    return (ULONGLONG)(End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+}
+
+static
+VOID
+TestChecksumSpeed(
+    PUCHAR Buffer)
+{
+    LARGE_INTEGER Frequency;
+    ULONGLONG WordTime, ComputeTime;
+    ULONG Iterations, i;
+
+    KeQueryPerformanceCounter(&Frequency);
+
+    for (i = 0; i < RTL_NUMBER_OF(BenchLengths); i++)
+    {
+        /* About 64 MB per run, measured from an odd address */
+        Iterations = (64 * 1024 * 1024) / BenchLengths[i];
+
+        WordTime = TimeChecksum(Buffer, BenchLengths[i], Iterations, TRUE, Frequency);
+        ComputeTime = TimeChecksum(Buffer, BenchLengths[i], Iterations, FALSE, Frequency);
+
+        trace("%u bytes x %lu: 16-bit loop %I64u us, ChecksumCompute %I64u us\n",
+              BenchLengths[i], Iterations, WordTime, ComputeTime);
+    }
+}
+
+static
+VOID
+NTAPI
+RunTest(
+    _In_ PVOID Context)
+{
+    PUCHAR Buffer;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    Buffer = ExAllocatePoolWithTag(NonPagedPool, BUFFER_SIZE, TAG_TEST);
+    ok(Buffer != NULL, "Failed to allocate the buffer\n");
+    if (skip(Buffer != NULL, "No buffer\n"))
+        return;
+
+    /* Not a power of two, so words differ across the buffer */
+    for (i = 0; i < BUFFER_SIZE; i++)
+        Buffer[i] = (UCHAR)(i * 167 + (i >> 8));
+
+    TestChecksumResults(Buffer);
+    TestChecksumSpeed(Buffer);
+
+    ExFreePoolWithTag(Buffer, TAG_TEST);
+}
+
+KMT_MESSAGE_HANDLER TestChecksum;
+NTSTATUS
+TestChecksum(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ ULONG ControlCode,
+    _In_opt_ PVOID Buffer,
+    _In_ SIZE_T InLength,
+    _Inout_ PSIZE_T OutLength
+)
+{
+    PKTHREAD Thread;
+
+    Thread = KmtStartThread(RunTest, NULL);
+    KmtFinishThread(Thread, NULL);
+
+    return STATUS_SUCCESS;
+}
@@ -233,7 +233,8 @@ MiSwapInPage(PMMSUPPORT AddressSpace,
     }
 
     Status = MmReadFromSwapPage(Resources->SwapEntry,
-                                Resources->Page[Resources->Offset]);
+                                Resources->Page[Resources->Offset],
+                                NULL);
     if (!NT_SUCCESS(Status))
     {
         DPRINT1("MmReadFromSwapPage failed, status = %x\n", Status);
@@ -490,6 +490,14 @@ INIT_FUNCTION CM_SYSTEM_CONTROL_VECTOR CmControlVector[] =
         NULL
     },
 
+    {
+        L"Session Manager\\Memory Management",
+        L"LargePageDrivers",
+        MmLargePageDriverBuffer,
+        &MmLargePageDriverBufferLength,
+        NULL
+    },
+
     {
         L"Session Manager\\Memory Management",
         L"LargePageMinimum",
@@ -530,6 +538,22 @@ INIT_FUNCTION CM_SYSTEM_CONTROL_VECTOR CmControlVector[] =
         NULL
     },
 
+    {
+        L"Session Manager\\Memory Management",
+        L"CodeClusterSize",
+        &MmCodeClusterSize,
+        NULL,
+        NULL
+    },
+
+    {
+        L"Session Manager\\Memory Management",
+        L"DataClusterSize",
+        &MmDataClusterSize,
+        NULL,
+        NULL
+    },
+
     {
         L"Session Manager\\Executive",
         L"AdditionalCriticalWorkerThreads",
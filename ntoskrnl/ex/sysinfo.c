@@ -639,10 +639,10 @@ QSI_DEF(SystemPerformanceInformation)
     Spi->PageFaultCount = 0; /* FIXME */
     Spi->CopyOnWriteCount = 0; /* FIXME */
     Spi->TransitionCount = 0; /* FIXME */
-    Spi->CacheTransitionCount = 0; /* FIXME */
+    Spi->CacheTransitionCount = MmSectionPrefetchHitCount;
     Spi->DemandZeroCount = 0; /* FIXME */
-    Spi->PageReadCount = 0; /* FIXME */
-    Spi->PageReadIoCount = 0; /* FIXME */
+    Spi->PageReadCount = MmSectionReadPageCount;
+    Spi->PageReadIoCount = MmSectionReadIoCount;
     Spi->CacheReadCount = 0; /* FIXME */
     Spi->CacheIoCount = 0; /* FIXME */
     Spi->DirtyPagesWriteCount = 0; /* FIXME */
@@ -2503,6 +2503,26 @@ QSI_DEF(SystemExtendedHandleInformation)
     return Status;
 }
 
+/* Class 80 - Memory list information */
+QSI_DEF(SystemMemoryListInformation)
+{
+    SYSTEM_MEMORY_LIST_INFORMATION MemoryListInfo;
+
+    *ReqSize = sizeof(SYSTEM_MEMORY_LIST_INFORMATION);
+
+    /* Check user's buffer size */
+    if (Size < sizeof(SYSTEM_MEMORY_LIST_INFORMATION))
+    {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    /* Snapshot the page lists, then copy out */
+    MmQueryMemoryListInformation(&MemoryListInfo);
+    RtlCopyMemory(Buffer, &MemoryListInfo, sizeof(MemoryListInfo));
+
+    return STATUS_SUCCESS;
+}
+
 /* Query/Set Calls Table */
 typedef
 struct _QSSI_CALLS
@@ -2590,11 +2610,28 @@ CallQS [] =
     SI_XX(SystemEmulationBasicInformation), /* FIXME: not implemented */
     SI_XX(SystemEmulationProcessorInformation), /* FIXME: not implemented */
     SI_QX(SystemExtendedHandleInformation),
+    SI_XX(SystemLostDelayedWriteInformation),
+    SI_XX(SystemBigPoolInformation),
+    SI_XX(SystemSessionPoolTagInformation),
+    SI_XX(SystemSessionMappedViewInformation),
+    SI_XX(SystemHotpatchInformation),
+    SI_XX(SystemObjectSecurityMode),
+    SI_XX(SystemWatchDogTimerHandler),
+    SI_XX(SystemWatchDogTimerInformation),
+    SI_XX(SystemLogicalProcessorInformation),
+    SI_XX(SystemWow64SharedInformationObsolete),
+    SI_XX(SystemRegisterFirmwareTableInformationHandler),
+    SI_XX(SystemFirmwareTableInformation),
+    SI_XX(SystemModuleInformationEx),
+    SI_XX(SystemVerifierTriageInformation),
+    SI_XX(SystemSuperfetchInformation),
+    SI_QX(SystemMemoryListInformation),
 };
 
 C_ASSERT(SystemBasicInformation == 0);
 #define MIN_SYSTEM_INFO_CLASS (SystemBasicInformation)
 #define MAX_SYSTEM_INFO_CLASS (sizeof(CallQS) / sizeof(CallQS[0]))
+C_ASSERT(MAX_SYSTEM_INFO_CLASS == SystemMemoryListInformation + 1);
 
 /*
  * @implemented
@@ -22,95 +22,255 @@
 PAGED_LOOKASIDE_LIST FsRtlFirstMappingLookasideList;
 NPAGED_LOOKASIDE_LIST FsRtlFastMutexLookasideList;
 
-/* We use only real 'mapping' runs; we do not store 'holes' to our GTree. */
+/*
+ * The mapping is a sorted array of runs covering [0, NextVbn of the last run).
+ * A run starts where the previous one ends (at 0 for the first one), so the
+ * array is searched by binary search and run N is simply Mapping[N].
+ * 'Holes' are stored as runs mapping to Lbn -1; the last run is never a hole,
+ * two holes are never adjacent and two runs are merged as soon as their Lbns
+ * are contiguous, which is exactly the run list the FsRtl API reports.
+ */
 typedef struct _LARGE_MCB_MAPPING_ENTRY // run
 {
-    LARGE_INTEGER RunStartVbn;
-    LARGE_INTEGER RunEndVbn;   /* RunStartVbn+SectorCount; that means +1 after the last sector */
-    LARGE_INTEGER StartingLbn; /* Lbn of 'RunStartVbn' */
+    LARGE_INTEGER NextVbn;  /* +1 after the last sector of the run */
+    LARGE_INTEGER Lbn;      /* Lbn of the first sector of the run, -1 for a hole */
 } LARGE_MCB_MAPPING_ENTRY, *PLARGE_MCB_MAPPING_ENTRY;
 
-typedef struct _LARGE_MCB_MAPPING // mcb_priv
-{
-    RTL_GENERIC_TABLE Table;
-} LARGE_MCB_MAPPING, *PLARGE_MCB_MAPPING;
-
 typedef struct _BASE_MCB_INTERNAL {
-    ULONG MaximumPairCount;
-    ULONG PairCount;
+    ULONG MaximumPairCount;     /* Capacity of Mapping, in runs */
+    ULONG PairCount;            /* Runs in use, holes included */
     USHORT PoolType;
     USHORT Flags;
-    PLARGE_MCB_MAPPING Mapping;
+    PLARGE_MCB_MAPPING_ENTRY Mapping;
 } BASE_MCB_INTERNAL, *PBASE_MCB_INTERNAL;
 
-/*
-static LARGE_MCB_MAPPING_ENTRY StaticRunBelow0 = {
-    {{-1}}, // ignored
-    {{0}},
-    {{-1}}, // ignored
-};
-*/
-
-static PVOID NTAPI McbMappingAllocate(PRTL_GENERIC_TABLE Table, CLONG Bytes)
+C_ASSERT(sizeof(BASE_MCB_INTERNAL) == sizeof(BASE_MCB));
+
+#define MCB_HOLE_LBN (-1LL)
+
+static
+LONGLONG
+McbRunStartVbn(IN PBASE_MCB_INTERNAL Mcb,
+               IN ULONG Index)
 {
-    PVOID Result;
-    PBASE_MCB Mcb = (PBASE_MCB)Table->TableContext;
-    Result = ExAllocatePoolWithTag(Mcb->PoolType, Bytes, 'LMCB');
-    DPRINT("McbMappingAllocate(%lu) => %p\n", Bytes, Result);
-    return Result;
+    return (Index == 0) ? 0 : Mcb->Mapping[Index - 1].NextVbn.QuadPart;
 }
 
-static VOID NTAPI McbMappingFree(PRTL_GENERIC_TABLE Table, PVOID Buffer)
+static
+LONGLONG
+McbMappedEndVbn(IN PBASE_MCB_INTERNAL Mcb)
 {
-    DPRINT("McbMappingFree(%p)\n", Buffer);
-    ExFreePoolWithTag(Buffer, 'LMCB');
+    return (Mcb->PairCount == 0) ? 0 : Mcb->Mapping[Mcb->PairCount - 1].NextVbn.QuadPart;
 }
 
+/* Returns the index of the run containing Vbn, or PairCount if Vbn is past the last run */
 static
-RTL_GENERIC_COMPARE_RESULTS
-NTAPI
-McbMappingCompare(PRTL_GENERIC_TABLE Table,
-                  PVOID PtrA,
-                  PVOID PtrB)
+ULONG
+McbFindRun(IN PBASE_MCB_INTERNAL Mcb,
+           IN LONGLONG Vbn)
 {
-    PLARGE_MCB_MAPPING_ENTRY A = PtrA, B = PtrB;
-    RTL_GENERIC_COMPARE_RESULTS Res;
-
-    ASSERT(A);
-    ASSERT(B);
-
-    if (A->RunStartVbn.QuadPart == B->RunStartVbn.QuadPart && A->RunEndVbn.QuadPart == B->RunEndVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunEndVbn.QuadPart <= B->RunStartVbn.QuadPart)
-        Res = GenericLessThan;
-    else if (A->RunEndVbn.QuadPart >= B->RunStartVbn.QuadPart)
-        Res = GenericGreaterThan;
+    ULONG Low = 0, High = Mcb->PairCount;
+
+    while (Low < High)
+    {
+        ULONG Middle = Low + (High - Low) / 2;
+
+        if (Mcb->Mapping[Middle].NextVbn.QuadPart > Vbn)
+            High = Middle;
+        else
+            Low = Middle + 1;
+    }
+
+    return Low;
+}
+
+/* Unmaps everything from Vbn on by trimming the runs in place, never needs memory */
+static
+VOID
+McbTruncate(IN PBASE_MCB_INTERNAL Mcb,
+            IN LONGLONG Vbn)
+{
+    ULONG First;
+
+    if (Vbn >= McbMappedEndVbn(Mcb))
+        return;
+
+    First = McbFindRun(Mcb, Vbn);
+    if (McbRunStartVbn(Mcb, First) < Vbn)
+    {
+        /* Keep the head of the run Vbn falls into */
+        Mcb->Mapping[First].NextVbn.QuadPart = Vbn;
+        Mcb->PairCount = First + 1;
+    }
     else
     {
-        ASSERT(FALSE);
-        Res = GenericEqual;
+        Mcb->PairCount = First;
     }
 
-    return Res;
+    /* Holes are implicit past the last run */
+    while (Mcb->PairCount && Mcb->Mapping[Mcb->PairCount - 1].Lbn.QuadPart == MCB_HOLE_LBN)
+        Mcb->PairCount--;
 }
 
-static RTL_GENERIC_COMPARE_RESULTS NTAPI McbMappingIntersectCompare(PRTL_GENERIC_TABLE Table, PVOID PtrA, PVOID PtrB)
+/* Makes room for at least Count runs, keeping the current ones */
+static
+BOOLEAN
+McbReserveRuns(IN PBASE_MCB_INTERNAL Mcb,
+               IN ULONG Count)
 {
-    PLARGE_MCB_MAPPING_ENTRY A = PtrA, B = PtrB;
-    RTL_GENERIC_COMPARE_RESULTS Res;
-
-    if (A->RunStartVbn.QuadPart <= B->RunStartVbn.QuadPart && A->RunEndVbn.QuadPart > B->RunStartVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunStartVbn.QuadPart >= B->RunStartVbn.QuadPart && B->RunEndVbn.QuadPart > A->RunStartVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunStartVbn.QuadPart < B->RunStartVbn.QuadPart)
-        Res = GenericLessThan;
-    else if (A->RunStartVbn.QuadPart > B->RunStartVbn.QuadPart)
-        Res = GenericGreaterThan;
+    PLARGE_MCB_MAPPING_ENTRY NewMapping;
+    ULONG NewMaximum;
+
+    if (Count <= Mcb->MaximumPairCount)
+        return TRUE;
+
+    NewMaximum = MAX(Mcb->MaximumPairCount, MAXIMUM_PAIR_COUNT);
+    while (NewMaximum < Count)
+    {
+        if (NewMaximum > MAXULONG / 2 / sizeof(LARGE_MCB_MAPPING_ENTRY))
+            return FALSE;
+        NewMaximum *= 2;
+    }
+
+    NewMapping = ExAllocatePoolWithTag(Mcb->PoolType,
+                                       NewMaximum * sizeof(LARGE_MCB_MAPPING_ENTRY),
+                                       'FSBC');
+    if (!NewMapping)
+    {
+        if (Mcb->Flags & MCB_FLAG_RAISE_ON_ALLOCATION_FAILURE)
+            ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+        return FALSE;
+    }
+
+    RtlCopyMemory(NewMapping, Mcb->Mapping, Mcb->PairCount * sizeof(LARGE_MCB_MAPPING_ENTRY));
+
+    /* The initial mapping of paged MCBs comes from the lookaside list */
+    if (Mcb->PoolType == PagedPool && Mcb->MaximumPairCount == MAXIMUM_PAIR_COUNT)
+        ExFreeToPagedLookasideList(&FsRtlFirstMappingLookasideList, Mcb->Mapping);
     else
-        Res = GenericEqual;
+        ExFreePoolWithTag(Mcb->Mapping, 'FSBC');
 
-    return Res;
+    Mcb->Mapping = NewMapping;
+    Mcb->MaximumPairCount = NewMaximum;
+    return TRUE;
+}
+
+/* Whether the run at Index can be folded into the one before it */
+static
+BOOLEAN
+McbCanMergeWithPrevious(IN PBASE_MCB_INTERNAL Mcb,
+                        IN ULONG Index)
+{
+    PLARGE_MCB_MAPPING_ENTRY Previous = &Mcb->Mapping[Index - 1];
+    PLARGE_MCB_MAPPING_ENTRY Run = &Mcb->Mapping[Index];
+
+    if (Previous->Lbn.QuadPart == MCB_HOLE_LBN || Run->Lbn.QuadPart == MCB_HOLE_LBN)
+        return (Previous->Lbn.QuadPart == Run->Lbn.QuadPart);
+
+    return (Previous->Lbn.QuadPart + (Previous->NextVbn.QuadPart - McbRunStartVbn(Mcb, Index - 1)) ==
+            Run->Lbn.QuadPart);
+}
+
+/*
+ * Maps [StartVbn, EndVbn) to Lbn (MCB_HOLE_LBN to unmap it), replacing
+ * whatever was mapped there, then restores the invariants of the array.
+ * Everything is done in place with a single move of the runs that follow.
+ */
+static
+BOOLEAN
+McbSetRange(IN PBASE_MCB_INTERNAL Mcb,
+            IN LONGLONG StartVbn,
+            IN LONGLONG EndVbn,
+            IN LONGLONG Lbn)
+{
+    LARGE_MCB_MAPPING_ENTRY NewRuns[4];
+    ULONG First, Last, OldCount, NewCount = 0, i;
+    LONGLONG MappedEndVbn = McbMappedEndVbn(Mcb);
+
+    if (StartVbn >= MappedEndVbn)
+    {
+        /* Nothing to unmap past the end; otherwise append, after a hole if needed */
+        if (Lbn == MCB_HOLE_LBN)
+            return TRUE;
+
+        First = Mcb->PairCount;
+        OldCount = 0;
+        if (StartVbn > MappedEndVbn)
+        {
+            NewRuns[NewCount].NextVbn.QuadPart = StartVbn;
+            NewRuns[NewCount].Lbn.QuadPart = MCB_HOLE_LBN;
+            NewCount++;
+        }
+        NewRuns[NewCount].NextVbn.QuadPart = EndVbn;
+        NewRuns[NewCount].Lbn.QuadPart = Lbn;
+        NewCount++;
+    }
+    else
+    {
+        First = McbFindRun(Mcb, StartVbn);
+        Last = (EndVbn >= MappedEndVbn) ? Mcb->PairCount - 1 : McbFindRun(Mcb, EndVbn - 1);
+        OldCount = Last - First + 1;
+
+        /* Head of the first run that stays in place */
+        if (McbRunStartVbn(Mcb, First) < StartVbn)
+        {
+            NewRuns[NewCount].NextVbn.QuadPart = StartVbn;
+            NewRuns[NewCount].Lbn = Mcb->Mapping[First].Lbn;
+            NewCount++;
+        }
+
+        NewRuns[NewCount].NextVbn.QuadPart = EndVbn;
+        NewRuns[NewCount].Lbn.QuadPart = Lbn;
+        NewCount++;
+
+        /* Tail of the last run that stays in place */
+        if (Mcb->Mapping[Last].NextVbn.QuadPart > EndVbn)
+        {
+            NewRuns[NewCount].NextVbn = Mcb->Mapping[Last].NextVbn;
+            NewRuns[NewCount].Lbn = Mcb->Mapping[Last].Lbn;
+            if (NewRuns[NewCount].Lbn.QuadPart != MCB_HOLE_LBN)
+                NewRuns[NewCount].Lbn.QuadPart += EndVbn - McbRunStartVbn(Mcb, Last);
+            NewCount++;
+        }
+    }
+
+    if (NewCount > OldCount &&
+        !McbReserveRuns(Mcb, Mcb->PairCount + NewCount - OldCount))
+    {
+        return FALSE;
+    }
+
+    RtlMoveMemory(&Mcb->Mapping[First + NewCount],
+                  &Mcb->Mapping[First + OldCount],
+                  (Mcb->PairCount - First - OldCount) * sizeof(LARGE_MCB_MAPPING_ENTRY));
+    RtlCopyMemory(&Mcb->Mapping[First], NewRuns, NewCount * sizeof(LARGE_MCB_MAPPING_ENTRY));
+    Mcb->PairCount += NewCount - OldCount;
+
+    /* Merge the new runs with each other and with their neighbours */
+    i = MAX(First, 1);
+    Last = MIN(First + NewCount, Mcb->PairCount - 1);
+    while (i <= Last && i < Mcb->PairCount)
+    {
+        if (McbCanMergeWithPrevious(Mcb, i))
+        {
+            Mcb->Mapping[i - 1].NextVbn = Mcb->Mapping[i].NextVbn;
+            RtlMoveMemory(&Mcb->Mapping[i],
+                          &Mcb->Mapping[i + 1],
+                          (Mcb->PairCount - i - 1) * sizeof(LARGE_MCB_MAPPING_ENTRY));
+            Mcb->PairCount--;
+            Last--;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    /* Holes are implicit past the last run */
+    while (Mcb->PairCount && Mcb->Mapping[Mcb->PairCount - 1].Lbn.QuadPart == MCB_HOLE_LBN)
+        Mcb->PairCount--;
+
+    return TRUE;
 }
 
 
@@ -126,7 +286,9 @@ static RTL_GENERIC_COMPARE_RESULTS NTAPI McbMappingIntersectCompare(PRTL_GENERIC
  * Value less or equal to %0 is forbidden; FIXME: Is the reject of %0 W32 compliant?
  *
  * Adds the specified range @Vbn ... @Vbn+@SectorCount-1 to @Mcb.
- * Any mappings previously in this range are deleted first.
+ * Parts of the range that are already mapped must be mapped to the same
+ * Lbns, otherwise nothing is changed and %FALSE is returned.
+ * The new run is merged with the runs around it when their Lbns are contiguous.
  *
  * Returns: %TRUE if successful.
  */
@@ -138,136 +300,43 @@ FsRtlAddBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
                      IN LONGLONG SectorCount)
 {
     BOOLEAN Result = TRUE;
-    BOOLEAN IntResult;
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    LARGE_MCB_MAPPING_ENTRY Node, NeedleRun;
-    PLARGE_MCB_MAPPING_ENTRY LowerRun, HigherRun;
-    BOOLEAN NewElement;
-    LONGLONG IntLbn;
+    LONGLONG EndVbn, RunStartVbn, OverlapVbn;
+    ULONG i;
 
     DPRINT("FsRtlAddBaseMcbEntry(%p, %I64d, %I64d, %I64d)\n", OpaqueMcb, Vbn, Lbn, SectorCount);
 
-    if (Vbn < 0)
+    if (Vbn < 0 || Lbn < 0 || SectorCount <= 0)
     {
         Result = FALSE;
         goto quit;
     }
 
-    if (SectorCount <= 0)
+    EndVbn = Vbn + SectorCount;
+    if (EndVbn <= Vbn)
     {
         Result = FALSE;
         goto quit;
     }
 
-    IntResult = FsRtlLookupBaseMcbEntry(OpaqueMcb, Vbn, &IntLbn, NULL, NULL, NULL, NULL);
-    if (IntResult)
+    /* Overwriting an existing mapping with a different one is not possible */
+    for (i = McbFindRun(Mcb, Vbn); i < Mcb->PairCount; i++)
     {
-        if (IntLbn != -1 && IntLbn != Lbn)
+        RunStartVbn = McbRunStartVbn(Mcb, i);
+        if (RunStartVbn >= EndVbn)
+            break;
+        if (Mcb->Mapping[i].Lbn.QuadPart == MCB_HOLE_LBN)
+            continue;
+
+        OverlapVbn = MAX(RunStartVbn, Vbn);
+        if (Mcb->Mapping[i].Lbn.QuadPart + (OverlapVbn - RunStartVbn) != Lbn + (OverlapVbn - Vbn))
         {
             Result = FALSE;
             goto quit;
         }
     }
 
-    /* clean any possible previous entries in our range */
-    FsRtlRemoveBaseMcbEntry(OpaqueMcb, Vbn, SectorCount);
-
-    // We need to map [Vbn, Vbn+SectorCount) to [Lbn, Lbn+SectorCount),
-    // taking in account the fact that we need to merge these runs if
-    // they are adjacent or overlap, but fail if new run fully fits into another run
-
-    /* initially we think we will be inserted as a separate run */
-    Node.RunStartVbn.QuadPart = Vbn;
-    Node.RunEndVbn.QuadPart = Vbn + SectorCount;
-    Node.StartingLbn.QuadPart = Lbn;
-
-    /* optionally merge with lower run */
-    NeedleRun.RunStartVbn.QuadPart = Node.RunStartVbn.QuadPart - 1;
-    NeedleRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart + 1;
-    NeedleRun.StartingLbn.QuadPart = ~0ULL;
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    if ((LowerRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)) &&
-        (LowerRun->StartingLbn.QuadPart + (LowerRun->RunEndVbn.QuadPart - LowerRun->RunStartVbn.QuadPart) == Node.StartingLbn.QuadPart))
-    {
-        ASSERT(LowerRun->RunEndVbn.QuadPart == Node.RunStartVbn.QuadPart);
-        Node.RunStartVbn.QuadPart = LowerRun->RunStartVbn.QuadPart;
-        Node.StartingLbn.QuadPart = LowerRun->StartingLbn.QuadPart;
-        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, LowerRun);
-        --Mcb->PairCount;
-        DPRINT("Intersecting lower run found (%I64d,%I64d) Lbn: %I64d\n", LowerRun->RunStartVbn.QuadPart, LowerRun->RunEndVbn.QuadPart, LowerRun->StartingLbn.QuadPart);
-    }
-
-    /* optionally merge with higher run */
-    NeedleRun.RunStartVbn.QuadPart = Node.RunEndVbn.QuadPart;
-    NeedleRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart + 1;
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    if ((HigherRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)) &&
-        (Node.StartingLbn.QuadPart <= HigherRun->StartingLbn.QuadPart))
-    {
-        ASSERT(HigherRun->RunStartVbn.QuadPart == Node.RunEndVbn.QuadPart);
-        Node.RunEndVbn.QuadPart = HigherRun->RunEndVbn.QuadPart;
-        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, HigherRun);
-        --Mcb->PairCount;
-        DPRINT("Intersecting higher run found (%I64d,%I64d) Lbn: %I64d\n", HigherRun->RunStartVbn.QuadPart, HigherRun->RunEndVbn.QuadPart, HigherRun->StartingLbn.QuadPart);
-    }
-    Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-
-    /* finally insert the resulting run */
-    RtlInsertElementGenericTable(&Mcb->Mapping->Table, &Node, sizeof(Node), &NewElement);
-    ++Mcb->PairCount;
-    ASSERT(NewElement);
-
-    // NB: Two consecutive runs can only be merged, if actual LBNs also match!
-
-    /* 1.
-            Existing->RunStartVbn
-            |
-            |///////|
-                |/////////////|
-                |
-                Node->RunStartVbn
-
-        2.
-            Existing->RunStartVbn
-            |
-            |///////|
-        |//////|
-        |
-        Node->RunStartVbn
-
-        3.
-            Existing->RunStartVbn
-            |
-            |///////|
-                |///|
-                |
-                Node->RunStartVbn
-
-        4.
-            Existing->RunStartVbn
-            |
-            |///////|
-        |///////////////|
-        |
-        Node->RunStartVbn
-
-
-    Situation with holes:
-    1. Holes at both ends
-    2. Hole at the right, new run merged with the previous run
-    3. Hole at the right, new run is not merged with the previous run
-    4. Hole at the left, new run merged with the next run
-    5. Hole at the left, new run is not merged with the next run
-    6. No holes, exact fit to merge with both previous and next runs
-    7. No holes, merges only with the next run
-    8. No holes, merges only with the previous run
-    9. No holes, does not merge with next or prev runs
-
-
-    Overwriting existing mapping is not possible and results in FALSE being returned
-    */
+    Result = McbSetRange(Mcb, Vbn, EndVbn, Lbn);
 
 quit:
     DPRINT("FsRtlAddBaseMcbEntry(%p, %I64d, %I64d, %I64d) = %d\n", Mcb, Vbn, Lbn, SectorCount, Result);
@@ -316,7 +385,6 @@ FsRtlAddLargeMcbEntry(IN PLARGE_MCB Mcb,
  * Retrieves the parameters of the specified run with index @RunIndex.
  * 
  * Mapping %0 always starts at virtual block %0, either as 'hole' or as 'real' mapping.
- * libcaptive does not store 'hole' information to its #GTree.
  * Last run is always a 'real' run. 'hole' runs appear as mapping to constant @Lbn value %-1.
  *
  * Returns: %TRUE if successful.
@@ -331,46 +399,15 @@ FsRtlGetNextBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
 {
     BOOLEAN Result = FALSE;
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Run = NULL;
-    ULONG CurrentIndex = 0;
-    ULONGLONG LastVbn = 0;
-    ULONGLONG LastSectorCount = 0;
-
-    // Traverse the tree 
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-    Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
-    {
-        // is the current index a hole?
-        if (Run->RunStartVbn.QuadPart > (LastVbn + LastSectorCount))
-        {
-            // Is this the index we're looking for?
-            if (RunIndex == CurrentIndex)
-            {
-                *Vbn = LastVbn + LastSectorCount;
-                *Lbn = -1;
-                *SectorCount = Run->RunStartVbn.QuadPart - *Vbn;
-
-                Result = TRUE;
-                goto quit;
-            }
 
-            CurrentIndex++;
-        }
-
-        if (RunIndex == CurrentIndex)
-        {
-            *Vbn = Run->RunStartVbn.QuadPart;
-            *Lbn = Run->StartingLbn.QuadPart;
-            *SectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
-
-            Result = TRUE;
-            goto quit;
-        }
+    if (RunIndex < Mcb->PairCount)
+    {
+        *Vbn = McbRunStartVbn(Mcb, RunIndex);
+        *Lbn = Mcb->Mapping[RunIndex].Lbn.QuadPart;
+        *SectorCount = Mcb->Mapping[RunIndex].NextVbn.QuadPart - *Vbn;
 
-        CurrentIndex++;
-        LastVbn = Run->RunStartVbn.QuadPart;
-        LastSectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
+        Result = TRUE;
+        goto quit;
     }
 
     // these values are meaningless when returning false (but setting them can be helpful for debugging purposes)
@@ -428,18 +465,14 @@ FsRtlInitializeBaseMcb(IN PBASE_MCB OpaqueMcb,
     else
     {
         Mcb->Mapping = ExAllocatePoolWithTag(PoolType | POOL_RAISE_IF_ALLOCATION_FAILURE,
-                                             sizeof(LARGE_MCB_MAPPING),
+                                             sizeof(LARGE_MCB_MAPPING_ENTRY) * MAXIMUM_PAIR_COUNT,
                                              'FSBC');
     }
 
     Mcb->PoolType = PoolType;
+    Mcb->Flags = MCB_FLAG_RAISE_ON_ALLOCATION_FAILURE;
     Mcb->PairCount = 0;
     Mcb->MaximumPairCount = MAXIMUM_PAIR_COUNT;
-    RtlInitializeGenericTable(&Mcb->Mapping->Table,
-                              McbMappingCompare,
-                              McbMappingAllocate,
-                              McbMappingFree,
-                              Mcb);
 }
 
 /*
@@ -482,7 +515,7 @@ FsRtlInitializeLargeMcbs(VOID)
                                    NULL,
                                    NULL,
                                    POOL_RAISE_IF_ALLOCATION_FAILURE,
-                                   sizeof(LARGE_MCB_MAPPING),
+                                   sizeof(LARGE_MCB_MAPPING_ENTRY) * MAXIMUM_PAIR_COUNT,
                                    IFS_POOL_TAG,
                                    0); /* FIXME: Should be 4 */
 
@@ -510,36 +543,38 @@ FsRtlLookupBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
     OUT PULONG Index OPTIONAL)
 {
     BOOLEAN Result = FALSE;
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    LONGLONG RunStartVbn;
     ULONG i;
-    LONGLONG LastVbn = 0, LastLbn = 0, Count = 0;   // the last values we've found during traversal
 
     DPRINT("FsRtlLookupBaseMcbEntry(%p, %I64d, %p, %p, %p, %p, %p)\n", OpaqueMcb, Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn, Index);
 
-    for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &LastVbn, &LastLbn, &Count); i++)
+    i = (Vbn >= 0) ? McbFindRun(Mcb, Vbn) : Mcb->PairCount;
+    if (i < Mcb->PairCount)
     {
-        // have we reached the target mapping?
-        if (Vbn < LastVbn + Count)
+        Run = &Mcb->Mapping[i];
+        RunStartVbn = McbRunStartVbn(Mcb, i);
+
+        if (Lbn)
         {
-            if (Lbn)
-            {
-                if (LastLbn == -1)
-                    *Lbn = -1;
-                else
-                    *Lbn = LastLbn + (Vbn - LastVbn);
-            }
+            if (Run->Lbn.QuadPart == MCB_HOLE_LBN)
+                *Lbn = -1;
+            else
+                *Lbn = Run->Lbn.QuadPart + (Vbn - RunStartVbn);
+        }
 
-            if (SectorCountFromLbn)
-                *SectorCountFromLbn = LastVbn + Count - Vbn;
-            if (StartingLbn)
-                *StartingLbn = LastLbn;
-            if (SectorCountFromStartingLbn)
-                *SectorCountFromStartingLbn = LastVbn + Count - LastVbn;
-            if (Index)
-                *Index = i;
+        if (SectorCountFromLbn)
+            *SectorCountFromLbn = Run->NextVbn.QuadPart - Vbn;
+        if (StartingLbn)
+            *StartingLbn = Run->Lbn.QuadPart;
+        if (SectorCountFromStartingLbn)
+            *SectorCountFromStartingLbn = Run->NextVbn.QuadPart - RunStartVbn;
+        if (Index)
+            *Index = i;
 
-            Result = TRUE;
-            goto quit;
-        }
+        Result = TRUE;
+        goto quit;
     }
 
     if (Lbn)
@@ -598,47 +633,28 @@ FsRtlLookupLastLargeMcbEntryAndIndex_internal(IN PBASE_MCB_INTERNAL Mcb,
                                               OUT PLONGLONG Lbn,
                                               OUT PULONG Index OPTIONAL)
 {
-    ULONG RunIndex = 0;
-    PLARGE_MCB_MAPPING_ENTRY Run, RunFound = NULL;
-    LONGLONG LastVbn = 0;
+    PLARGE_MCB_MAPPING_ENTRY RunFound;
 
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-        Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
-    {
-        /* Take care when we must emulate missing 'hole' runs. */
-        if (Run->RunStartVbn.QuadPart > LastVbn)
-        {
-            RunIndex++;
-        }
-        LastVbn = Run->RunEndVbn.QuadPart;
-        RunIndex++;
-        RunFound = Run;
-    }
-
-    if (!RunFound)
+    if (Mcb->PairCount == 0)
     {
         return FALSE;
     }
 
+    /* The last run is never a hole */
+    RunFound = &Mcb->Mapping[Mcb->PairCount - 1];
+    ASSERT(RunFound->Lbn.QuadPart != MCB_HOLE_LBN);
+
     if (Vbn)
     {
-        *Vbn = RunFound->RunEndVbn.QuadPart - 1;
+        *Vbn = RunFound->NextVbn.QuadPart - 1;
     }
     if (Lbn)
     {
-        if (1)
-        {
-            *Lbn = RunFound->StartingLbn.QuadPart + (RunFound->RunEndVbn.QuadPart - RunFound->RunStartVbn.QuadPart) - 1;
-        }
-        else
-        {
-            *Lbn = ~0ULL;
-        }
+        *Lbn = RunFound->Lbn.QuadPart + (RunFound->NextVbn.QuadPart - McbRunStartVbn(Mcb, Mcb->PairCount - 1)) - 1;
     }
     if (Index)
     {
-        *Index = RunIndex - 1;
+        *Index = Mcb->PairCount - 1;
     }
 
     return TRUE;
@@ -745,17 +761,12 @@ ULONG
 NTAPI
 FsRtlNumberOfRunsInBaseMcb(IN PBASE_MCB OpaqueMcb)
 {
-    ULONG NumberOfRuns = 0;
-    LONGLONG Vbn, Lbn, Count;
-    int i;
+    ULONG NumberOfRuns;
 
     DPRINT("FsRtlNumberOfRunsInBaseMcb(%p)\n", OpaqueMcb);
 
-    // Count how many Mcb entries there are
-    for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &Vbn, &Lbn, &Count); i++)
-    {
-        NumberOfRuns++;
-    }
+    /* Holes are stored as runs, so this is just the number of entries */
+    NumberOfRuns = OpaqueMcb->PairCount;
 
     DPRINT("FsRtlNumberOfRunsInBaseMcb(%p) = %d\n", OpaqueMcb, NumberOfRuns);
     return NumberOfRuns;
@@ -801,8 +812,6 @@ FsRtlRemoveBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
                         IN LONGLONG SectorCount)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    LARGE_MCB_MAPPING_ENTRY NeedleRun;
-    PLARGE_MCB_MAPPING_ENTRY HaystackRun;
     BOOLEAN Result = TRUE;
 
     DPRINT("FsRtlRemoveBaseMcbEntry(%p, %I64d, %I64d)\n", OpaqueMcb, Vbn, SectorCount);
@@ -819,35 +828,11 @@ FsRtlRemoveBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
         goto quit;
     }
 
-    NeedleRun.RunStartVbn.QuadPart = Vbn;
-    NeedleRun.RunEndVbn.QuadPart = Vbn + SectorCount;
-    NeedleRun.StartingLbn.QuadPart = ~0ULL;
-
-    /* adjust/destroy all intersecting ranges */
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    while ((HaystackRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)))
-    {
-        if (HaystackRun->RunStartVbn.QuadPart < NeedleRun.RunStartVbn.QuadPart)
-        {
-            ASSERT(HaystackRun->RunEndVbn.QuadPart > NeedleRun.RunStartVbn.QuadPart);
-            HaystackRun->RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart;
-        }
-        else if (HaystackRun->RunEndVbn.QuadPart > NeedleRun.RunEndVbn.QuadPart)
-        {
-            ASSERT(HaystackRun->RunStartVbn.QuadPart < NeedleRun.RunEndVbn.QuadPart);
-            HaystackRun->RunStartVbn.QuadPart = NeedleRun.RunEndVbn.QuadPart;
-        }
-        else
-        {
-            //ASSERT(NeedleRun.RunStartVbn.QuadPart >= HaystackRun->RunStartVbn.QuadPart);
-            //ASSERT(NeedleRun.RunEndVbn.QuadPart <= HaystackRun->RunEndVbn.QuadPart);
-            Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-            RtlDeleteElementGenericTable(&Mcb->Mapping->Table, HaystackRun);
-            --Mcb->PairCount;
-            Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-        }
-    }
-    Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
+    /* Removing the tail is a truncation; only a hole in the middle can need memory */
+    if (Vbn + SectorCount >= McbMappedEndVbn(Mcb))
+        McbTruncate(Mcb, Vbn);
+    else
+        Result = McbSetRange(Mcb, Vbn, Vbn + SectorCount, MCB_HOLE_LBN);
 
 quit:
     DPRINT("FsRtlRemoveBaseMcbEntry(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, SectorCount, Result);
@@ -878,18 +863,11 @@ NTAPI
 FsRtlResetBaseMcb(IN PBASE_MCB OpaqueMcb)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Element;
 
     DPRINT("FsRtlResetBaseMcb(%p)\n", OpaqueMcb);
 
-    while (RtlNumberGenericTableElements(&Mcb->Mapping->Table) &&
-           (Element = (PLARGE_MCB_MAPPING_ENTRY)RtlGetElementGenericTable(&Mcb->Mapping->Table, 0)))
-    {
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, Element);
-    }
-
+    /* Keep the mapping array, the MCB will most likely be filled again */
     Mcb->PairCount = 0;
-    Mcb->MaximumPairCount = 0;
 }
 
 /*
@@ -912,7 +890,16 @@ FsRtlResetLargeMcb(IN PLARGE_MCB Mcb,
 }
 
 /*
- * @unimplemented
+ * @implemented
+ * @Mcb: #PLARGE_MCB initialized by FsRtlInitializeLargeMcb().
+ * %NULL value is forbidden.
+ * @Vbn: Virtual block number where to insert the hole.
+ * @Amount: Length of the hole to insert.
+ *
+ * Inserts a hole of @Amount sectors at @Vbn, moving all the mappings
+ * from @Vbn onwards up by @Amount.
+ *
+ * Returns: %TRUE if successful.
  */
 BOOLEAN
 NTAPI
@@ -921,54 +908,91 @@ FsRtlSplitBaseMcb(IN PBASE_MCB OpaqueMcb,
                   IN LONGLONG Amount)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Run, InsertLowerRun = NULL, ExistingRun = NULL;
-    BOOLEAN NewElement;
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    LONGLONG RunStartVbn;
+    ULONG i, Inserted;
+    BOOLEAN Result = TRUE;
 
     DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d)\n", OpaqueMcb, Vbn, Amount);
 
-    /* Traverse the tree */
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-        Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
+    if (Vbn < 0 || Amount <= 0)
     {
-        /* unaffected run? */
-        /* FIXME: performance: effective skip of all 'lower' runs without traversing them */
-        if (Vbn >= Run->RunEndVbn.QuadPart) { DPRINT("Skipping it\n"); continue; }
-
-        /* crossing run to be split?
-        * 'lower_run' is created on the original place; just shortened.
-        * current 'run' is shifted up later
-        */
-        if (Vbn < Run->RunEndVbn.QuadPart)
-        {
-            /* FIXME: shift 'run->Lbn_start' ? */
-            Run->RunStartVbn.QuadPart = Vbn;
-
-            InsertLowerRun = NULL;
-        }
+        Result = FALSE;
+        goto quit;
+    }
 
-        /* Shift the current 'run'.
-        * Ordering is not changed in Generic Tree so I hope I do not need to reinsert it.
-        */
-        Run->RunStartVbn.QuadPart += Amount;
-        ASSERT(Run->RunEndVbn.QuadPart + Amount > Run->RunEndVbn.QuadPart); /* overflow? */
-        Run->RunEndVbn.QuadPart += Amount;
-        /* FIXME: shift 'run->Lbn_start' ? */
+    /* Nothing is mapped from Vbn onwards */
+    i = McbFindRun(Mcb, Vbn);
+    if (i == Mcb->PairCount)
+        goto quit;
 
-        /* continue the traversal */
+    if (McbMappedEndVbn(Mcb) + Amount <= McbMappedEndVbn(Mcb))
+    {
+        Result = FALSE;
+        goto quit;
     }
 
-    if (InsertLowerRun)
+    Run = &Mcb->Mapping[i];
+    RunStartVbn = McbRunStartVbn(Mcb, i);
+
+    if (Run->Lbn.QuadPart == MCB_HOLE_LBN)
     {
-        ExistingRun = RtlInsertElementGenericTable(&Mcb->Mapping->Table, InsertLowerRun, sizeof(*InsertLowerRun), &NewElement);
-        ++Mcb->PairCount;
+        /* Vbn is in a hole, which just grows */
+        Inserted = 0;
+    }
+    else if (RunStartVbn == Vbn)
+    {
+        if (i > 0 && Mcb->Mapping[i - 1].Lbn.QuadPart == MCB_HOLE_LBN)
+        {
+            /* The run follows a hole, which grows */
+            i--;
+            Inserted = 0;
+        }
+        else
+        {
+            /* Insert the hole in front of the run */
+            if (!McbReserveRuns(Mcb, Mcb->PairCount + 1))
+            {
+                Result = FALSE;
+                goto quit;
+            }
+            RtlMoveMemory(&Mcb->Mapping[i + 1],
+                          &Mcb->Mapping[i],
+                          (Mcb->PairCount - i) * sizeof(LARGE_MCB_MAPPING_ENTRY));
+            Mcb->Mapping[i].NextVbn.QuadPart = Vbn;
+            Mcb->Mapping[i].Lbn.QuadPart = MCB_HOLE_LBN;
+            Mcb->PairCount++;
+            Inserted = 0;
+        }
+    }
+    else
+    {
+        /* Cut the run in two around the new hole */
+        if (!McbReserveRuns(Mcb, Mcb->PairCount + 2))
+        {
+            Result = FALSE;
+            goto quit;
+        }
+        RtlMoveMemory(&Mcb->Mapping[i + 2],
+                      &Mcb->Mapping[i],
+                      (Mcb->PairCount - i) * sizeof(LARGE_MCB_MAPPING_ENTRY));
+        Mcb->Mapping[i].NextVbn.QuadPart = Vbn;
+        Mcb->Mapping[i + 1].NextVbn.QuadPart = Vbn;
+        Mcb->Mapping[i + 1].Lbn.QuadPart = MCB_HOLE_LBN;
+        Mcb->Mapping[i + 2].Lbn.QuadPart += Vbn - RunStartVbn;
+        Mcb->PairCount += 2;
+        Inserted = 1;
     }
 
-    ASSERT(ExistingRun == NULL);
-
-    DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, Amount, TRUE);
+    /* Shift the hole end and every run after it */
+    for (i += Inserted; i < Mcb->PairCount; i++)
+    {
+        Mcb->Mapping[i].NextVbn.QuadPart += Amount;
+    }
 
-    return TRUE;
+quit:
+    DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, Amount, Result);
+    return Result;
 }
 
 /*
@@ -996,16 +1020,22 @@ FsRtlSplitLargeMcb(IN PLARGE_MCB Mcb,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
 FsRtlTruncateBaseMcb(IN PBASE_MCB OpaqueMcb,
                      IN LONGLONG Vbn)
 {
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
+
     DPRINT("FsRtlTruncateBaseMcb(%p, %I64d)\n", OpaqueMcb, Vbn);
 
-    FsRtlRemoveBaseMcbEntry(OpaqueMcb, Vbn, MAXLONG - Vbn + 1);
+    if (Vbn < 0)
+        Vbn = 0;
+
+    /* Whatever follows Vbn goes away, the run it falls into is trimmed in place */
+    McbTruncate(Mcb, Vbn);
 }
 
 /*
@@ -1034,7 +1064,8 @@ FsRtlUninitializeBaseMcb(IN PBASE_MCB Mcb)
 
     FsRtlResetBaseMcb(Mcb);
 
-    if ((Mcb->PoolType == PagedPool)/* && (Mcb->MaximumPairCount == MAXIMUM_PAIR_COUNT)*/)
+    /* The mapping only comes from the lookaside list until it first grows */
+    if ((Mcb->PoolType == PagedPool) && (Mcb->MaximumPairCount == MAXIMUM_PAIR_COUNT))
     {
         ExFreeToPagedLookasideList(&FsRtlFirstMappingLookasideList,
                                    Mcb->Mapping);
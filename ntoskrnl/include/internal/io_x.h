@@ -129,6 +129,20 @@ IopUpdateTransferCount(IN IOP_TRANSFER_TYPE Type, IN ULONG TransferCount)
     }
 }
 
+static
+__inline
+BOOLEAN
+IopSkipCompletionPort(IN PFILE_OBJECT FileObject,
+                      IN NTSTATUS Status)
+{
+    /*
+     * The caller asked not to get a completion packet for requests that
+     * succeed right away, since it already handles them inline
+     */
+    return ((FileObject->Flags & FO_SKIP_COMPLETION_PORT) &&
+            NT_SUCCESS(Status));
+}
+
 static
 __inline
 BOOLEAN
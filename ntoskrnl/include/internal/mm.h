@@ -37,6 +37,12 @@ extern SIZE_T MmPagedPoolCommit;
 extern SIZE_T MmPeakCommitment;
 extern SIZE_T MmtotalCommitLimitMaximum;
 
+extern ULONG MmCodeClusterSize;
+extern ULONG MmDataClusterSize;
+extern ULONG MmSectionReadIoCount;
+extern ULONG MmSectionReadPageCount;
+extern ULONG MmSectionPrefetchHitCount;
+
 extern PVOID MiDebugMapping; // internal
 extern PMMPTE MmDebugPte; // internal
 
@@ -93,6 +99,10 @@ typedef ULONG_PTR SWAPENTRY;
 #define MC_SYSTEM                           (2)
 #define MC_MAXIMUM                          (3)
 
+#define MM_LOWEST_PAGE_PRIORITY             (0)
+#define MM_DEFAULT_PAGE_PRIORITY            (5)
+#define MM_HIGHEST_PAGE_PRIORITY            (7)
+
 #define PAGED_POOL_MASK                     1
 #define MUST_SUCCEED_POOL_MASK              2
 #define CACHE_ALIGNED_POOL_MASK             4
@@ -206,6 +216,7 @@ typedef struct _ROS_SECTION_OBJECT
 typedef struct _MEMORY_AREA
 {
     MMVAD VadNode;
+    ULONG_PTR LargestGap;
 
     ULONG Type;
     ULONG Protect;
@@ -616,7 +627,8 @@ NTSTATUS
 NTAPI
 MmReadFromSwapPage(
     SWAPENTRY SwapEntry,
-    PFN_NUMBER Page
+    PFN_NUMBER Page,
+    PMMSUPPORT AddressSpace
 );
 
 NTSTATUS
@@ -630,6 +642,17 @@ VOID
 NTAPI
 MmShowOutOfSpaceMessagePagingFile(VOID);
 
+VOID
+NTAPI
+MmInsertStandbySwapPage(
+    SWAPENTRY SwapEntry,
+    PFN_NUMBER Page
+);
+
+ULONG
+NTAPI
+MmTrimStandbySwapPages(ULONG Target);
+
 NTSTATUS
 NTAPI
 MiReadPageFile(
@@ -809,6 +832,37 @@ VOID
 NTAPI
 MmRebalanceMemoryConsumers(VOID);
 
+NTSTATUS
+NTAPI
+MmQueryWorkingSetAging(
+    IN PEPROCESS Process,
+    OUT PPROCESS_WS_AGING_INFORMATION AgingInfo
+);
+
+VOID
+NTAPI
+MmNoteHardFault(
+    PMMSUPPORT AddressSpace
+);
+
+VOID
+NTAPI
+MmDeleteHardFaultCount(
+    PEPROCESS Process
+);
+
+VOID
+NTAPI
+MmMarkPrefetchedPage(
+    PFN_NUMBER Page
+);
+
+VOID
+NTAPI
+MmNotePageUsed(
+    PFN_NUMBER Page
+);
+
 /* rmap.c **************************************************************/
 
 VOID
@@ -862,6 +916,17 @@ BOOLEAN
 NTAPI
 MmIsDirtyPageRmap(PFN_NUMBER Page);
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedRmaps(PFN_NUMBER Page);
+
+ULONG
+NTAPI
+MmGetRmapCountForProcess(
+    PFN_NUMBER Page,
+    struct _EPROCESS *Process
+);
+
 NTSTATUS
 NTAPI
 MmPageOutPhysicalAddress(PFN_NUMBER Page);
@@ -1096,6 +1161,13 @@ MmSetCleanPage(
     PVOID Address
 );
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(
+    struct _EPROCESS *Process,
+    PVOID Address
+);
+
 VOID
 NTAPI
 MmDeletePageTable(
@@ -1390,6 +1462,14 @@ ExReturnPoolQuota(
     IN PVOID P);
 
 
+/* pfnlist.c ***************************************************************/
+
+VOID
+NTAPI
+MmQueryMemoryListInformation(
+    OUT PSYSTEM_MEMORY_LIST_INFORMATION MemoryListInfo);
+
+
 /* mmsup.c *****************************************************************/
 
 NTSTATUS
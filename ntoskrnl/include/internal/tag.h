@@ -132,6 +132,12 @@
 /* formerly located in mm/rmap.c */
 #define TAG_RMAP    'PAMR'
 
+/* mm/pagefile.c */
+#define TAG_MM_STANDBY   'BSMM'
+
+/* mm/balance.c */
+#define TAG_MM_HARDFAULT 'FHMM'
+
 /* formerly located in mm/ARM3/section.c */
 #define TAG_MM      '  mM'
 
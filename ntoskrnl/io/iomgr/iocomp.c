@@ -15,6 +15,9 @@
 
 POBJECT_TYPE IoCompletionType;
 
+/* Most packets NtRemoveIoCompletionEx hands out per call */
+#define IOP_MAX_COMPLETION_BATCH 64
+
 GENERAL_LOOKASIDE IoCompletionPacketLookaside;
 
 GENERIC_MAPPING IopCompletionMapping =
@@ -137,6 +140,48 @@ IopDeleteIoCompletion(PVOID ObjectBody)
     }
 }
 
+static
+VOID
+IopRetrieveCompletionPacket(IN PLIST_ENTRY ListEntry,
+                            OUT PFILE_IO_COMPLETION_INFORMATION CompletionInfo)
+{
+    PIOP_MINI_COMPLETION_PACKET Packet;
+    PIRP Irp;
+
+    /* Get the Packet Data */
+    Packet = CONTAINING_RECORD(ListEntry,
+                               IOP_MINI_COMPLETION_PACKET,
+                               ListEntry);
+
+    /* Check if this is piggybacked on an IRP */
+    if (Packet->PacketType == IopCompletionPacketIrp)
+    {
+        /* Get the IRP */
+        Irp = CONTAINING_RECORD(ListEntry,
+                                IRP,
+                                Tail.Overlay.ListEntry);
+
+        /* Save values */
+        CompletionInfo->KeyContext = Irp->Tail.CompletionKey;
+        CompletionInfo->ApcContext = Irp->Overlay.AsynchronousParameters.UserApcContext;
+        CompletionInfo->IoStatusBlock = Irp->IoStatus;
+
+        /* Free the IRP */
+        IoFreeIrp(Irp);
+    }
+    else
+    {
+        /* Save values */
+        CompletionInfo->KeyContext = Packet->KeyContext;
+        CompletionInfo->ApcContext = Packet->ApcContext;
+        CompletionInfo->IoStatusBlock.Status = Packet->IoStatus;
+        CompletionInfo->IoStatusBlock.Information = Packet->IoStatusInformation;
+
+        /* Free the packet */
+        IopFreeMiniPacket(Packet);
+    }
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -449,13 +494,10 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
 {
     LARGE_INTEGER SafeTimeout;
     PKQUEUE Queue;
-    PIOP_MINI_COMPLETION_PACKET Packet;
     PLIST_ENTRY ListEntry;
     KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
     NTSTATUS Status;
-    PIRP Irp;
-    PVOID Apc, Key;
-    IO_STATUS_BLOCK IoStatus;
+    FILE_IO_COMPLETION_INFORMATION CompletionInfo;
     PAGED_CODE();
 
     /* Check if the call was from user mode */
@@ -506,46 +548,123 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
         }
         else
         {
-            /* Get the Packet Data */
-            Packet = CONTAINING_RECORD(ListEntry,
-                                       IOP_MINI_COMPLETION_PACKET,
-                                       ListEntry);
+            /* Get the packet data and free it */
+            IopRetrieveCompletionPacket(ListEntry, &CompletionInfo);
 
-            /* Check if this is piggybacked on an IRP */
-            if (Packet->PacketType == IopCompletionPacketIrp)
+            /* Enter SEH to write back the values */
+            _SEH2_TRY
             {
-                /* Get the IRP */
-                Irp = CONTAINING_RECORD(ListEntry,
-                                        IRP,
-                                        Tail.Overlay.ListEntry);
-
-                /* Save values */
-                Key = Irp->Tail.CompletionKey;
-                Apc = Irp->Overlay.AsynchronousParameters.UserApcContext;
-                IoStatus = Irp->IoStatus;
-
-                /* Free the IRP */
-                IoFreeIrp(Irp);
+                /* Write the values to caller */
+                *ApcContext = CompletionInfo.ApcContext;
+                *KeyContext = CompletionInfo.KeyContext;
+                *IoStatusBlock = CompletionInfo.IoStatusBlock;
             }
-            else
+            _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
-                /* Save values */
-                Key = Packet->KeyContext;
-                Apc = Packet->ApcContext;
-                IoStatus.Status = Packet->IoStatus;
-                IoStatus.Information = Packet->IoStatusInformation;
+                /* Get the exception code */
+                Status = _SEH2_GetExceptionCode();
+            }
+            _SEH2_END;
+        }
 
-                /* Free the packet */
-                IopFreeMiniPacket(Packet);
+        /* Dereference the Object */
+        ObDereferenceObject(Queue);
+    }
+
+    /* Return status */
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+NtRemoveIoCompletionEx(IN HANDLE IoCompletionHandle,
+                       OUT PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+                       IN ULONG Count,
+                       OUT PULONG NumEntriesRemoved,
+                       IN PLARGE_INTEGER Timeout OPTIONAL,
+                       IN BOOLEAN Alertable)
+{
+    LARGE_INTEGER SafeTimeout;
+    PKQUEUE Queue;
+    PLIST_ENTRY EntryArray[IOP_MAX_COMPLETION_BATCH];
+    KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    NTSTATUS Status;
+    FILE_IO_COMPLETION_INFORMATION CompletionInfo;
+    ULONG Removed = 0, i;
+    PAGED_CODE();
+
+    /* We need room for at least one packet */
+    if (!Count) return STATUS_INVALID_PARAMETER;
+
+    /* Don't hand out more than we can hold on the stack */
+    if (Count > IOP_MAX_COMPLETION_BATCH) Count = IOP_MAX_COMPLETION_BATCH;
+
+    /* Check if the call was from user mode */
+    if (PreviousMode != KernelMode)
+    {
+        /* Protect probes in SEH */
+        _SEH2_TRY
+        {
+            /* Probe the output array and count */
+            ProbeForWrite(IoCompletionInformation,
+                          Count * sizeof(FILE_IO_COMPLETION_INFORMATION),
+                          sizeof(PVOID));
+            ProbeForWriteUlong(NumEntriesRemoved);
+            if (Timeout)
+            {
+                /* Probe and capture the timeout */
+                SafeTimeout = ProbeForReadLargeInteger(Timeout);
+                Timeout = &SafeTimeout;
             }
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Return the exception code */
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* Open the Object */
+    Status = ObReferenceObjectByHandle(IoCompletionHandle,
+                                       IO_COMPLETION_MODIFY_STATE,
+                                       IoCompletionType,
+                                       PreviousMode,
+                                       (PVOID*)&Queue,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Wait for the first packet and take whatever else is already queued */
+    Removed = KeRemoveQueueEx(Queue,
+                              PreviousMode,
+                              Alertable,
+                              Timeout,
+                              EntryArray,
+                              Count);
+
+    /* If we got a timeout, an alert or user_apc back, return the status */
+    if (((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_TIMEOUT) ||
+        ((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_USER_APC) ||
+        ((NTSTATUS)(ULONG_PTR)EntryArray[0] == STATUS_ALERTED))
+    {
+        /* Set this as the status */
+        Status = (NTSTATUS)(ULONG_PTR)EntryArray[0];
+        Removed = 0;
+    }
+    else
+    {
+        for (i = 0; i < Removed; i++)
+        {
+            /* Get the packet data and free it */
+            IopRetrieveCompletionPacket(EntryArray[i], &CompletionInfo);
+
+            /* Once the caller's buffer faulted, only free the rest */
+            if (!NT_SUCCESS(Status)) continue;
 
             /* Enter SEH to write back the values */
             _SEH2_TRY
             {
-                /* Write the values to caller */
-                *ApcContext = Apc;
-                *KeyContext = Key;
-                *IoStatusBlock = IoStatus;
+                IoCompletionInformation[i] = CompletionInfo;
             }
             _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
@@ -554,10 +673,22 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
             }
             _SEH2_END;
         }
+    }
 
-        /* Dereference the Object */
-        ObDereferenceObject(Queue);
+    /* Dereference the Object */
+    ObDereferenceObject(Queue);
+
+    /* Tell the caller how many packets we removed */
+    _SEH2_TRY
+    {
+        *NumEntriesRemoved = Removed;
+    }
+    _SEH2_EXCEPT(ExSystemExceptionFilter())
+    {
+        /* Get the exception code */
+        Status = _SEH2_GetExceptionCode();
     }
+    _SEH2_END;
 
     /* Return status */
     return Status;
@@ -138,108 +138,54 @@ KiInsertQueue(IN PKQUEUE Queue,
     return InitialState;
 }
 
-/* PUBLIC FUNCTIONS **********************************************************/
-
 /*
- * @implemented
- */
-VOID
-NTAPI
-KeInitializeQueue(IN PKQUEUE Queue,
-                  IN ULONG Count OPTIONAL)
-{
-    /* Initialize the Header */
-    Queue->Header.Type = QueueObject;
-    Queue->Header.Abandoned = 0;
-    Queue->Header.Size = sizeof(KQUEUE) / sizeof(ULONG);
-    Queue->Header.SignalState = 0;
-    InitializeListHead(&(Queue->Header.WaitListHead));
-
-    /* Initialize the Lists */
-    InitializeListHead(&Queue->EntryListHead);
-    InitializeListHead(&Queue->ThreadListHead);
-
-    /* Set the Current and Maximum Count */
-    Queue->CurrentCount = 0;
-    Queue->MaximumCount = (Count == 0) ? (ULONG) KeNumberProcessors : Count;
-}
-
-/*
- * @implemented
+ * Takes up to Count entries that are already queued. The caller holds the
+ * dispatcher lock and is already an active thread of the queue, so this
+ * doesn't change the concurrency count.
  */
-LONG
-NTAPI
-KeInsertHeadQueue(IN PKQUEUE Queue,
-                  IN PLIST_ENTRY Entry)
+static
+ULONG
+KiRemoveQueuedEntries(IN PKQUEUE Queue,
+                      OUT PLIST_ENTRY *EntryArray,
+                      IN ULONG Count)
 {
-    LONG PreviousState;
-    KIRQL OldIrql;
-    ASSERT_QUEUE(Queue);
-    ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
-
-    /* Lock the Dispatcher Database */
-    OldIrql = KiAcquireDispatcherLock();
-
-    /* Insert the Queue */
-    PreviousState = KiInsertQueue(Queue, Entry, TRUE);
-
-    /* Release the Dispatcher Lock */
-    KiReleaseDispatcherLock(OldIrql);
-
-    /* Return previous State */
-    return PreviousState;
-}
-
-/*
- * @implemented
- */
-LONG
-NTAPI
-KeInsertQueue(IN PKQUEUE Queue,
-              IN PLIST_ENTRY Entry)
-{
-    LONG PreviousState;
-    KIRQL OldIrql;
-    ASSERT_QUEUE(Queue);
-    ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
-
-    /* Lock the Dispatcher Database */
-    OldIrql = KiAcquireDispatcherLock();
+    PLIST_ENTRY QueueEntry;
+    ULONG Removed;
 
-    /* Insert the Queue */
-    PreviousState = KiInsertQueue(Queue, Entry, FALSE);
+    for (Removed = 0; Removed < Count; Removed++)
+    {
+        QueueEntry = Queue->EntryListHead.Flink;
+        if (QueueEntry == &Queue->EntryListHead) break;
 
-    /* Release the Dispatcher Lock */
-    KiReleaseDispatcherLock(OldIrql);
+        /* Remove the Entry */
+        Queue->Header.SignalState--;
+        RemoveEntryList(QueueEntry);
+        QueueEntry->Flink = NULL;
+        EntryArray[Removed] = QueueEntry;
+    }
 
-    /* Return previous State */
-    return PreviousState;
+    return Removed;
 }
 
 /*
- * @implemented
- *
- * Returns number of entries in the queue
+ * Waits for one entry, then takes up to Count - 1 more if they are already
+ * queued. Returns the number of entries written to EntryArray; a failed wait
+ * writes its status as the only entry. Waiters are woken up from the tail of
+ * the wait list, so the thread that blocked last runs first and its stack is
+ * still hot.
  */
-LONG
-NTAPI
-KeReadStateQueue(IN PKQUEUE Queue)
-{
-    /* Returns the Signal State */
-    ASSERT_QUEUE(Queue);
-    return Queue->Header.SignalState;
-}
-
-/*
- * @implemented
- */
-PLIST_ENTRY
-NTAPI
-KeRemoveQueue(IN PKQUEUE Queue,
+static
+ULONG
+KiRemoveQueue(IN PKQUEUE Queue,
               IN KPROCESSOR_MODE WaitMode,
-              IN PLARGE_INTEGER Timeout OPTIONAL)
+              IN BOOLEAN Alertable,
+              IN PLARGE_INTEGER Timeout OPTIONAL,
+              OUT PLIST_ENTRY *EntryArray,
+              IN ULONG Count)
 {
     PLIST_ENTRY QueueEntry;
+    ULONG Removed = 1;
+    KIRQL OldIrql;
     LONG_PTR Status;
     PKTHREAD Thread = KeGetCurrentThread();
     PKQUEUE PreviousQueue;
@@ -328,6 +274,9 @@ KeRemoveQueue(IN PKQUEUE Queue,
             RemoveEntryList(QueueEntry);
             QueueEntry->Flink = NULL;
 
+            /* Take whatever else is queued while we hold the lock */
+            Removed += KiRemoveQueuedEntries(Queue, &EntryArray[1], Count - 1);
+
             /* Nothing to wait on */
             break;
         }
@@ -344,12 +293,12 @@ KeRemoveQueue(IN PKQUEUE Queue,
             }
             else
             {
-                /* Fail if there's a User APC Pending */
-                if ((WaitMode != KernelMode) &&
-                    (Thread->ApcState.UserApcPending))
+                /* Fail if we were alerted or there's a User APC Pending */
+                Status = KiCheckAlertability(Thread, Alertable, WaitMode);
+                if (Status != STATUS_WAIT_0)
                 {
                     /* Return the status and increase the pending threads */
-                    QueueEntry = (PLIST_ENTRY)STATUS_USER_APC;
+                    QueueEntry = (PLIST_ENTRY)Status;
                     Queue->CurrentCount++;
                     break;
                 }
@@ -404,7 +353,22 @@ KeRemoveQueue(IN PKQUEUE Queue,
                 Thread->WaitReason = 0;
 
                 /* Check if we were executing an APC */
-                if (Status != STATUS_KERNEL_APC) return (PLIST_ENTRY)Status;
+                if (Status != STATUS_KERNEL_APC)
+                {
+                    /* Either a failed wait, or an entry was handed to us */
+                    EntryArray[0] = (PLIST_ENTRY)Status;
+                    if ((Count > 1) &&
+                        (Status != STATUS_TIMEOUT) &&
+                        (Status != STATUS_USER_APC) &&
+                        (Status != STATUS_ALERTED))
+                    {
+                        /* The lock was dropped to sleep, take it again for the rest */
+                        OldIrql = KiAcquireDispatcherLock();
+                        Removed += KiRemoveQueuedEntries(Queue, &EntryArray[1], Count - 1);
+                        KiReleaseDispatcherLock(OldIrql);
+                    }
+                    return Removed;
+                }
 
                 /* Check if we had a timeout */
                 if (Timeout)
@@ -427,9 +391,141 @@ KeRemoveQueue(IN PKQUEUE Queue,
     /* Unlock Database and return */
     KiReleaseDispatcherLockFromDpcLevel();
     KiExitDispatcher(Thread->WaitIrql);
+    EntryArray[0] = QueueEntry;
+    return Removed;
+}
+
+/* PUBLIC FUNCTIONS **********************************************************/
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+KeInitializeQueue(IN PKQUEUE Queue,
+                  IN ULONG Count OPTIONAL)
+{
+    /* Initialize the Header */
+    Queue->Header.Type = QueueObject;
+    Queue->Header.Abandoned = 0;
+    Queue->Header.Size = sizeof(KQUEUE) / sizeof(ULONG);
+    Queue->Header.SignalState = 0;
+    InitializeListHead(&(Queue->Header.WaitListHead));
+
+    /* Initialize the Lists */
+    InitializeListHead(&Queue->EntryListHead);
+    InitializeListHead(&Queue->ThreadListHead);
+
+    /* Set the Current and Maximum Count */
+    Queue->CurrentCount = 0;
+    Queue->MaximumCount = (Count == 0) ? (ULONG) KeNumberProcessors : Count;
+}
+
+/*
+ * @implemented
+ */
+LONG
+NTAPI
+KeInsertHeadQueue(IN PKQUEUE Queue,
+                  IN PLIST_ENTRY Entry)
+{
+    LONG PreviousState;
+    KIRQL OldIrql;
+    ASSERT_QUEUE(Queue);
+    ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
+
+    /* Lock the Dispatcher Database */
+    OldIrql = KiAcquireDispatcherLock();
+
+    /* Insert the Queue */
+    PreviousState = KiInsertQueue(Queue, Entry, TRUE);
+
+    /* Release the Dispatcher Lock */
+    KiReleaseDispatcherLock(OldIrql);
+
+    /* Return previous State */
+    return PreviousState;
+}
+
+/*
+ * @implemented
+ */
+LONG
+NTAPI
+KeInsertQueue(IN PKQUEUE Queue,
+              IN PLIST_ENTRY Entry)
+{
+    LONG PreviousState;
+    KIRQL OldIrql;
+    ASSERT_QUEUE(Queue);
+    ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
+
+    /* Lock the Dispatcher Database */
+    OldIrql = KiAcquireDispatcherLock();
+
+    /* Insert the Queue */
+    PreviousState = KiInsertQueue(Queue, Entry, FALSE);
+
+    /* Release the Dispatcher Lock */
+    KiReleaseDispatcherLock(OldIrql);
+
+    /* Return previous State */
+    return PreviousState;
+}
+
+/*
+ * @implemented
+ *
+ * Returns number of entries in the queue
+ */
+LONG
+NTAPI
+KeReadStateQueue(IN PKQUEUE Queue)
+{
+    /* Returns the Signal State */
+    ASSERT_QUEUE(Queue);
+    return Queue->Header.SignalState;
+}
+
+/*
+ * @implemented
+ */
+PLIST_ENTRY
+NTAPI
+KeRemoveQueue(IN PKQUEUE Queue,
+              IN KPROCESSOR_MODE WaitMode,
+              IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    PLIST_ENTRY QueueEntry;
+
+    /* Wait for a single entry, non-alertably */
+    KiRemoveQueue(Queue, WaitMode, FALSE, Timeout, &QueueEntry, 1);
     return QueueEntry;
 }
 
+/*
+ * @implemented
+ *
+ * Returns the number of entries written to EntryArray. Only the first one is
+ * waited for, the rest are taken only if they are already queued. If the wait
+ * fails, its status is returned as the only entry.
+ */
+ULONG
+NTAPI
+KeRemoveQueueEx(IN PKQUEUE Queue,
+                IN KPROCESSOR_MODE WaitMode,
+                IN BOOLEAN Alertable,
+                IN PLARGE_INTEGER Timeout OPTIONAL,
+                OUT PLIST_ENTRY *EntryArray,
+                IN ULONG Count)
+{
+    ASSERT_QUEUE(Queue);
+    ASSERT(Count != 0);
+
+    /* The entries already queued are taken along with the first one */
+    return KiRemoveQueue(Queue, WaitMode, Alertable, Timeout, EntryArray, Count);
+}
+
 /*
  * @implemented
  */
@@ -6,6 +6,15 @@
  * PROGRAMMERS:     ReactOS Portable Systems Group
  */
 
+/*
+ * Large pages are only implemented for non-PAE x86 (4MB PDEs). They back
+ * MEM_LARGE_PAGES user allocations and the drivers named in the
+ * LargePageDrivers registry value. The kernel, the HAL, the boot drivers
+ * and nonpaged pool stay on small pages: they are mapped before CR4.PSE is
+ * enabled, and the pool and MDL free paths resolve their pages through PTEs.
+ * PAE and x64 (2MB PDEs) report large pages as unsupported.
+ */
+
 /* INCLUDES *******************************************************************/
 
 #include <ntoskrnl.h>
@@ -22,7 +31,7 @@ PMMPTE MiLargePageHyperPte;
 ULONG MiLargePageRangeIndex;
 MI_LARGE_PAGE_RANGES MiLargePageRanges[64];
 WCHAR MmLargePageDriverBuffer[512] = {0};
-ULONG MmLargePageDriverBufferLength = -1;
+ULONG MmLargePageDriverBufferLength = sizeof(MmLargePageDriverBuffer);
 LIST_ENTRY MiLargePageDriverList;
 BOOLEAN MiLargePageAllDrivers;
 
@@ -54,11 +63,21 @@ INIT_FUNCTION
 MiSyncCachedRanges(VOID)
 {
     ULONG i;
+    PFN_NUMBER PageFrameIndex;
+    PMMPFN Pfn1;
 
     /* Scan every range */
     for (i = 0; i < MiLargePageRangeIndex; i++)
     {
-        UNIMPLEMENTED_DBGBREAK("No support for large pages\n");
+        /* These frames are mapped cached by a large page, so the PFN database must agree */
+        for (PageFrameIndex = MiLargePageRanges[i].StartFrame;
+             PageFrameIndex <= MiLargePageRanges[i].LastFrame;
+             PageFrameIndex++)
+        {
+            /* Skip holes that aren't RAM */
+            Pfn1 = MiGetPfnEntry(PageFrameIndex);
+            if (Pfn1) Pfn1->u3.e1.CacheAttribute = MiCached;
+        }
     }
 }
 
@@ -68,6 +87,7 @@ INIT_FUNCTION
 MiInitializeDriverLargePageList(VOID)
 {
     PWCHAR p, pp;
+    PMI_LARGE_PAGE_DRIVER_ENTRY Entry;
 
     /* Initialize the list */
     InitializeListHead(&MiLargePageDriverList);
@@ -88,6 +108,14 @@ MiInitializeDriverLargePageList(VOID)
             continue;
         }
 
+        /* Skip the terminators of a multi-string value too */
+        if (*p == UNICODE_NULL)
+        {
+            /* Skip the character */
+            p++;
+            continue;
+        }
+
         /* A star means everything */
         if (*p == L'*')
         {
@@ -96,9 +124,330 @@ MiInitializeDriverLargePageList(VOID)
             break;
         }
 
-        DPRINT1("Large page drivers not supported\n");
-        ASSERT(FALSE);
+        /* Allocate an entry for this driver */
+        Entry = ExAllocatePoolWithTag(NonPagedPool,
+                                      sizeof(MI_LARGE_PAGE_DRIVER_ENTRY),
+                                      'pLmM');
+        if (!Entry) break;
+
+        /* The name lives in the registry buffer, find where it ends */
+        Entry->BaseName.Buffer = p;
+        while ((p < pp) &&
+               (*p != L' ') && (*p != L'\n') && (*p != L'\r') && (*p != L'\t') &&
+               (*p != UNICODE_NULL))
+        {
+            /* Keep going */
+            p++;
+        }
+
+        /* Set up the name and link the entry in */
+        Entry->BaseName.Length = (USHORT)((ULONG_PTR)p - (ULONG_PTR)Entry->BaseName.Buffer);
+        Entry->BaseName.MaximumLength = Entry->BaseName.Length;
+        InsertTailList(&MiLargePageDriverList, &Entry->Links);
+        DPRINT("Large page driver: %wZ\n", &Entry->BaseName);
+    }
+}
+
+BOOLEAN
+NTAPI
+MiIsLargePageSupported(VOID)
+{
+#if defined(_M_IX86) && (_MI_PAGING_LEVELS == 2)
+    /* The CPU must have large pages, and the kernel must have turned them on */
+    if (!(KeFeatureBits & KF_LARGE_PAGE)) return FALSE;
+    if (!(__readcr4() & CR4_PSE)) return FALSE;
+    return TRUE;
+#else
+    /* Large page mappings are only implemented for non-PAE x86 */
+    return FALSE;
+#endif
+}
+
+PFN_NUMBER
+NTAPI
+MiAllocateLargePage(IN BOOLEAN ZeroPage)
+{
+    PFN_NUMBER PageFrameIndex, i;
+    PMMPFN Pfn1;
+    ASSERT(KeGetCurrentIrql() <= APC_LEVEL);
+
+    /* Don't let a large page eat into the pages the system needs to make progress */
+    if (MmAvailablePages < (MmMinimumFreePages + MI_LARGE_PAGE_PAGES)) return 0;
+
+    /* Find a free, naturally aligned run of physical pages */
+    PageFrameIndex = MiFindContiguousPages(0,
+                                           MmHighestPhysicalPage,
+                                           MI_LARGE_PAGE_PAGES,
+                                           MI_LARGE_PAGE_PAGES,
+                                           MmCached);
+    if (!PageFrameIndex) return 0;
+    ASSERT((PageFrameIndex & (MI_LARGE_PAGE_PAGES - 1)) == 0);
+
+    /* The allocation markers only matter to MmFreeContiguousMemory */
+    Pfn1 = MI_PFN_ELEMENT(PageFrameIndex);
+    Pfn1->u3.e1.StartOfAllocation = 0;
+    Pfn1[MI_LARGE_PAGE_PAGES - 1].u3.e1.EndOfAllocation = 0;
+
+    /* Large pages are always mapped cached */
+    for (i = 0; i < MI_LARGE_PAGE_PAGES; i++)
+    {
+        Pfn1[i].u3.e1.CacheAttribute = MiCached;
+        if (ZeroPage) MiZeroPhysicalPage(PageFrameIndex + i);
     }
+
+    /* Return the first page */
+    return PageFrameIndex;
+}
+
+VOID
+NTAPI
+MiFreeLargePage(IN PFN_NUMBER PageFrameIndex)
+{
+    PMMPFN Pfn1;
+    PFN_NUMBER i;
+    KIRQL OldIrql;
+    ASSERT((PageFrameIndex & (MI_LARGE_PAGE_PAGES - 1)) == 0);
+
+    /* Delete every page, locked MDLs will let go of theirs later */
+    Pfn1 = MI_PFN_ELEMENT(PageFrameIndex);
+    OldIrql = KeAcquireQueuedSpinLock(LockQueuePfnLock);
+    for (i = 0; i < MI_LARGE_PAGE_PAGES; i++, Pfn1++)
+    {
+        MI_SET_PFN_DELETED(Pfn1);
+        MiDecrementShareCount(Pfn1, PageFrameIndex + i);
+    }
+    KeReleaseQueuedSpinLock(LockQueuePfnLock, OldIrql);
+}
+
+PPFN_NUMBER
+NTAPI
+MiAllocateLargePages(IN PEPROCESS Process,
+                     IN PFN_NUMBER LargePageCount)
+{
+    PPFN_NUMBER LargePages;
+    PFN_NUMBER i;
+    NTSTATUS Status;
+
+    /* Large pages are never paged out, charge the process for all of them up front */
+    Status = PsChargeProcessPageFileQuota(Process, LargePageCount * MI_LARGE_PAGE_PAGES);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Quota exceeded for %lu large pages\n", LargePageCount);
+        return NULL;
+    }
+
+    /* Allocate the array that tracks the first page of each large page */
+    LargePages = ExAllocatePoolWithTag(PagedPool,
+                                       LargePageCount * sizeof(PFN_NUMBER),
+                                       'pLmM');
+    if (!LargePages)
+    {
+        PsReturnProcessPageFileQuota(Process, LargePageCount * MI_LARGE_PAGE_PAGES);
+        return NULL;
+    }
+
+    /* Grab zeroed large pages */
+    for (i = 0; i < LargePageCount; i++)
+    {
+        LargePages[i] = MiAllocateLargePage(TRUE);
+        if (!LargePages[i])
+        {
+            /* Physical memory is too fragmented, give back what we got */
+            DPRINT1("Only found %lu out of %lu large pages\n", i, LargePageCount);
+            MiFreeLargePages(NULL, LargePages, i);
+            PsReturnProcessPageFileQuota(Process, LargePageCount * MI_LARGE_PAGE_PAGES);
+            return NULL;
+        }
+    }
+
+    /* All done */
+    return LargePages;
+}
+
+VOID
+NTAPI
+MiFreeLargePages(IN PEPROCESS Process OPTIONAL,
+                 IN PPFN_NUMBER LargePages,
+                 IN PFN_NUMBER LargePageCount)
+{
+    PFN_NUMBER i;
+
+    /* Free the pages, then the array */
+    for (i = 0; i < LargePageCount; i++) MiFreeLargePage(LargePages[i]);
+    ExFreePoolWithTag(LargePages, 'pLmM');
+
+    /* Give back the quota MiAllocateLargePages charged */
+    if (Process) PsReturnProcessPageFileQuota(Process, LargePageCount * MI_LARGE_PAGE_PAGES);
+}
+
+NTSTATUS
+NTAPI
+MiMapLargePages(IN PEPROCESS Process,
+                IN ULONG_PTR StartingAddress,
+                IN PMMVAD Vad,
+                IN PPFN_NUMBER LargePages)
+{
+#if defined(_M_IX86) && (_MI_PAGING_LEVELS == 2)
+    PMMPDE PointerPde, LastPde;
+    MMPDE TempPde;
+    PETHREAD Thread = PsGetCurrentThread();
+    ULONG i;
+    ASSERT(Process == PsGetCurrentProcess());
+
+    /* The VAD was inserted unlocked, so make sure it is still around */
+    MmLockAddressSpace(&Process->Vm);
+    if ((Process->VmDeleted) ||
+        (MiLocateAddress((PVOID)StartingAddress) != Vad))
+    {
+        /* Somebody freed it, or the process is going away */
+        MmUnlockAddressSpace(&Process->Vm);
+        DPRINT1("Large page VAD at 0x%p went away\n", StartingAddress);
+        return STATUS_MEMORY_NOT_ALLOCATED;
+    }
+    ASSERT(Vad->u.VadFlags.VadType == VadLargePages);
+
+    /* Get the PDE range covered by the VAD */
+    PointerPde = MiAddressToPde(StartingAddress);
+    LastPde = MiAddressToPde(Vad->EndingVpn << PAGE_SHIFT);
+
+    /* Write a large PDE for each large page */
+    MiLockProcessWorkingSetUnsafe(Process, Thread);
+    for (i = 0; PointerPde <= LastPde; i++, PointerPde++)
+    {
+        /* Faults in large page VADs are refused, so there can't be a page table */
+        ASSERT(PointerPde->u.Long == 0);
+
+        /* Build and write the PDE */
+        MI_MAKE_HARDWARE_PTE_USER(&TempPde,
+                                  MiPdeToPte(PointerPde),
+                                  Vad->u.VadFlags.Protection,
+                                  LargePages[i]);
+        TempPde.u.Hard.LargePage = 1;
+        MI_WRITE_VALID_PDE(PointerPde, TempPde);
+    }
+    MiUnlockProcessWorkingSetUnsafe(Process, Thread);
+
+    /* The whole VAD is committed, charge it like NtAllocateVirtualMemory does */
+    Vad->u.VadFlags.CommitCharge = i * MI_LARGE_PAGE_PAGES;
+    Process->CommitCharge += i * MI_LARGE_PAGE_PAGES;
+    if (Process->CommitCharge > Process->CommitChargePeak)
+    {
+        Process->CommitChargePeak = Process->CommitCharge;
+    }
+
+    /* Release the address space */
+    MmUnlockAddressSpace(&Process->Vm);
+    return STATUS_SUCCESS;
+#else
+    UNREFERENCED_PARAMETER(Process);
+    UNREFERENCED_PARAMETER(StartingAddress);
+    UNREFERENCED_PARAMETER(Vad);
+    UNREFERENCED_PARAMETER(LargePages);
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
+VOID
+NTAPI
+MiDeleteLargePageRange(IN ULONG_PTR StartingAddress,
+                       IN ULONG_PTR EndingAddress,
+                       IN PEPROCESS Process)
+{
+#if defined(_M_IX86) && (_MI_PAGING_LEVELS == 2)
+    PMMPDE PointerPde, LastPde;
+    PFN_NUMBER PageFrameIndex;
+
+    /* The caller holds the working set lock of the current process */
+    ASSERT(Process == PsGetCurrentProcess());
+    ASSERT((StartingAddress & (MI_LARGE_PAGE_SIZE - 1)) == 0);
+
+    /* Loop the PDEs */
+    PointerPde = MiAddressToPde(StartingAddress);
+    LastPde = MiAddressToPde(EndingAddress);
+    while (PointerPde <= LastPde)
+    {
+        /* The range might never have been mapped if the allocation raced with us */
+        if (PointerPde->u.Long)
+        {
+            ASSERT(MI_IS_PAGE_LARGE(PointerPde));
+            PageFrameIndex = PFN_FROM_PTE(PointerPde);
+
+            /* Unmap the large page and make sure no processor still uses it */
+            MI_ERASE_PTE(PointerPde);
+            KeFlushProcessTb();
+
+            /* Now the pages can go, along with their commit and quota charge */
+            MiFreeLargePage(PageFrameIndex);
+            Process->CommitCharge -= MI_LARGE_PAGE_PAGES;
+            PsReturnProcessPageFileQuota(Process, MI_LARGE_PAGE_PAGES);
+        }
+
+        /* Move on */
+        PointerPde++;
+    }
+#else
+    UNREFERENCED_PARAMETER(StartingAddress);
+    UNREFERENCED_PARAMETER(EndingAddress);
+    UNREFERENCED_PARAMETER(Process);
+    ASSERT(FALSE);
+#endif
+}
+
+VOID
+NTAPI
+MiWriteSystemLargePde(IN PMMPDE PointerPde,
+                      IN MMPDE TempPde)
+{
+#if defined(_M_IX86) && (_MI_PAGING_LEVELS == 2)
+    PLIST_ENTRY NextEntry;
+    PEPROCESS Process;
+    PMMPDE PageDirectory;
+    MMPTE TempPte;
+    ULONG Index;
+    KIRQL OldIrql;
+    ASSERT(MI_IS_PAGE_LARGE(&TempPde));
+
+    /* Get the index of the PDE in the page directory */
+    Index = ((ULONG_PTR)PointerPde & (SYSTEM_PD_SIZE - 1)) / sizeof(MMPTE);
+    ASSERT(Index >= MiGetPdeOffset(MmSystemRangeStart));
+
+    /* Processes can't come or go while we hold the expansion lock */
+    OldIrql = MiAcquireExpansionLock();
+
+    /* Update the double-mapped system page directory */
+    MmSystemPagePtes[Index] = TempPde;
+
+    /* The PDE it replaces is valid, so nothing syncs it lazily. Do every process */
+    for (NextEntry = MmProcessList.Flink;
+         NextEntry != &MmProcessList;
+         NextEntry = NextEntry->Flink)
+    {
+        /* Map this process' page directory */
+        Process = CONTAINING_RECORD(NextEntry, EPROCESS, MmProcessLinks);
+        MI_MAKE_HARDWARE_PTE_KERNEL(&TempPte,
+                                    MiLargePageHyperPte,
+                                    MM_READWRITE,
+                                    Process->Pcb.DirectoryTableBase[0] >> PAGE_SHIFT);
+        MI_WRITE_VALID_PTE(MiLargePageHyperPte, TempPte);
+        PageDirectory = MiPteToAddress(MiLargePageHyperPte);
+        KeInvalidateTlbEntry(PageDirectory);
+
+        /* Write the PDE and unmap the page directory */
+        PageDirectory[Index] = TempPde;
+        MI_ERASE_PTE(MiLargePageHyperPte);
+    }
+
+    /* The current page directory might belong to a process that is not in the list */
+    *PointerPde = TempPde;
+    MiReleaseExpansionLock(OldIrql);
+
+    /* Get rid of any cached translation through the old page table */
+    KeFlushEntireTb(TRUE, TRUE);
+#else
+    UNREFERENCED_PARAMETER(PointerPde);
+    UNREFERENCED_PARAMETER(TempPde);
+    ASSERT(FALSE);
+#endif
 }
 
 /* EOF */
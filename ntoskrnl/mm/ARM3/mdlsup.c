@@ -72,7 +72,7 @@ MiMapLockedPagesInUserSpace(
     }
 
     /* Allocate a VAD for our mapped region */
-    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MMVAD_LONG), 'ldaV');
+    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MI_VAD), 'ldaV');
     if (Vad == NULL)
     {
         Status = STATUS_INSUFFICIENT_RESOURCES;
@@ -80,7 +80,7 @@ MiMapLockedPagesInUserSpace(
     }
 
     /* Initialize PhysicalMemory VAD */
-    RtlZeroMemory(Vad, sizeof(*Vad));
+    RtlZeroMemory(Vad, sizeof(MI_VAD));
     Vad->u2.VadFlags2.LongVad = 1;
     Vad->u.VadFlags.VadType = VadDevicePhysicalMemory;
     Vad->u.VadFlags.Protection = MM_READWRITE;
@@ -400,7 +400,6 @@ MmBuildMdlForNonPagedPool(IN PMDL Mdl)
     PPFN_NUMBER MdlPages, EndPage;
     PFN_NUMBER Pfn, PageCount;
     PVOID Base;
-    PMMPTE PointerPte;
 
     //
     // Sanity checks
@@ -432,16 +431,23 @@ MmBuildMdlForNonPagedPool(IN PMDL Mdl)
     EndPage = MdlPages + PageCount;
 
     //
-    // Loop the PTEs
+    // Loop the pages
     //
-    PointerPte = MiAddressToPte(Base);
     do
     {
         //
-        // Write the PFN
+        // Write the PFN, data of a driver loaded in large pages has no PTE
         //
-        Pfn = PFN_FROM_PTE(PointerPte++);
+        if (MI_IS_PHYSICAL_ADDRESS(Base))
+        {
+            Pfn = MI_GET_LARGE_PAGE_FRAME(MiAddressToPde(Base), Base);
+        }
+        else
+        {
+            Pfn = PFN_FROM_PTE(MiAddressToPte(Base));
+        }
         *MdlPages++ = Pfn;
+        Base = (PVOID)((ULONG_PTR)Base + PAGE_SIZE);
     } while (MdlPages < EndPage);
 
     //
@@ -1170,7 +1176,7 @@ MmProbeAndLockPages(IN PMDL Mdl,
                (PointerPpe->u.Hard.Valid == 0) ||
 #endif
                (PointerPde->u.Hard.Valid == 0) ||
-               (PointerPte->u.Hard.Valid == 0))
+               (!MI_IS_PAGE_LARGE(PointerPde) && (PointerPte->u.Hard.Valid == 0)))
         {
             //
             // What kind of lock were we using?
@@ -1221,10 +1227,24 @@ MmProbeAndLockPages(IN PMDL Mdl,
             }
         }
 
+        //
+        // Large pages have no PTE, only their PDE says if they can be written
+        //
+        if ((Operation != IoReadAccess) &&
+            (MI_IS_PAGE_LARGE(PointerPde)) &&
+            !(PointerPde->u.Long & PTE_READWRITE))
+        {
+            //
+            // Fail, since we won't allow this
+            //
+            Status = STATUS_ACCESS_VIOLATION;
+            goto CleanupWithLock;
+        }
+
         //
         // Check if this was a write or modify
         //
-        if (Operation != IoReadAccess)
+        if ((Operation != IoReadAccess) && !MI_IS_PAGE_LARGE(PointerPde))
         {
             //
             // Check if the PTE is not writable
@@ -1307,7 +1327,14 @@ MmProbeAndLockPages(IN PMDL Mdl,
         //
         // Grab the PFN
         //
-        PageFrameIndex = PFN_FROM_PTE(PointerPte);
+        if (MI_IS_PAGE_LARGE(PointerPde))
+        {
+            PageFrameIndex = MI_GET_LARGE_PAGE_FRAME(PointerPde, MiPteToAddress(PointerPte));
+        }
+        else
+        {
+            PageFrameIndex = PFN_FROM_PTE(PointerPte);
+        }
         Pfn1 = MiGetPfnEntry(PageFrameIndex);
         if (Pfn1)
         {
@@ -19,6 +19,10 @@
 /* Area mapped by a PDE */
 #define PDE_MAPPED_VA  (PTE_COUNT * PAGE_SIZE)
 
+/* Area and pages mapped by a large page PDE */
+#define MI_LARGE_PAGE_SIZE   PDE_MAPPED_VA
+#define MI_LARGE_PAGE_PAGES  (MI_LARGE_PAGE_SIZE >> PAGE_SHIFT)
+
 /* Size of a page table */
 #define PT_SIZE  (PTE_COUNT * sizeof(MMPTE))
 
@@ -416,6 +420,17 @@ typedef struct _MI_LARGE_PAGE_RANGES
     PFN_NUMBER LastFrame;
 } MI_LARGE_PAGE_RANGES, *PMI_LARGE_PAGE_RANGES;
 
+//
+// ARM3 allocates its VADs with room for private data after them. LargestGap is
+// the largest free range, in VPNs, between two consecutive nodes of the subtree
+// rooted at the VAD. Memory areas keep their own copy in the MEMORY_AREA.
+//
+typedef struct _MI_VAD
+{
+    MMVAD_LONG Vad;
+    ULONG_PTR LargestGap;
+} MI_VAD, *PMI_VAD;
+
 typedef struct _MMVIEW
 {
     ULONG_PTR Entry;
@@ -580,6 +595,7 @@ extern ULONG MmMaximumNonPagedPoolPercent;
 extern ULONG MmLargeStackSize;
 extern PMMCOLOR_TABLES MmFreePagesByColor[FreePageList + 1];
 extern MMPFNLIST MmStandbyPageListByPriority[8];
+extern SIZE_T MmStandbyRepurposedByPriority[8];
 extern ULONG MmProductType;
 extern MM_SYSTEMSIZE MmSystemSize;
 extern PKEVENT MiLowMemoryEvent;
@@ -636,6 +652,26 @@ extern LIST_ENTRY MmWorkingSetExpansionHead;
 extern KSPIN_LOCK MmExpansionLock;
 extern PETHREAD MiExpansionLockOwner;
 
+//
+// New pages take the page priority of the process they are brought in for,
+// which decides the standby list they land on once they are unused
+//
+FORCEINLINE
+ULONG
+MiGetPagePriority(VOID)
+{
+    return PsGetCurrentProcess()->Vm.Flags.PagePriority;
+}
+
+FORCEINLINE
+PULONG_PTR
+MiAddressNodeLargestGap(IN PMMADDRESS_NODE Node)
+{
+    /* Only valid for the nodes of process and memory area trees */
+    if (((PMMVAD)Node)->u.VadFlags.Spare) return &((PMEMORY_AREA)Node)->LargestGap;
+    return &CONTAINING_RECORD(Node, MI_VAD, Vad)->LargestGap;
+}
+
 FORCEINLINE
 BOOLEAN
 MiIsMemoryTypeFree(TYPE_OF_MEMORY MemoryType)
@@ -906,6 +942,18 @@ MI_IS_PHYSICAL_ADDRESS(IN PVOID Address)
     return ((PointerPde->u.Hard.LargePage) && (PointerPde->u.Hard.Valid));
 }
 
+//
+// Returns the page frame that backs an address mapped by a large page PDE
+//
+FORCEINLINE
+PFN_NUMBER
+MI_GET_LARGE_PAGE_FRAME(IN PMMPDE PointerPde,
+                        IN PVOID Address)
+{
+    ASSERT(MI_IS_PAGE_LARGE(PointerPde));
+    return PointerPde->u.Hard.PageFrameNumber + MiAddressToPteOffset(Address);
+}
+
 //
 // Writes a valid PTE
 //
@@ -1925,7 +1973,8 @@ NTAPI
 MiInitializePfnForOtherProcess(
     IN PFN_NUMBER PageFrameIndex,
     IN PVOID PteAddress,
-    IN PFN_NUMBER PteFrame
+    IN PFN_NUMBER PteFrame,
+    IN ULONG Priority
 );
 
 VOID
@@ -1998,6 +2047,63 @@ MiSyncCachedRanges(
     VOID
 );
 
+BOOLEAN
+NTAPI
+MiIsLargePageSupported(
+    VOID
+);
+
+PFN_NUMBER
+NTAPI
+MiAllocateLargePage(
+    IN BOOLEAN ZeroPage
+);
+
+VOID
+NTAPI
+MiFreeLargePage(
+    IN PFN_NUMBER PageFrameIndex
+);
+
+PPFN_NUMBER
+NTAPI
+MiAllocateLargePages(
+    IN PEPROCESS Process,
+    IN PFN_NUMBER LargePageCount
+);
+
+VOID
+NTAPI
+MiFreeLargePages(
+    IN PEPROCESS Process OPTIONAL,
+    IN PPFN_NUMBER LargePages,
+    IN PFN_NUMBER LargePageCount
+);
+
+NTSTATUS
+NTAPI
+MiMapLargePages(
+    IN PEPROCESS Process,
+    IN ULONG_PTR StartingAddress,
+    IN PMMVAD Vad,
+    IN PPFN_NUMBER LargePages
+);
+
+VOID
+NTAPI
+MiDeleteLargePageRange(
+    IN ULONG_PTR StartingAddress,
+    IN ULONG_PTR EndingAddress,
+    IN PEPROCESS Process
+);
+
+VOID
+NTAPI
+MiWriteSystemLargePde(
+    IN PMMPDE PointerPde,
+    IN MMPDE TempPde
+);
+
 BOOLEAN
 NTAPI
 MiIsPfnInUse(
@@ -2113,6 +2219,13 @@ MiRemoveNode(
     IN PMM_AVL_TABLE Table
 );
 
+VOID
+NTAPI
+MiUpdateNodeGaps(
+    IN PMMADDRESS_NODE Node,
+    IN PMM_AVL_TABLE Table
+);
+
 PMMADDRESS_NODE
 NTAPI
 MiGetPreviousNode(
@@ -34,9 +34,11 @@
 #define RtlpRebalanceAvlTreeNode MiRebalanceAvlTreeNode
 #define RtlpInsertAvlTreeNode MiInsertAvlTreeNode
 #define RtlpDeleteAvlTreeNode MiDeleteAvlTreeNode
+#define RtlpPropagateAvlTreeNode MiPropagateAvlTreeNode
 
 /* These are implementation specific */
 #define RtlpCopyAvlNodeData MiCopyAvlNodeData
+#define RtlpUpdateAvlTreeNode MiUpdateAvlTreeNode
 #define RtlpAvlCompareRoutine MiAvlCompareRoutine
 #define RtlSetParent MiSetParent
 #define RtlSetBalance MiSetBalance
@@ -49,6 +51,40 @@
 #define RtlInsertAsLeftChildAvl MiInsertAsLeftChildAvl
 #define RtlInsertAsRightChildAvl MiInsertAsRightChildAvl
 
+FORCEINLINE
+VOID
+MiUpdateAvlTreeNode(IN PRTL_AVL_TABLE Table,
+                    IN PRTL_BALANCED_LINKS Node)
+{
+    PRTL_BALANCED_LINKS Neighbour;
+    ULONG_PTR LargestGap = 0;
+
+    /* Based sections are not searched that way, and they have no room for it */
+    if (Table == &MmSectionBasedRoot) return;
+
+    /* Take the gaps inside the left subtree and between it and this node */
+    if (Node->LeftChild)
+    {
+        Neighbour = Node->LeftChild;
+        while (Neighbour->RightChild) Neighbour = Neighbour->RightChild;
+        ASSERT(Neighbour->EndingVpn < Node->StartingVpn);
+        LargestGap = max(*MiAddressNodeLargestGap(Node->LeftChild),
+                         Node->StartingVpn - Neighbour->EndingVpn - 1);
+    }
+
+    /* And the same on the right side */
+    if (Node->RightChild)
+    {
+        Neighbour = Node->RightChild;
+        while (Neighbour->LeftChild) Neighbour = Neighbour->LeftChild;
+        ASSERT(Neighbour->StartingVpn > Node->EndingVpn);
+        LargestGap = max(LargestGap, *MiAddressNodeLargestGap(Node->RightChild));
+        LargestGap = max(LargestGap, Neighbour->StartingVpn - Node->EndingVpn - 1);
+    }
+
+    *MiAddressNodeLargestGap(Node) = LargestGap;
+}
+
 FORCEINLINE
 VOID
 MiCopyAvlNodeData(IN PRTL_BALANCED_LINKS Node1,
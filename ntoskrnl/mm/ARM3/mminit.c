@@ -1876,7 +1876,8 @@ MiBuildPagedPool(VOID)
     /* Initialize the PFN entry for it */
     MiInitializePfnForOtherProcess(PageFrameIndex,
                                    (PMMPTE)PointerPde,
-                                   PFN_FROM_PTE(MiAddressToPpe(MmPagedPoolStart)));
+                                   PFN_FROM_PTE(MiAddressToPpe(MmPagedPoolStart)),
+                                   MM_DEFAULT_PAGE_PRIORITY);
 #else
     /* Do it this way */
 //    Bla = MmSystemPageDirectory[(PointerPde - (PMMPTE)PDE_BASE) / PDE_COUNT]
@@ -1884,7 +1885,8 @@ MiBuildPagedPool(VOID)
     /* Initialize the PFN entry for it */
     MiInitializePfnForOtherProcess(PageFrameIndex,
                                    (PMMPTE)PointerPde,
-                                   MmSystemPageDirectory[(PointerPde - (PMMPDE)PDE_BASE) / PDE_COUNT]);
+                                   MmSystemPageDirectory[(PointerPde - (PMMPDE)PDE_BASE) / PDE_COUNT],
+                                   MM_DEFAULT_PAGE_PRIORITY);
 #endif
 
     //
@@ -249,6 +249,13 @@ MiCheckVirtualAddress(IN PVOID VirtualAddress,
             /* ReactOS does not handle AWE VADs yet */
             ASSERT(Vad->u.VadFlags.VadType != VadAwe);
 
+            /* Large page VADs are mapped when created, never on demand */
+            if (Vad->u.VadFlags.VadType == VadLargePages)
+            {
+                *ProtectCode = MM_NOACCESS;
+                return NULL;
+            }
+
             /* This must be a TEB/PEB VAD */
             if (Vad->u.VadFlags.MemCommit)
             {
@@ -1680,7 +1687,7 @@ MmArmAccessFault(IN BOOLEAN StoreInstruction,
             (PointerPpe->u.Hard.Valid == 0) ||
 #endif
             (PointerPde->u.Hard.Valid == 0) ||
-            (PointerPte->u.Hard.Valid == 0))
+            (!MI_IS_PAGE_LARGE(PointerPde) && (PointerPte->u.Hard.Valid == 0)))
         {
             /* This fault is not valid, print out some debugging help */
             DbgPrint("MM:***PAGE FAULT AT IRQL > 1  Va %p, IRQL %lx\n",
@@ -1708,8 +1715,14 @@ MmArmAccessFault(IN BOOLEAN StoreInstruction,
             return STATUS_IN_PAGE_ERROR | 0x10000000;
         }
 
+        /* Large pages are always resident, the fault must have been spurious */
+        if (MI_IS_PAGE_LARGE(PointerPde))
+        {
+            DPRINT1("Fault at IRQL %u on a large page is ok (%p)\n", OldIrql, Address);
+            return STATUS_SUCCESS;
+        }
+
         /* Not yet implemented in ReactOS */
-        ASSERT(MI_IS_PAGE_LARGE(PointerPde) == FALSE);
         ASSERT(((StoreInstruction) && MI_IS_PAGE_COPY_ON_WRITE(PointerPte)) == FALSE);
 
         /* Check if this was a write */
@@ -1769,6 +1782,9 @@ MmArmAccessFault(IN BOOLEAN StoreInstruction,
         /* Not handling session faults yet */
         IsSessionAddress = MI_IS_SESSION_ADDRESS(Address);
 
+        /* Large pages (drivers loaded with them) are always resident and writable */
+        if (MI_IS_PAGE_LARGE(PointerPde)) return STATUS_SUCCESS;
+
         /* The PDE is valid, so read the PTE */
         TempPte = *PointerPte;
         if (TempPte.u.Hard.Valid == 1)
@@ -2126,10 +2142,22 @@ UserFault:
         ASSERT(KeAreAllApcsDisabled() == TRUE);
         ASSERT(PointerPde->u.Hard.Valid == 1);
     }
-    else
+    else if (MI_IS_PAGE_LARGE(PointerPde))
     {
-        /* Not yet implemented in ReactOS */
-        ASSERT(MI_IS_PAGE_LARGE(PointerPde) == FALSE);
+        /* Large pages are always resident, so only a write to a read-only one can fault */
+        if ((StoreInstruction) && !(PointerPde->u.Long & PTE_READWRITE))
+        {
+            Status = STATUS_ACCESS_VIOLATION;
+        }
+        else
+        {
+            /* Somebody else's TB flush raced with us */
+            Status = STATUS_SUCCESS;
+        }
+
+        /* Release the working set and get out */
+        MiUnlockProcessWorkingSet(CurrentProcess, CurrentThread);
+        return Status;
     }
 
     /* Now capture the PTE. */
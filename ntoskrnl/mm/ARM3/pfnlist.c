@@ -42,6 +42,7 @@ MMPFNLIST MmZeroedPageListHead = {0, ZeroedPageList, LIST_HEAD, LIST_HEAD};
 MMPFNLIST MmFreePageListHead = {0, FreePageList, LIST_HEAD, LIST_HEAD};
 MMPFNLIST MmStandbyPageListHead = {0, StandbyPageList, LIST_HEAD, LIST_HEAD};
 MMPFNLIST MmStandbyPageListByPriority[8];
+SIZE_T MmStandbyRepurposedByPriority[8];
 MMPFNLIST MmModifiedPageListHead = {0, ModifiedPageList, LIST_HEAD, LIST_HEAD};
 MMPFNLIST MmModifiedPageListByColor[1] = {{0, ModifiedPageList, LIST_HEAD, LIST_HEAD}};
 MMPFNLIST MmModifiedNoWritePageListHead = {0, ModifiedNoWritePageList, LIST_HEAD, LIST_HEAD};
@@ -470,6 +471,59 @@ MiRemovePageByColor(IN PFN_NUMBER PageIndex,
     return PageIndex;
 }
 
+static
+BOOLEAN
+MiRepurposeStandbyPage(VOID)
+{
+    PFN_NUMBER PageFrameIndex;
+    PMMPFN Pfn1;
+    MMPTE OriginalPte;
+    ULONG Priority;
+
+    /* Lowest priority first, and the oldest page of that list */
+    for (Priority = 0; Priority < 8; Priority++)
+    {
+        PageFrameIndex = MmStandbyPageListByPriority[Priority].Blink;
+        if (PageFrameIndex != LIST_HEAD) break;
+    }
+    if (Priority == 8) return FALSE;
+
+    Pfn1 = MI_PFN_ELEMENT(PageFrameIndex);
+    ASSERT(Pfn1->u3.e1.PageLocation == StandbyPageList);
+    ASSERT(Pfn1->u3.e1.Modified == 0);
+
+    /* Unlinking wipes the original PTE, so grab it first */
+    OriginalPte = Pfn1->OriginalPte;
+    MiUnlinkPageFromList(Pfn1);
+
+    /* The prototype PTE stops pointing at this page */
+    ASSERT(MiAddressToPte(Pfn1->PteAddress)->u.Hard.Valid == 1);
+    ASSERT(Pfn1->PteAddress->u.Soft.Transition == 1);
+    MI_WRITE_INVALID_PTE(Pfn1->PteAddress, OriginalPte);
+
+    /* Drop the reference it held on the page that holds the prototype PTE */
+    MiDecrementShareCount(MI_PFN_ELEMENT(Pfn1->u4.PteFrame), Pfn1->u4.PteFrame);
+
+    MmStandbyRepurposedByPriority[Priority]++;
+
+    /* Hand it over to the free list like any other dead page */
+    Pfn1->u3.e1.PageLocation = ActiveAndValid;
+    MI_SET_PFN_DELETED(Pfn1);
+    MiInsertPageInFreeList(PageFrameIndex);
+    return TRUE;
+}
+
+static
+VOID
+MiRepurposeStandbyPages(VOID)
+{
+    /* Standby pages count as available, so they must be reusable once the free ones are gone */
+    while ((MmFreePageListHead.Total == 0) && (MmZeroedPageListHead.Total == 0))
+    {
+        if (!MiRepurposeStandbyPage()) break;
+    }
+}
+
 PFN_NUMBER
 NTAPI
 MiRemoveAnyPage(IN ULONG Color)
@@ -482,6 +536,9 @@ MiRemoveAnyPage(IN ULONG Color)
     ASSERT(MmAvailablePages != 0);
     ASSERT(Color < MmSecondaryColors);
 
+    /* Fall back to the standby lists if needed */
+    MiRepurposeStandbyPages();
+
     /* Check the colored free list */
     PageIndex = MmFreePagesByColor[FreePageList][Color].Flink;
     if (PageIndex == LIST_HEAD)
@@ -503,7 +560,7 @@ MiRemoveAnyPage(IN ULONG Color)
                 ASSERT(PageIndex != LIST_HEAD);
                 if (PageIndex == LIST_HEAD)
                 {
-                    /* FIXME: Should check the standby list */
+                    /* The standby lists were already drained above */
                     ASSERT(MmZeroedPageListHead.Total == 0);
                 }
             }
@@ -539,6 +596,9 @@ MiRemoveZeroPage(IN ULONG Color)
     ASSERT(MmAvailablePages != 0);
     ASSERT(Color < MmSecondaryColors);
 
+    /* Fall back to the standby lists if needed */
+    MiRepurposeStandbyPages();
+
     /* Check the colored zero list */
     PageIndex = MmFreePagesByColor[ZeroedPageList][Color].Flink;
     if (PageIndex == LIST_HEAD)
@@ -563,7 +623,7 @@ MiRemoveZeroPage(IN ULONG Color)
                 ASSERT(PageIndex != LIST_HEAD);
                 if (PageIndex == LIST_HEAD)
                 {
-                    /* FIXME: Should check the standby list */
+                    /* The standby lists were already drained above */
                     ASSERT(MmZeroedPageListHead.Total == 0);
                 }
             }
@@ -1003,6 +1063,7 @@ MiInitializePfn(IN PFN_NUMBER PageFrameIndex,
     Pfn1->u3.e1.PageLocation = ActiveAndValid;
     ASSERT(Pfn1->u3.e1.Rom == 0);
     Pfn1->u3.e1.Modified = Modified;
+    Pfn1->u4.Priority = MiGetPagePriority();
 
     /* Get the page table for the PTE */
     PointerPtePte = MiAddressToPte(PointerPte);
@@ -1057,6 +1118,7 @@ MiInitializePfnAndMakePteValid(IN PFN_NUMBER PageFrameIndex,
     Pfn1->u3.e1.PageLocation = ActiveAndValid;
     ASSERT(Pfn1->u3.e1.Rom == 0);
     Pfn1->u3.e1.Modified = 1;
+    Pfn1->u4.Priority = MiGetPagePriority();
 
     /* Get the page table for the PTE */
     PointerPtePte = MiAddressToPte(PointerPte);
@@ -1120,7 +1182,8 @@ MiInitializeAndChargePfn(OUT PPFN_NUMBER PageFrameIndex,
     /* Initialize the PFN */
     MiInitializePfnForOtherProcess(*PageFrameIndex,
                                    PointerPde,
-                                   ContainingPageFrame);
+                                   ContainingPageFrame,
+                                   MM_DEFAULT_PAGE_PRIORITY);
     ASSERT(MI_PFN_ELEMENT(*PageFrameIndex)->u1.WsIndex == 0);
 
     /* Release the lock and return success */
@@ -1279,7 +1342,8 @@ VOID
 NTAPI
 MiInitializePfnForOtherProcess(IN PFN_NUMBER PageFrameIndex,
                                IN PVOID PteAddress,
-                               IN PFN_NUMBER PteFrame)
+                               IN PFN_NUMBER PteFrame,
+                               IN ULONG Priority)
 {
     PMMPFN Pfn1;
 
@@ -1297,6 +1361,7 @@ MiInitializePfnForOtherProcess(IN PFN_NUMBER PageFrameIndex,
     Pfn1->u3.e1.PageLocation = ActiveAndValid;
     Pfn1->u3.e1.Modified = TRUE;
     Pfn1->u4.InPageError = FALSE;
+    Pfn1->u4.Priority = Priority;
 
     /* Did we get a PFN for the page table */
     if (PteFrame)
@@ -1310,4 +1375,29 @@ MiInitializePfnForOtherProcess(IN PFN_NUMBER PageFrameIndex,
     }
 }
 
+VOID
+NTAPI
+MmQueryMemoryListInformation(OUT PSYSTEM_MEMORY_LIST_INFORMATION MemoryListInfo)
+{
+    KIRQL OldIrql;
+    ULONG i;
+
+    /* Take a consistent snapshot of the list counters */
+    OldIrql = KeAcquireQueuedSpinLock(LockQueuePfnLock);
+
+    MemoryListInfo->ZeroPageCount = MmZeroedPageListHead.Total;
+    MemoryListInfo->FreePageCount = MmFreePageListHead.Total;
+    MemoryListInfo->ModifiedPageCount = MmModifiedPageListHead.Total;
+    MemoryListInfo->ModifiedNoWritePageCount = MmModifiedNoWritePageListHead.Total;
+    MemoryListInfo->BadPageCount = MmBadPageListHead.Total;
+    for (i = 0; i < 8; i++)
+    {
+        MemoryListInfo->PageCountByPriority[i] = MmStandbyPageListByPriority[i].Total;
+        MemoryListInfo->RepurposedPagesByPriority[i] = MmStandbyRepurposedByPriority[i];
+    }
+    MemoryListInfo->ModifiedPageCountPageFile = MmTotalPagesForPagingFile;
+
+    KeReleaseQueuedSpinLock(LockQueuePfnLock, OldIrql);
+}
+
 /* EOF */
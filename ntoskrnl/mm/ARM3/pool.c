@@ -561,7 +561,8 @@ MiAllocatePoolPages(IN POOL_TYPE PoolType,
                 /* Initialize the PFN */
                 MiInitializePfnForOtherProcess(PageFrameNumber,
                                                (PMMPTE)PointerPde,
-                                               MmSystemPageDirectory[(PointerPde - MiAddressToPde(NULL)) / PDE_COUNT]);
+                                               MmSystemPageDirectory[(PointerPde - MiAddressToPde(NULL)) / PDE_COUNT],
+                                               MM_DEFAULT_PAGE_PRIORITY);
 
                 /* Write the actual PDE now */
 //                MI_WRITE_VALID_PDE(PointerPde, TempPde);
@@ -37,7 +37,7 @@ MiCreatePebOrTeb(IN PEPROCESS Process,
     LARGE_INTEGER CurrentTime;
 
     /* Allocate a VAD */
-    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MMVAD_LONG), 'ldaV');
+    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MI_VAD), 'ldaV');
     if (!Vad) return STATUS_NO_MEMORY;
 
     /* Setup the primary flags with the size, and make it commited, private, RW */
@@ -1180,11 +1180,6 @@ MmCreateProcessAddressSpace(IN ULONG MinWs,
     Pfn1 = MiGetPfnEntry(PdeIndex);
     Pfn1->PteAddress = (PMMPTE)PDE_BASE;
 
-    /* Insert us into the Mm process list */
-    OldIrql = MiAcquireExpansionLock();
-    InsertTailList(&MmProcessList, &Process->MmProcessLinks);
-    MiReleaseExpansionLock(OldIrql);
-
     /* Get a PTE to map the page directory */
     PointerPte = MiReserveSystemPtes(1, SystemPteSpace);
     ASSERT(PointerPte != NULL);
@@ -1202,11 +1197,18 @@ MmCreateProcessAddressSpace(IN ULONG MinWs,
     /* Now get the page directory (which we'll double map, so call it a page table */
     SystemTable = MiPteToAddress(PointerPte);
 
-    /* Copy all the kernel mappings */
+    /*
+     * Insert us into the Mm process list and copy all the kernel mappings
+     * in one go, so that a large page PDE written to every process in the
+     * list can't be missed by our copy
+     */
+    OldIrql = MiAcquireExpansionLock();
+    InsertTailList(&MmProcessList, &Process->MmProcessLinks);
     PdeOffset = MiGetPdeOffset(MmSystemRangeStart);
     RtlCopyMemory(&SystemTable[PdeOffset],
                   MiAddressToPde(MmSystemRangeStart),
                   PAGE_SIZE - PdeOffset * sizeof(MMPTE));
+    MiReleaseExpansionLock(OldIrql);
 
     /* Now write the PTE/PDE entry for hyperspace itself */
     TempPte = ValidKernelPteLocal;
@@ -1276,8 +1278,9 @@ MmCleanProcessAddressSpace(IN PEPROCESS Process)
         ASSERT(VadTree->NumberGenericTableElements >= 1);
         MiRemoveNode((PMMADDRESS_NODE)Vad, VadTree);
 
-        /* Only regular VADs supported for now */
-        ASSERT(Vad->u.VadFlags.VadType == VadNone);
+        /* Only regular and large page VADs supported for now */
+        ASSERT((Vad->u.VadFlags.VadType == VadNone) ||
+               (Vad->u.VadFlags.VadType == VadLargePages));
 
         /* Check if this is a section VAD */
         if (!(Vad->u.VadFlags.PrivateMemory) && (Vad->ControlArea))
@@ -1285,6 +1288,16 @@ MmCleanProcessAddressSpace(IN PEPROCESS Process)
             /* Remove the view */
             MiRemoveMappedView(Process, Vad);
         }
+        else if (Vad->u.VadFlags.VadType == VadLargePages)
+        {
+            /* Large pages have no page tables, unmap and free them directly */
+            MiDeleteLargePageRange(Vad->StartingVpn << PAGE_SHIFT,
+                                   (Vad->EndingVpn << PAGE_SHIFT) | (PAGE_SIZE - 1),
+                                   Process);
+
+            /* Release the working set */
+            MiUnlockProcessWorkingSetUnsafe(Process, Thread);
+        }
         else
         {
             /* Delete the addresses */
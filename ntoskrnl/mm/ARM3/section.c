@@ -519,7 +519,8 @@ MiFillSystemPageDirectory(IN PVOID Base,
             /* Initialize its PFN entry, with the parent system page directory page table */
             MiInitializePfnForOtherProcess(PageFrameIndex,
                                            (PMMPTE)PointerPde,
-                                           ParentPage);
+                                           ParentPage,
+                                           MM_DEFAULT_PAGE_PRIORITY);
 
             /* Make the system PDE entry valid */
             MI_WRITE_VALID_PDE(SystemMapPde, TempPde);
@@ -1008,7 +1009,8 @@ _WARN("MiSessionCommitPageTables halfplemented for amd64")
             /* Initialize the PFN */
             MiInitializePfnForOtherProcess(PageFrameNumber,
                                            StartPde,
-                                           MmSessionSpace->SessionPageDirectoryIndex);
+                                           MmSessionSpace->SessionPageDirectoryIndex,
+                                           MM_DEFAULT_PAGE_PRIORITY);
 
             /* And now release the lock */
             KeReleaseQueuedSpinLock(LockQueuePfnLock, OldIrql);
@@ -1362,14 +1364,14 @@ MiMapViewOfDataSection(IN PCONTROL_AREA ControlArea,
     /* A VAD can now be allocated. Do so and zero it out */
     /* FIXME: we are allocating a LONG VAD for ReactOS compatibility only */
     ASSERT((AllocationType & MEM_RESERVE) == 0); /* ARM3 does not support this */
-    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MMVAD_LONG), 'ldaV');
+    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MI_VAD), 'ldaV');
     if (!Vad)
     {
         MiDereferenceControlArea(ControlArea);
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    RtlZeroMemory(Vad, sizeof(MMVAD_LONG));
+    RtlZeroMemory(Vad, sizeof(MI_VAD));
     Vad->u4.Banked = (PVOID)0xDEADBABE;
 
     /* Write all the data required in the VAD for handling a fault */
@@ -538,7 +538,8 @@ MiSessionInitializeWorkingSetList(VOID)
         /* Initialize the page directory page, and now zero the working set list itself */
         MiInitializePfnForOtherProcess(PageFrameIndex,
                                        PointerPde,
-                                       MmSessionSpace->SessionPageDirectoryIndex);
+                                       MmSessionSpace->SessionPageDirectoryIndex,
+                                       MM_DEFAULT_PAGE_PRIORITY);
         KeZeroPages(PointerPte, PAGE_SIZE);
     }
 
@@ -728,7 +729,8 @@ MiSessionCreateInternal(OUT PULONG SessionId)
     MI_WRITE_VALID_PDE(PointerPde, TempPde);
     MiInitializePfnForOtherProcess(SessionPageDirIndex,
                                    PointerPde,
-                                   SessionPageDirIndex);
+                                   SessionPageDirIndex,
+                                   MM_DEFAULT_PAGE_PRIORITY);
     ASSERT(MI_PFN_ELEMENT(SessionPageDirIndex)->u1.WsIndex == 0);
 
      /* Loop all the local PTEs for it */
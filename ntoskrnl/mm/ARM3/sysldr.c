@@ -1625,6 +1625,9 @@ MmFreeDriverInitialization(IN PLDR_DATA_TABLE_ENTRY LdrEntry)
     DllBase = LdrEntry->DllBase;
     PageCount = LdrEntry->SizeOfImage >> PAGE_SHIFT;
 
+    /* Part of a large page can't be given back */
+    if (MI_IS_PHYSICAL_ADDRESS(DllBase)) return;
+
     /* Get the last PTE in this image */
     EndPte = MiAddressToPte(DllBase) + PageCount;
 
@@ -2282,13 +2285,16 @@ MiUseLargeDriverPage(IN ULONG NumberOfPtes,
     PLIST_ENTRY NextEntry;
     BOOLEAN DriverFound = FALSE;
     PMI_LARGE_PAGE_DRIVER_ENTRY LargePageDriverEntry;
+    PFN_COUNT LargePageCount, PteCount, i;
+    PPFN_NUMBER LargePages;
+    PMMPTE PointerPte, StartPte;
+    PVOID NewImageAddress;
+    MMPDE TempPde;
     ASSERT(KeGetCurrentIrql () <= APC_LEVEL);
     ASSERT(*ImageBaseAddress >= MmSystemRangeStart);
 
-#ifdef _X86_
-    if (!(KeFeatureBits & KF_LARGE_PAGE)) return FALSE;
-    if (!(__readcr4() & CR4_PSE)) return FALSE;
-#endif
+    /* Nothing to do if the processor or the memory manager can't do large pages */
+    if (!MiIsLargePageSupported()) return FALSE;
 
     /* Make sure there's enough system PTEs for a large page driver */
     if (MmTotalFreeSystemPtes[SystemPteSpace] < (16 * (PDE_MAPPED_VA >> PAGE_SHIFT)))
@@ -2324,9 +2330,74 @@ MiUseLargeDriverPage(IN ULONG NumberOfPtes,
         if (DriverFound == FALSE) return FALSE;
     }
 
-    /* Nothing to do yet */
-    DPRINT1("Large pages not supported!\n");
-    return FALSE;
+    /* Reserve enough system PTEs to find a large page aligned range in them */
+    LargePageCount = (NumberOfPtes + MI_LARGE_PAGE_PAGES - 1) / MI_LARGE_PAGE_PAGES;
+    PteCount = (LargePageCount + 1) * MI_LARGE_PAGE_PAGES;
+    PointerPte = MiReserveSystemPtes(PteCount, SystemPteSpace);
+    if (!PointerPte) return FALSE;
+
+    /* Align the image on a large page, and give back the PTEs around it */
+    NewImageAddress = (PVOID)ALIGN_UP_BY(MiPteToAddress(PointerPte), MI_LARGE_PAGE_SIZE);
+    StartPte = MiAddressToPte(NewImageAddress);
+    if (StartPte != PointerPte)
+    {
+        MiReleaseSystemPtes(PointerPte, (PFN_COUNT)(StartPte - PointerPte), SystemPteSpace);
+    }
+    i = (PFN_COUNT)(PointerPte + PteCount - (StartPte + LargePageCount * MI_LARGE_PAGE_PAGES));
+    if (i) MiReleaseSystemPtes(PointerPte + PteCount - i, i, SystemPteSpace);
+
+    /* Get the physical memory for the image */
+    LargePages = ExAllocatePoolWithTag(PagedPool,
+                                       LargePageCount * sizeof(PFN_NUMBER),
+                                       'pLmM');
+    if (!LargePages)
+    {
+        MiReleaseSystemPtes(StartPte, LargePageCount * MI_LARGE_PAGE_PAGES, SystemPteSpace);
+        return FALSE;
+    }
+    for (i = 0; i < LargePageCount; i++)
+    {
+        LargePages[i] = MiAllocateLargePage(FALSE);
+        if (!LargePages[i])
+        {
+            /* Memory is too fragmented, the driver will just use small pages */
+            DPRINT1("No large page for %wZ\n", BaseImageName);
+            MiFreeLargePages(NULL, LargePages, i);
+            MiReleaseSystemPtes(StartPte, LargePageCount * MI_LARGE_PAGE_PAGES, SystemPteSpace);
+            return FALSE;
+        }
+    }
+
+    /*
+     * Map the large pages. The page tables that used to map this range are
+     * orphaned, which is fine since drivers don't get unloaded (yet).
+     */
+    for (i = 0; i < LargePageCount; i++)
+    {
+        MI_MAKE_HARDWARE_PTE_KERNEL(&TempPde,
+                                    StartPte + i * MI_LARGE_PAGE_PAGES,
+                                    MM_EXECUTE_READWRITE,
+                                    LargePages[i]);
+        TempPde.u.Hard.LargePage = 1;
+        MiWriteSystemLargePde(MiAddressToPde((ULONG_PTR)NewImageAddress + i * MI_LARGE_PAGE_SIZE),
+                              TempPde);
+    }
+    ExFreePoolWithTag(LargePages, 'pLmM');
+
+    /* Move the image over, and clear what's left of the last large page */
+    RtlCopyMemory(NewImageAddress, *ImageBaseAddress, NumberOfPtes << PAGE_SHIFT);
+    RtlZeroMemory((PVOID)((ULONG_PTR)NewImageAddress + (NumberOfPtes << PAGE_SHIFT)),
+                  (LargePageCount * MI_LARGE_PAGE_PAGES - NumberOfPtes) << PAGE_SHIFT);
+
+    /* Free the small pages that held the image until now */
+    PointerPte = MiAddressToPte(*ImageBaseAddress);
+    MiDeleteSystemPageableVm(PointerPte, NumberOfPtes, 0, NULL);
+    MiReleaseSystemPtes(PointerPte, NumberOfPtes, SystemPteSpace);
+
+    /* The image now lives in large pages */
+    DPRINT1("Loaded %wZ at %p with %lu large pages\n", BaseImageName, NewImageAddress, LargePageCount);
+    *ImageBaseAddress = NewImageAddress;
+    return TRUE;
 }
 
 ULONG
@@ -3114,7 +3185,7 @@ LoaderScan:
         if (NT_SUCCESS(Status))
         {
             /* Support large pages for drivers */
-            MiUseLargeDriverPage(DriverSize / PAGE_SIZE,
+            MiUseLargeDriverPage(BYTES_TO_PAGES(DriverSize),
                                  &ModuleLoadBase,
                                  &BaseName,
                                  TRUE);
@@ -426,6 +426,15 @@ MiRemoveNode(IN PMMADDRESS_NODE Node,
     }
 }
 
+VOID
+NTAPI
+MiUpdateNodeGaps(IN PMMADDRESS_NODE Node,
+                 IN PMM_AVL_TABLE Table)
+{
+    /* The bounds of the node changed, refresh the gaps recorded above it */
+    RtlpPropagateAvlTreeNode(Table, Node);
+}
+
 PMMADDRESS_NODE
 NTAPI
 MiGetPreviousNode(IN PMMADDRESS_NODE Node)
@@ -497,6 +506,160 @@ MiGetNextNode(IN PMMADDRESS_NODE Node)
     return NULL;
 }
 
+static
+BOOLEAN
+MiFindLowestGapInTree(IN PMM_AVL_TABLE Table,
+                      IN ULONG_PTR PageCount,
+                      IN ULONG_PTR AlignmentVpn,
+                      IN ULONG_PTR LowestVpn,
+                      OUT PMMADDRESS_NODE *Parent,
+                      OUT TABLE_SEARCH_RESULT *Result,
+                      OUT PULONG_PTR BaseVpn)
+{
+    PMMADDRESS_NODE Node, Child, Neighbour;
+    ULONG_PTR LowVpn;
+
+    /* Start at the root, every gap between two nodes is below it or on its sides */
+    Node = RtlRightChildAvl(&Table->BalancedRoot);
+    while (TRUE)
+    {
+        /* Go down on the left as long as a gap there can hold the range */
+        while (((Child = RtlLeftChildAvl(Node)) != NULL) &&
+               (*MiAddressNodeLargestGap(Child) >= PageCount)) Node = Child;
+
+        while (TRUE)
+        {
+            /* Check the gap between the left subtree and the current node */
+            Child = RtlLeftChildAvl(Node);
+            if (Child)
+            {
+                Neighbour = Child;
+                while (RtlRightChildAvl(Neighbour)) Neighbour = RtlRightChildAvl(Neighbour);
+                LowVpn = ALIGN_UP_BY(max(LowestVpn, Neighbour->EndingVpn + 1), AlignmentVpn);
+                if (Node->StartingVpn >= LowVpn + PageCount)
+                {
+                    /* The neighbour is right-most in its subtree, so it's the parent */
+                    *Parent = Neighbour;
+                    *Result = TableInsertAsRight;
+                    *BaseVpn = LowVpn;
+                    return TRUE;
+                }
+            }
+
+            /* Check the gap between the current node and the right subtree */
+            Child = RtlRightChildAvl(Node);
+            if (Child)
+            {
+                Neighbour = Child;
+                while (RtlLeftChildAvl(Neighbour)) Neighbour = RtlLeftChildAvl(Neighbour);
+                LowVpn = ALIGN_UP_BY(max(LowestVpn, Node->EndingVpn + 1), AlignmentVpn);
+                if (Neighbour->StartingVpn >= LowVpn + PageCount)
+                {
+                    /* The neighbour is left-most in its subtree, so it's the parent */
+                    *Parent = Neighbour;
+                    *Result = TableInsertAsLeft;
+                    *BaseVpn = LowVpn;
+                    return TRUE;
+                }
+
+                /* Continue in the right subtree if a gap there can hold the range */
+                if (*MiAddressNodeLargestGap(Child) >= PageCount)
+                {
+                    Node = Child;
+                    break;
+                }
+            }
+
+            /* This subtree is done, go up to the first node we left on its left side */
+            do
+            {
+                Child = Node;
+                Node = RtlParentAvl(Node);
+                if (Node == (PMMADDRESS_NODE)&Table->BalancedRoot) return FALSE;
+            } while (RtlRightChildAvl(Node) == Child);
+        }
+    }
+}
+
+static
+BOOLEAN
+MiFindHighestGapInTree(IN PMM_AVL_TABLE Table,
+                       IN ULONG_PTR PageCount,
+                       IN ULONG_PTR AlignmentVpn,
+                       IN ULONG_PTR HighestVpn,
+                       OUT PMMADDRESS_NODE *Parent,
+                       OUT TABLE_SEARCH_RESULT *Result,
+                       OUT PULONG_PTR BaseVpn)
+{
+    PMMADDRESS_NODE Node, Child, Neighbour;
+    ULONG_PTR LowVpn, HighVpn;
+
+    /* Start at the root, every gap between two nodes is below it or on its sides */
+    Node = RtlRightChildAvl(&Table->BalancedRoot);
+    while (TRUE)
+    {
+        /* Go down on the right as long as a gap there can hold the range
+           and is not entirely above the boundary */
+        while ((Node->EndingVpn < HighestVpn) &&
+               ((Child = RtlRightChildAvl(Node)) != NULL) &&
+               (*MiAddressNodeLargestGap(Child) >= PageCount)) Node = Child;
+
+        while (TRUE)
+        {
+            /* Check the gap between the current node and the right subtree */
+            Child = RtlRightChildAvl(Node);
+            if (Child && (Node->EndingVpn < HighestVpn))
+            {
+                Neighbour = Child;
+                while (RtlLeftChildAvl(Neighbour)) Neighbour = RtlLeftChildAvl(Neighbour);
+                HighVpn = min(Neighbour->StartingVpn, HighestVpn);
+                LowVpn = ALIGN_UP_BY(Node->EndingVpn + 1, AlignmentVpn);
+                if ((HighVpn > LowVpn) && ((HighVpn - LowVpn) >= PageCount))
+                {
+                    /* The neighbour is left-most in its subtree, so it's the parent */
+                    *Parent = Neighbour;
+                    *Result = TableInsertAsLeft;
+                    *BaseVpn = ALIGN_DOWN_BY(HighVpn - PageCount, AlignmentVpn);
+                    return TRUE;
+                }
+            }
+
+            /* Check the gap between the left subtree and the current node */
+            Child = RtlLeftChildAvl(Node);
+            if (Child)
+            {
+                Neighbour = Child;
+                while (RtlRightChildAvl(Neighbour)) Neighbour = RtlRightChildAvl(Neighbour);
+                HighVpn = min(Node->StartingVpn, HighestVpn);
+                LowVpn = ALIGN_UP_BY(Neighbour->EndingVpn + 1, AlignmentVpn);
+                if ((HighVpn > LowVpn) && ((HighVpn - LowVpn) >= PageCount))
+                {
+                    /* The neighbour is right-most in its subtree, so it's the parent */
+                    *Parent = Neighbour;
+                    *Result = TableInsertAsRight;
+                    *BaseVpn = ALIGN_DOWN_BY(HighVpn - PageCount, AlignmentVpn);
+                    return TRUE;
+                }
+
+                /* Continue in the left subtree if a gap there can hold the range */
+                if (*MiAddressNodeLargestGap(Child) >= PageCount)
+                {
+                    Node = Child;
+                    break;
+                }
+            }
+
+            /* This subtree is done, go up to the first node we left on its right side */
+            do
+            {
+                Child = Node;
+                Node = RtlParentAvl(Node);
+                if (Node == (PMMADDRESS_NODE)&Table->BalancedRoot) return FALSE;
+            } while (RtlLeftChildAvl(Node) == Child);
+        }
+    }
+}
+
 TABLE_SEARCH_RESULT
 NTAPI
 MiFindEmptyAddressRangeInTree(IN SIZE_T Length,
@@ -505,73 +668,58 @@ MiFindEmptyAddressRangeInTree(IN SIZE_T Length,
                               OUT PMMADDRESS_NODE *PreviousVad,
                               OUT PULONG_PTR Base)
 {
-    PMMADDRESS_NODE Node, PreviousNode;
-    ULONG_PTR PageCount, AlignmentVpn, LowVpn, HighestVpn;
+    PMMADDRESS_NODE Node;
+    ULONG_PTR PageCount, AlignmentVpn, LowVpn, LowestVpn, HighestVpn;
+    TABLE_SEARCH_RESULT Result;
     ASSERT(Length != 0);
 
     /* Calculate page numbers for the length, alignment, and starting address */
     PageCount = BYTES_TO_PAGES(Length);
     AlignmentVpn = Alignment >> PAGE_SHIFT;
-    LowVpn = ALIGN_UP_BY((ULONG_PTR)MM_LOWEST_USER_ADDRESS >> PAGE_SHIFT, AlignmentVpn);
+    LowestVpn = ALIGN_UP_BY((ULONG_PTR)MM_LOWEST_USER_ADDRESS >> PAGE_SHIFT, AlignmentVpn);
 
     /* Check for kernel mode table (memory areas) */
     if (Table->Unused == 1)
     {
-        LowVpn = ALIGN_UP_BY((ULONG_PTR)MmSystemRangeStart >> PAGE_SHIFT, AlignmentVpn);
+        LowestVpn = ALIGN_UP_BY((ULONG_PTR)MmSystemRangeStart >> PAGE_SHIFT, AlignmentVpn);
     }
 
     /* Check if the table is empty */
     if (Table->NumberGenericTableElements == 0)
     {
         /* Tree is empty, the candidate address is already the best one */
-        *Base = LowVpn << PAGE_SHIFT;
+        *Base = LowestVpn << PAGE_SHIFT;
         return TableEmptyTree;
     }
 
-    /* Otherwise, follow the leftmost child of the right root node's child */
+    /* Check if the gap below the lowest node is suitable */
     Node = RtlRightChildAvl(&Table->BalancedRoot);
     while (RtlLeftChildAvl(Node)) Node = RtlLeftChildAvl(Node);
-
-    /* Start a search to find a gap */
-    PreviousNode = NULL;
-    while (Node != NULL)
+    if (Node->StartingVpn >= LowestVpn + PageCount)
     {
-        /* Check if the gap below the current node is suitable */
-        if (Node->StartingVpn >= LowVpn + PageCount)
-        {
-            /* There is enough space to add our node */
-            *Base = LowVpn << PAGE_SHIFT;
-
-            /* Can we use the current node as parent? */
-            if (RtlLeftChildAvl(Node) == NULL)
-            {
-                /* Node has no left child, so use it as parent */
-                *PreviousVad = Node;
-                return TableInsertAsLeft;
-            }
-            else
-            {
-                /* Node has a left child, this means that the previous node is
-                   the right-most child of it's left child and can be used as
-                   the parent. In case we use the space before the left-most
-                   node, it's left child must be NULL. */
-                ASSERT(PreviousNode != NULL);
-                ASSERT(RtlRightChildAvl(PreviousNode) == NULL);
-                *PreviousVad = PreviousNode;
-                return TableInsertAsRight;
-            }
-        }
-
-        /* The next candidate is above the current node */
-        if (Node->EndingVpn >= LowVpn)
-            LowVpn = ALIGN_UP_BY(Node->EndingVpn + 1, AlignmentVpn);
+        /* There is enough space to add our node, as its left child */
+        *Base = LowestVpn << PAGE_SHIFT;
+        *PreviousVad = Node;
+        return TableInsertAsLeft;
+    }
 
-        /* Remember the current node and go to the next node */
-        PreviousNode = Node;
-        Node = MiGetNextNode(Node);
+    /* Look for the lowest suitable gap between two nodes */
+    if (MiFindLowestGapInTree(Table,
+                              PageCount,
+                              AlignmentVpn,
+                              LowestVpn,
+                              PreviousVad,
+                              &Result,
+                              &LowVpn))
+    {
+        *Base = LowVpn << PAGE_SHIFT;
+        return Result;
     }
 
     /* We're up to the highest VAD, will this allocation fit above it? */
+    Node = RtlRightChildAvl(&Table->BalancedRoot);
+    while (RtlRightChildAvl(Node)) Node = RtlRightChildAvl(Node);
+    LowVpn = ALIGN_UP_BY(max(LowestVpn, Node->EndingVpn + 1), AlignmentVpn);
     HighestVpn = ((ULONG_PTR)MM_HIGHEST_VAD_ADDRESS + 1) / PAGE_SIZE;
 
     /* Check for kernel mode table (memory areas) */
@@ -583,7 +731,7 @@ MiFindEmptyAddressRangeInTree(IN SIZE_T Length,
     if (HighestVpn >= LowVpn + PageCount)
     {
         /* Yes! Use this VAD to store the allocation */
-        *PreviousVad = PreviousNode;
+        *PreviousVad = Node;
         *Base = LowVpn << PAGE_SHIFT;
         return TableInsertAsRight;
     }
@@ -601,9 +749,10 @@ MiFindEmptyAddressRangeDownTree(IN SIZE_T Length,
                                 OUT PULONG_PTR Base,
                                 OUT PMMADDRESS_NODE *Parent)
 {
-    PMMADDRESS_NODE Node, OldNode = NULL, Child;
+    PMMADDRESS_NODE Node;
     ULONG_PTR LowVpn, HighVpn, AlignmentVpn;
     PFN_NUMBER PageCount;
+    TABLE_SEARCH_RESULT Result;
 
     /* Sanity checks */
     ASSERT(BoundaryAddress);
@@ -642,63 +791,43 @@ MiFindEmptyAddressRangeDownTree(IN SIZE_T Length,
     /* Calculate the initial upper margin */
     HighVpn = (BoundaryAddress + 1) >> PAGE_SHIFT;
 
-    /* Starting from the root, follow the right children until we found a node
-       that ends above the boundary */
+    /* Check if the gap above the highest node is suitable */
     Node = RtlRightChildAvl(&Table->BalancedRoot);
-    while ((Node->EndingVpn < HighVpn) &&
-           ((Child = RtlRightChildAvl(Node)) != NULL)) Node = Child;
-
-    /* Now loop the Vad nodes */
-    while (Node)
+    while (RtlRightChildAvl(Node)) Node = RtlRightChildAvl(Node);
+    LowVpn = ALIGN_UP_BY(Node->EndingVpn + 1, AlignmentVpn);
+    if ((HighVpn > LowVpn) && ((HighVpn - LowVpn) >= PageCount))
     {
-        /* Calculate the lower margin */
-        LowVpn = ALIGN_UP_BY(Node->EndingVpn + 1, AlignmentVpn);
-
-        /* Check if the current bounds are suitable */
-        if ((HighVpn > LowVpn) && ((HighVpn - LowVpn) >= PageCount))
-        {
-            /* There is enough space to add our node */
-            LowVpn = ALIGN_DOWN_BY(HighVpn - PageCount, AlignmentVpn);
-            *Base = LowVpn << PAGE_SHIFT;
-
-            /* Can we use the current node as parent? */
-            if (!RtlRightChildAvl(Node))
-            {
-                /* Node has no right child, so use it as parent */
-                *Parent = Node;
-                return TableInsertAsRight;
-            }
-            else
-            {
-                /* Node has a right child. This means we must have already
-                   moved one node left from the right-most node we started
-                   with, thus we already have an OldNode! */
-                ASSERT(OldNode != NULL);
-
-                /* The node we had before is the most left grandchild of 
-                   that right child, use it as parent. */
-                ASSERT(RtlLeftChildAvl(OldNode) == NULL);
-                *Parent = OldNode;
-                return TableInsertAsLeft;
-            }
-        }
-
-        /* Update the upper margin if necessary */
-        if (Node->StartingVpn < HighVpn) HighVpn = Node->StartingVpn;
+        /* There is enough space to add our node, as its right child */
+        LowVpn = ALIGN_DOWN_BY(HighVpn - PageCount, AlignmentVpn);
+        *Base = LowVpn << PAGE_SHIFT;
+        *Parent = Node;
+        return TableInsertAsRight;
+    }
 
-        /* Remember the current node and go to the previous node */
-        OldNode = Node;
-        Node = MiGetPreviousNode(Node);
+    /* Look for the highest suitable gap between two nodes */
+    if (MiFindHighestGapInTree(Table,
+                               PageCount,
+                               AlignmentVpn,
+                               HighVpn,
+                               Parent,
+                               &Result,
+                               &LowVpn))
+    {
+        *Base = LowVpn << PAGE_SHIFT;
+        return Result;
     }
 
     /* Check if there's enough space before the lowest Vad */
+    Node = RtlRightChildAvl(&Table->BalancedRoot);
+    while (RtlLeftChildAvl(Node)) Node = RtlLeftChildAvl(Node);
+    HighVpn = min(HighVpn, Node->StartingVpn);
     LowVpn = ALIGN_UP_BY((ULONG_PTR)MI_LOWEST_VAD_ADDRESS, Alignment) / PAGE_SIZE;
     if ((HighVpn > LowVpn) && ((HighVpn - LowVpn) >= PageCount))
     {
         /* There is enough space to add our address */
         LowVpn = ALIGN_DOWN_BY(HighVpn - PageCount, Alignment >> PAGE_SHIFT);
         *Base = LowVpn << PAGE_SHIFT;
-        *Parent = OldNode;
+        *Parent = Node;
         return TableInsertAsLeft;
     }
 
@@ -1462,8 +1462,9 @@ MiQueryAddressState(IN PVOID Va,
     ASSERT((Vad->StartingVpn <= ((ULONG_PTR)Va >> PAGE_SHIFT)) &&
            (Vad->EndingVpn >= ((ULONG_PTR)Va >> PAGE_SHIFT)));
 
-    /* Only normal VADs supported */
-    ASSERT(Vad->u.VadFlags.VadType == VadNone);
+    /* Only normal and large page VADs supported */
+    ASSERT((Vad->u.VadFlags.VadType == VadNone) ||
+           (Vad->u.VadFlags.VadType == VadLargePages));
 
     /* Get the PDE and PTE for the address */
     PointerPde = MiAddressToPde(Va);
@@ -1521,6 +1522,18 @@ MiQueryAddressState(IN PVOID Va,
             break;
         }
 
+        /* Large pages have no PTEs, and are committed for their whole life */
+        if (MI_IS_PHYSICAL_ADDRESS(Va))
+        {
+            /* Next range starts at the next PDE */
+            ASSERT(Vad->u.VadFlags.VadType == VadLargePages);
+            *NextVa = MiPdeToAddress(PointerPde + 1);
+            DemandZeroPte = FALSE;
+            State = MEM_COMMIT;
+            Protect = MmProtectToValue[Vad->u.VadFlags.Protection];
+            break;
+        }
+
         /* Is the PDE valid? */
         if (PointerPde->u.Hard.Valid == 0)
         {
@@ -4389,6 +4402,7 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
     PMMPTE PointerPte, LastPte;
     PMMPDE PointerPde;
     TABLE_SEARCH_RESULT Result;
+    PPFN_NUMBER LargePages = NULL;
     PAGED_CODE();
 
     /* Check for valid Zero bits */
@@ -4567,13 +4581,33 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
     }
 
     //
-    // Fail on the things we don't yet support
+    // Large pages are reserved and committed in one go, and only come in whole,
+    // cached, large page aligned pieces
     //
-    if ((AllocationType & MEM_LARGE_PAGES) == MEM_LARGE_PAGES)
+    if (AllocationType & MEM_LARGE_PAGES)
     {
-        DPRINT1("MEM_LARGE_PAGES not supported\n");
-        Status = STATUS_INVALID_PARAMETER;
-        goto FailPathNoLock;
+        if (!MiIsLargePageSupported())
+        {
+            DPRINT1("MEM_LARGE_PAGES not supported\n");
+            Status = STATUS_INVALID_PARAMETER;
+            goto FailPathNoLock;
+        }
+
+        if (!(AllocationType & MEM_RESERVE) ||
+            ((ULONG_PTR)PBaseAddress & (MI_LARGE_PAGE_SIZE - 1)) ||
+            (PRegionSize & (MI_LARGE_PAGE_SIZE - 1)))
+        {
+            DPRINT1("MEM_LARGE_PAGES allocation is not large page aligned\n");
+            Status = STATUS_INVALID_PARAMETER;
+            goto FailPathNoLock;
+        }
+
+        if (ProtectionMask & MM_PROTECT_SPECIAL)
+        {
+            DPRINT1("Invalid protection for MEM_LARGE_PAGES\n");
+            Status = STATUS_INVALID_PAGE_PROTECTION;
+            goto FailPathNoLock;
+        }
     }
     if ((AllocationType & MEM_PHYSICAL) == MEM_PHYSICAL)
     {
@@ -4644,10 +4678,25 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
             StartingAddress = (ULONG_PTR)PBaseAddress;
         }
 
+        //
+        // Large pages are never demand-faulted, so grab them all up front,
+        // before there is a VAD anyone could see
+        //
+        if (AllocationType & MEM_LARGE_PAGES)
+        {
+            LargePages = MiAllocateLargePages(Process, PRegionSize / MI_LARGE_PAGE_SIZE);
+            if (LargePages == NULL)
+            {
+                DPRINT1("Failed to allocate large pages!\n");
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                goto FailPathNoLock;
+            }
+        }
+
         //
         // Allocate and initialize the VAD
         //
-        Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MMVAD_LONG), 'SdaV');
+        Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MI_VAD), 'SdaV');
         if (Vad == NULL)
         {
             DPRINT1("Failed to allocate a VAD!\n");
@@ -4655,8 +4704,9 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
             goto FailPathNoLock;
         }
 
-        RtlZeroMemory(Vad, sizeof(MMVAD_LONG));
+        RtlZeroMemory(Vad, sizeof(MI_VAD));
         if (AllocationType & MEM_COMMIT) Vad->u.VadFlags.MemCommit = 1;
+        if (LargePages) Vad->u.VadFlags.VadType = VadLargePages;
         Vad->u.VadFlags.Protection = ProtectionMask;
         Vad->u.VadFlags.PrivateMemory = 1;
         Vad->ControlArea = NULL; // For Memory-Area hack
@@ -4668,7 +4718,7 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
                                &StartingAddress,
                                PRegionSize,
                                HighestAddress,
-                               MM_VIRTMEM_GRANULARITY,
+                               LargePages ? MI_LARGE_PAGE_SIZE : MM_VIRTMEM_GRANULARITY,
                                AllocationType);
         if (!NT_SUCCESS(Status))
         {
@@ -4676,6 +4726,25 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
             goto FailPathNoLock;
         }
 
+        //
+        // Now map the large pages. If this fails, the VAD is gone already
+        //
+        if (LargePages)
+        {
+            Status = MiMapLargePages(Process, StartingAddress, Vad, LargePages);
+            if (!NT_SUCCESS(Status))
+            {
+                DPRINT1("Failed to map the large pages!\n");
+                goto FailPathNoLock;
+            }
+
+            //
+            // The pages belong to the VAD now
+            //
+            ExFreePoolWithTag(LargePages, 'pLmM');
+            LargePages = NULL;
+        }
+
         //
         // Detach and dereference the target process if
         // it was different from the current process
@@ -5052,6 +5121,7 @@ FailPath:
     }
 
 FailPathNoLock:
+    if (LargePages) MiFreeLargePages(Process, LargePages, PRegionSize / MI_LARGE_PAGE_SIZE);
     if (Attached) KeUnstackDetachProcess(&ApcState);
     if (ProcessHandle != NtCurrentProcess()) ObDereferenceObject(Process);
 
@@ -5275,9 +5345,23 @@ NtFreeVirtualMemory(IN HANDLE ProcessHandle,
     if (FreeType & MEM_RELEASE)
     {
         //
-        // ARM3 only supports this VAD in this path
+        // ARM3 only supports these VADs in this path
         //
-        ASSERT(Vad->u.VadFlags.VadType == VadNone);
+        ASSERT((Vad->u.VadFlags.VadType == VadNone) ||
+               (Vad->u.VadFlags.VadType == VadLargePages));
+
+        //
+        // Large page VADs can only be released as a whole
+        //
+        if ((Vad->u.VadFlags.VadType == VadLargePages) &&
+            (PRegionSize) &&
+            (((StartingAddress >> PAGE_SHIFT) != Vad->StartingVpn) ||
+             ((EndingAddress >> PAGE_SHIFT) != Vad->EndingVpn)))
+        {
+            DPRINT1("Trying to release part of a large page VAD\n");
+            Status = STATUS_FREE_VM_NOT_AT_BASE;
+            goto FailPath;
+        }
 
         //
         // Is the caller trying to remove the whole VAD, or remove only a portion
@@ -5387,6 +5471,7 @@ NtFreeVirtualMemory(IN HANDLE ProcessHandle,
                     ASSERT(Vad->EndingVpn == MemoryArea->VadNode.EndingVpn);
                     Vad->EndingVpn = (StartingAddress - 1) >> PAGE_SHIFT;
                     MemoryArea->VadNode.EndingVpn = Vad->EndingVpn;
+                    MiUpdateNodeGaps((PMMADDRESS_NODE)Vad, &Process->VadRoot);
                 }
                 else
                 {
@@ -5416,7 +5501,14 @@ NtFreeVirtualMemory(IN HANDLE ProcessHandle,
         // to do that and then release the working set, since we're done messing
         // around with process pages.
         //
-        MiDeleteVirtualAddresses(StartingAddress, EndingAddress, NULL);
+        if ((Vad) && (Vad->u.VadFlags.VadType == VadLargePages))
+        {
+            MiDeleteLargePageRange(StartingAddress, EndingAddress, Process);
+        }
+        else
+        {
+            MiDeleteVirtualAddresses(StartingAddress, EndingAddress, NULL);
+        }
         MiUnlockProcessWorkingSetUnsafe(Process, CurrentThread);
         Status = STATUS_SUCCESS;
 
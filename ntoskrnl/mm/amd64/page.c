@@ -446,6 +446,48 @@ MmSetDirtyPage(PEPROCESS Process, PVOID Address)
     MiFlushTlb(Pte, Address);
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(PEPROCESS Process, PVOID Address)
+{
+    PMMPTE Pte;
+    MMPTE OldPte, NewPte;
+    BOOLEAN Accessed;
+
+    Pte = MiGetPteForProcess(Process, Address, FALSE);
+    if (!Pte)
+    {
+        return FALSE;
+    }
+
+    do
+    {
+        OldPte = *Pte;
+
+        /* In a swap or transition entry bit 5 is not the accessed bit */
+        if (!OldPte.u.Hard.Valid)
+        {
+            MiFlushTlb(Pte, Address);
+            return FALSE;
+        }
+
+        NewPte = OldPte;
+        NewPte.u.Hard.Accessed = 0;
+    } while (InterlockedCompareExchange64((PLONG64)&Pte->u.Long,
+                                          NewPte.u.Long,
+                                          OldPte.u.Long) != (LONG64)OldPte.u.Long);
+
+    Accessed = (BOOLEAN)OldPte.u.Hard.Accessed;
+    if (Accessed)
+    {
+        if (!MiIsHyperspaceAddress(Pte))
+            __invlpg(Address);
+    }
+
+    MiFlushTlb(Pte, Address);
+    return Accessed;
+}
+
 VOID
 NTAPI
 MmDeleteVirtualMapping(
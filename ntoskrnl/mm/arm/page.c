@@ -235,6 +235,15 @@ MmSetDirtyPage(IN PEPROCESS Process,
     UNIMPLEMENTED_DBGBREAK();
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(IN PEPROCESS Process,
+                           IN PVOID Address)
+{
+    UNIMPLEMENTED_DBGBREAK();
+    return FALSE;
+}
+
 BOOLEAN
 NTAPI
 MmIsPagePresent(IN PEPROCESS Process,
@@ -31,6 +31,14 @@ typedef struct _MM_ALLOCATION_REQUEST
     KEVENT Event;
 }
 MM_ALLOCATION_REQUEST, *PMM_ALLOCATION_REQUEST;
+
+typedef struct _MM_HARD_FAULT_COUNT
+{
+    LIST_ENTRY ListEntry;
+    PEPROCESS Process;
+    ULONG HardFaultCount;
+}
+MM_HARD_FAULT_COUNT, *PMM_HARD_FAULT_COUNT;
 /* GLOBALS ******************************************************************/
 
 MM_MEMORY_CONSUMER MiMemoryConsumers[MC_MAXIMUM];
@@ -45,6 +53,40 @@ static HANDLE MiBalancerThreadHandle = NULL;
 static KEVENT MiBalancerEvent;
 static KTIMER MiBalancerTimer;
 
+/*
+ * Per-page age of the user pages, in clock hand sweeps since the page was
+ * last seen accessed. Pages at MI_MAX_PAGE_AGE are the first to be trimmed.
+ */
+#define MI_MAX_PAGE_AGE (PROCESS_WS_AGE_BUCKETS - 1)
+static PUCHAR MiUserPageAge;
+
+/* User pages sampled per aging pass and the last page the clock hand visited */
+#define MI_AGE_PAGES_PER_PASS 256
+static PFN_NUMBER MiAgeClockHand;
+
+/*
+ * Pages younger than MI_MAX_PAGE_AGE seen by the trimmer, by age, to fall
+ * back on if the oldest ones are not enough. Only the balancer thread trims.
+ */
+#define MI_TRIM_CANDIDATES 256
+static PFN_NUMBER MiTrimCandidates[MI_MAX_PAGE_AGE][MI_TRIM_CANDIDATES];
+
+/*
+ * One bit per page read in ahead of a fault by fault clustering. It is
+ * cleared when the page is first seen used, or when the page is released.
+ */
+static PLONG MiPrefetchedPages;
+
+/*
+ * Faults of the RosMm fault paths which had to wait for the disk, per
+ * process. Hashed by process, an entry is made on the first hard fault.
+ */
+#define MI_HARD_FAULT_BUCKETS 64
+static LIST_ENTRY MiHardFaultBuckets[MI_HARD_FAULT_BUCKETS];
+static KSPIN_LOCK MiHardFaultLock;
+#define MiHardFaultBucket(Process) \
+    (&MiHardFaultBuckets[((ULONG_PTR)(Process) >> 6) % MI_HARD_FAULT_BUCKETS])
+
 /* FUNCTIONS ****************************************************************/
 
 VOID
@@ -52,10 +94,16 @@ INIT_FUNCTION
 NTAPI
 MmInitializeBalancer(ULONG NrAvailablePages, ULONG NrSystemPages)
 {
+    ULONG i;
+
     memset(MiMemoryConsumers, 0, sizeof(MiMemoryConsumers));
     InitializeListHead(&AllocationListHead);
     KeInitializeSpinLock(&AllocationListLock);
 
+    for (i = 0; i < MI_HARD_FAULT_BUCKETS; i++)
+        InitializeListHead(&MiHardFaultBuckets[i]);
+    KeInitializeSpinLock(&MiHardFaultLock);
+
     MiNrTotalPages = NrAvailablePages;
 
     /* Set up targets. */
@@ -106,6 +154,10 @@ MmReleasePageMemoryConsumer(ULONG Consumer, PFN_NUMBER Page)
     {
         if(Consumer == MC_USER) MmRemoveLRUUserPage(Page);
         (void)InterlockedDecrementUL(&MiMemoryConsumers[Consumer].PagesUsed);
+
+        /* It was read ahead for nothing */
+        if (MiPrefetchedPages)
+            InterlockedBitTestAndReset(&MiPrefetchedPages[Page / 32], (LONG)(Page % 32));
     }
 
     MmDereferencePage(Page);
@@ -174,24 +226,79 @@ MiTrimMemoryConsumer(ULONG Consumer, ULONG InitialTarget)
     }
 }
 
+static
+VOID
+MiAgeUserPages(ULONG MaxPages)
+{
+    PFN_NUMBER CurrentPage;
+    PFN_NUMBER FirstPage;
+    UCHAR Age;
+
+    if (!MiUserPageAge) return;
+
+    /* Move the clock hand over at most MaxPages user pages, so a pass stays cheap */
+    CurrentPage = MiAgeClockHand ? MmGetLRUNextUserPage(MiAgeClockHand) : 0;
+    if (CurrentPage == 0) CurrentPage = MmGetLRUFirstUserPage();
+    FirstPage = CurrentPage;
+
+    while (CurrentPage != 0 && MaxPages-- > 0)
+    {
+        Age = MiUserPageAge[CurrentPage];
+        if (MmTestAndClearAccessedRmaps(CurrentPage))
+        {
+            Age = 0;
+            MmNotePageUsed(CurrentPage);
+        }
+        else if (Age < MI_MAX_PAGE_AGE)
+        {
+            Age++;
+        }
+        MiUserPageAge[CurrentPage] = Age;
+        MiAgeClockHand = CurrentPage;
+
+        /* Continue at the start once the end is reached, but only go round once */
+        CurrentPage = MmGetLRUNextUserPage(CurrentPage);
+        if (CurrentPage == 0) CurrentPage = MmGetLRUFirstUserPage();
+        if (CurrentPage == FirstPage) break;
+    }
+}
+
 NTSTATUS
 MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
 {
     PFN_NUMBER CurrentPage;
     PFN_NUMBER NextPage;
     NTSTATUS Status;
+    ULONG CandidateCount[MI_MAX_PAGE_AGE];
+    ULONG i;
+    LONG Age;
 
-    (*NrFreedPages) = 0;
+    /* Pages on standby are already out of every working set, give them up first */
+    (*NrFreedPages) = MmTrimStandbySwapPages(Target);
+    Target -= *NrFreedPages;
+    if (Target == 0) return STATUS_SUCCESS;
 
+    MiAgeUserPages(MI_AGE_PAGES_PER_PASS);
+
+    /* Page out the coldest pages as they are found, and remember younger ones by age */
+    RtlZeroMemory(CandidateCount, sizeof(CandidateCount));
     CurrentPage = MmGetLRUFirstUserPage();
     while (CurrentPage != 0 && Target > 0)
     {
-        Status = MmPageOutPhysicalAddress(CurrentPage);
-        if (NT_SUCCESS(Status))
+        Age = MiUserPageAge ? MiUserPageAge[CurrentPage] : MI_MAX_PAGE_AGE;
+        if (Age == MI_MAX_PAGE_AGE)
+        {
+            Status = MmPageOutPhysicalAddress(CurrentPage);
+            if (NT_SUCCESS(Status))
+            {
+                DPRINT("Succeeded\n");
+                Target--;
+                (*NrFreedPages)++;
+            }
+        }
+        else if (CandidateCount[Age] < MI_TRIM_CANDIDATES)
         {
-            DPRINT("Succeeded\n");
-            Target--;
-            (*NrFreedPages)++;
+            MiTrimCandidates[Age][CandidateCount[Age]++] = CurrentPage;
         }
 
         NextPage = MmGetLRUNextUserPage(CurrentPage);
@@ -203,9 +310,192 @@ MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
         CurrentPage = NextPage;
     }
 
+    /* Still short of the target, go on with younger and younger pages */
+    for (Age = MI_MAX_PAGE_AGE - 1; (Age >= 0) && (Target > 0); Age--)
+    {
+        for (i = 0; (i < CandidateCount[Age]) && (Target > 0); i++)
+        {
+            /* Skip the page if it was released or used since the walk */
+            CurrentPage = MiTrimCandidates[Age][i];
+            if (MiUserPageAge[CurrentPage] != Age) continue;
+
+            Status = MmPageOutPhysicalAddress(CurrentPage);
+            if (NT_SUCCESS(Status))
+            {
+                DPRINT("Succeeded\n");
+                Target--;
+                (*NrFreedPages)++;
+            }
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static
+PMM_HARD_FAULT_COUNT
+MiFindHardFaultCount(PEPROCESS Process)
+{
+    PLIST_ENTRY Bucket, Entry;
+    PMM_HARD_FAULT_COUNT Count;
+
+    /* The caller holds MiHardFaultLock */
+    Bucket = MiHardFaultBucket(Process);
+    for (Entry = Bucket->Flink; Entry != Bucket; Entry = Entry->Flink)
+    {
+        Count = CONTAINING_RECORD(Entry, MM_HARD_FAULT_COUNT, ListEntry);
+        if (Count->Process == Process) return Count;
+    }
+
+    return NULL;
+}
+
+static
+ULONG
+MiGetHardFaultCount(PEPROCESS Process)
+{
+    PMM_HARD_FAULT_COUNT Count;
+    ULONG HardFaultCount;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&MiHardFaultLock, &OldIrql);
+    Count = MiFindHardFaultCount(Process);
+    HardFaultCount = Count ? Count->HardFaultCount : 0;
+    KeReleaseSpinLock(&MiHardFaultLock, OldIrql);
+
+    return HardFaultCount;
+}
+
+VOID
+NTAPI
+MmNoteHardFault(PMMSUPPORT AddressSpace)
+{
+    PEPROCESS Process = MmGetAddressSpaceOwner(AddressSpace);
+    PMM_HARD_FAULT_COUNT Count, NewCount = NULL;
+    KIRQL OldIrql;
+
+    /* Only user address spaces are accounted */
+    if (Process == NULL) return;
+
+    KeAcquireSpinLock(&MiHardFaultLock, &OldIrql);
+    Count = MiFindHardFaultCount(Process);
+    if (Count == NULL)
+    {
+        /* First hard fault of the process, allocate outside the lock */
+        KeReleaseSpinLock(&MiHardFaultLock, OldIrql);
+        NewCount = ExAllocatePoolWithTag(NonPagedPool, sizeof(*NewCount), TAG_MM_HARDFAULT);
+        if (NewCount == NULL) return;
+
+        KeAcquireSpinLock(&MiHardFaultLock, &OldIrql);
+        Count = MiFindHardFaultCount(Process);
+        if (Count == NULL)
+        {
+            NewCount->Process = Process;
+            NewCount->HardFaultCount = 0;
+            InsertTailList(MiHardFaultBucket(Process), &NewCount->ListEntry);
+            Count = NewCount;
+            NewCount = NULL;
+        }
+    }
+    Count->HardFaultCount++;
+    KeReleaseSpinLock(&MiHardFaultLock, OldIrql);
+
+    /* Someone else made the entry in the meantime */
+    if (NewCount) ExFreePoolWithTag(NewCount, TAG_MM_HARDFAULT);
+}
+
+VOID
+NTAPI
+MmDeleteHardFaultCount(PEPROCESS Process)
+{
+    PMM_HARD_FAULT_COUNT Count;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&MiHardFaultLock, &OldIrql);
+    Count = MiFindHardFaultCount(Process);
+    if (Count) RemoveEntryList(&Count->ListEntry);
+    KeReleaseSpinLock(&MiHardFaultLock, OldIrql);
+
+    if (Count) ExFreePoolWithTag(Count, TAG_MM_HARDFAULT);
+}
+
+NTSTATUS
+NTAPI
+MmQueryWorkingSetAging(IN PEPROCESS Process,
+                       OUT PPROCESS_WS_AGING_INFORMATION AgingInfo)
+{
+    PFN_NUMBER CurrentPage;
+    PFN_NUMBER NextPage;
+    ULONG Count;
+    ULONG FaultCount, HardFaultCount;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(AgingInfo, sizeof(*AgingInfo));
+
+    /* The ages are kept per page, so collect the ones this process maps */
+    if (MiUserPageAge)
+    {
+        CurrentPage = MmGetLRUFirstUserPage();
+        while (CurrentPage != 0)
+        {
+            Count = MmGetRmapCountForProcess(CurrentPage, Process);
+            if (Count)
+            {
+                AgingInfo->AgeHistogram[MiUserPageAge[CurrentPage]] += Count;
+            }
+
+            NextPage = MmGetLRUNextUserPage(CurrentPage);
+            if (NextPage <= CurrentPage)
+            {
+                /* We wrapped around, so we're done */
+                break;
+            }
+            CurrentPage = NextPage;
+        }
+    }
+
+    AgingInfo->WorkingSetSize = Process->Vm.WorkingSetSize;
+    AgingInfo->PeakWorkingSetSize = Process->Vm.PeakWorkingSetSize;
+
+    /* Every fault that did not wait for the disk was a soft one */
+    FaultCount = Process->Vm.PageFaultCount;
+    HardFaultCount = MiGetHardFaultCount(Process);
+    AgingInfo->HardFaultCount = HardFaultCount;
+    AgingInfo->SoftFaultCount = (FaultCount > HardFaultCount) ? FaultCount - HardFaultCount : 0;
+
     return STATUS_SUCCESS;
 }
 
+VOID
+NTAPI
+MmMarkPrefetchedPage(PFN_NUMBER Page)
+{
+    if (MiPrefetchedPages)
+        InterlockedBitTestAndSet(&MiPrefetchedPages[Page / 32], (LONG)(Page % 32));
+}
+
+VOID
+NTAPI
+MmNotePageUsed(PFN_NUMBER Page)
+{
+    /* Only the first use of a page that was read ahead is a prefetch hit */
+    if (MiPrefetchedPages &&
+        InterlockedBitTestAndReset(&MiPrefetchedPages[Page / 32], (LONG)(Page % 32)))
+    {
+        InterlockedIncrement((PLONG)&MmSectionPrefetchHitCount);
+    }
+}
+
+static
+VOID
+MiInsertUserPage(PFN_NUMBER Page)
+{
+    /* A newly handed out page starts young */
+    if (MiUserPageAge) MiUserPageAge[Page] = 0;
+    MmInsertLRULastUserPage(Page);
+}
+
 static BOOLEAN
 MiIsBalancerThread(VOID)
 {
@@ -252,7 +542,7 @@ MmRequestPageMemoryConsumer(ULONG Consumer, BOOLEAN CanWait,
         {
             KeBugCheck(NO_PAGES_AVAILABLE);
         }
-        if (Consumer == MC_USER) MmInsertLRULastUserPage(Page);
+        if (Consumer == MC_USER) MiInsertUserPage(Page);
         *AllocatedPage = Page;
         if (MmAvailablePages < MiMinimumAvailablePages)
             MmRebalanceMemoryConsumers();
@@ -293,7 +583,7 @@ MmRequestPageMemoryConsumer(ULONG Consumer, BOOLEAN CanWait,
             KeBugCheck(NO_PAGES_AVAILABLE);
         }
 
-        if(Consumer == MC_USER) MmInsertLRULastUserPage(Page);
+        if(Consumer == MC_USER) MiInsertUserPage(Page);
         *AllocatedPage = Page;
 
         if (MmAvailablePages < MiMinimumAvailablePages)
@@ -312,7 +602,7 @@ MmRequestPageMemoryConsumer(ULONG Consumer, BOOLEAN CanWait,
     {
         KeBugCheck(NO_PAGES_AVAILABLE);
     }
-    if(Consumer == MC_USER) MmInsertLRULastUserPage(Page);
+    if(Consumer == MC_USER) MiInsertUserPage(Page);
     *AllocatedPage = Page;
 
     if (MmAvailablePages < MiMinimumAvailablePages)
@@ -394,6 +684,12 @@ MiBalancerThread(PVOID Unused)
                 }
             }
             while (InitialTarget != 0);
+
+            /* Periodic wakes also age the user pages, so trimming has history to go on */
+            if (Status == STATUS_WAIT_1)
+            {
+                MiAgeUserPages(MI_AGE_PAGES_PER_PASS);
+            }
         }
         else
         {
@@ -458,6 +754,22 @@ MiInitBalancerThread(VOID)
 #endif
 
 
+    MiUserPageAge = ExAllocatePoolWithTag(NonPagedPool,
+                                          MmHighestPhysicalPage + 1,
+                                          TAG_MM);
+    if (MiUserPageAge)
+    {
+        RtlZeroMemory(MiUserPageAge, MmHighestPhysicalPage + 1);
+    }
+
+    MiPrefetchedPages = ExAllocatePoolWithTag(NonPagedPool,
+                                              (MmHighestPhysicalPage / 32 + 1) * sizeof(LONG),
+                                              TAG_MM);
+    if (MiPrefetchedPages)
+    {
+        RtlZeroMemory(MiPrefetchedPages, (MmHighestPhysicalPage / 32 + 1) * sizeof(LONG));
+    }
+
     KeInitializeEvent(&MiBalancerEvent, SynchronizationEvent, FALSE);
     KeInitializeTimerEx(&MiBalancerTimer, SynchronizationTimer);
     KeSetTimerEx(&MiBalancerTimer,
@@ -589,6 +589,42 @@ MmSetDirtyPage(PEPROCESS Process, PVOID Address)
     }
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(PEPROCESS Process, PVOID Address)
+{
+    PULONG Pt;
+    ULONG Pte;
+
+    Pt = MmGetPageTableForProcess(Process, Address, FALSE);
+    if (Pt == NULL)
+    {
+        return FALSE;
+    }
+
+    do
+    {
+        Pte = *Pt;
+
+        /* In a swap or transition entry bit 5 is not the accessed bit */
+        if (!(Pte & PA_PRESENT))
+        {
+            MmUnmapPageTable(Pt);
+            return FALSE;
+        }
+    } while (Pte != InterlockedCompareExchangePte(Pt, Pte & ~PA_ACCESSED, Pte));
+
+    if (Pte & PA_ACCESSED)
+    {
+        /* The processor only sets the bit again if it walks the page table */
+        MiFlushTlb(Pt, Address);
+        return TRUE;
+    }
+
+    MmUnmapPageTable(Pt);
+    return FALSE;
+}
+
 BOOLEAN
 NTAPI
 MmIsPagePresent(PEPROCESS Process, PVOID Address)
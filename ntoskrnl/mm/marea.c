@@ -576,6 +576,8 @@ MmDeleteProcessAddressSpace(PEPROCESS Process)
     DPRINT("MmDeleteProcessAddressSpace(Process %p (%s))\n", Process,
            Process->ImageFileName);
 
+    MmDeleteHardFaultCount(Process);
+
 #ifndef _M_AMD64
     OldIrql = MiAcquireExpansionLock();
     RemoveEntryList(&Process->MmProcessLinks);
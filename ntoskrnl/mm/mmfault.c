@@ -98,6 +98,10 @@ MmpAccessFault(KPROCESSOR_MODE Mode,
     while (Status == STATUS_MM_RESTART_OPERATION);
 
     DPRINT("Completed page fault handling\n");
+    if (NT_SUCCESS(Status))
+    {
+        InterlockedIncrement((PLONG)&AddressSpace->PageFaultCount);
+    }
     if (!FromMdl)
     {
         MmUnlockAddressSpace(AddressSpace);
@@ -190,6 +194,10 @@ MmNotPresentFault(KPROCESSOR_MODE Mode,
     while (Status == STATUS_MM_RESTART_OPERATION);
 
     DPRINT("Completed page fault handling\n");
+    if (NT_SUCCESS(Status))
+    {
+        InterlockedIncrement((PLONG)&AddressSpace->PageFaultCount);
+    }
     if (!FromMdl)
     {
         MmUnlockAddressSpace(AddressSpace);
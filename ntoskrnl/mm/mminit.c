@@ -324,6 +324,9 @@ MmInitSystem(IN ULONG Phase,
                                 PageFrameNumber);
     *MmSharedUserDataPte = TempPte;
 
+    /* The kernel has turned on large pages by now, so tell user mode about them */
+    if (MiIsLargePageSupported()) SharedUserData->LargePageMinimum = MI_LARGE_PAGE_SIZE;
+
     /* Initialize session working set support */
     MiInitializeSessionWsSupport();
 
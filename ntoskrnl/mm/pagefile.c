@@ -64,6 +64,20 @@ typedef struct _RETRIEVEL_DESCRIPTOR_LIST
 }
 RETRIEVEL_DESCRIPTOR_LIST, *PRETRIEVEL_DESCRIPTOR_LIST;
 
+/*
+ * A trimmed page whose contents are still identical to its swap slot.
+ * Faulting the swap entry back in takes the data from here instead of
+ * going to the disk.
+ */
+typedef struct _MM_STANDBY_SWAP_PAGE
+{
+    LIST_ENTRY HashEntry;
+    LIST_ENTRY ListEntry;
+    SWAPENTRY SwapEntry;
+    PFN_NUMBER Page;
+}
+MM_STANDBY_SWAP_PAGE, *PMM_STANDBY_SWAP_PAGE;
+
 /* GLOBALS *******************************************************************/
 
 #define PAIRS_PER_RUN (1024)
@@ -119,8 +133,156 @@ C_ASSERT(FILE_FROM_ENTRY(0xffffffff) < MAX_PAGING_FILES);
 
 static BOOLEAN MmSwapSpaceMessage = FALSE;
 
+/* Standby pages, hashed by swap entry and kept in trim order */
+#define MI_STANDBY_SWAP_BUCKETS (256)
+#define MI_STANDBY_SWAP_HASH(e) ((OFFSET_FROM_ENTRY(e) ^ FILE_FROM_ENTRY(e)) & (MI_STANDBY_SWAP_BUCKETS - 1))
+
+static LIST_ENTRY MiStandbySwapHash[MI_STANDBY_SWAP_BUCKETS];
+static LIST_ENTRY MiStandbySwapListHead;
+static KSPIN_LOCK MiStandbySwapLock;
+static NPAGED_LOOKASIDE_LIST MiStandbySwapLookasideList;
+
+/* Number of pages currently held on standby */
+PFN_COUNT MiStandbySwapPages;
+
+/* Number of swap reads satisfied from a standby page */
+ULONG MiStandbySwapHitCount;
+
 /* FUNCTIONS *****************************************************************/
 
+static PMM_STANDBY_SWAP_PAGE
+MiRemoveStandbySwapPage(SWAPENTRY SwapEntry)
+{
+    PLIST_ENTRY Head, NextEntry;
+    PMM_STANDBY_SWAP_PAGE Standby;
+    KIRQL OldIrql;
+
+    Head = &MiStandbySwapHash[MI_STANDBY_SWAP_HASH(SwapEntry)];
+
+    KeAcquireSpinLock(&MiStandbySwapLock, &OldIrql);
+    for (NextEntry = Head->Flink; NextEntry != Head; NextEntry = NextEntry->Flink)
+    {
+        Standby = CONTAINING_RECORD(NextEntry, MM_STANDBY_SWAP_PAGE, HashEntry);
+        if (Standby->SwapEntry == SwapEntry)
+        {
+            RemoveEntryList(&Standby->HashEntry);
+            RemoveEntryList(&Standby->ListEntry);
+            MiStandbySwapPages--;
+            KeReleaseSpinLock(&MiStandbySwapLock, OldIrql);
+            return Standby;
+        }
+    }
+    KeReleaseSpinLock(&MiStandbySwapLock, OldIrql);
+
+    return NULL;
+}
+
+static VOID
+MiDropStandbySwapPage(SWAPENTRY SwapEntry)
+{
+    PMM_STANDBY_SWAP_PAGE Standby;
+
+    Standby = MiRemoveStandbySwapPage(SwapEntry);
+    if (Standby != NULL)
+    {
+        MmReleasePageMemoryConsumer(MC_USER, Standby->Page);
+        ExFreeToNPagedLookasideList(&MiStandbySwapLookasideList, Standby);
+    }
+}
+
+VOID
+NTAPI
+MmInsertStandbySwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+{
+    PMM_STANDBY_SWAP_PAGE Standby;
+    KIRQL OldIrql;
+
+    ASSERT(SwapEntry != 0);
+
+    Standby = ExAllocateFromNPagedLookasideList(&MiStandbySwapLookasideList);
+    if (Standby == NULL)
+    {
+        /* Not worth failing the trim over, just let the page go */
+        MmReleasePageMemoryConsumer(MC_USER, Page);
+        return;
+    }
+
+    /* A page read back from this slot and trimmed again replaces the old copy */
+    MiDropStandbySwapPage(SwapEntry);
+
+    Standby->SwapEntry = SwapEntry;
+    Standby->Page = Page;
+
+    KeAcquireSpinLock(&MiStandbySwapLock, &OldIrql);
+    InsertTailList(&MiStandbySwapHash[MI_STANDBY_SWAP_HASH(SwapEntry)], &Standby->HashEntry);
+    InsertTailList(&MiStandbySwapListHead, &Standby->ListEntry);
+    MiStandbySwapPages++;
+    KeReleaseSpinLock(&MiStandbySwapLock, OldIrql);
+}
+
+ULONG
+NTAPI
+MmTrimStandbySwapPages(ULONG Target)
+{
+    PMM_STANDBY_SWAP_PAGE Standby;
+    PLIST_ENTRY ListEntry;
+    ULONG Freed = 0;
+    KIRQL OldIrql;
+
+    while (Freed < Target)
+    {
+        /* Oldest pages go first */
+        KeAcquireSpinLock(&MiStandbySwapLock, &OldIrql);
+        if (IsListEmpty(&MiStandbySwapListHead))
+        {
+            KeReleaseSpinLock(&MiStandbySwapLock, OldIrql);
+            break;
+        }
+        ListEntry = RemoveHeadList(&MiStandbySwapListHead);
+        Standby = CONTAINING_RECORD(ListEntry, MM_STANDBY_SWAP_PAGE, ListEntry);
+        RemoveEntryList(&Standby->HashEntry);
+        MiStandbySwapPages--;
+        KeReleaseSpinLock(&MiStandbySwapLock, OldIrql);
+
+        MmReleasePageMemoryConsumer(MC_USER, Standby->Page);
+        ExFreeToNPagedLookasideList(&MiStandbySwapLookasideList, Standby);
+        Freed++;
+    }
+
+    return Freed;
+}
+
+static BOOLEAN
+MiCopyStandbySwapPage(PFN_NUMBER Source, PFN_NUMBER Destination)
+{
+    UCHAR MdlBase[sizeof(MDL) + 2 * sizeof(PFN_NUMBER)];
+    PMDL Mdl = (PMDL)MdlBase;
+    PFN_NUMBER Pages[2];
+    PUCHAR Buffer;
+
+    /* Hyperspace only holds one mapping at a time, so map both pages at once */
+    Pages[0] = Source;
+    Pages[1] = Destination;
+    MmInitializeMdl(Mdl, NULL, 2 * PAGE_SIZE);
+    MmBuildMdlFromPages(Mdl, Pages);
+    Mdl->MdlFlags |= MDL_PAGES_LOCKED;
+
+    Buffer = MmMapLockedPagesSpecifyCache(Mdl,
+                                          KernelMode,
+                                          MmCached,
+                                          NULL,
+                                          FALSE,
+                                          NormalPagePriority);
+    if (Buffer == NULL)
+    {
+        return FALSE;
+    }
+
+    RtlCopyMemory(Buffer + PAGE_SIZE, Buffer, PAGE_SIZE);
+    MmUnmapLockedPages(Buffer, Mdl);
+    return TRUE;
+}
+
 VOID
 NTAPI
 MmBuildMdlFromPages(PMDL Mdl, PPFN_NUMBER Pages)
@@ -238,6 +400,9 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
         return(STATUS_UNSUCCESSFUL);
     }
 
+    /* Whatever was kept for this slot is about to become stale */
+    MiDropStandbySwapPage(SwapEntry);
+
     i = FILE_FROM_ENTRY(SwapEntry);
     offset = OFFSET_FROM_ENTRY(SwapEntry) - 1;
 
@@ -277,8 +442,30 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
 
 NTSTATUS
 NTAPI
-MmReadFromSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+MmReadFromSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page, PMMSUPPORT AddressSpace)
 {
+    PMM_STANDBY_SWAP_PAGE Standby;
+    BOOLEAN Copied;
+
+    /* Try the pages trimmed earlier before going to the disk */
+    Standby = MiRemoveStandbySwapPage(SwapEntry);
+    if (Standby != NULL)
+    {
+        Copied = MiCopyStandbySwapPage(Standby->Page, Page);
+        MmReleasePageMemoryConsumer(MC_USER, Standby->Page);
+        ExFreeToNPagedLookasideList(&MiStandbySwapLookasideList, Standby);
+        if (Copied)
+        {
+            InterlockedIncrement((PLONG)&MiStandbySwapHitCount);
+            return STATUS_SUCCESS;
+        }
+    }
+
+    if (AddressSpace)
+    {
+        /* The faulting thread has to wait for the disk */
+        MmNoteHardFault(AddressSpace);
+    }
     return MiReadPageFile(Page, FILE_FROM_ENTRY(SwapEntry), OFFSET_FROM_ENTRY(SwapEntry) - 1);
 }
 
@@ -358,6 +545,21 @@ MmInitPagingFile(VOID)
         PagingFileList[i] = NULL;
     }
     MmNumberOfPagingFiles = 0;
+
+    KeInitializeSpinLock(&MiStandbySwapLock);
+    InitializeListHead(&MiStandbySwapListHead);
+    for (i = 0; i < MI_STANDBY_SWAP_BUCKETS; i++)
+    {
+        InitializeListHead(&MiStandbySwapHash[i]);
+    }
+    MiStandbySwapPages = 0;
+    ExInitializeNPagedLookasideList(&MiStandbySwapLookasideList,
+                                    NULL,
+                                    NULL,
+                                    0,
+                                    sizeof(MM_STANDBY_SWAP_PAGE),
+                                    TAG_MM_STANDBY,
+                                    50);
 }
 
 static ULONG
@@ -398,6 +600,9 @@ MmFreeSwapPage(SWAPENTRY Entry)
     i = FILE_FROM_ENTRY(Entry);
     off = OFFSET_FROM_ENTRY(Entry) - 1;
 
+    /* The slot can be handed out again, so its standby copy must go first */
+    MiDropStandbySwapPage(Entry);
+
     KeAcquireSpinLock(&PagingFileListLock, &oldIrql);
     if (PagingFileList[i] == NULL)
     {
@@ -262,6 +262,51 @@ MmIsDirtyPageRmap(PFN_NUMBER Page)
     return(FALSE);
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedRmaps(PFN_NUMBER Page)
+{
+    PMM_RMAP_ENTRY current_entry;
+    BOOLEAN Accessed = FALSE;
+
+    ExAcquireFastMutex(&RmapListLock);
+    current_entry = MmGetRmapListHeadPage(Page);
+    while (current_entry != NULL)
+    {
+        /* Every mapping must be cleared, so don't stop at the first hit */
+        if (!RMAP_IS_SEGMENT(current_entry->Address) &&
+            MmTestAndClearAccessedPage(current_entry->Process, current_entry->Address))
+        {
+            Accessed = TRUE;
+        }
+        current_entry = current_entry->Next;
+    }
+    ExReleaseFastMutex(&RmapListLock);
+    return Accessed;
+}
+
+ULONG
+NTAPI
+MmGetRmapCountForProcess(PFN_NUMBER Page, PEPROCESS Process)
+{
+    PMM_RMAP_ENTRY current_entry;
+    ULONG Count = 0;
+
+    ExAcquireFastMutex(&RmapListLock);
+    current_entry = MmGetRmapListHeadPage(Page);
+    while (current_entry != NULL)
+    {
+        if (!RMAP_IS_SEGMENT(current_entry->Address) &&
+            current_entry->Process == Process)
+        {
+            Count++;
+        }
+        current_entry = current_entry->Next;
+    }
+    ExReleaseFastMutex(&RmapListLock);
+    return Count;
+}
+
 VOID
 NTAPI
 MmInsertRmap(PFN_NUMBER Page, PEPROCESS Process,
@@ -137,6 +137,20 @@ POBJECT_TYPE MmSectionObjectType = NULL;
 
 ULONG_PTR MmSubsectionBase;
 
+/*
+ * Fault clustering: when a page of a file or image view has to be read in,
+ * the free pages around it, up to this many in total, are brought in and
+ * mapped by the same fault. 0 or 1 turns it off.
+ */
+ULONG MmCodeClusterSize = 16;
+ULONG MmDataClusterSize = 8;
+#define MI_MAX_FAULT_CLUSTER 32
+
+/* In-page statistics, reported through SystemPerformanceInformation */
+ULONG MmSectionReadIoCount;         /* reads sent to the file system */
+ULONG MmSectionReadPageCount;       /* pages brought in by those reads */
+ULONG MmSectionPrefetchHitCount;    /* pages read in ahead that were then used */
+
 static ULONG SectionCharacteristicsToProtect[16] =
 {
     PAGE_NOACCESS,          /* 0 = NONE */
@@ -1062,17 +1076,60 @@ MiCopyFromUserPage(PFN_NUMBER DestPage, PFN_NUMBER SrcPage)
 }
 
 #ifndef NEWCC
+static
+NTSTATUS
+MiReadSectionVacb(PROS_SHARED_CACHE_MAP SharedCacheMap,
+                  PROS_VACB Vacb,
+                  BOOLEAN UptoDate,
+                  PMMSUPPORT AddressSpace)
+{
+    NTSTATUS Status;
+    LONGLONG Length;
+
+    if (UptoDate)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    /*
+     * If the VACB isn't up to date then call the file
+     * system to read in the data.
+     */
+    Status = CcReadVirtualAddress(Vacb);
+    if (!NT_SUCCESS(Status))
+    {
+        CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
+        return Status;
+    }
+
+    /* CcReadVirtualAddress reads the whole view in one go */
+    Length = SharedCacheMap->SectionSize.QuadPart - Vacb->FileOffset.QuadPart;
+    Length = MIN(Length, VACB_MAPPING_GRANULARITY);
+    InterlockedIncrement((PLONG)&MmSectionReadIoCount);
+    InterlockedExchangeAdd((PLONG)&MmSectionReadPageCount, (LONG)BYTES_TO_PAGES(Length));
+    if (AddressSpace)
+    {
+        /* The faulting thread had to wait for the disk */
+        MmNoteHardFault(AddressSpace);
+    }
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS
 NTAPI
 MiReadPage(PMEMORY_AREA MemoryArea,
            LONGLONG SegOffset,
-           PPFN_NUMBER Page)
+           PPFN_NUMBER Page,
+           PMMSUPPORT AddressSpace)
 /*
  * FUNCTION: Read a page for a section backed memory area.
  * PARAMETERS:
  *       MemoryArea - Memory area to read the page for.
  *       Offset - Offset of the page to read.
  *       Page - Variable that receives a page contains the read data.
+ *       AddressSpace - Faulting address space, charged with a hard fault
+ *                      if the data has to be read. NULL if the page is
+ *                      read along with a neighbouring faulting one.
  */
 {
     LONGLONG BaseOffset;
@@ -1122,18 +1179,10 @@ MiReadPage(PMEMORY_AREA MemoryArea,
         {
             return(Status);
         }
-        if (!UptoDate)
+        Status = MiReadSectionVacb(SharedCacheMap, Vacb, UptoDate, AddressSpace);
+        if (!NT_SUCCESS(Status))
         {
-            /*
-             * If the VACB isn't up to date then call the file
-             * system to read in the data.
-             */
-            Status = CcReadVirtualAddress(Vacb);
-            if (!NT_SUCCESS(Status))
-            {
-                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
-                return Status;
-            }
+            return Status;
         }
 
         /* Probe the page, since it's PDE might not be synced */
@@ -1175,18 +1224,10 @@ MiReadPage(PMEMORY_AREA MemoryArea,
         {
             return(Status);
         }
-        if (!UptoDate)
+        Status = MiReadSectionVacb(SharedCacheMap, Vacb, UptoDate, AddressSpace);
+        if (!NT_SUCCESS(Status))
         {
-            /*
-             * If the VACB isn't up to date then call the file
-             * system to read in the data.
-             */
-            Status = CcReadVirtualAddress(Vacb);
-            if (!NT_SUCCESS(Status))
-            {
-                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
-                return Status;
-            }
+            return Status;
         }
 
         Process = PsGetCurrentProcess();
@@ -1216,18 +1257,10 @@ MiReadPage(PMEMORY_AREA MemoryArea,
             {
                 return(Status);
             }
-            if (!UptoDate)
+            Status = MiReadSectionVacb(SharedCacheMap, Vacb, UptoDate, NULL);
+            if (!NT_SUCCESS(Status))
             {
-                /*
-                 * If the VACB isn't up to date then call the file
-                 * system to read in the data.
-                 */
-                Status = CcReadVirtualAddress(Vacb);
-                if (!NT_SUCCESS(Status))
-                {
-                    CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
-                    return Status;
-                }
+                return Status;
             }
             PageAddr = MiMapPageInHyperSpace(Process, *Page, &Irql);
             if (Length < PAGE_SIZE)
@@ -1249,18 +1282,24 @@ NTSTATUS
 NTAPI
 MiReadPage(PMEMORY_AREA MemoryArea,
            LONGLONG SegOffset,
-           PPFN_NUMBER Page)
+           PPFN_NUMBER Page,
+           PMMSUPPORT AddressSpace)
 /*
  * FUNCTION: Read a page for a section backed memory area.
  * PARAMETERS:
  *       MemoryArea - Memory area to read the page for.
  *       Offset - Offset of the page to read.
  *       Page - Variable that receives a page contains the read data.
+ *       AddressSpace - Faulting address space, charged with a hard fault
+ *                      if the data has to be read. NULL if the page is
+ *                      read along with a neighbouring faulting one.
  */
 {
     MM_REQUIRED_RESOURCES Resources;
     NTSTATUS Status;
 
+    UNREFERENCED_PARAMETER(AddressSpace);
+
     RtlZeroMemory(&Resources, sizeof(MM_REQUIRED_RESOURCES));
 
     Resources.Context = MemoryArea->Data.SectionData.Section->FileObject;
@@ -1277,6 +1316,204 @@ MiReadPage(PMEMORY_AREA MemoryArea,
 }
 #endif
 
+static
+VOID
+MiGetFaultCluster(PMEMORY_AREA MemoryArea,
+                  PVOID RegionBase,
+                  PMM_REGION Region,
+                  PVOID PAddress,
+                  LONGLONG SegOffset,
+                  PULONG_PTR ClusterStart,
+                  PULONG_PTR ClusterEnd)
+/*
+ * FUNCTION: Get the range of pages that can be brought in along with a
+ * faulting one: the aligned window of MmCodeClusterSize or MmDataClusterSize
+ * pages around it, clipped to the view, the region (so every page gets the
+ * same protection), the data of the segment and the cache view holding the
+ * faulting page, whose read brings in the whole window.
+ */
+{
+    PROS_SECTION_OBJECT Section = MemoryArea->Data.SectionData.Section;
+    PMM_SECTION_SEGMENT Segment = MemoryArea->Data.SectionData.Segment;
+    ULONG_PTR Address = (ULONG_PTR)PAddress;
+    ULONG_PTR RegionEnd;
+    ULONG ClusterSize;
+    ULONG Before, After;
+    LONGLONG Length;
+#ifndef NEWCC
+    LONGLONG CacheOffset;
+#endif
+
+    if (Section->AllocationAttributes & SEC_IMAGE)
+        ClusterSize = MmCodeClusterSize;
+    else
+        ClusterSize = MmDataClusterSize;
+    ClusterSize = MIN(ClusterSize, MI_MAX_FAULT_CLUSTER);
+    if (ClusterSize <= 1)
+    {
+        *ClusterStart = Address;
+        *ClusterEnd = Address + PAGE_SIZE;
+        return;
+    }
+
+    Before = (ULONG)((Address >> PAGE_SHIFT) % ClusterSize);
+    After = ClusterSize - 1 - Before;
+
+    /* Stay within the view and the region */
+    RegionEnd = (ULONG_PTR)RegionBase + Region->Length;
+    Before = (ULONG)MIN(Before, (Address - MA_GetStartingAddress(MemoryArea)) >> PAGE_SHIFT);
+    Before = (ULONG)MIN(Before, (Address - (ULONG_PTR)RegionBase) >> PAGE_SHIFT);
+    After = (ULONG)MIN(After, ((MA_GetEndingAddress(MemoryArea) - Address) >> PAGE_SHIFT) - 1);
+    After = (ULONG)MIN(After, ((RegionEnd - Address) >> PAGE_SHIFT) - 1);
+
+    /* Image pages past the raw data are zero filled, not read */
+    Length = (LONGLONG)PAGE_ROUND_UP(Segment->Length.QuadPart);
+    if (Section->AllocationAttributes & SEC_IMAGE)
+        Length = MIN(Length, (LONGLONG)PAGE_ROUND_UP(Segment->RawLength.QuadPart));
+    Length = (Length - SegOffset) >> PAGE_SHIFT;
+    After = (ULONG)MIN((LONGLONG)After, MAX(Length - 1, 0));
+
+#ifndef NEWCC
+    CacheOffset = (SegOffset + Segment->Image.FileOffset) % VACB_MAPPING_GRANULARITY;
+    Before = (ULONG)MIN(Before, CacheOffset >> PAGE_SHIFT);
+    After = (ULONG)MIN(After, (VACB_MAPPING_GRANULARITY - CacheOffset - 1) >> PAGE_SHIFT);
+#endif
+
+    *ClusterStart = Address - Before * PAGE_SIZE;
+    *ClusterEnd = Address + (After + 1) * PAGE_SIZE;
+}
+
+static
+BOOLEAN
+MiClaimClusterPage(PEPROCESS Process,
+                   PMEMORY_AREA MemoryArea,
+                   PVOID Address)
+/*
+ * FUNCTION: Mark the section offset of a neighbour of a faulting page as
+ * being read in, if there is nothing at its address and offset yet. Both
+ * the address space and the segment must be locked; the caller creates the
+ * wait entry in the page table once the segment is unlocked.
+ */
+{
+    PMM_SECTION_SEGMENT Segment = MemoryArea->Data.SectionData.Segment;
+    LARGE_INTEGER Offset;
+
+    if (MmIsPagePresent(Process, Address) ||
+            MmIsPageSwapEntry(Process, Address) ||
+            MmIsDisabledPage(Process, Address))
+    {
+        return FALSE;
+    }
+
+    Offset.QuadPart = (ULONG_PTR)Address - MA_GetStartingAddress(MemoryArea)
+                      + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+    if (MmGetPageEntrySectionSegment(Segment, &Offset) != 0)
+    {
+        return FALSE;
+    }
+
+    MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SWAP_SSE(MM_WAIT_ENTRY));
+    return TRUE;
+}
+
+static
+VOID
+MiFinishClusterPage(PEPROCESS Process,
+                    PMEMORY_AREA MemoryArea,
+                    PVOID Address,
+                    ULONG Attributes,
+                    PFN_NUMBER Page)
+/*
+ * FUNCTION: Map a page read in along with a faulting one, or drop the
+ * claim on it if it couldn't be read (Page is 0). Both the address space
+ * and the segment must be locked.
+ */
+{
+    PMM_SECTION_SEGMENT Segment = MemoryArea->Data.SectionData.Segment;
+    LARGE_INTEGER Offset;
+    SWAPENTRY FakeSwapEntry;
+    NTSTATUS Status;
+
+    Offset.QuadPart = (ULONG_PTR)Address - MA_GetStartingAddress(MemoryArea)
+                      + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+
+    MmDeletePageFileMapping(Process, Address, &FakeSwapEntry);
+    if (Page == 0)
+    {
+        MmSetPageEntrySectionSegment(Segment, &Offset, 0);
+        return;
+    }
+
+    Status = MmCreateVirtualMapping(Process,
+                                    Address,
+                                    Attributes,
+                                    &Page,
+                                    1);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Unable to create virtual mapping\n");
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
+    MmInsertRmap(Page, Process, Address);
+    MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SSE(Page << PAGE_SHIFT, 1));
+
+    /* Nobody asked for this page yet, see whether somebody does */
+    MmMarkPrefetchedPage(Page);
+}
+
+static
+VOID
+MiMapResidentNeighbours(PEPROCESS Process,
+                        PMEMORY_AREA MemoryArea,
+                        ULONG_PTR ClusterStart,
+                        ULONG_PTR ClusterEnd,
+                        ULONG Attributes)
+/*
+ * FUNCTION: Map the pages of a fault cluster which are already backed by a
+ * page in the segment but not mapped here yet, saving a fault on each of
+ * them. Both the address space and the segment must be locked.
+ */
+{
+    PMM_SECTION_SEGMENT Segment = MemoryArea->Data.SectionData.Segment;
+    LARGE_INTEGER Offset;
+    ULONG_PTR Address;
+    ULONG_PTR Entry;
+    PFN_NUMBER Page;
+    NTSTATUS Status;
+
+    for (Address = ClusterStart; Address < ClusterEnd; Address += PAGE_SIZE)
+    {
+        if (MmIsPagePresent(Process, (PVOID)Address) ||
+                MmIsPageSwapEntry(Process, (PVOID)Address) ||
+                MmIsDisabledPage(Process, (PVOID)Address))
+        {
+            continue;
+        }
+
+        Offset.QuadPart = Address - MA_GetStartingAddress(MemoryArea)
+                          + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+        Entry = MmGetPageEntrySectionSegment(Segment, &Offset);
+        if (Entry == 0 || IS_SWAP_FROM_SSE(Entry) ||
+                SHARE_COUNT_FROM_SSE(Entry) == MAX_SHARE_COUNT)
+        {
+            continue;
+        }
+
+        Page = PFN_FROM_SSE(Entry);
+        Status = MmCreateVirtualMapping(Process,
+                                        (PVOID)Address,
+                                        Attributes,
+                                        &Page,
+                                        1);
+        if (!NT_SUCCESS(Status))
+        {
+            break;
+        }
+        MmInsertRmap(Page, Process, (PVOID)Address);
+        MmSharePageEntrySectionSegment(Segment, &Offset);
+    }
+}
+
 NTSTATUS
 NTAPI
 MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
@@ -1293,10 +1530,13 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     ULONG_PTR Entry1;
     ULONG Attributes;
     PMM_REGION Region;
+    PVOID RegionBase;
     BOOLEAN HasSwapEntry;
     PVOID PAddress;
     PEPROCESS Process = MmGetAddressSpaceOwner(AddressSpace);
     SWAPENTRY SwapEntry;
+    ULONG_PTR ClusterStart;
+    ULONG_PTR ClusterEnd;
 
     /*
      * There is a window between taking the page fault and locking the
@@ -1329,7 +1569,7 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     Section = MemoryArea->Data.SectionData.Section;
     Region = MmFindRegion((PVOID)MA_GetStartingAddress(MemoryArea),
                           &MemoryArea->Data.SectionData.RegionListHead,
-                          Address, NULL);
+                          Address, &RegionBase);
     ASSERT(Region != NULL);
     /*
      * Lock the segment
@@ -1419,7 +1659,7 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
 
         if (HasSwapEntry)
         {
-            Status = MmReadFromSwapPage(SwapEntry, Page);
+            Status = MmReadFromSwapPage(SwapEntry, Page, AddressSpace);
             if (!NT_SUCCESS(Status))
             {
                 DPRINT1("MmReadFromSwapPage failed, status = %x\n", Status);
@@ -1497,23 +1737,58 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     if (Entry == 0)
     {
         SWAPENTRY FakeSwapEntry;
+        BOOLEAN ZeroFill;
+        ULONG_PTR ClusterFirst;
+        ULONG_PTR ClusterLast;
+        ULONG_PTR ClusterAddress;
+        PFN_NUMBER ClusterPages[MI_MAX_FAULT_CLUSTER];
+        LARGE_INTEGER ClusterOffset;
+        ULONG i;
 
         /*
          * If the entry is zero (and it can't change because we have
          * locked the segment) then we need to load the page.
          */
+        ZeroFill = (Segment->Flags & MM_PAGEFILE_SEGMENT) ||
+                   ((Offset.QuadPart >= (LONGLONG)PAGE_ROUND_UP(Segment->RawLength.QuadPart) &&
+                     (Section->AllocationAttributes & SEC_IMAGE)));
 
         /*
-         * Release all our locks and read in the page from disk
+         * Claim the free pages next to this one, so that they are read in
+         * and mapped along with it.
          */
         MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SWAP_SSE(MM_WAIT_ENTRY));
+        ClusterStart = ClusterFirst = (ULONG_PTR)PAddress;
+        ClusterEnd = ClusterLast = (ULONG_PTR)PAddress;
+        if (!ZeroFill)
+        {
+            MiGetFaultCluster(MemoryArea, RegionBase, Region, PAddress,
+                              Offset.QuadPart, &ClusterStart, &ClusterEnd);
+            while (ClusterFirst > ClusterStart &&
+                   MiClaimClusterPage(Process, MemoryArea, (PVOID)(ClusterFirst - PAGE_SIZE)))
+            {
+                ClusterFirst -= PAGE_SIZE;
+            }
+            while (ClusterLast + PAGE_SIZE < ClusterEnd &&
+                   MiClaimClusterPage(Process, MemoryArea, (PVOID)(ClusterLast + PAGE_SIZE)))
+            {
+                ClusterLast += PAGE_SIZE;
+            }
+        }
+
+        /*
+         * Release all our locks and read in the page from disk
+         */
         MmUnlockSectionSegment(Segment);
-        MmCreatePageFileMapping(Process, PAddress, MM_WAIT_ENTRY);
+        for (ClusterAddress = ClusterFirst;
+             ClusterAddress <= ClusterLast;
+             ClusterAddress += PAGE_SIZE)
+        {
+            MmCreatePageFileMapping(Process, (PVOID)ClusterAddress, MM_WAIT_ENTRY);
+        }
         MmUnlockAddressSpace(AddressSpace);
 
-        if ((Segment->Flags & MM_PAGEFILE_SEGMENT) ||
-                ((Offset.QuadPart >= (LONGLONG)PAGE_ROUND_UP(Segment->RawLength.QuadPart) &&
-                  (Section->AllocationAttributes & SEC_IMAGE))))
+        if (ZeroFill)
         {
             MI_SET_USAGE(MI_USAGE_SECTION);
             if (Process) MI_SET_PROCESS2(Process->ImageFileName);
@@ -1527,12 +1802,45 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         }
         else
         {
-            Status = MiReadPage(MemoryArea, Offset.QuadPart, &Page);
+            Status = MiReadPage(MemoryArea, Offset.QuadPart, &Page, AddressSpace);
             if (!NT_SUCCESS(Status))
             {
                 DPRINT1("MiReadPage failed (Status %x)\n", Status);
             }
         }
+
+        /* The neighbours come from the same cache view, failing to read them is not fatal */
+        for (ClusterAddress = ClusterFirst, i = 0;
+             ClusterAddress <= ClusterLast;
+             ClusterAddress += PAGE_SIZE, i++)
+        {
+            ClusterPages[i] = 0;
+            if (ClusterAddress == (ULONG_PTR)PAddress || !NT_SUCCESS(Status))
+                continue;
+
+            ClusterOffset.QuadPart = ClusterAddress - MA_GetStartingAddress(MemoryArea)
+                                     + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+            if (!NT_SUCCESS(MiReadPage(MemoryArea, ClusterOffset.QuadPart, &ClusterPages[i], NULL)))
+            {
+                ClusterPages[i] = 0;
+            }
+        }
+
+        /* Lock both segment and process address space while we proceed. */
+        MmLockAddressSpace(AddressSpace);
+        MmLockSectionSegment(Segment);
+
+        for (ClusterAddress = ClusterFirst, i = 0;
+             ClusterAddress <= ClusterLast;
+             ClusterAddress += PAGE_SIZE, i++)
+        {
+            if (ClusterAddress != (ULONG_PTR)PAddress)
+            {
+                MiFinishClusterPage(Process, MemoryArea, (PVOID)ClusterAddress,
+                                    Attributes, ClusterPages[i]);
+            }
+        }
+
         if (!NT_SUCCESS(Status))
         {
             /*
@@ -1541,16 +1849,12 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
             /*
              * Cleanup and release locks
              */
-            MmLockAddressSpace(AddressSpace);
+            MmUnlockSectionSegment(Segment);
             MiSetPageEvent(Process, Address);
             DPRINT("Address 0x%p\n", Address);
             return(Status);
         }
 
-        /* Lock both segment and process address space while we proceed. */
-        MmLockAddressSpace(AddressSpace);
-        MmLockSectionSegment(Segment);
-
         MmDeletePageFileMapping(Process, PAddress, &FakeSwapEntry);
         DPRINT("CreateVirtualMapping Page %x Process %p PAddress %p Attributes %x\n",
                Page, Process, PAddress, Attributes);
@@ -1570,6 +1874,9 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         /* Set this section offset has being backed by our new page. */
         Entry = MAKE_SSE(Page << PAGE_SHIFT, 1);
         MmSetPageEntrySectionSegment(Segment, &Offset, Entry);
+
+        /* And pick up the pages of the cluster that were already resident */
+        MiMapResidentNeighbours(Process, MemoryArea, ClusterStart, ClusterEnd, Attributes);
         MmUnlockSectionSegment(Segment);
 
         MiSetPageEvent(Process, Address);
@@ -1607,7 +1914,7 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
             KeBugCheck(MEMORY_MANAGEMENT);
         }
 
-        Status = MmReadFromSwapPage(SwapEntry, Page);
+        Status = MmReadFromSwapPage(SwapEntry, Page, AddressSpace);
         if (!NT_SUCCESS(Status))
         {
             KeBugCheck(MEMORY_MANAGEMENT);
@@ -1676,9 +1983,15 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
             KeBugCheck(MEMORY_MANAGEMENT);
         }
         MmInsertRmap(Page, Process, Address);
+        MmNotePageUsed(Page);
 
         /* Take a reference on it */
         MmSharePageEntrySectionSegment(Segment, &Offset);
+
+        /* Map its resident neighbours while we are at it */
+        MiGetFaultCluster(MemoryArea, RegionBase, Region, PAddress,
+                          Offset.QuadPart, &ClusterStart, &ClusterEnd);
+        MiMapResidentNeighbours(Process, MemoryArea, ClusterStart, ClusterEnd, Attributes);
         MmUnlockSectionSegment(Segment);
 
         MiSetPageEvent(Process, Address);
@@ -2027,10 +2340,11 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
         if (!Context.WasDirty && SwapEntry != 0)
         {
             MmSetSavedSwapEntryPage(Page, 0);
+            /* The pagefile already holds this data, keep the page around for a soft fault */
+            MmInsertStandbySwapPage(SwapEntry, Page);
             MmLockSectionSegment(Context.Segment);
             MmSetPageEntrySectionSegment(Context.Segment, &Context.Offset, MAKE_SWAP_SSE(SwapEntry));
             MmUnlockSectionSegment(Context.Segment);
-            MmReleasePageMemoryConsumer(MC_USER, Page);
             MiSetPageEvent(NULL, NULL);
             return(STATUS_SUCCESS);
         }
@@ -2046,13 +2360,20 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
         if (!Context.WasDirty || SwapEntry != 0)
         {
             MmSetSavedSwapEntryPage(Page, 0);
+            if (SwapEntry != 0 && !Context.WasDirty)
+            {
+                MmInsertStandbySwapPage(SwapEntry, Page);
+            }
+            else
+            {
+                MmReleasePageMemoryConsumer(MC_USER, Page);
+            }
             if (SwapEntry != 0)
             {
                 MmLockSectionSegment(Context.Segment);
                 MmSetPageEntrySectionSegment(Context.Segment, &Context.Offset, MAKE_SWAP_SSE(SwapEntry));
                 MmUnlockSectionSegment(Context.Segment);
             }
-            MmReleasePageMemoryConsumer(MC_USER, Page);
             MiSetPageEvent(NULL, NULL);
             return(STATUS_SUCCESS);
         }
@@ -2096,6 +2417,7 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
     {
         DPRINT("Not dirty and private and not swapped (%p:%p)\n", Process, Address);
         MmSetSavedSwapEntryPage(Page, 0);
+        MmInsertStandbySwapPage(SwapEntry, Page);
         MmLockAddressSpace(AddressSpace);
         Status = MmCreatePageFileMapping(Process,
                                          Address,
@@ -2106,7 +2428,6 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
             DPRINT1("Status %x Swapping out %p:%p\n", Status, Process, Address);
             KeBugCheckEx(MEMORY_MANAGEMENT, Status, (ULONG_PTR)Process, (ULONG_PTR)Address, SwapEntry);
         }
-        MmReleasePageMemoryConsumer(MC_USER, Page);
         MiSetPageEvent(NULL, NULL);
         return(STATUS_SUCCESS);
     }
@@ -2229,7 +2550,8 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
     }
     else
     {
-        MmReleasePageMemoryConsumer(MC_USER, Page);
+        /* The page matches what we just wrote, a later fault can take it back */
+        MmInsertStandbySwapPage(SwapEntry, Page);
     }
 
     if (Context.Private)
@@ -1424,6 +1424,7 @@
 @ stdcall ZwCreateDirectoryObject(ptr long ptr)
 @ stdcall ZwCreateEvent(ptr long ptr long long)
 @ stdcall ZwCreateFile(ptr long ptr ptr ptr long long long long ptr long)
+@ stdcall ZwCreateIoCompletion(ptr long ptr long)
 @ stdcall ZwCreateJobObject(ptr long ptr)
 @ stdcall ZwCreateKey(ptr long ptr long ptr long ptr)
 @ stdcall ZwCreateSection(ptr long ptr ptr long long ptr)
@@ -1496,6 +1497,8 @@
 @ stdcall ZwQueryValueKey(ptr ptr long ptr long ptr)
 @ stdcall ZwQueryVolumeInformationFile(ptr ptr ptr long long)
 @ stdcall ZwReadFile(ptr ptr ptr ptr ptr ptr long ptr ptr)
+@ stdcall ZwRemoveIoCompletion(ptr ptr ptr ptr ptr)
+@ stdcall ZwRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 @ stdcall ZwReplaceKey(ptr ptr ptr)
 @ stdcall ZwRequestWaitReplyPort(ptr ptr ptr)
 @ stdcall ZwResetEvent(ptr ptr)
@@ -1515,6 +1518,7 @@
 @ stdcall ZwSetInformationObject(ptr long ptr long)
 @ stdcall ZwSetInformationProcess(ptr long ptr long)
 @ stdcall ZwSetInformationThread(ptr long ptr long)
+@ stdcall ZwSetIoCompletion(ptr ptr ptr long long)
 @ stdcall ZwSetSecurityObject(ptr long ptr)
 @ stdcall ZwSetSystemInformation(long ptr long)
 @ stdcall ZwSetSystemTime(ptr ptr)
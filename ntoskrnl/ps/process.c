@@ -452,11 +452,15 @@ PspCreateProcess(OUT PHANDLE ProcessHandle,
         Process->InheritedFromUniqueProcessId = Parent->UniqueProcessId;
         Process->DefaultHardErrorProcessing = Parent->
                                               DefaultHardErrorProcessing;
+
+        /* Inherit the page priority */
+        Process->Vm.Flags.PagePriority = Parent->Vm.Flags.PagePriority;
     }
     else
     {
-        /* Use default hard error processing */
+        /* Use default hard error processing and page priority */
         Process->DefaultHardErrorProcessing = TRUE;
+        Process->Vm.Flags.PagePriority = MM_DEFAULT_PAGE_PRIORITY;
     }
 
     /* Check for a section handle */
@@ -495,6 +495,9 @@ PspInitPhase0(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
     /* Clear kernel time */
     PsIdleProcess->Pcb.KernelTime = 0;
 
+    /* Pages allocated during boot go to the default standby list */
+    PsIdleProcess->Vm.Flags.PagePriority = MM_DEFAULT_PAGE_PRIORITY;
+
     /* Initialize Object Initializer */
     RtlZeroMemory(&ObjectTypeInitializer, sizeof(ObjectTypeInitializer));
     ObjectTypeInitializer.Length = sizeof(ObjectTypeInitializer);
@@ -76,6 +76,7 @@ NtQueryInformationProcess(IN HANDLE ProcessHandle,
     PIO_COUNTERS IoCounters = (PIO_COUNTERS)ProcessInformation;
     PQUOTA_LIMITS QuotaLimits = (PQUOTA_LIMITS)ProcessInformation;
     PROCESS_DEVICEMAP_INFORMATION DeviceMap;
+    PROCESS_WS_AGING_INFORMATION WsAging;
     PUNICODE_STRING ImageName;
     ULONG Cookie, ExecuteOptions = 0;
     ULONG_PTR Wow64 = 0;
@@ -775,6 +776,44 @@ NtQueryInformationProcess(IN HANDLE ProcessHandle,
             ObDereferenceObject(Process);
             break;
 
+        /* Standby list priority of the pages the process faults in */
+        case ProcessPagePriority:
+
+            if (ProcessInformationLength != sizeof(ULONG))
+            {
+                Status = STATUS_INFO_LENGTH_MISMATCH;
+                break;
+            }
+
+            /* Set the return length */
+            Length = sizeof(ULONG);
+
+            /* Reference the process */
+            Status = ObReferenceObjectByHandle(ProcessHandle,
+                                               PROCESS_QUERY_INFORMATION,
+                                               PsProcessType,
+                                               PreviousMode,
+                                               (PVOID*)&Process,
+                                               NULL);
+            if (!NT_SUCCESS(Status)) break;
+
+            /* Enter SEH for writing back data */
+            _SEH2_TRY
+            {
+                /* Return the page priority */
+                *(PULONG)ProcessInformation = Process->Vm.Flags.PagePriority;
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                /* Get the exception code */
+                Status = _SEH2_GetExceptionCode();
+            }
+            _SEH2_END;
+
+            /* Dereference the process */
+            ObDereferenceObject(Process);
+            break;
+
         /* Per-process security cookie */
         case ProcessCookie:
 
@@ -1043,6 +1082,48 @@ NtQueryInformationProcess(IN HANDLE ProcessHandle,
             }
             break;
 
+        /* Working set size, page age histogram and fault counts */
+        case ProcessWorkingSetAging:
+
+            if (ProcessInformationLength != sizeof(PROCESS_WS_AGING_INFORMATION))
+            {
+                Status = STATUS_INFO_LENGTH_MISMATCH;
+                break;
+            }
+
+            /* Reference the process */
+            Status = ObReferenceObjectByHandle(ProcessHandle,
+                                               PROCESS_QUERY_INFORMATION,
+                                               PsProcessType,
+                                               PreviousMode,
+                                               (PVOID*)&Process,
+                                               NULL);
+            if (!NT_SUCCESS(Status)) break;
+
+            /* Let Mm walk the user pages outside of SEH */
+            Status = MmQueryWorkingSetAging(Process, &WsAging);
+            if (NT_SUCCESS(Status))
+            {
+                /* Enter SEH for write safety */
+                _SEH2_TRY
+                {
+                    *(PPROCESS_WS_AGING_INFORMATION)ProcessInformation = WsAging;
+
+                    /* Set the return length */
+                    Length = sizeof(PROCESS_WS_AGING_INFORMATION);
+                }
+                _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+                {
+                    /* Get the exception code */
+                    Status = _SEH2_GetExceptionCode();
+                }
+                _SEH2_END;
+            }
+
+            /* Dereference the process */
+            ObDereferenceObject(Process);
+            break;
+
         case ProcessLdtInformation:
             DPRINT1("VDM/16-bit not implemented: %lx\n", ProcessInformationClass);
             Status = STATUS_NOT_IMPLEMENTED;
@@ -1108,6 +1189,7 @@ NtSetInformationProcess(IN HANDLE ProcessHandle,
     ULONG DefaultHardErrorMode = 0;
     ULONG DebugFlags = 0, EnableFixup = 0, Boost = 0;
     ULONG NoExecute = 0, VdmPower = 0;
+    ULONG PagePriority = 0;
     BOOLEAN HasPrivilege;
     PLIST_ENTRY Next;
     PETHREAD Thread;
@@ -1659,6 +1741,47 @@ NtSetInformationProcess(IN HANDLE ProcessHandle,
 
             break;
 
+        case ProcessPagePriority:
+
+            /* Check buffer length */
+            if (ProcessInformationLength != sizeof(ULONG))
+            {
+                Status = STATUS_INFO_LENGTH_MISMATCH;
+                break;
+            }
+
+            /* Enter SEH for direct buffer read */
+            _SEH2_TRY
+            {
+                PagePriority = *(PULONG)ProcessInformation;
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                /* Get exception code */
+                Status = _SEH2_GetExceptionCode();
+                _SEH2_YIELD(break);
+            }
+            _SEH2_END;
+
+            /* Validate it */
+            if (PagePriority > MM_HIGHEST_PAGE_PRIORITY)
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            /* Raising it above the default requires SeIncreaseBasePriorityPrivilege */
+            if ((PagePriority > MM_DEFAULT_PAGE_PRIORITY) &&
+                !(SeSinglePrivilegeCheck(SeIncreaseBasePriorityPrivilege, PreviousMode)))
+            {
+                Status = STATUS_PRIVILEGE_NOT_HELD;
+                break;
+            }
+
+            /* New pages of this process go to the matching standby list */
+            Process->Vm.Flags.PagePriority = PagePriority;
+            break;
+
         case ProcessAffinityMask:
 
             /* Check buffer length */
@@ -887,7 +887,8 @@ typedef struct _MMSUPPORT_FLAGS
     ULONG MemoryPriority:8;
     ULONG GrowWsleHash:1;
     ULONG AcquiredUnsafe:1;
-    ULONG Available:14;
+    ULONG PagePriority:3; // ReactOS specific: standby list of new pages
+    ULONG Available:11;
 } MMSUPPORT_FLAGS, *PMMSUPPORT_FLAGS;
 
 //
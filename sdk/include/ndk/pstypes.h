@@ -363,7 +363,12 @@ typedef enum _PROCESSINFOCLASS
     ProcessImageFileMapping,
     ProcessAffinityUpdateMode,
     ProcessMemoryAllocationMode,
-    MaxProcessInfoClass
+    MaxProcessInfoClass,
+
+    //
+    // ReactOS specific classes, kept clear of the ones newer Windows adds
+    //
+    ProcessWorkingSetAging = 0x1000
 } PROCESSINFOCLASS;
 
 typedef enum _THREADINFOCLASS
@@ -914,6 +919,20 @@ typedef struct _PROCESS_FOREGROUND_BACKGROUND
     BOOLEAN Foreground;
 } PROCESS_FOREGROUND_BACKGROUND, *PPROCESS_FOREGROUND_BACKGROUND;
 
+//
+// Working set aging information (ReactOS specific)
+//
+#define PROCESS_WS_AGE_BUCKETS 8
+
+typedef struct _PROCESS_WS_AGING_INFORMATION
+{
+    SIZE_T WorkingSetSize;
+    SIZE_T PeakWorkingSetSize;
+    ULONG SoftFaultCount;
+    ULONG HardFaultCount;
+    ULONG AgeHistogram[PROCESS_WS_AGE_BUCKETS];
+} PROCESS_WS_AGING_INFORMATION, *PPROCESS_WS_AGING_INFORMATION;
+
 //
 // Apphelp SHIM Cache
 //
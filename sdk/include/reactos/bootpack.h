@@ -0,0 +1,52 @@
+/*
+ * PROJECT:     ReactOS Boot Loader
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Boot pack format: a compressed container of the files
+ *              FreeLoader needs to start the system (kernel, HAL, boot
+ *              drivers, SYSTEM hive, NLS tables), read in one piece.
+ */
+
+#ifndef _BOOTPACK_H_
+#define _BOOTPACK_H_
+
+/*
+ * Layout of the file:
+ *
+ *   BOOT_PACK_HEADER
+ *   BOOT_PACK_ENTRY[EntryCount]
+ *   zlib stream of CompressedSize bytes, inflating to UncompressedSize
+ *   bytes holding the contents of all the files, one after the other.
+ *
+ * All fields are little-endian.
+ */
+
+#define BOOT_PACK_FILE_NAME     "bootpack.img"
+
+#define BOOT_PACK_SIGNATURE     0x4B504252  /* "RBPK" */
+#define BOOT_PACK_VERSION       1
+
+#define BOOT_PACK_FLAG_CRC32    0x00000001  /* Crc32 is valid and must be checked */
+
+#define BOOT_PACK_MAX_NAME      64
+
+typedef struct _BOOT_PACK_HEADER
+{
+    ULONG Signature;
+    ULONG Version;
+    ULONG Flags;
+    ULONG EntryCount;
+    ULONG UncompressedSize;
+    ULONG CompressedSize;
+    ULONG Crc32;                    /* CRC-32 of the uncompressed data */
+    ULONG Reserved;
+} BOOT_PACK_HEADER, *PBOOT_PACK_HEADER;
+
+typedef struct _BOOT_PACK_ENTRY
+{
+    ULONG Offset;                   /* In the uncompressed data */
+    ULONG Size;
+    CHAR Name[BOOT_PACK_MAX_NAME];  /* Relative to the directory of the pack,
+                                       '\\'-separated, NUL-terminated */
+} BOOT_PACK_ENTRY, *PBOOT_PACK_ENTRY;
+
+#endif /* _BOOTPACK_H_ */
@@ -0,0 +1,65 @@
+/*
+ * PROJECT:     ReactOS Storage Stack
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Constants and types for querying the classpnp I/O scheduler
+ */
+
+#ifndef _NTDDIOSCHED_H_
+#define _NTDDIOSCHED_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// Returns a CLASS_IO_SCHEDULER_STATISTICS structure.
+// Can be sent to the disk or to any of its partitions.
+//
+#define IOCTL_CLASS_QUERY_IO_SCHEDULER_STATISTICS \
+  CTL_CODE(IOCTL_STORAGE_BASE, 0x0800, METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+//
+// Scheduling policies, selected by the "IoScheduler" value
+// in the Classpnp subkey of the device's hardware key.
+//
+#define CLASS_IO_SCHEDULER_NONE      0  // requests go straight to the port driver
+#define CLASS_IO_SCHEDULER_FIFO      1  // arrival order, with merging
+#define CLASS_IO_SCHEDULER_DEADLINE  2  // elevator order with deadlines and priorities (default)
+
+//
+// Priority classes, derived from the client irp
+//
+#define CLASS_IO_PRIORITY_HIGH       0  // paging reads, a thread waits for them
+#define CLASS_IO_PRIORITY_NORMAL     1
+#define CLASS_IO_PRIORITY_LOW        2  // asynchronous paging writes
+#define CLASS_IO_PRIORITY_CLASSES    3
+
+//
+// Bucket 0 counts requests that completed in less than 100us,
+// bucket n counts the ones that took [100us << (n - 1), 100us << n),
+// the last bucket counts everything slower.
+//
+#define CLASS_IO_LATENCY_BUCKETS     16
+#define CLASS_IO_LATENCY_BASE_US     100
+
+typedef struct _CLASS_IO_SCHEDULER_STATISTICS {
+  ULONG Version;                    // sizeof(CLASS_IO_SCHEDULER_STATISTICS)
+  ULONG Policy;
+  ULONG QueueDepth;                 // client requests waiting in the scheduler
+  ULONG PeakQueueDepth;
+  ULONG OutstandingCount;           // transfers sent to the port driver
+  ULONG MaxOutstanding;
+  ULONGLONG RequestCount;           // client requests received
+  ULONGLONG DispatchCount;          // transfers sent to the port driver
+  ULONGLONG BackMergeCount;
+  ULONGLONG FrontMergeCount;
+  ULONGLONG DeadlineExpiredCount;   // transfers sent out of order because their deadline passed
+  ULONGLONG PriorityRequestCount[CLASS_IO_PRIORITY_CLASSES];
+  ULONGLONG LatencyHistogram[CLASS_IO_LATENCY_BUCKETS];
+} CLASS_IO_SCHEDULER_STATISTICS, *PCLASS_IO_SCHEDULER_STATISTICS;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NTDDIOSCHED_H_ */
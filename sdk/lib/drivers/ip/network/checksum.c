@@ -36,24 +36,51 @@ ULONG ChecksumCompute(
  *     Seed  = Previously calculated checksum (if any)
  * RETURNS:
  *     Checksum of buffer
+ * NOTES:
+ *     32-bit words are summed into a 64-bit accumulator, which holds the
+ *     carries that a 16-bit sum would have to fold back immediately. Since
+ *     2^16 and 2^32 are both 1 modulo 0xFFFF, the result folds to the same
+ *     value as a word by word sum.
  */
 {
-  register ULONG Sum = Seed;
+  ULONG64 Sum = Seed;
+  PUCHAR Buffer = Data;
 
-  while (Count > 1)
+  while (Count >= 8 * sizeof(ULONG))
     {
-      Sum += *(PUSHORT)Data;
-      Count -= 2;
-      Data = (PVOID)((ULONG_PTR) Data + 2);
+      Sum += (ULONG64)((PULONG)Buffer)[0] + ((PULONG)Buffer)[1] +
+                      ((PULONG)Buffer)[2] + ((PULONG)Buffer)[3];
+      Sum += (ULONG64)((PULONG)Buffer)[4] + ((PULONG)Buffer)[5] +
+                      ((PULONG)Buffer)[6] + ((PULONG)Buffer)[7];
+      Count  -= 8 * sizeof(ULONG);
+      Buffer += 8 * sizeof(ULONG);
+    }
+
+  while (Count >= sizeof(ULONG))
+    {
+      Sum += *(PULONG)Buffer;
+      Count  -= sizeof(ULONG);
+      Buffer += sizeof(ULONG);
+    }
+
+  if (Count >= sizeof(USHORT))
+    {
+      Sum += *(PUSHORT)Buffer;
+      Count  -= sizeof(USHORT);
+      Buffer += sizeof(USHORT);
     }
 
   /* Add left-over byte, if any */
   if (Count > 0)
     {
-      Sum += *(PUCHAR)Data;
+      Sum += *Buffer;
     }
 
-  return Sum;
+  /* Fold 64-bit sum to 32 bits */
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+
+  return (ULONG)Sum;
 }
 
 ULONG
@@ -62,44 +89,21 @@ UDPv4ChecksumCalculate(
   PUCHAR PacketBuffer,
   ULONG DataLength)
 {
-  ULONG Sum = 0;
-  USHORT TmpSum;
-  ULONG i;
-  BOOLEAN Pad;
-
-  /* Pad the data if needed */
-  Pad = (DataLength & 1);
-  if (Pad)
-      DataLength++;
+  ULONG Sum;
 
-  /* Add from the UDP header and data */
-  for (i = 0; i < DataLength; i += 2)
-  {
-       TmpSum = ((PacketBuffer[i] << 8) & 0xFF00) +
-                ((Pad && i == DataLength - 2) ? 0 : (PacketBuffer[i+1] & 0x00FF));
-       Sum += TmpSum;
-  }
+  /*
+   * Sum the UDP header and data and the addresses as they are in memory,
+   * the one's complement sum of byte swapped words being the byte swapped
+   * sum (RFC 1071). A trailing odd byte is padded with zero.
+   */
+  Sum = ChecksumCompute(PacketBuffer, DataLength, 0);
+  Sum = ChecksumCompute(&IPHeader->SrcAddr, sizeof(IPv4_RAW_ADDRESS), Sum);
+  Sum = ChecksumCompute(&IPHeader->DstAddr, sizeof(IPv4_RAW_ADDRESS), Sum);
 
-  /* Add the source address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->SrcAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->SrcAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the destination address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->DstAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->DstAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the proto number and length */
-  Sum += IPPROTO_UDP + (DataLength - (Pad ? 1 : 0));
+  /* Convert it to host order before adding the proto number and length */
+  Sum = WN2H(ChecksumFold(Sum));
+  Sum += IPPROTO_UDP + DataLength;
 
   /* Fold the checksum and return the one's complement */
   return ~ChecksumFold(Sum);
 }
-
@@ -17,6 +17,199 @@
 LIST_ENTRY FIBListHead;
 KSPIN_LOCK FIBLock;
 
+/*
+ * IPv4 FIB entries are also indexed by a path compressed binary trie
+ * keyed on the network prefix, so that route lookups cost at most one
+ * node visit per prefix bit instead of a scan of the whole FIB.
+ * The trie is protected by the FIB lock.
+ */
+PFIB_NODE FIBRoot = NULL;
+
+#define FIB_PREFIX_MASK(Length) \
+    ((Length) ? 0xFFFFFFFF << (32 - (Length)) : 0)
+#define FIB_PREFIX_BIT(Key, Index) \
+    (((Key) >> (31 - (Index))) & 1)
+
+static UINT FIBCommonBits(
+    ULONG Key1,
+    ULONG Key2)
+/*
+ * FUNCTION: Computes the number of leading bits two host order keys share
+ */
+{
+    ULONG Difference = Key1 ^ Key2;
+    UINT Bits = 0;
+
+    while (Bits < 32 && !(Difference & 0x80000000)) {
+        Difference <<= 1;
+        Bits++;
+    }
+
+    return Bits;
+}
+
+static PFIB_NODE FIBCreateNode(
+    ULONG Key,
+    UINT Length,
+    PFIB_NODE Parent)
+{
+    PFIB_NODE Node;
+
+    Node = ExAllocatePoolWithTag(NonPagedPool, sizeof(FIB_NODE), FIB_TAG);
+    if (!Node)
+        return NULL;
+
+    Node->Parent = Parent;
+    Node->Child[0] = Node->Child[1] = NULL;
+    Node->Prefix = Key & FIB_PREFIX_MASK(Length);
+    Node->PrefixLength = Length;
+    InitializeListHead(&Node->Routes);
+
+    return Node;
+}
+
+static VOID FIBPruneNode(
+    PFIB_NODE Node)
+/*
+ * FUNCTION: Removes nodes left without routes and with at most one child
+ * NOTES:
+ *     The forward information base lock must be held when called
+ */
+{
+    PFIB_NODE Parent, Child;
+
+    while (Node && IsListEmpty(&Node->Routes) &&
+           (!Node->Child[0] || !Node->Child[1])) {
+        Parent = Node->Parent;
+        Child = Node->Child[0] ? Node->Child[0] : Node->Child[1];
+
+        if (Child)
+            Child->Parent = Parent;
+
+        if (!Parent)
+            FIBRoot = Child;
+        else if (Parent->Child[0] == Node)
+            Parent->Child[0] = Child;
+        else
+            Parent->Child[1] = Child;
+
+        ExFreePoolWithTag(Node, FIB_TAG);
+        Node = Parent;
+    }
+}
+
+static PFIB_NODE FIBInsertNode(
+    ULONG Key,
+    UINT Length)
+/*
+ * FUNCTION: Finds or creates the trie node for a prefix
+ * ARGUMENTS:
+ *     Key    = Prefix in host order
+ *     Length = Prefix length in bits
+ * RETURNS:
+ *     Pointer to the node, NULL if out of memory
+ * NOTES:
+ *     The forward information base lock must be held when called
+ */
+{
+    PFIB_NODE *Link = &FIBRoot;
+    PFIB_NODE Parent = NULL;
+    PFIB_NODE Node, Split, New;
+    UINT Common;
+
+    Key &= FIB_PREFIX_MASK(Length);
+
+    while ((Node = *Link) != NULL) {
+        Common = FIBCommonBits(Key, Node->Prefix);
+        Common = min(Common, min(Length, Node->PrefixLength));
+
+        if (Common == Node->PrefixLength) {
+            /* This node is a prefix of the key */
+            if (Node->PrefixLength == Length)
+                return Node;
+
+            Parent = Node;
+            Link = &Node->Child[FIB_PREFIX_BIT(Key, Node->PrefixLength)];
+            continue;
+        }
+
+        /* The key diverges inside this node: insert above it */
+        Split = FIBCreateNode(Key, Common, Parent);
+        if (!Split)
+            return NULL;
+
+        Split->Child[FIB_PREFIX_BIT(Node->Prefix, Common)] = Node;
+        Node->Parent = Split;
+        *Link = Split;
+
+        if (Common == Length)
+            return Split;
+
+        New = FIBCreateNode(Key, Length, Split);
+        if (!New) {
+            FIBPruneNode(Split);
+            return NULL;
+        }
+
+        Split->Child[FIB_PREFIX_BIT(Key, Common)] = New;
+        return New;
+    }
+
+    New = FIBCreateNode(Key, Length, Parent);
+    if (New)
+        *Link = New;
+
+    return New;
+}
+
+static PNEIGHBOR_CACHE_ENTRY FIBLookup(
+    ULONG Key)
+/*
+ * FUNCTION: Finds the router of the longest prefix matching a destination
+ * ARGUMENTS:
+ *     Key = Destination address in host order
+ * RETURNS:
+ *     Pointer to NCE for router, NULL if no prefix matches
+ * NOTES:
+ *     Among routes of the same prefix, one whose router is not stale
+ *     or incomplete is preferred.
+ *     The forward information base lock must be held when called
+ */
+{
+    PFIB_NODE Node = FIBRoot, Best = NULL;
+    PLIST_ENTRY CurrentEntry;
+    PFIB_ENTRY Current;
+
+    while (Node) {
+        if (Node->PrefixLength &&
+            FIBCommonBits(Key, Node->Prefix) < Node->PrefixLength)
+            break;
+
+        if (!IsListEmpty(&Node->Routes))
+            Best = Node;
+
+        if (Node->PrefixLength == 32)
+            break;
+
+        Node = Node->Child[FIB_PREFIX_BIT(Key, Node->PrefixLength)];
+    }
+
+    if (!Best)
+        return NULL;
+
+    for (CurrentEntry = Best->Routes.Flink;
+         CurrentEntry != &Best->Routes;
+         CurrentEntry = CurrentEntry->Flink) {
+        Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, NodeListEntry);
+
+        if (!(Current->Router->State & (NUD_STALE | NUD_INCOMPLETE)))
+            return Current->Router;
+    }
+
+    Current = CONTAINING_RECORD(Best->Routes.Flink, FIB_ENTRY, NodeListEntry);
+    return Current->Router;
+}
+
 void RouterDumpRoutes() {
     PLIST_ENTRY CurrentEntry;
     PLIST_ENTRY NextEntry;
@@ -69,6 +262,12 @@ VOID DestroyFIBE(
     /* Unlink the FIB entry from the list */
     RemoveEntryList(&FIBE->ListEntry);
 
+    /* And from the trie */
+    if (FIBE->Node) {
+        RemoveEntryList(&FIBE->NodeListEntry);
+        FIBPruneNode(FIBE->Node);
+    }
+
     /* And free the FIB entry */
     FreeFIB(FIBE);
 }
@@ -207,6 +406,7 @@ PFIB_ENTRY RouterAddRoute(
  */
 {
     PFIB_ENTRY FIBE;
+    KIRQL OldIrql;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. NetworkAddress (0x%X)  Netmask (0x%X) "
         "Router (0x%X)  Metric (%d).\n", NetworkAddress, Netmask, Router, Metric));
@@ -228,9 +428,27 @@ PFIB_ENTRY RouterAddRoute(
 		   sizeof(FIBE->Netmask) );
     FIBE->Router         = Router;
     FIBE->Metric         = Metric;
+    FIBE->Node           = NULL;
+
+    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
+
+    /* Index IPv4 routes by prefix */
+    if (NetworkAddress->Type == IP_ADDRESS_V4 && Netmask->Type == IP_ADDRESS_V4) {
+        FIBE->Node = FIBInsertNode(IPv4NToHl(NetworkAddress->Address.IPv4Address),
+                                   AddrCountPrefixBits(Netmask));
+        if (!FIBE->Node) {
+            TcpipReleaseSpinLock(&FIBLock, OldIrql);
+            TI_DbgPrint(MIN_TRACE, ("Insufficient resources.\n"));
+            FreeFIB(FIBE);
+            return NULL;
+        }
+        InsertTailList(&FIBE->Node->Routes, &FIBE->NodeListEntry);
+    }
 
     /* Add FIB to the forward information base */
-    TcpipInterlockedInsertTailList(&FIBListHead, &FIBE->ListEntry, &FIBLock);
+    InsertTailList(&FIBListHead, &FIBE->ListEntry);
+
+    TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
     return FIBE;
 }
@@ -261,7 +479,14 @@ PNEIGHBOR_CACHE_ENTRY RouterGetRoute(PIP_ADDRESS Destination)
 
     TcpipAcquireSpinLock(&FIBLock, &OldIrql);
 
-    CurrentEntry = FIBListHead.Flink;
+    /* IPv4 routes are all in the trie */
+    if (Destination->Type == IP_ADDRESS_V4) {
+        BestNCE = FIBLookup(IPv4NToHl(Destination->Address.IPv4Address));
+        CurrentEntry = &FIBListHead;
+    } else {
+        CurrentEntry = FIBListHead.Flink;
+    }
+
     while (CurrentEntry != &FIBListHead) {
         NextEntry = CurrentEntry->Flink;
 	    Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
@@ -112,9 +112,18 @@
   #error "MEMP_NUM_REASSDATA > IP_REASS_MAX_PBUFS doesn't make sense since each struct ip_reassdata must hold 2 pbufs at least!"
 #endif
 #endif /* !MEMP_MEM_MALLOC */
+#if !LWIP_WND_SCALE
 #if (LWIP_TCP && (TCP_WND > 0xffff))
-  #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
+  #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h (or enable window scaling)"
 #endif
+#else /* !LWIP_WND_SCALE */
+#if (LWIP_TCP && (TCP_RCV_SCALE > 14))
+  #error "TCP_RCV_SCALE must not exceed 14 (RFC 1323), so, you have to reduce it in your lwipopts.h"
+#endif
+#if (LWIP_TCP && (TCP_WND > (0xffffUL << TCP_RCV_SCALE)))
+  #error "TCP_WND is bigger than the configured window scale can announce, so, you have to reduce it in your lwipopts.h"
+#endif
+#endif /* !LWIP_WND_SCALE */
 #if (LWIP_TCP && (TCP_SND_QUEUELEN > 0xffff))
   #error "If you want to use TCP, TCP_SND_QUEUELEN must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
 #endif
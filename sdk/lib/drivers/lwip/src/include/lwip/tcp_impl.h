@@ -292,12 +292,27 @@ struct tcp_seg {
 #define TF_SEG_OPTS_TS          (u8_t)0x02U /* Include timestamp option. */
 #define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* ALL data (not the header) is
                                                checksummed into 'chksum' */
+#define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include WND SCALE option */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
 #define LWIP_TCP_OPT_LENGTH(flags)              \
-  (flags & TF_SEG_OPTS_MSS ? 4  : 0) +          \
-  (flags & TF_SEG_OPTS_TS  ? 12 : 0)
+  (flags & TF_SEG_OPTS_MSS       ? 4  : 0) +    \
+  (flags & TF_SEG_OPTS_TS        ? 12 : 0) +    \
+  (flags & TF_SEG_OPTS_WND_SCALE ? 4  : 0)
+
+#if LWIP_WND_SCALE
+/** The full receive window is only usable once window scaling was negotiated */
+#define TCP_WND_MAX(pcb)        ((tcpwnd_size_t)(((pcb)->flags & TF_WND_SCALE) ? TCP_WND : TCPWND16(TCP_WND)))
+#define RCV_WND_SCALE(pcb, wnd) (((wnd) >> (pcb)->rcv_scale))
+#define SND_WND_SCALE(pcb, wnd) (((tcpwnd_size_t)(wnd) << (pcb)->snd_scale))
+/** NOP, NOP, window scale option (kind 3, length 3) carrying TCP_RCV_SCALE */
+#define TCP_BUILD_WND_SCALE_OPTION() PP_HTONL(0x01030300 | TCP_RCV_SCALE)
+#else /* LWIP_WND_SCALE */
+#define TCP_WND_MAX(pcb)        TCP_WND
+#define RCV_WND_SCALE(pcb, wnd) (wnd)
+#define SND_WND_SCALE(pcb, wnd) (wnd)
+#endif /* LWIP_WND_SCALE */
 
 /** This returns a TCP header option for MSS in an u32_t */
 #define TCP_BUILD_MSS_OPTION(mss) htonl(0x02040000 | ((mss) & 0xFFFF))
@@ -64,7 +64,14 @@
  * add support for other transport mediums */
 #define TCP_MSS                         1460
 
-#define TCP_WND                         0xFFFF
+/* Window scaling lets us announce more than 64 KB, which is what keeps
+ * a single connection from stalling on links with a large
+ * bandwidth-delay product. A shift of 3 covers a 256 KB window. */
+#define LWIP_WND_SCALE                  1
+
+#define TCP_RCV_SCALE                   3
+
+#define TCP_WND                         0x40000
 
 #define TCP_SND_BUF                     TCP_WND
 
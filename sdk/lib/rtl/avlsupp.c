@@ -15,6 +15,14 @@ typedef struct _TABLE_ENTRY_HEADER
     LONGLONG UserData;
 } TABLE_ENTRY_HEADER, *PTABLE_ENTRY_HEADER;
 
+/*
+ * The glue code defines RtlpUpdateAvlTreeNode, which recomputes whatever the
+ * glue keeps about a node's whole subtree from the node and its two children.
+ * It gets the table too, since the glue may only keep such data for some.
+ * The routines below call it on every node whose subtree changes, bottom-up,
+ * so that the glue can answer range queries without walking the tree.
+ */
+
 typedef enum _RTL_AVL_BALANCE_FACTOR
 {
     RtlUnbalancedAvlTree = -2,
@@ -27,6 +35,19 @@ C_ASSERT(RtlBalancedAvlTree == 0);
 
 /* FUNCTIONS ******************************************************************/
 
+FORCEINLINE
+VOID
+RtlpPropagateAvlTreeNode(IN PRTL_AVL_TABLE Table,
+                         IN PRTL_BALANCED_LINKS Node)
+{
+    /* Refresh the node and all its ancestors, stopping at the root sentinel */
+    while (RtlParentAvl(Node) != Node)
+    {
+        RtlpUpdateAvlTreeNode(Table, Node);
+        Node = RtlParentAvl(Node);
+    }
+}
+
 FORCEINLINE
 TABLE_SEARCH_RESULT
 RtlpFindAvlTableNodeOrParent(IN PRTL_AVL_TABLE Table,
@@ -96,7 +117,8 @@ RtlpFindAvlTableNodeOrParent(IN PRTL_AVL_TABLE Table,
 
 FORCEINLINE
 VOID
-RtlpPromoteAvlTreeNode(IN PRTL_BALANCED_LINKS Node)
+RtlpPromoteAvlTreeNode(IN PRTL_AVL_TABLE Table,
+                       IN PRTL_BALANCED_LINKS Node)
 {
     PRTL_BALANCED_LINKS ParentNode, SuperParentNode;
     PRTL_BALANCED_LINKS *SwapNode1, *SwapNode2;
@@ -120,11 +142,16 @@ RtlpPromoteAvlTreeNode(IN PRTL_BALANCED_LINKS Node)
                  &SuperParentNode->LeftChild: &SuperParentNode->RightChild;
     *SwapNode1 = Node;
     RtlSetParent(Node, SuperParentNode);
+
+    /* The old parent is now below the node, so refresh it first */
+    RtlpUpdateAvlTreeNode(Table, ParentNode);
+    RtlpUpdateAvlTreeNode(Table, Node);
 }
 
 FORCEINLINE
 BOOLEAN
-RtlpRebalanceAvlTreeNode(IN PRTL_BALANCED_LINKS Node)
+RtlpRebalanceAvlTreeNode(IN PRTL_AVL_TABLE Table,
+                         IN PRTL_BALANCED_LINKS Node)
 {
     PRTL_BALANCED_LINKS ChildNode, SubChildNode;
     CHAR Balance;
@@ -139,7 +166,7 @@ RtlpRebalanceAvlTreeNode(IN PRTL_BALANCED_LINKS Node)
     if (RtlBalance(ChildNode) == Balance)
     {
         /* This performs the rotation described in Knuth A8-A10 for Case 1 */
-        RtlpPromoteAvlTreeNode(ChildNode);
+        RtlpPromoteAvlTreeNode(Table, ChildNode);
 
         /* The nodes are now balanced */
         RtlSetBalance(ChildNode, RtlBalancedAvlTree);
@@ -155,8 +182,8 @@ RtlpRebalanceAvlTreeNode(IN PRTL_BALANCED_LINKS Node)
                         RtlLeftChildAvl(ChildNode) : RtlRightChildAvl(ChildNode);
 
         /* Do the double-rotation described in Knuth A8-A10 for Case 2 */
-        RtlpPromoteAvlTreeNode(SubChildNode);
-        RtlpPromoteAvlTreeNode(SubChildNode);
+        RtlpPromoteAvlTreeNode(Table, SubChildNode);
+        RtlpPromoteAvlTreeNode(Table, SubChildNode);
 
         /* Was the sub-child sharing the same balance as the node? */
         if (RtlBalance(SubChildNode) == Balance)
@@ -194,7 +221,7 @@ RtlpRebalanceAvlTreeNode(IN PRTL_BALANCED_LINKS Node)
      * The case that remains is that the child was already balanced, so this is
      * This is the rotation required for Case 3 in Knuth A8-A10
      */
-    RtlpPromoteAvlTreeNode(ChildNode);
+    RtlpPromoteAvlTreeNode(Table, ChildNode);
 
     /* Now the child has the opposite weight of the node */
     RtlSetBalance(ChildNode, -Balance);
@@ -229,6 +256,7 @@ RtlpInsertAvlTreeNode(IN PRTL_AVL_TABLE Table,
         /* On AVL trees, we also update the depth */
         ASSERT(Table->DepthOfTree == 0);
         Table->DepthOfTree = 1;
+        RtlpUpdateAvlTreeNode(Table, NewNode);
         return;
     }
     else if (SearchResult == TableInsertAsLeft)
@@ -242,6 +270,9 @@ RtlpInsertAvlTreeNode(IN PRTL_AVL_TABLE Table,
         RtlInsertAsRightChildAvl(NodeOrParent, NewNode);
     }
 
+    /* Account for the new node before any rotation moves things around */
+    RtlpPropagateAvlTreeNode(Table, NewNode);
+
     /* Little cheat to save on loop processing, taken from Timo */
     RtlSetBalance(&Table->BalancedRoot, RtlLeftHeavyAvlTree);
 
@@ -284,7 +315,7 @@ RtlpInsertAvlTreeNode(IN PRTL_AVL_TABLE Table,
         else
         {
             /* The tree is now unbalanced, so AVL rebalancing must happen */
-            RtlpRebalanceAvlTreeNode(NodeOrParent);
+            RtlpRebalanceAvlTreeNode(Table, NodeOrParent);
             break;
         }
     }
@@ -338,6 +369,9 @@ RtlpDeleteAvlTreeNode(IN PRTL_AVL_TABLE Table,
     /* If the node has a child now, update its parent */
     if (*Node1) RtlSetParent(*Node1, ParentNode);
 
+    /* Account for the unlinked node before any rotation moves things around */
+    RtlpPropagateAvlTreeNode(Table, ParentNode);
+
     /* Assume balanced root for loop optimization */
     RtlSetBalance(&Table->BalancedRoot, RtlBalancedAvlTree);
 
@@ -362,7 +396,7 @@ RtlpDeleteAvlTreeNode(IN PRTL_AVL_TABLE Table,
         else
         {
             /* The tree has become unbalanced, so a rebalance is needed */
-            if (RtlpRebalanceAvlTreeNode(ParentNode)) break;
+            if (RtlpRebalanceAvlTreeNode(Table, ParentNode)) break;
 
             /* Get the new parent after the balance */
             ParentNode = RtlParentAvl(ParentNode);
@@ -390,6 +424,9 @@ RtlpDeleteAvlTreeNode(IN PRTL_AVL_TABLE Table,
     /* Reparent as appropriate */
     if (RtlLeftChildAvl(DeleteNode)) RtlSetParent(RtlLeftChildAvl(DeleteNode), DeleteNode);
     if (RtlRightChildAvl(DeleteNode)) RtlSetParent(RtlRightChildAvl(DeleteNode), DeleteNode);
+
+    /* The replacement node brings its own data to the place of the deleted one */
+    RtlpPropagateAvlTreeNode(Table, DeleteNode);
 }
 
 /* EOF */
@@ -78,6 +78,10 @@ RtlInsertElementGenericTableFullAvl(IN PRTL_AVL_TABLE Table,
         RtlZeroMemory(NewNode, sizeof(RTL_BALANCED_LINKS));
         RtlpInsertAvlTreeNode(Table, NewNode, NodeOrParent, SearchResult);
 
+        /* Reset accounting */
+        Table->WhichOrderedElement = 0;
+        Table->OrderedPointer = NULL;
+
         /* Copy user buffer */
         RtlCopyMemory(UserData, Buffer, BufferSize);
     }
@@ -278,15 +282,92 @@ RtlEnumerateGenericTableWithoutSplayingAvl(IN PRTL_AVL_TABLE Table,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 PVOID
 NTAPI
 RtlGetElementGenericTableAvl(IN PRTL_AVL_TABLE Table,
                              IN ULONG I)
 {
-    UNIMPLEMENTED;
-	return NULL;
+    ULONG OrderedElement, ElementCount;
+    PRTL_BALANCED_LINKS OrderedNode;
+    ULONG DeltaUp, DeltaDown;
+    ULONG NextI = I + 1;
+
+    /* Setup current accounting data */
+    OrderedNode = Table->OrderedPointer;
+    OrderedElement = Table->WhichOrderedElement;
+    ElementCount = Table->NumberGenericTableElements;
+
+    /* Sanity checks */
+    if ((I == MAXULONG) || (NextI > ElementCount)) return NULL;
+
+    /* Check if we already found the entry */
+    if (NextI == OrderedElement)
+    {
+        /* Return it */
+        return &((PTABLE_ENTRY_HEADER)OrderedNode)->UserData;
+    }
+
+    /* Distances from the cached element, or from the two ends of the table */
+    DeltaUp = NextI - 1;
+    DeltaDown = ElementCount - NextI;
+
+    if ((OrderedElement) && (OrderedElement < NextI) &&
+        ((NextI - OrderedElement) <= min(DeltaUp, DeltaDown)))
+    {
+        /* Walk forwards from the cached element */
+        DeltaUp = NextI - OrderedElement;
+        while (DeltaUp)
+        {
+            /* Get next node */
+            OrderedNode = RtlRealSuccessorAvl(OrderedNode);
+            DeltaUp--;
+        }
+    }
+    else if ((OrderedElement) && (OrderedElement > NextI) &&
+             ((OrderedElement - NextI) <= min(DeltaUp, DeltaDown)))
+    {
+        /* Walk backwards from the cached element */
+        DeltaDown = OrderedElement - NextI;
+        while (DeltaDown)
+        {
+            /* Get previous node */
+            OrderedNode = RtlRealPredecessorAvl(OrderedNode);
+            DeltaDown--;
+        }
+    }
+    else if (DeltaUp <= DeltaDown)
+    {
+        /* Start from the smallest element and walk forwards */
+        OrderedNode = RtlRightChildAvl(&Table->BalancedRoot);
+        while (RtlLeftChildAvl(OrderedNode)) OrderedNode = RtlLeftChildAvl(OrderedNode);
+        while (DeltaUp)
+        {
+            /* Get next node */
+            OrderedNode = RtlRealSuccessorAvl(OrderedNode);
+            DeltaUp--;
+        }
+    }
+    else
+    {
+        /* Start from the largest element and walk backwards */
+        OrderedNode = RtlRightChildAvl(&Table->BalancedRoot);
+        while (RtlRightChildAvl(OrderedNode)) OrderedNode = RtlRightChildAvl(OrderedNode);
+        while (DeltaDown)
+        {
+            /* Get previous node */
+            OrderedNode = RtlRealPredecessorAvl(OrderedNode);
+            DeltaDown--;
+        }
+    }
+
+    /* Got the element, save it */
+    Table->OrderedPointer = OrderedNode;
+    Table->WhichOrderedElement = NextI;
+
+    /* Return the element */
+    return &((PTABLE_ENTRY_HEADER)OrderedNode)->UserData;
 }
 
 /*
@@ -24,6 +24,16 @@
 #define RtlInsertAsLeftChildAvl     RtlInsertAsLeftChild
 #define RtlIsLeftChildAvl           RtlIsLeftChild
 
+FORCEINLINE
+VOID
+RtlpUpdateAvlTreeNode(IN PRTL_AVL_TABLE Table,
+                      IN PRTL_BALANCED_LINKS Node)
+{
+    /* RTL tables don't keep any per-subtree data */
+    UNREFERENCED_PARAMETER(Table);
+    UNREFERENCED_PARAMETER(Node);
+}
+
 FORCEINLINE
 VOID
 RtlpCopyAvlNodeData(IN PRTL_BALANCED_LINKS Node1,
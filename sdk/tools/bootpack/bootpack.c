@@ -0,0 +1,223 @@
+/*
+ * PROJECT:     ReactOS Boot Pack Creator
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Builds the compressed container FreeLoader reads the
+ *              kernel, HAL, boot drivers, SYSTEM hive and NLS tables from
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <typedefs.h>
+
+#define Z_SOLO
+#include <zlib.h>
+
+#include <bootpack.h>
+
+static
+void
+Usage(void)
+{
+    printf("Builds a FreeLoader boot pack.\n"
+           "Syntax: bootpack <output file> <name>=<source file> [...]\n"
+           "  <name> is the path of the file relative to the directory\n"
+           "  the boot pack is put in, e.g. system32\\drivers\\disk.sys\n");
+}
+
+static
+voidpf
+ZlibAlloc(voidpf Opaque, uInt Items, uInt Size)
+{
+    return calloc(Items, Size);
+}
+
+static
+void
+ZlibFree(voidpf Opaque, voidpf Address)
+{
+    free(Address);
+}
+
+static
+unsigned char *
+ReadWholeFile(const char *FileName, ULONG *Size)
+{
+    FILE *File;
+    long Length;
+    unsigned char *Data;
+
+    File = fopen(FileName, "rb");
+    if (!File)
+    {
+        fprintf(stderr, "Cannot open '%s'\n", FileName);
+        return NULL;
+    }
+
+    if (fseek(File, 0, SEEK_END) != 0 || (Length = ftell(File)) < 0 ||
+        fseek(File, 0, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "Cannot get the size of '%s'\n", FileName);
+        fclose(File);
+        return NULL;
+    }
+
+    Data = malloc(Length ? Length : 1);
+    if (!Data)
+    {
+        fprintf(stderr, "Out of memory\n");
+        fclose(File);
+        return NULL;
+    }
+
+    if (fread(Data, 1, Length, File) != (size_t)Length)
+    {
+        fprintf(stderr, "Cannot read '%s'\n", FileName);
+        free(Data);
+        fclose(File);
+        return NULL;
+    }
+
+    fclose(File);
+    *Size = (ULONG)Length;
+    return Data;
+}
+
+int main(int argc, char *argv[])
+{
+    BOOT_PACK_HEADER Header;
+    BOOT_PACK_ENTRY *Entries;
+    unsigned char *Data = NULL, *Compressed;
+    ULONG DataSize = 0, EntryCount, i;
+    uLong CompressedSize;
+    z_stream Stream;
+    FILE *Output;
+
+    if (argc < 3)
+    {
+        Usage();
+        return 1;
+    }
+
+    EntryCount = argc - 2;
+    Entries = calloc(EntryCount, sizeof(BOOT_PACK_ENTRY));
+    if (!Entries)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Gather all the files, one after the other */
+    for (i = 0; i < EntryCount; i++)
+    {
+        char *Name = argv[i + 2];
+        char *Source = strchr(Name, '=');
+        unsigned char *FileData, *NewData;
+        ULONG FileSize;
+        char *p;
+
+        if (!Source || Source == Name || (size_t)(Source - Name) >= BOOT_PACK_MAX_NAME)
+        {
+            fprintf(stderr, "Invalid entry '%s'\n", Name);
+            return 1;
+        }
+
+        memcpy(Entries[i].Name, Name, Source - Name);
+        for (p = Entries[i].Name; *p; p++)
+        {
+            if (*p == '/')
+                *p = '\\';
+        }
+        Source++;
+
+        FileData = ReadWholeFile(Source, &FileSize);
+        if (!FileData)
+            return 1;
+
+        if (FileSize > MAXULONG - DataSize)
+        {
+            fprintf(stderr, "Boot pack too large\n");
+            return 1;
+        }
+
+        NewData = realloc(Data, DataSize + FileSize + 1);
+        if (!NewData)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        Data = NewData;
+        memcpy(Data + DataSize, FileData, FileSize);
+        free(FileData);
+
+        Entries[i].Offset = DataSize;
+        Entries[i].Size = FileSize;
+        DataSize += FileSize;
+    }
+
+    /* Compress everything as a single stream, so that the files share the dictionary */
+    memset(&Stream, 0, sizeof(Stream));
+    Stream.zalloc = ZlibAlloc;
+    Stream.zfree = ZlibFree;
+    if (deflateInit(&Stream, Z_BEST_COMPRESSION) != Z_OK)
+    {
+        fprintf(stderr, "Cannot initialize the compressor\n");
+        return 1;
+    }
+
+    CompressedSize = deflateBound(&Stream, DataSize);
+    Compressed = malloc(CompressedSize);
+    if (!Compressed)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    Stream.next_in = Data;
+    Stream.avail_in = DataSize;
+    Stream.next_out = Compressed;
+    Stream.avail_out = CompressedSize;
+    if (deflate(&Stream, Z_FINISH) != Z_STREAM_END)
+    {
+        fprintf(stderr, "Cannot compress the boot pack\n");
+        return 1;
+    }
+    CompressedSize = Stream.total_out;
+    deflateEnd(&Stream);
+
+    memset(&Header, 0, sizeof(Header));
+    Header.Signature = BOOT_PACK_SIGNATURE;
+    Header.Version = BOOT_PACK_VERSION;
+    Header.Flags = BOOT_PACK_FLAG_CRC32;
+    Header.EntryCount = EntryCount;
+    Header.UncompressedSize = DataSize;
+    Header.CompressedSize = (ULONG)CompressedSize;
+    Header.Crc32 = (ULONG)crc32(0, Data, DataSize);
+
+    Output = fopen(argv[1], "wb");
+    if (!Output)
+    {
+        fprintf(stderr, "Cannot create '%s'\n", argv[1]);
+        return 1;
+    }
+
+    if (fwrite(&Header, sizeof(Header), 1, Output) != 1 ||
+        fwrite(Entries, sizeof(BOOT_PACK_ENTRY), EntryCount, Output) != EntryCount ||
+        fwrite(Compressed, 1, CompressedSize, Output) != CompressedSize)
+    {
+        fprintf(stderr, "Cannot write '%s'\n", argv[1]);
+        fclose(Output);
+        remove(argv[1]);
+        return 1;
+    }
+
+    fclose(Output);
+
+    printf("%s: %lu files, %lu bytes compressed to %lu\n", argv[1],
+           (unsigned long)EntryCount, (unsigned long)DataSize, (unsigned long)CompressedSize);
+
+    free(Compressed);
+    free(Data);
+    free(Entries);
+    return 0;
+}
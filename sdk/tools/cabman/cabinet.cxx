@@ -932,8 +932,6 @@ ULONG CCabinet::FindNext(PCAB_SEARCH Search)
  *     Status of operation
  */
 {
-    bool bFound = false;
-    PSEARCH_CRITERIA Criteria;
     ULONG Status;
 
     if (RestartSearch)
@@ -956,25 +954,7 @@ ULONG CCabinet::FindNext(PCAB_SEARCH Search)
     /* Check each search criteria against each file */
     while(Search->Next)
     {
-        // Some features (like displaying cabinets) don't require search criteria, so we can just break here.
-        // If a feature requires it, handle this in the ParseCmdline() function in "main.cxx".
-        if(!CriteriaListHead)
-            break;
-
-        Criteria = CriteriaListHead;
-
-        while(Criteria)
-        {
-            if(MatchFileNamePattern(Search->Next->FileName, Criteria->Search))
-            {
-                bFound = true;
-                break;
-            }
-
-            Criteria = Criteria->Next;
-        }
-
-        if(bFound)
+        if(MatchSearchCriteria(Search->Next->FileName))
             break;
 
         Search->Next = Search->Next->Next;
@@ -1034,10 +1014,6 @@ ULONG CCabinet::ExtractFile(char* FileName)
     CFDATA CFData;
     ULONG Status;
     bool Skip;
-#if defined(_WIN32)
-    FILETIME FileTime;
-#endif
-    CHAR DestName[PATH_MAX];
     CHAR TempName[PATH_MAX];
 
     Status = LocateFile(FileName, &File);
@@ -1069,78 +1045,9 @@ ULONG CCabinet::ExtractFile(char* FileName)
         (UINT)File->DataBlock->AbsoluteOffset,
         (UINT)File->DataBlock->UncompOffset));
 
-    strcpy(DestName, DestPath);
-    strcat(DestName, FileName);
-
-    /* Create destination file, fail if it already exists */
-#if defined(_WIN32)
-    DestFile = CreateFile(DestName,      // Create this file
-        GENERIC_WRITE,                   // Open for writing
-        0,                               // No sharing
-        NULL,                            // No security
-        CREATE_NEW,                      // New file only
-        FILE_ATTRIBUTE_NORMAL,           // Normal file
-        NULL);                           // No attribute template
-    if (DestFile == INVALID_HANDLE_VALUE)
-    {
-        /* If file exists, ask to overwrite file */
-        if (((Status = GetLastError()) == ERROR_FILE_EXISTS) &&
-            (OnOverwrite(&File->File, FileName)))
-        {
-            /* Create destination file, overwrite if it already exists */
-            DestFile = CreateFile(DestName, // Create this file
-                GENERIC_WRITE,              // Open for writing
-                0,                          // No sharing
-                NULL,                       // No security
-                TRUNCATE_EXISTING,          // Truncate the file
-                FILE_ATTRIBUTE_NORMAL,      // Normal file
-                NULL);                      // No attribute template
-            if (DestFile == INVALID_HANDLE_VALUE)
-                return CAB_STATUS_CANNOT_CREATE;
-        }
-        else
-        {
-            if (Status == ERROR_FILE_EXISTS)
-                return CAB_STATUS_FILE_EXISTS;
-            else
-                return CAB_STATUS_CANNOT_CREATE;
-        }
-    }
-#else /* !_WIN32 */
-    DestFile = fopen(DestName, "rb");
-    if (DestFile != NULL)
-    {
-        fclose(DestFile);
-        /* If file exists, ask to overwrite file */
-        if (OnOverwrite(&File->File, FileName))
-        {
-            DestFile = fopen(DestName, "w+b");
-            if (DestFile == NULL)
-                return CAB_STATUS_CANNOT_CREATE;
-        }
-        else
-            return CAB_STATUS_FILE_EXISTS;
-    }
-    else
-    {
-        DestFile = fopen(DestName, "w+b");
-        if (DestFile == NULL)
-            return CAB_STATUS_CANNOT_CREATE;
-    }
-#endif
-#if defined(_WIN32)
-    if (!DosDateTimeToFileTime(File->File.FileDate, File->File.FileTime, &FileTime))
-    {
-        CloseFile(DestFile);
-        DPRINT(MIN_TRACE, ("DosDateTimeToFileTime() failed (%u).\n", (UINT)GetLastError()));
-        return CAB_STATUS_CANNOT_WRITE;
-    }
-
-    SetFileTime(DestFile, NULL, &FileTime, NULL);
-#else
-    //DPRINT(MIN_TRACE, ("FIXME: DosDateTimeToFileTime\n"));
-#endif
-    SetAttributesOnFile(DestName, File->File.Attributes);
+    Status = CreateDestinationFile(File, FileName, &DestFile);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
 
     Buffer = (PUCHAR)AllocateMemory(CAB_BLOCKSIZE + 12); // This should be enough
     if (!Buffer)
@@ -1450,6 +1357,375 @@ ULONG CCabinet::ExtractFile(char* FileName)
     return CAB_STATUS_SUCCESS;
 }
 
+ULONG CCabinet::ExtractFiles()
+/*
+ * FUNCTION: Extracts all files matching the search criteria from the cabinet
+ * RETURNS
+ *     Status of operation
+ * NOTES:
+ *     Each folder is decompressed once, in order, and files are written as
+ *     their byte ranges are produced. Cabinets that are part of a set may
+ *     have files split across disks and are extracted file by file
+ */
+{
+    PCFFOLDER_NODE FolderNode;
+    CAB_SEARCH Search;
+    ULONG Status;
+
+    if (CABHeader.Flags & (CAB_FLAG_HASPREV | CAB_FLAG_HASNEXT))
+    {
+        Status = FindFirst(&Search);
+        while (Status == CAB_STATUS_SUCCESS)
+        {
+            Status = ExtractFile(Search.FileName);
+            if (Status != CAB_STATUS_SUCCESS)
+                return Status;
+
+            Status = FindNext(&Search);
+        }
+        return (Status == CAB_STATUS_NOFILE ? CAB_STATUS_SUCCESS : Status);
+    }
+
+    FolderNode = FolderListHead;
+    while (FolderNode != NULL)
+    {
+        Status = ExtractFolder(FolderNode);
+        if (Status != CAB_STATUS_SUCCESS)
+        {
+            DPRINT(MID_TRACE, ("Cannot extract folder (%u) (%u).\n", (UINT)FolderNode->Index, (UINT)Status));
+            return Status;
+        }
+        FolderNode = FolderNode->Next;
+    }
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::ExtractFolder(PCFFOLDER_NODE FolderNode)
+/*
+ * FUNCTION: Extracts all matching files of a folder in a single pass
+ * ARGUMENTS:
+ *     FolderNode = Pointer to CFFOLDER_NODE structure for folder
+ * RETURNS
+ *     Status of operation
+ * NOTES:
+ *     The data blocks are read through a large read-ahead buffer. Blocks
+ *     in front of the first pending file are skipped without being read
+ *     and decompression stops after the last matching file
+ */
+{
+    PCAB_EXTRACT Files;
+    PCAB_EXTRACT Extract;
+    PCFFILE_NODE FileNode;
+    PCFDATA_NODE DataNode;
+    PUCHAR ReadBuffer;
+    ULONG ReadStart;
+    ULONG ReadLength;
+    ULONG FolderEnd;
+    ULONG FileCount;
+    ULONG First;
+    ULONG Index;
+    ULONG Size;
+    ULONG BlockOffset;
+    ULONG BlockStart;
+    ULONG BlockEnd;
+    ULONG Start;
+    ULONG BytesRead;
+    ULONG BytesToRead;
+    ULONG BytesToWrite;
+#if defined(_WIN32)
+    ULONG BytesWritten;
+#endif
+    ULONG Status;
+
+    /* Count the files of this folder that match the search criteria */
+    FileCount = 0;
+    for (FileNode = FileListHead; FileNode != NULL; FileNode = FileNode->Next)
+    {
+        if ((FileNode->File.FileControlID == FolderNode->Index) &&
+            MatchSearchCriteria(FileNode->FileName))
+        {
+            FileCount++;
+        }
+    }
+
+    if (FileCount == 0)
+        return CAB_STATUS_SUCCESS;
+
+    switch (FolderNode->Folder.CompressionType & CAB_COMP_MASK)
+    {
+        case CAB_COMP_NONE:
+            SelectCodec(CAB_CODEC_RAW);
+            break;
+
+        case CAB_COMP_MSZIP:
+            SelectCodec(CAB_CODEC_MSZIP);
+            break;
+
+        default:
+            return CAB_STATUS_UNSUPPCOMP;
+    }
+
+    Files = (PCAB_EXTRACT)AllocateMemory(FileCount * sizeof(CAB_EXTRACT));
+    if (!Files)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    ReadBuffer = (PUCHAR)AllocateMemory(CAB_READBUFFERSIZE);
+    if (!ReadBuffer)
+    {
+        FreeMemory(Files);
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    /* Sort the files by uncompressed offset in the folder */
+    Index = 0;
+    for (FileNode = FileListHead; FileNode != NULL; FileNode = FileNode->Next)
+    {
+        if ((FileNode->File.FileControlID != FolderNode->Index) ||
+            !MatchSearchCriteria(FileNode->FileName))
+        {
+            continue;
+        }
+
+        for (First = Index;
+             (First > 0) && (Files[First - 1].File->File.FileOffset > FileNode->File.FileOffset);
+             First--)
+        {
+            Files[First] = Files[First - 1];
+        }
+
+        Files[First].File      = FileNode;
+        Files[First].BytesLeft = FileNode->File.FileSize;
+        Files[First].Opened    = false;
+        Files[First].Done      = false;
+        Index++;
+    }
+
+    Status = CAB_STATUS_SUCCESS;
+
+    /* Empty files don't need any data */
+    for (Index = 0; Index < FileCount; Index++)
+    {
+        Extract = &Files[Index];
+        if (Extract->BytesLeft != 0)
+            continue;
+
+        Status = CreateDestinationFile(Extract->File, Extract->File->FileName, &Extract->DestFile);
+        if (Status != CAB_STATUS_SUCCESS)
+            break;
+
+        OnExtract(&Extract->File->File, Extract->File->FileName);
+
+        CloseFile(Extract->DestFile);
+        Extract->Done = true;
+    }
+
+    First = 0;
+    while ((First < FileCount) && Files[First].Done)
+        First++;
+
+    ReadStart  = 0;
+    ReadLength = 0;
+    FolderEnd  = 0;
+    if (FolderNode->DataListTail != NULL)
+    {
+        FolderEnd = FolderNode->DataListTail->AbsoluteOffset + sizeof(CFDATA) +
+            FolderNode->DataListTail->Data.CompSize;
+    }
+
+    DataNode = FolderNode->DataListHead;
+    while ((Status == CAB_STATUS_SUCCESS) && (DataNode != NULL) && (First < FileCount))
+    {
+        BlockStart = DataNode->UncompOffset;
+        BlockEnd   = BlockStart + DataNode->Data.UncompSize;
+
+        if (DataNode->Data.UncompSize == 0)
+        {
+            /* Block continues in the next cabinet */
+            DPRINT(MIN_TRACE, ("Unexpected split data block.\n"));
+            Status = CAB_STATUS_INVALID_CAB;
+            break;
+        }
+
+        /* Skip blocks in front of the first pending file */
+        Start = Files[First].File->File.FileOffset +
+            Files[First].File->File.FileSize - Files[First].BytesLeft;
+        if (BlockEnd <= Start)
+        {
+            DataNode = DataNode->Next;
+            continue;
+        }
+
+        Size = sizeof(CFDATA) + DataNode->Data.CompSize;
+        if (DataNode->Data.CompSize > CAB_BLOCKSIZE + 12)
+        {
+            DPRINT(MIN_TRACE, ("Data block too large (%u).\n", DataNode->Data.CompSize));
+            Status = CAB_STATUS_INVALID_CAB;
+            break;
+        }
+
+        /* Make sure the whole block is in the read buffer */
+        BlockOffset = DataNode->AbsoluteOffset - ReadStart;
+        if ((DataNode->AbsoluteOffset < ReadStart) || (BlockOffset + Size > ReadLength))
+        {
+            if ((DataNode->AbsoluteOffset >= ReadStart) && (BlockOffset < ReadLength))
+            {
+                /* Keep what is already buffered of this block */
+                ReadLength -= BlockOffset;
+                memmove(ReadBuffer, ReadBuffer + BlockOffset, ReadLength);
+            }
+            else
+            {
+                if (DataNode->AbsoluteOffset != ReadStart + ReadLength)
+                {
+#if defined(_WIN32)
+                    if (SetFilePointer(FileHandle,
+                                       DataNode->AbsoluteOffset,
+                                       NULL,
+                                       FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+                    {
+                        DPRINT(MIN_TRACE, ("SetFilePointer() failed, error code is %u.\n", (UINT)GetLastError()));
+                        Status = CAB_STATUS_INVALID_CAB;
+                        break;
+                    }
+#else
+                    if (fseek(FileHandle, (off_t)DataNode->AbsoluteOffset, SEEK_SET) != 0)
+                    {
+                        DPRINT(MIN_TRACE, ("fseek() failed.\n"));
+                        Status = CAB_STATUS_INVALID_CAB;
+                        break;
+                    }
+#endif
+                }
+                ReadLength = 0;
+            }
+
+            ReadStart   = DataNode->AbsoluteOffset;
+            BytesToRead = FolderEnd - (ReadStart + ReadLength);
+            if (BytesToRead > CAB_READBUFFERSIZE - ReadLength)
+                BytesToRead = CAB_READBUFFERSIZE - ReadLength;
+
+            DPRINT(MAX_TRACE, ("Reading (%u bytes) at absolute offset (0x%X).\n",
+                (UINT)BytesToRead, (UINT)(ReadStart + ReadLength)));
+
+            if (((Status = ReadBlock(ReadBuffer + ReadLength, BytesToRead, &BytesRead)) !=
+                CAB_STATUS_SUCCESS) || (BytesRead != BytesToRead))
+            {
+                DPRINT(MIN_TRACE, ("Cannot read from file (%u).\n", (UINT)Status));
+                Status = CAB_STATUS_INVALID_CAB;
+                break;
+            }
+
+            ReadLength += BytesRead;
+            BlockOffset = 0;
+
+            if (Size > ReadLength)
+            {
+                Status = CAB_STATUS_INVALID_CAB;
+                break;
+            }
+        }
+
+        Status = Codec->Uncompress(OutputBuffer,
+                                   ReadBuffer + BlockOffset + sizeof(CFDATA),
+                                   DataNode->Data.CompSize,
+                                   &BytesToWrite);
+        if (Status != CS_SUCCESS)
+        {
+            DPRINT(MID_TRACE, ("Cannot uncompress block.\n"));
+            Status = (Status == CS_NOMEMORY ? CAB_STATUS_NOMEMORY : CAB_STATUS_INVALID_CAB);
+            break;
+        }
+
+        if (BytesToWrite != DataNode->Data.UncompSize)
+        {
+            DPRINT(MID_TRACE, ("BytesToWrite (%u) != UncompSize (%d)\n",
+                (UINT)BytesToWrite, DataNode->Data.UncompSize));
+            Status = CAB_STATUS_INVALID_CAB;
+            break;
+        }
+
+        /* Hand out the uncompressed data to all files it belongs to */
+        for (Index = First;
+             (Index < FileCount) && (Files[Index].File->File.FileOffset < BlockEnd);
+             Index++)
+        {
+            Extract = &Files[Index];
+            if (Extract->Done)
+                continue;
+
+            if (!Extract->Opened)
+            {
+                Status = CreateDestinationFile(Extract->File, Extract->File->FileName, &Extract->DestFile);
+                if (Status != CAB_STATUS_SUCCESS)
+                    break;
+
+                Extract->Opened = true;
+
+                OnExtract(&Extract->File->File, Extract->File->FileName);
+            }
+
+            Start = Extract->File->File.FileOffset +
+                Extract->File->File.FileSize - Extract->BytesLeft;
+
+            BytesToWrite = BlockEnd - Start;
+            if (BytesToWrite > Extract->BytesLeft)
+                BytesToWrite = Extract->BytesLeft;
+
+#if defined(_WIN32)
+            if (!WriteFile(Extract->DestFile, (void*)((PUCHAR)OutputBuffer + (Start - BlockStart)),
+                BytesToWrite, (LPDWORD)&BytesWritten, NULL) ||
+                (BytesToWrite != BytesWritten))
+            {
+                DPRINT(MIN_TRACE, ("Status 0x%X.\n", (UINT)GetLastError()));
+#else
+            if (fwrite((void*)((PUCHAR)OutputBuffer + (Start - BlockStart)),
+                BytesToWrite, 1, Extract->DestFile) < 1)
+            {
+#endif
+                DPRINT(MIN_TRACE, ("Cannot write to file.\n"));
+                Status = CAB_STATUS_CANNOT_WRITE;
+                break;
+            }
+
+            Extract->BytesLeft -= BytesToWrite;
+            if (Extract->BytesLeft == 0)
+            {
+                CloseFile(Extract->DestFile);
+                Extract->Opened = false;
+                Extract->Done   = true;
+            }
+        }
+
+        while ((First < FileCount) && Files[First].Done)
+            First++;
+
+        DataNode = DataNode->Next;
+    }
+
+    if ((Status == CAB_STATUS_SUCCESS) && (First < FileCount))
+    {
+        DPRINT(MIN_TRACE, ("Folder (%u) ends before file '%s'.\n",
+            (UINT)FolderNode->Index, Files[First].File->FileName));
+        Status = CAB_STATUS_INVALID_CAB;
+    }
+
+    for (Index = 0; Index < FileCount; Index++)
+    {
+        if (Files[Index].Opened)
+            CloseFile(Files[Index].DestFile);
+    }
+
+    FreeMemory(ReadBuffer);
+    FreeMemory(Files);
+
+    return Status;
+}
+
 bool CCabinet::IsCodecSelected()
 /*
  * FUNCTION: Returns the value of CodecSelected
@@ -2466,6 +2742,101 @@ ULONG CCabinet::LocateFile(char* FileName,
     return CAB_STATUS_NOFILE;
 }
 
+ULONG CCabinet::CreateDestinationFile(PCFFILE_NODE File,
+                                      char* FileName,
+                                      FILEHANDLE* DestFile)
+/*
+ * FUNCTION: Creates the destination file for a file being extracted
+ * ARGUMENTS:
+ *     File     = Pointer to CFFILE_NODE structure for file
+ *     FileName = Pointer to buffer with name of file
+ *     DestFile = Address of buffer to place handle of destination file
+ * RETURNS
+ *     Status of operation
+ */
+{
+#if defined(_WIN32)
+    ULONG Status;
+    FILETIME FileTime;
+#endif
+    CHAR DestName[PATH_MAX];
+
+    strcpy(DestName, DestPath);
+    strcat(DestName, FileName);
+
+    /* Create destination file, fail if it already exists */
+#if defined(_WIN32)
+    *DestFile = CreateFile(DestName,      // Create this file
+        GENERIC_WRITE,                   // Open for writing
+        0,                               // No sharing
+        NULL,                            // No security
+        CREATE_NEW,                      // New file only
+        FILE_ATTRIBUTE_NORMAL,           // Normal file
+        NULL);                           // No attribute template
+    if (*DestFile == INVALID_HANDLE_VALUE)
+    {
+        /* If file exists, ask to overwrite file */
+        if (((Status = GetLastError()) == ERROR_FILE_EXISTS) &&
+            (OnOverwrite(&File->File, FileName)))
+        {
+            /* Create destination file, overwrite if it already exists */
+            *DestFile = CreateFile(DestName, // Create this file
+                GENERIC_WRITE,              // Open for writing
+                0,                          // No sharing
+                NULL,                       // No security
+                TRUNCATE_EXISTING,          // Truncate the file
+                FILE_ATTRIBUTE_NORMAL,      // Normal file
+                NULL);                      // No attribute template
+            if (*DestFile == INVALID_HANDLE_VALUE)
+                return CAB_STATUS_CANNOT_CREATE;
+        }
+        else
+        {
+            if (Status == ERROR_FILE_EXISTS)
+                return CAB_STATUS_FILE_EXISTS;
+            else
+                return CAB_STATUS_CANNOT_CREATE;
+        }
+    }
+#else /* !_WIN32 */
+    *DestFile = fopen(DestName, "rb");
+    if (*DestFile != NULL)
+    {
+        fclose(*DestFile);
+        /* If file exists, ask to overwrite file */
+        if (OnOverwrite(&File->File, FileName))
+        {
+            *DestFile = fopen(DestName, "w+b");
+            if (*DestFile == NULL)
+                return CAB_STATUS_CANNOT_CREATE;
+        }
+        else
+            return CAB_STATUS_FILE_EXISTS;
+    }
+    else
+    {
+        *DestFile = fopen(DestName, "w+b");
+        if (*DestFile == NULL)
+            return CAB_STATUS_CANNOT_CREATE;
+    }
+#endif
+#if defined(_WIN32)
+    if (!DosDateTimeToFileTime(File->File.FileDate, File->File.FileTime, &FileTime))
+    {
+        CloseFile(*DestFile);
+        DPRINT(MIN_TRACE, ("DosDateTimeToFileTime() failed (%u).\n", (UINT)GetLastError()));
+        return CAB_STATUS_CANNOT_WRITE;
+    }
+
+    SetFileTime(*DestFile, NULL, &FileTime, NULL);
+#else
+    //DPRINT(MIN_TRACE, ("FIXME: DosDateTimeToFileTime\n"));
+#endif
+    SetAttributesOnFile(DestName, File->File.Attributes);
+
+    return CAB_STATUS_SUCCESS;
+}
+
 
 ULONG CCabinet::ReadString(char* String, LONG MaxLength)
 /*
@@ -3002,6 +3373,31 @@ ULONG CCabinet::ReadBlock(void* Buffer,
     return CAB_STATUS_SUCCESS;
 }
 
+bool CCabinet::MatchSearchCriteria(char* FileName)
+/*
+ * FUNCTION: Checks a file name against the search criteria
+ * ARGUMENTS:
+ *     FileName = The file name to check
+ * RETURNS:
+ *     Whether the file matches any of the search criteria
+ */
+{
+    PSEARCH_CRITERIA Criteria;
+
+    // Some features (like displaying cabinets) don't require search criteria, so we can just match everything here.
+    // If a feature requires it, handle this in the ParseCmdline() function in "main.cxx".
+    if (!CriteriaListHead)
+        return true;
+
+    for (Criteria = CriteriaListHead; Criteria != NULL; Criteria = Criteria->Next)
+    {
+        if (MatchFileNamePattern(FileName, Criteria->Search))
+            return true;
+    }
+
+    return false;
+}
+
 bool CCabinet::MatchFileNamePattern(char* FileName, char* Pattern)
 /*
  * FUNCTION: Matches a wildcard character pattern against a file
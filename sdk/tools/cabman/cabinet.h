@@ -97,6 +97,7 @@ extern ULONG DebugTraceLevel;
 #define CAB_SIGNATURE        0x4643534D // "MSCF"
 #define CAB_VERSION          0x0103
 #define CAB_BLOCKSIZE        32768
+#define CAB_READBUFFERSIZE   0x100000 // Read-ahead buffer used when extracting folders
 
 #define CAB_COMP_MASK        0x00FF
 #define CAB_COMP_NONE        0x0000
@@ -236,6 +237,15 @@ typedef struct _CAB_SEARCH
     char*             FileName;  // Current filename
 } CAB_SEARCH, *PCAB_SEARCH;
 
+typedef struct _CAB_EXTRACT
+{
+    PCFFILE_NODE      File;      // File being extracted
+    FILEHANDLE        DestFile;  // Destination file (valid if Opened is true)
+    ULONG             BytesLeft; // Number of bytes still to be written
+    bool              Opened;    // true if the destination file is open
+    bool              Done;      // true if the file has been completely written
+} CAB_EXTRACT, *PCAB_EXTRACT;
+
 
 /* Constants */
 
@@ -356,6 +366,8 @@ public:
     ULONG FindNext(PCAB_SEARCH Search);
     /* Extracts a file from the current cabinet file */
     ULONG ExtractFile(char* FileName);
+    /* Extracts all files matching the search criteria, decompressing each folder once */
+    ULONG ExtractFiles();
     /* Select codec engine to use */
     void SelectCodec(LONG Id);
     /* Returns whether a codec engine is selected */
@@ -414,6 +426,8 @@ private:
     PCFFOLDER_NODE LocateFolderNode(ULONG Index);
     ULONG GetAbsoluteOffset(PCFFILE_NODE File);
     ULONG LocateFile(char* FileName, PCFFILE_NODE *File);
+    ULONG CreateDestinationFile(PCFFILE_NODE File, char* FileName, FILEHANDLE* DestFile);
+    ULONG ExtractFolder(PCFFOLDER_NODE FolderNode);
     ULONG ReadString(char* String, LONG MaxLength);
     ULONG ReadFileTable();
     ULONG ReadDataBlocks(PCFFOLDER_NODE FolderNode);
@@ -428,6 +442,7 @@ private:
     ULONG ComputeChecksum(void* Buffer, ULONG Size, ULONG Seed);
     ULONG ReadBlock(void* Buffer, ULONG Size, PULONG BytesRead);
     bool MatchFileNamePattern(char* FileName, char* Pattern);
+    bool MatchSearchCriteria(char* FileName);
 #ifndef CAB_READ_ONLY
     ULONG InitCabinetHeader();
     ULONG WriteCabinetHeader(bool MoreDisks);
@@ -499,7 +499,6 @@ bool CCABManager::ExtractFromCabinet()
  */
 {
     bool bRet = true;
-    CAB_SEARCH Search;
     ULONG Status;
 
     if (Open() == CAB_STATUS_SUCCESS)
@@ -509,43 +508,34 @@ bool CCABManager::ExtractFromCabinet()
             printf("Cabinet %s\n\n", GetCabinetName());
         }
 
-        if (FindFirst(&Search) == CAB_STATUS_SUCCESS)
+        switch (Status = ExtractFiles())
         {
-            do
-            {
-                switch (Status = ExtractFile(Search.FileName))
-                {
-                    case CAB_STATUS_SUCCESS:
-                        break;
-
-                    case CAB_STATUS_INVALID_CAB:
-                        printf("ERROR: Cabinet contains errors.\n");
-                        bRet = false;
-                        break;
-
-                    case CAB_STATUS_UNSUPPCOMP:
-                        printf("ERROR: Cabinet uses unsupported compression type.\n");
-                        bRet = false;
-                        break;
-
-                    case CAB_STATUS_CANNOT_WRITE:
-                        printf("ERROR: You've run out of free space on the destination volume or the volume is damaged.\n");
-                        bRet = false;
-                        break;
-
-                    default:
-                        printf("ERROR: Unspecified error code (%u).\n", (UINT)Status);
-                        bRet = false;
-                        break;
-                }
-
-                if(!bRet)
-                    break;
-            } while (FindNext(&Search) == CAB_STATUS_SUCCESS);
-
-            DestroySearchCriteria();
+            case CAB_STATUS_SUCCESS:
+                break;
+
+            case CAB_STATUS_INVALID_CAB:
+                printf("ERROR: Cabinet contains errors.\n");
+                bRet = false;
+                break;
+
+            case CAB_STATUS_UNSUPPCOMP:
+                printf("ERROR: Cabinet uses unsupported compression type.\n");
+                bRet = false;
+                break;
+
+            case CAB_STATUS_CANNOT_WRITE:
+                printf("ERROR: You've run out of free space on the destination volume or the volume is damaged.\n");
+                bRet = false;
+                break;
+
+            default:
+                printf("ERROR: Unspecified error code (%u).\n", (UINT)Status);
+                bRet = false;
+                break;
         }
 
+        DestroySearchCriteria();
+
         return bRet;
     }
     else
@@ -9,6 +9,8 @@
 
 #include "diskio.h"		/* FatFs lower layer API */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*-----------------------------------------------------------------------*/
 /* Correspondence between physical drive number and image file handles.  */
@@ -17,6 +19,94 @@ UINT sectorCount[1] = { 0 };
 FILE* driveHandle[1] = { NULL };
 const int driveHandleCount = sizeof(driveHandle) / sizeof(FILE*);
 
+/*-----------------------------------------------------------------------*/
+/* The whole image is kept in memory and all sector I/O is done there.   */
+/* driveSaved holds what the image file currently contains, so that only */
+/* the sectors which really changed are written back, in large runs.     */
+
+BYTE* driveImage[1] = { NULL };
+BYTE* driveSaved[1] = { NULL };
+UINT imageSectors[1] = { 0 };
+UINT savedSectors[1] = { 0 };
+
+/*-----------------------------------------------------------------------*/
+/* Grow the in-memory image of a Drive                                   */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT disk_growimage(BYTE pdrv, UINT count)
+{
+    BYTE* image;
+    BYTE* saved;
+
+    if (count <= imageSectors[pdrv])
+        return RES_OK;
+
+    image = realloc(driveImage[pdrv], (size_t)count * 512);
+    if (!image)
+        return RES_ERROR;
+    driveImage[pdrv] = image;
+
+    saved = realloc(driveSaved[pdrv], (size_t)count * 512);
+    if (!saved)
+        return RES_ERROR;
+    driveSaved[pdrv] = saved;
+
+    /* New sectors read back as zeroes, like a freshly extended file */
+    memset(image + (size_t)imageSectors[pdrv] * 512, 0, (size_t)(count - imageSectors[pdrv]) * 512);
+    imageSectors[pdrv] = count;
+
+    return RES_OK;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Write the changed sectors of a Drive back to its image file           */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT disk_flushimage(BYTE pdrv)
+{
+    UINT sector = 0;
+    UINT first;
+    size_t offset, length;
+
+    while (sector < imageSectors[pdrv])
+    {
+        /* Skip the sectors that the file already has */
+        if (sector < savedSectors[pdrv] &&
+            !memcmp(driveImage[pdrv] + (size_t)sector * 512, driveSaved[pdrv] + (size_t)sector * 512, 512))
+        {
+            sector++;
+            continue;
+        }
+
+        /* Collect the run of changed (or new) sectors */
+        first = sector++;
+        while (sector < imageSectors[pdrv] &&
+               (sector >= savedSectors[pdrv] ||
+                memcmp(driveImage[pdrv] + (size_t)sector * 512, driveSaved[pdrv] + (size_t)sector * 512, 512)))
+        {
+            sector++;
+        }
+
+        offset = (size_t)first * 512;
+        length = (size_t)(sector - first) * 512;
+
+        if (fseek(driveHandle[pdrv], (long)offset, SEEK_SET))
+            return RES_ERROR;
+
+        if (fwrite(driveImage[pdrv] + offset, 1, length, driveHandle[pdrv]) != length)
+            return RES_ERROR;
+
+        memcpy(driveSaved[pdrv] + offset, driveImage[pdrv] + offset, length);
+    }
+
+    savedSectors[pdrv] = imageSectors[pdrv];
+
+    if (fflush(driveHandle[pdrv]))
+        return RES_ERROR;
+
+    return RES_OK;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Open an image file a Drive                                            */
 /*-----------------------------------------------------------------------*/
@@ -35,7 +125,28 @@ DSTATUS disk_openimage(BYTE pdrv, const char* imageFileName)
         }
 
         if (driveHandle[0] != NULL)
-            return 0;
+        {
+            long size;
+            UINT count;
+
+            /* Load the existing image, a trailing partial sector is zero-padded */
+            if (fseek(driveHandle[0], 0, SEEK_END) == 0 &&
+                (size = ftell(driveHandle[0])) >= 0 &&
+                disk_growimage(0, (UINT)((size + 511) / 512)) == RES_OK)
+            {
+                rewind(driveHandle[0]);
+                count = size ? (UINT)fread(driveImage[0], 1, size, driveHandle[0]) : 0;
+                if (count == (UINT)size)
+                {
+                    if (size)
+                        memcpy(driveSaved[0], driveImage[0], (size_t)imageSectors[0] * 512);
+                    savedSectors[0] = (UINT)(size / 512);
+                    return 0;
+                }
+            }
+
+            disk_cleanup(0);
+        }
     }
     return STA_NOINIT;
 }
@@ -45,18 +156,33 @@ DSTATUS disk_openimage(BYTE pdrv, const char* imageFileName)
 /* Cleanup a Drive                                                       */
 /*-----------------------------------------------------------------------*/
 
-VOID disk_cleanup(
+DRESULT disk_cleanup(
     BYTE pdrv		/* Physical drive nmuber (0..) */
     )
 {
+    DRESULT res = RES_OK;
+
     if (pdrv < driveHandleCount)
     {
         if (driveHandle[pdrv] != NULL)
         {
-            fclose(driveHandle[pdrv]);
+            if (driveImage[pdrv] != NULL && disk_flushimage(pdrv) != RES_OK)
+                res = RES_ERROR;
+
+            if (fclose(driveHandle[pdrv]))
+                res = RES_ERROR;
             driveHandle[pdrv] = NULL;
         }
+
+        free(driveImage[pdrv]);
+        free(driveSaved[pdrv]);
+        driveImage[pdrv] = NULL;
+        driveSaved[pdrv] = NULL;
+        imageSectors[pdrv] = 0;
+        savedSectors[pdrv] = 0;
     }
+
+    return res;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -103,19 +229,14 @@ DRESULT disk_read(
     UINT count		/* Number of sectors to read (1..128) */
     )
 {
-    DWORD result;
-
     if (pdrv < driveHandleCount)
     {
         if (driveHandle[pdrv] != NULL)
         {
-            if (fseek(driveHandle[pdrv], sector * 512, SEEK_SET))
+            if (sector >= imageSectors[pdrv] || count > imageSectors[pdrv] - sector)
                 return RES_ERROR;
 
-            result = fread(buff, 512, count, driveHandle[pdrv]);
-
-            if (result != count)
-                return RES_ERROR;
+            memcpy(buff, driveImage[pdrv] + (size_t)sector * 512, (size_t)count * 512);
 
             return RES_OK;
         }
@@ -138,19 +259,15 @@ DRESULT disk_write(
     UINT count			/* Number of sectors to write (1..128) */
     )
 {
-    DWORD result;
-
     if (pdrv < driveHandleCount)
     {
         if (driveHandle[pdrv] != NULL)
         {
-            if (fseek(driveHandle[pdrv], sector * 512, SEEK_SET))
+            /* Writing past the end extends the image */
+            if (disk_growimage(pdrv, sector + count) != RES_OK)
                 return RES_ERROR;
 
-            result = fwrite(buff, 512, count, driveHandle[pdrv]);
-
-            if (result != count)
-                return RES_ERROR;
+            memcpy(driveImage[pdrv] + (size_t)sector * 512, buff, (size_t)count * 512);
 
             return RES_OK;
         }
@@ -179,8 +296,8 @@ DRESULT disk_ioctl(
             switch (cmd)
             {
             case CTRL_SYNC:
-                fflush(driveHandle[pdrv]);
-                return RES_OK;
+                /* Write back what changed, so f_sync and f_close report failures */
+                return disk_flushimage(pdrv);
             case GET_SECTOR_SIZE:
                 *(DWORD*)buff = 512;
                 return RES_OK;
@@ -190,12 +307,7 @@ DRESULT disk_ioctl(
             case GET_SECTOR_COUNT:
             {
                 if (sectorCount[pdrv] <= 0)
-                {
-                    if (fseek(driveHandle[pdrv], 0, SEEK_END))
-                        printf("fseek failed!\n");
-                    else
-                        sectorCount[pdrv] = ftell(driveHandle[pdrv]) / 512;
-                }
+                    sectorCount[pdrv] = imageSectors[pdrv];
 
                 *(DWORD*)buff = sectorCount[pdrv];
                 return RES_OK;
@@ -203,21 +315,12 @@ DRESULT disk_ioctl(
             case SET_SECTOR_COUNT:
             {
                 int count = *(DWORD*)buff;
-                long size;
 
                 sectorCount[pdrv] = count;
 
-                fseek(driveHandle[pdrv], 0, SEEK_END);
-                size = ftell(driveHandle[pdrv]) / 512;
-
-                if (size < count)
+                if (imageSectors[pdrv] < (UINT)count)
                 {
-                    if (fseek(driveHandle[pdrv], count * 512 - 1, SEEK_SET))
-                        return RES_ERROR;
-
-                    fwrite(buff, 1, 1, driveHandle[pdrv]);
-
-                    return RES_OK;
+                    return disk_growimage(pdrv, count);
                 }
                 else
                 {
@@ -32,7 +32,7 @@ typedef enum {
 /* Prototypes for disk control functions */
 
 DSTATUS disk_openimage(BYTE pdrv, const char* imageFileName);
-VOID disk_cleanup(BYTE pdrv);
+DRESULT disk_cleanup(BYTE pdrv);
 
 DSTATUS disk_initialize (BYTE pdrv);
 DSTATUS disk_status (BYTE pdrv);
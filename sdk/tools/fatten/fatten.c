@@ -567,7 +567,11 @@ int main(int oargc, char* oargv[])
 
 exit:
 
-    disk_cleanup(0);
+    if (disk_cleanup(0) != RES_OK)
+    {
+        fprintf(stderr, "Error: Failed to write back the image file.\n");
+        ret = 1;
+    }
 
     return ret;
 }
@@ -40,19 +40,22 @@ find_offset(void *data, size_t offset)
     PSYMBOLFILE_HEADER RosSymHeader = (PSYMBOLFILE_HEADER)data;
     PROSSYM_ENTRY Entries = (PROSSYM_ENTRY)((char *)data + RosSymHeader->SymbolsOffset);
     size_t symbols = RosSymHeader->SymbolsLength / sizeof(ROSSYM_ENTRY);
-    size_t i;
+    size_t low = 0, high = symbols, mid;
 
-    for (i = 0; i < symbols; i++)
+    /* rsym sorts the entries by address, find the first one above offset */
+    while (low < high)
     {
-        if (Entries[i].Address > offset)
-        {
-            if (!i--)
-                return NULL;
-            else
-                return &Entries[i];
-        }
+        mid = low + (high - low) / 2;
+        if (Entries[mid].Address > offset)
+            high = mid;
+        else
+            low = mid + 1;
     }
-    return NULL;
+
+    /* Like before, an offset past the last entry is not resolved */
+    if (low == 0 || low == symbols)
+        return NULL;
+    return &Entries[low - 1];
 }
 
 PIMAGE_SECTION_HEADER
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <rsym.h>
 
 #include "config.h"
 #include "compat.h"
@@ -216,4 +217,52 @@ sources_entry_create(PLIST list, char *path, char *prefix)
     return pentry;
 }
 
+/* Load an image once and keep it (and its rossym section) in memory.
+ * The whole file is kept in buf, the lookup name is stored behind it.
+ */
+PLIST_MEMBER
+module_entry_create(PLIST list, char *name, const char *path)
+{
+    PLIST_MEMBER pentry;
+    void *FileData;
+    size_t FileSize;
+    char *s;
+
+    if (!name || !path)
+        return NULL;
+
+    pentry = malloc(sizeof(LIST_MEMBER));
+    if (!pentry)
+        return NULL;
+
+    pentry->buf = NULL;
+    FileData = load_file(path, &FileSize);
+    if (!FileData)
+    {
+        l2l_dbg(0, "An error occured loading '%s'\n", path);
+        return entry_delete(pentry);
+    }
+
+    s = realloc(FileData, FileSize + strlen(name) + 1);
+    if (!s)
+    {
+        l2l_dbg(1, "Alloc entry failed\n");
+        free(FileData);
+        return entry_delete(pentry);
+    }
+
+    pentry->buf = s;
+    pentry->name = s + FileSize;
+    strcpy(pentry->name, name);
+    pentry->path = pentry->name;
+    pentry->ImageBase = INVALID_BASE;
+    pentry->RelBase = INVALID_BASE;
+    pentry->Size = FileSize;
+
+    l2l_dbg(2, "Loaded module %s (%s, %u bytes)\n", name, path, (unsigned int)FileSize);
+    if (list)
+        entry_insert(list, pentry);
+    return pentry;
+}
+
 /* EOF */
@@ -22,6 +22,7 @@ PLIST_MEMBER entry_delete(PLIST_MEMBER pentry);
 PLIST_MEMBER entry_insert(PLIST list, PLIST_MEMBER pentry);
 PLIST_MEMBER cache_entry_create(char *Line);
 PLIST_MEMBER sources_entry_create(PLIST list, char *path, char *prefix);
+PLIST_MEMBER module_entry_create(PLIST list, char *name, const char *path);
 void list_clear(PLIST list);
 
 /* EOF */
@@ -33,6 +33,7 @@ LIST sources;
 LINEINFO lastLine;
 FILE *logFile        = NULL;
 LIST cache;
+LIST modules;
 SUMM summ;
 REVINFO revinfo;
 
@@ -241,23 +242,15 @@ process_data(const void *FileData, size_t offset, char *toString)
 }
 
 static int
-process_file(const char *file_name, size_t offset, char *toString)
+process_file(const char *file_name, char *name, size_t offset, char *toString)
 {
-    void *FileData;
-    size_t FileSize;
-    int res = 1;
+    PLIST_MEMBER pentry;
 
-    FileData = load_file(file_name, &FileSize);
-    if (!FileData)
-    {
-        l2l_dbg(0, "An error occured loading '%s'\n", file_name);
-    }
-    else
-    {
-        res = process_data(FileData, offset, toString);
-        free(FileData);
-    }
-    return res;
+    pentry = module_entry_create(&modules, name, file_name);
+    if (!pentry)
+        return 1;
+
+    return process_data(pentry->buf, offset, toString);
 }
 
 static int
@@ -272,6 +265,15 @@ translate_file(const char *cpath, size_t offset, char *toString)
     if (!path)
         return 1;
 
+    // Already loaded images are translated from memory:
+    pentry = entry_lookup(&modules, path);
+    if (pentry)
+    {
+        res = process_data(pentry->buf, offset, toString);
+        free(dpath);
+        return res;
+    }
+
     // The path could be absolute:
     if (get_ImageBase(path, &base))
     {
@@ -295,7 +297,7 @@ translate_file(const char *cpath, size_t offset, char *toString)
 
     if (!res)
     {
-        res = process_file(path, offset, toString);
+        res = process_file(path, dpath, offset, toString);
     }
 
     free(dpath);
@@ -576,6 +578,7 @@ main(int argc, const char **argv)
 
     memset(&cache, 0, sizeof(LIST));
     memset(&sources, 0, sizeof(LIST));
+    memset(&modules, 0, sizeof(LIST));
     stat_clear(&summ);
     memset(&revinfo, 0, sizeof(REVINFO));
     clearLastLine();
@@ -668,6 +671,8 @@ main(int argc, const char **argv)
     if (opt_Pipe)
         PCLOSE(dbgIn);
 
+    list_clear(&modules);
+
     return res;
 }
 
@@ -29,5 +29,6 @@ extern LIST cache;
 extern FILE *logFile;
 extern LINEINFO lastLine;
 extern LIST sources;
+extern LIST modules;
 
 /* EOF */
@@ -27,32 +27,102 @@
 /* INCLUDES *****************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 
 #include "mkhive.h"
 
+static BOOL
+IsHiveFileUpToDate(
+    IN PCSTR FileName,
+    IN PHIVE_IMAGE Image)
+{
+    FILE *File;
+    PUCHAR Buffer;
+    long Size;
+    BOOL ret = FALSE;
+
+    File = fopen(FileName, "rb");
+    if (File == NULL)
+        return FALSE;
+
+    /* Only a file of the very same size can hold the same hive */
+    if (fseek(File, 0, SEEK_END) == 0 &&
+        (Size = ftell(File)) == (long)Image->Length &&
+        fseek(File, 0, SEEK_SET) == 0)
+    {
+        Buffer = malloc(Image->Length);
+        if (Buffer != NULL)
+        {
+            ret = (fread(Buffer, 1, Image->Length, File) == Image->Length) &&
+                  (memcmp(Buffer, Image->Buffer, Image->Length) == 0);
+            free(Buffer);
+        }
+    }
+
+    fclose(File);
+    return ret;
+}
+
 BOOL
 ExportBinaryHive(
     IN PCSTR FileName,
     IN PCMHIVE CmHive)
 {
+    HIVE_IMAGE Image;
     FILE *File;
     BOOL ret;
 
     printf("  Creating binary hive: %s\n", FileName);
 
+    /* Build the whole hive file in memory: the base block and all the bins */
+    Image.Length = 0;
+    Image.MaximumLength = HBLOCK_SIZE + CmHive->Hive.Storage[Stable].Length * HBLOCK_SIZE;
+    Image.Buffer = malloc(Image.MaximumLength);
+    if (Image.Buffer == NULL)
+    {
+        printf("    Error allocating hive image\n");
+        return FALSE;
+    }
+
+    CmHive->FileHandles[HFILE_TYPE_PRIMARY] = (HANDLE)&Image;
+    ret = HvWriteHive(&CmHive->Hive);
+    CmHive->FileHandles[HFILE_TYPE_PRIMARY] = NULL;
+    if (!ret)
+    {
+        printf("    Error writing hive\n");
+        free(Image.Buffer);
+        return FALSE;
+    }
+
+    /*
+     * The generated hives don't carry any time stamps, so unchanged inputs
+     * give the very same file. Keep it untouched then, so that whatever
+     * depends on it doesn't need to be rebuilt.
+     */
+    if (IsHiveFileUpToDate(FileName, &Image))
+    {
+        printf("    Hive is up to date\n");
+        free(Image.Buffer);
+        return TRUE;
+    }
+
     /* Create new hive file */
     File = fopen(FileName, "wb");
     if (File == NULL)
     {
         printf("    Error creating/opening file\n");
+        free(Image.Buffer);
         return FALSE;
     }
 
-    fseek(File, 0, SEEK_SET);
+    ret = (fwrite(Image.Buffer, 1, Image.Length, File) == Image.Length);
+    if (fclose(File) != 0)
+        ret = FALSE;
 
-    CmHive->FileHandles[HFILE_TYPE_PRIMARY] = (HANDLE)File;
-    ret = HvWriteHive(&CmHive->Hive);
-    fclose(File);
+    if (!ret)
+        printf("    Error writing file\n");
+
+    free(Image.Buffer);
     return ret;
 }
 
@@ -26,6 +26,14 @@
 
 #pragma once
 
+/* In-memory image of a hive file, filled by HvWriteHive() */
+typedef struct _HIVE_IMAGE
+{
+    PUCHAR Buffer;
+    ULONG Length;
+    ULONG MaximumLength;
+} HIVE_IMAGE, *PHIVE_IMAGE;
+
 BOOL
 ExportBinaryHive(
     IN PCSTR FileName,
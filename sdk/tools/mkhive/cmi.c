@@ -56,11 +56,12 @@ CmpFileRead(
     IN SIZE_T BufferLength)
 {
     PCMHIVE CmHive = (PCMHIVE)RegistryHive;
-    FILE *File = CmHive->FileHandles[HFILE_TYPE_PRIMARY];
-    if (fseek(File, *FileOffset, SEEK_SET) != 0)
+    PHIVE_IMAGE Image = (PHIVE_IMAGE)CmHive->FileHandles[HFILE_TYPE_PRIMARY];
+    if (*FileOffset > Image->Length || BufferLength > Image->Length - *FileOffset)
         return FALSE;
 
-    return (fread(Buffer, 1, BufferLength, File) == BufferLength);
+    memcpy(Buffer, Image->Buffer + *FileOffset, BufferLength);
+    return TRUE;
 }
 
 static BOOLEAN
@@ -73,11 +74,29 @@ CmpFileWrite(
     IN SIZE_T BufferLength)
 {
     PCMHIVE CmHive = (PCMHIVE)RegistryHive;
-    FILE *File = CmHive->FileHandles[HFILE_TYPE_PRIMARY];
-    if (fseek(File, *FileOffset, SEEK_SET) != 0)
-        return FALSE;
+    PHIVE_IMAGE Image = (PHIVE_IMAGE)CmHive->FileHandles[HFILE_TYPE_PRIMARY];
+    ULONG NewLength = *FileOffset + (ULONG)BufferLength;
+    PUCHAR NewBuffer;
+
+    if (NewLength > Image->MaximumLength)
+    {
+        NewBuffer = realloc(Image->Buffer, NewLength);
+        if (!NewBuffer)
+            return FALSE;
+
+        Image->Buffer = NewBuffer;
+        Image->MaximumLength = NewLength;
+    }
+
+    /* Zero any gap left before this write */
+    if (*FileOffset > Image->Length)
+        memset(Image->Buffer + Image->Length, 0, *FileOffset - Image->Length);
 
-    return (fwrite(Buffer, 1, BufferLength, File) == BufferLength);
+    memcpy(Image->Buffer + *FileOffset, Buffer, BufferLength);
+    if (NewLength > Image->Length)
+        Image->Length = NewLength;
+
+    return TRUE;
 }
 
 static BOOLEAN
@@ -100,9 +119,8 @@ CmpFileFlush(
     PLARGE_INTEGER FileOffset,
     ULONG Length)
 {
-    PCMHIVE CmHive = (PCMHIVE)RegistryHive;
-    FILE *File = CmHive->FileHandles[HFILE_TYPE_PRIMARY];
-    return (fflush(File) == 0);
+    /* The image is written out by ExportBinaryHive() */
+    return TRUE;
 }
 
 NTSTATUS
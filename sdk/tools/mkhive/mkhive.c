@@ -28,6 +28,7 @@
 #include <limits.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "mkhive.h"
 
@@ -83,9 +84,15 @@ void convert_path(char *dst, char *src)
     dst[i] = 0;
 }
 
+static unsigned long elapsed_ms(clock_t start)
+{
+    return (unsigned long)((clock() - start) * 1000 / CLOCKS_PER_SEC);
+}
+
 int main (int argc, char *argv[])
 {
     char FileName[PATH_MAX];
+    clock_t PhaseStart;
     int i;
 
     if (argc < 3)
@@ -98,6 +105,8 @@ int main (int argc, char *argv[])
 
     RegInitializeRegistry ();
 
+    PhaseStart = clock ();
+
     for (i = 2; i < argc; i++)
     {
         convert_path (FileName, argv[i]);
@@ -107,6 +116,10 @@ int main (int argc, char *argv[])
         }
     }
 
+    printf ("  Imported %d inf file(s) in %lu ms\n", argc - 2, elapsed_ms (PhaseStart));
+
+    PhaseStart = clock ();
+
     convert_path (FileName, argv[1]);
     strcat (FileName, DIR_SEPARATOR_STRING);
     strcat (FileName, "default");
@@ -155,6 +168,8 @@ int main (int argc, char *argv[])
         return 1;
     }
 
+    printf ("  Exported hives in %lu ms\n", elapsed_ms (PhaseStart));
+
     RegShutdownRegistry ();
 
     printf ("  Done.\n");
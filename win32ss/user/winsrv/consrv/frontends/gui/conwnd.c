@@ -1022,6 +1022,9 @@ GuiPaintGraphicsBuffer(PGRAPHICS_SCREEN_BUFFER Buffer,
                        PRECT rcView,
                        PRECT rcFramebuffer);
 
+VOID
+FlushDirtyRegion(PGUI_CONSOLE_DATA GuiData);
+
 static VOID
 OnPaint(PGUI_CONSOLE_DATA GuiData)
 {
@@ -1032,6 +1035,13 @@ OnPaint(PGUI_CONSOLE_DATA GuiData)
     /* Do nothing if the window is hidden */
     if (!GuiData->IsWindowVisible) return;
 
+    /* Apply the accumulated scroll before painting fresh contents */
+    if (ConDrvValidateConsoleUnsafe((PCONSOLE)GuiData->Console, CONSOLE_RUNNING, TRUE))
+    {
+        FlushDirtyRegion(GuiData);
+        LeaveCriticalSection(&GuiData->Console->Lock);
+    }
+
     BeginPaint(GuiData->hWindow, &ps);
     if (ps.hdc != NULL &&
         ps.rcPaint.left < ps.rcPaint.right &&
@@ -1287,6 +1297,93 @@ VOID
 InvalidateCell(PGUI_CONSOLE_DATA GuiData,
                SHORT x, SHORT y);
 
+/* Scroll the view so that the cursor stays visible. The console lock must be held. */
+static VOID
+FollowCursor(PGUI_CONSOLE_DATA GuiData,
+             PCONSOLE_SCREEN_BUFFER Buff)
+{
+    if ((GuiData->OldCursor.x != Buff->CursorPosition.X) ||
+        (GuiData->OldCursor.y != Buff->CursorPosition.Y))
+    {
+        SCROLLINFO sInfo;
+        int OldScrollX = -1, OldScrollY = -1;
+        int NewScrollX = -1, NewScrollY = -1;
+
+        sInfo.cbSize = sizeof(sInfo);
+        sInfo.fMask = SIF_POS;
+        // Capture the original position of the scroll bars and save them.
+        if (GetScrollInfo(GuiData->hWindow, SB_HORZ, &sInfo)) OldScrollX = sInfo.nPos;
+        if (GetScrollInfo(GuiData->hWindow, SB_VERT, &sInfo)) OldScrollY = sInfo.nPos;
+
+        // If we successfully got the info for the horizontal scrollbar
+        if (OldScrollX >= 0)
+        {
+            if ((Buff->CursorPosition.X < Buff->ViewOrigin.X) ||
+                (Buff->CursorPosition.X >= (Buff->ViewOrigin.X + Buff->ViewSize.X)))
+            {
+                // Handle the horizontal scroll bar
+                if (Buff->CursorPosition.X >= Buff->ViewSize.X)
+                    NewScrollX = Buff->CursorPosition.X - Buff->ViewSize.X + 1;
+                else
+                    NewScrollX = 0;
+            }
+            else
+            {
+                NewScrollX = OldScrollX;
+            }
+        }
+        // If we successfully got the info for the vertical scrollbar
+        if (OldScrollY >= 0)
+        {
+            if ((Buff->CursorPosition.Y < Buff->ViewOrigin.Y) ||
+                (Buff->CursorPosition.Y >= (Buff->ViewOrigin.Y + Buff->ViewSize.Y)))
+            {
+                // Handle the vertical scroll bar
+                if (Buff->CursorPosition.Y >= Buff->ViewSize.Y)
+                    NewScrollY = Buff->CursorPosition.Y - Buff->ViewSize.Y + 1;
+                else
+                    NewScrollY = 0;
+            }
+            else
+            {
+                NewScrollY = OldScrollY;
+            }
+        }
+
+        // Adjust scroll bars and refresh the window if the cursor has moved outside the visible area
+        // NOTE: OldScroll# and NewScroll# will both be -1 (initial value) if the info for the respective scrollbar
+        //       was not obtained successfully in the previous steps. This means their difference is 0 (no scrolling)
+        //       and their associated scrollbar is left alone.
+        if ((OldScrollX != NewScrollX) || (OldScrollY != NewScrollY))
+        {
+            Buff->ViewOrigin.X = NewScrollX;
+            Buff->ViewOrigin.Y = NewScrollY;
+            ScrollWindowEx(GuiData->hWindow,
+                           (OldScrollX - NewScrollX) * GuiData->CharWidth,
+                           (OldScrollY - NewScrollY) * GuiData->CharHeight,
+                           NULL,
+                           NULL,
+                           NULL,
+                           NULL,
+                           SW_INVALIDATE);
+            if (NewScrollX >= 0)
+            {
+                sInfo.nPos = NewScrollX;
+                SetScrollInfo(GuiData->hWindow, SB_HORZ, &sInfo, TRUE);
+            }
+            if (NewScrollY >= 0)
+            {
+                sInfo.nPos = NewScrollY;
+                SetScrollInfo(GuiData->hWindow, SB_VERT, &sInfo, TRUE);
+            }
+            UpdateWindow(GuiData->hWindow);
+            // InvalidateRect(GuiData->hWindow, NULL, FALSE);
+            GuiData->OldCursor.x = Buff->CursorPosition.X;
+            GuiData->OldCursor.y = Buff->CursorPosition.Y;
+        }
+    }
+}
+
 static VOID
 OnTimer(PGUI_CONSOLE_DATA GuiData)
 {
@@ -1307,86 +1404,9 @@ OnTimer(PGUI_CONSOLE_DATA GuiData)
         InvalidateCell(GuiData, Buff->CursorPosition.X, Buff->CursorPosition.Y);
         Buff->CursorBlinkOn = !Buff->CursorBlinkOn;
 
-        if ((GuiData->OldCursor.x != Buff->CursorPosition.X) ||
-            (GuiData->OldCursor.y != Buff->CursorPosition.Y))
-        {
-            SCROLLINFO sInfo;
-            int OldScrollX = -1, OldScrollY = -1;
-            int NewScrollX = -1, NewScrollY = -1;
-
-            sInfo.cbSize = sizeof(sInfo);
-            sInfo.fMask = SIF_POS;
-            // Capture the original position of the scroll bars and save them.
-            if (GetScrollInfo(GuiData->hWindow, SB_HORZ, &sInfo)) OldScrollX = sInfo.nPos;
-            if (GetScrollInfo(GuiData->hWindow, SB_VERT, &sInfo)) OldScrollY = sInfo.nPos;
-
-            // If we successfully got the info for the horizontal scrollbar
-            if (OldScrollX >= 0)
-            {
-                if ((Buff->CursorPosition.X < Buff->ViewOrigin.X) ||
-                    (Buff->CursorPosition.X >= (Buff->ViewOrigin.X + Buff->ViewSize.X)))
-                {
-                    // Handle the horizontal scroll bar
-                    if (Buff->CursorPosition.X >= Buff->ViewSize.X)
-                        NewScrollX = Buff->CursorPosition.X - Buff->ViewSize.X + 1;
-                    else
-                        NewScrollX = 0;
-                }
-                else
-                {
-                    NewScrollX = OldScrollX;
-                }
-            }
-            // If we successfully got the info for the vertical scrollbar
-            if (OldScrollY >= 0)
-            {
-                if ((Buff->CursorPosition.Y < Buff->ViewOrigin.Y) ||
-                    (Buff->CursorPosition.Y >= (Buff->ViewOrigin.Y + Buff->ViewSize.Y)))
-                {
-                    // Handle the vertical scroll bar
-                    if (Buff->CursorPosition.Y >= Buff->ViewSize.Y)
-                        NewScrollY = Buff->CursorPosition.Y - Buff->ViewSize.Y + 1;
-                    else
-                        NewScrollY = 0;
-                }
-                else
-                {
-                    NewScrollY = OldScrollY;
-                }
-            }
-
-            // Adjust scroll bars and refresh the window if the cursor has moved outside the visible area
-            // NOTE: OldScroll# and NewScroll# will both be -1 (initial value) if the info for the respective scrollbar
-            //       was not obtained successfully in the previous steps. This means their difference is 0 (no scrolling)
-            //       and their associated scrollbar is left alone.
-            if ((OldScrollX != NewScrollX) || (OldScrollY != NewScrollY))
-            {
-                Buff->ViewOrigin.X = NewScrollX;
-                Buff->ViewOrigin.Y = NewScrollY;
-                ScrollWindowEx(GuiData->hWindow,
-                               (OldScrollX - NewScrollX) * GuiData->CharWidth,
-                               (OldScrollY - NewScrollY) * GuiData->CharHeight,
-                               NULL,
-                               NULL,
-                               NULL,
-                               NULL,
-                               SW_INVALIDATE);
-                if (NewScrollX >= 0)
-                {
-                    sInfo.nPos = NewScrollX;
-                    SetScrollInfo(GuiData->hWindow, SB_HORZ, &sInfo, TRUE);
-                }
-                if (NewScrollY >= 0)
-                {
-                    sInfo.nPos = NewScrollY;
-                    SetScrollInfo(GuiData->hWindow, SB_VERT, &sInfo, TRUE);
-                }
-                UpdateWindow(GuiData->hWindow);
-                // InvalidateRect(GuiData->hWindow, NULL, FALSE);
-                GuiData->OldCursor.x = Buff->CursorPosition.X;
-                GuiData->OldCursor.y = Buff->CursorPosition.Y;
-            }
-        }
+        /* Scroll first, so that FollowCursor works on the up-to-date view */
+        FlushDirtyRegion(GuiData);
+        FollowCursor(GuiData, Buff);
     }
     else /* if (GetType(Buff) == GRAPHICS_BUFFER) */
     {
@@ -1395,6 +1415,36 @@ OnTimer(PGUI_CONSOLE_DATA GuiData)
     LeaveCriticalSection(&Console->Lock);
 }
 
+static VOID
+OnRefresh(PGUI_CONSOLE_DATA GuiData)
+{
+    PCONSRV_CONSOLE Console = GuiData->Console;
+    PCONSOLE_SCREEN_BUFFER Buff;
+
+    KillTimer(GuiData->hWindow, CONGUI_REFRESH_TIMER);
+
+    if (!ConDrvValidateConsoleUnsafe((PCONSOLE)Console, CONSOLE_RUNNING, TRUE))
+    {
+        /* The timer is gone, don't leave it marked as armed */
+        GuiData->RefreshPending = FALSE;
+        return;
+    }
+
+    /* Anything accumulated from now on arms the timer again */
+    GuiData->RefreshPending = FALSE;
+
+    if (GuiData->IsWindowVisible)
+    {
+        FlushDirtyRegion(GuiData);
+
+        Buff = GuiData->ActiveBuffer;
+        if (GetType(Buff) == TEXTMODE_BUFFER)
+            FollowCursor(GuiData, Buff);
+    }
+
+    LeaveCriticalSection(&Console->Lock);
+}
+
 static BOOL
 OnClose(PGUI_CONSOLE_DATA GuiData)
 {
@@ -1429,7 +1479,10 @@ OnNcDestroy(HWND hWnd)
     if (GuiData)
     {
         if (GuiData->IsWindowVisible)
+        {
             KillTimer(hWnd, CONGUI_UPDATE_TIMER);
+            KillTimer(hWnd, CONGUI_REFRESH_TIMER);
+        }
 
         /* Free the terminal framebuffer */
         if (GuiData->hMemDC ) DeleteDC(GuiData->hMemDC);
@@ -1454,6 +1507,9 @@ OnScroll(PGUI_CONSOLE_DATA GuiData, INT nBar, WORD sbCode)
 
     if (!ConDrvValidateConsoleUnsafe((PCONSOLE)Console, CONSOLE_RUNNING, TRUE)) return;
 
+    /* The accumulated updates are relative to the current view origin */
+    FlushDirtyRegion(GuiData);
+
     Buff = GuiData->ActiveBuffer;
 
     if (nBar == SB_HORZ)
@@ -2257,7 +2313,10 @@ ConWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
             break;
 
         case WM_TIMER:
-            OnTimer(GuiData);
+            if (wParam == CONGUI_REFRESH_TIMER)
+                OnRefresh(GuiData);
+            else
+                OnTimer(GuiData);
             break;
 
         case WM_PALETTECHANGED:
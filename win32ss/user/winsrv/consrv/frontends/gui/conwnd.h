@@ -21,6 +21,13 @@
 #define PM_CONSOLE_BEEP         (WM_APP + 4)
 #define PM_CONSOLE_SET_TITLE    (WM_APP + 5)
 
+/*
+ * Frontend repaints are accumulated and flushed at most once
+ * per refresh interval, see DrawRegion and FlushDirtyRegion.
+ */
+#define CONGUI_REFRESH_TIME     16
+#define CONGUI_REFRESH_TIMER    2
+
 /* Flags for GetKeyState */
 #define KEY_TOGGLED 0x0001
 #define KEY_PRESSED 0x8000
@@ -63,6 +70,11 @@ typedef struct _GUI_CONSOLE_DATA
     HBITMAP  hBitmap;           /* Console framebuffer                       */
     HPALETTE hSysPalette;       /* Handle to the original system palette     */
 
+    RECT DirtyRect;             /* Client area waiting to be repainted             */
+    LONG PendingScroll;         /* Pending vertical scroll, in pixels              */
+    LONG ScrollBottom;          /* Bottom of the area the pending scroll applies to */
+    BOOL RefreshPending;        /* TRUE when the refresh timer is armed            */
+
     HICON hIcon;                /* Handle to the console's icon (big)   */
     HICON hIconSm;              /* Handle to the console's icon (small) */
 
@@ -19,10 +19,6 @@
 #include "guiterm.h"
 #include "resource.h"
 
-// HACK!! Remove it when the hack in GuiWriteStream is fixed
-#define CONGUI_UPDATE_TIME    0
-#define CONGUI_UPDATE_TIMER   1
-
 #define PM_CREATE_CONSOLE     (WM_APP + 1)
 #define PM_DESTROY_CONSOLE    (WM_APP + 2)
 
@@ -92,16 +88,97 @@ SmallRectToRect(PGUI_CONSOLE_DATA GuiData, PRECT Rect, PSMALL_RECT SmallRect)
     Rect->bottom = (SmallRect->Bottom + 1 - Buffer->ViewOrigin.Y) * HeightUnit;
 }
 
+static VOID
+ScheduleRefresh(PGUI_CONSOLE_DATA GuiData)
+{
+    /* Arm the refresh timer only once, so that a stream of writes cannot keep pushing it back */
+    if (GuiData->RefreshPending) return;
+
+    GuiData->RefreshPending = TRUE;
+    SetTimer(GuiData->hWindow, CONGUI_REFRESH_TIMER, CONGUI_REFRESH_TIME, NULL);
+}
+
+static VOID
+ScrollRegion(PGUI_CONSOLE_DATA GuiData,
+             LONG Bottom,
+             LONG Lines)
+{
+    LONG Pixels = Lines * GuiData->CharHeight;
+
+    /*
+     * Only the part of the window that stayed inside every scroll area
+     * can be blitted at once; everything below it is repainted on flush.
+     */
+    if (GuiData->PendingScroll == 0)
+        GuiData->ScrollBottom = Bottom;
+    else
+        GuiData->ScrollBottom = min(GuiData->ScrollBottom - Pixels, Bottom);
+    GuiData->PendingScroll += Pixels;
+
+    /* What was already dirty moves up along with the text */
+    if (!IsRectEmpty(&GuiData->DirtyRect))
+        GuiData->DirtyRect.top = max(GuiData->DirtyRect.top - Pixels, 0);
+
+    ScheduleRefresh(GuiData);
+}
+
 static VOID
 DrawRegion(PGUI_CONSOLE_DATA GuiData,
            SMALL_RECT* Region)
 {
     RECT RegionRect;
 
+    /* Accumulate the region, it gets repainted by FlushDirtyRegion */
     SmallRectToRect(GuiData, &RegionRect, Region);
-    /* Do not erase the background: it speeds up redrawing and reduce flickering */
-    InvalidateRect(GuiData->hWindow, &RegionRect, FALSE);
-    /**UpdateWindow(GuiData->hWindow);**/
+    UnionRect(&GuiData->DirtyRect, &GuiData->DirtyRect, &RegionRect);
+    ScheduleRefresh(GuiData);
+}
+
+/*
+ * Apply the accumulated scroll with a single blit and invalidate the
+ * accumulated dirty region. The console lock must be held.
+ */
+VOID
+FlushDirtyRegion(PGUI_CONSOLE_DATA GuiData)
+{
+    RECT ScrollRect;
+
+    if (GuiData->PendingScroll != 0)
+    {
+        GetClientRect(GuiData->hWindow, &ScrollRect);
+
+        /* Everything below the scrolled area is stale */
+        if (GuiData->ScrollBottom < ScrollRect.bottom)
+        {
+            RECT StaleRect = ScrollRect;
+            StaleRect.top = max(GuiData->ScrollBottom, 0);
+            UnionRect(&GuiData->DirtyRect, &GuiData->DirtyRect, &StaleRect);
+        }
+
+        if (GuiData->ScrollBottom > 0)
+        {
+            ScrollRect.right  = GuiData->ActiveBuffer->ViewSize.X * GuiData->CharWidth;
+            ScrollRect.bottom = GuiData->ScrollBottom;
+
+            ScrollWindowEx(GuiData->hWindow,
+                           0,
+                           -GuiData->PendingScroll,
+                           &ScrollRect,
+                           NULL,
+                           NULL,
+                           NULL,
+                           SW_INVALIDATE);
+        }
+
+        GuiData->PendingScroll = 0;
+    }
+
+    if (!IsRectEmpty(&GuiData->DirtyRect))
+    {
+        /* Do not erase the background: it speeds up redrawing and reduce flickering */
+        InvalidateRect(GuiData->hWindow, &GuiData->DirtyRect, FALSE);
+        SetRectEmpty(&GuiData->DirtyRect);
+    }
 }
 
 VOID
@@ -672,7 +749,6 @@ GuiWriteStream(IN OUT PFRONTEND This,
     PGUI_CONSOLE_DATA GuiData = This->Context;
     PCONSOLE_SCREEN_BUFFER Buff;
     SHORT CursorEndX, CursorEndY;
-    RECT ScrollRect;
 
     if (NULL == GuiData || NULL == GuiData->hWindow) return;
 
@@ -684,19 +760,9 @@ GuiWriteStream(IN OUT PFRONTEND This,
 
     if (0 != ScrolledLines)
     {
-        ScrollRect.left = 0;
-        ScrollRect.top = 0;
-        ScrollRect.right = Buff->ViewSize.X * GuiData->CharWidth;
-        ScrollRect.bottom = Region->Top * GuiData->CharHeight;
-
-        ScrollWindowEx(GuiData->hWindow,
-                       0,
-                       -(int)(ScrolledLines * GuiData->CharHeight),
-                       &ScrollRect,
-                       NULL,
-                       NULL,
-                       NULL,
-                       SW_INVALIDATE);
+        ScrollRegion(GuiData,
+                     Region->Top * GuiData->CharHeight,
+                     ScrolledLines);
     }
 
     DrawRegion(GuiData, Region);
@@ -716,11 +782,8 @@ GuiWriteStream(IN OUT PFRONTEND This,
         InvalidateCell(GuiData, CursorEndX, CursorEndY);
     }
 
-    // HACK!!
-    // Set up the update timer (very short interval) - this is a "hack" for getting the OS to
-    // repaint the window without having it just freeze up and stay on the screen permanently.
+    /* Keep the cursor visible while writing; the refresh timer repaints everything */
     Buff->CursorBlinkOn = TRUE;
-    SetTimer(GuiData->hWindow, CONGUI_UPDATE_TIMER, CONGUI_UPDATE_TIME, NULL);
 }
 
 /* static */ VOID NTAPI
@@ -388,7 +388,7 @@ GuiPaintTextModeBuffer(PTEXTMODE_SCREEN_BUFFER Buffer,
 
     for (Line = TopLine; Line <= BottomLine; Line++)
     {
-        WCHAR LineBuffer[80];   // Buffer containing a part or all the line to be displayed
+        WCHAR LineBuffer[256];  // Buffer containing a part or all the line to be displayed
         From  = ConioCoordToPointer(Buffer, LeftChar, Line);    // Get the first code of the line
         Start = LeftChar;
         To    = LineBuffer;